@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 
 namespace MyConfig {
 
@@ -19,6 +20,116 @@ struct DefaultConfig {
 
     // Диапазон измерений
     static constexpr int range = 0;    
+
+    // Минимальный период опроса канала (нс)
+    static constexpr int64_t min_period_ns = 100;
+
+    // Минимальный интервал между пробуждениями потока измерений канала (нс);
+    // при более коротком периоде значения генерируются блоками
+    static constexpr int64_t block_wakeup_interval_ns = 1000000;
+
+    // Максимальное количество значений в одном блоке измерений
+    static constexpr size_t max_block_samples = 65536;
+
+    // Предельная емкость плотной таблицы каналов (ChannelTable)
+    static constexpr size_t channel_table_capacity = 65536;
+
+    // Запас ячеек плотной таблицы сверх начальных каналов под каналы,
+    // создаваемые командой create_channel
+    static constexpr size_t channel_table_reserve = 1024;
+
+    // Окна статистики канала по умолчанию (скользящие и неперекрывающиеся)
+    static constexpr const char* stats_windows = "1s,10s,1m,tumbling:1s,tumbling:1m";
+
+    // Количество корзин в скользящем окне статистики
+    static constexpr size_t stats_window_buckets = 20;
+
+    // Максимальное количество окон статистики (и скетчей квантилей) канала; каждое окно
+    // обновляется каждым значением, поэтому add_stats_window сверх предела отвечает fail
+    static constexpr size_t max_stats_windows = 16;
+
+    // Окна скетчей квантилей канала по умолчанию
+    static constexpr const char* quantile_windows = "1m,10s,tumbling:1m";
+
+    // Количество корзин в скользящем окне скетчей квантилей
+    static constexpr size_t quantile_window_buckets = 10;
+
+    // Параметр точности скетча квантилей (ошибка ранга порядка 1/k)
+    static constexpr size_t quantile_sketch_k = 128;
+
+    // Количество значений в истории канала для осциллограмм
+    static constexpr size_t waveform_history_capacity = 65536;
+
+    // Количество кэшей корзин осциллограмм на канал (по одному на разрешение)
+    static constexpr size_t waveform_cache_entries = 8;
+
+    // Количество min-max кандидатов на точку перед прореживанием LTTB
+    static constexpr size_t waveform_lttb_preselection = 4;
+
+    // Максимальное количество точек осциллограммы в одном ответе
+    static constexpr size_t waveform_max_points = 4096;
+
+    // Каталог дискового хранилища значений каналов (пустая строка - хранилище отключено)
+    static constexpr const char* store_directory = "multimeter_data";
+
+    // Количество значений в блоке хранилища
+    static constexpr size_t store_chunk_samples = 16384;
+
+    // Максимальный возраст открытого блока хранилища (мс); ограничивает потерю данных при сбое
+    static constexpr int store_chunk_max_age_ms = 10000;
+
+    // Интервал выгрузки истории каналов в хранилище (нс): половина времени заполнения
+    // истории канала на минимальном периоде опроса, чтобы история не перезаписывалась
+    // между выгрузками
+    static constexpr int64_t store_flush_interval_ns = static_cast<int64_t>(waveform_history_capacity) * min_period_ns / 2;
+
+    // Профиль имитации сбоев каналов по умолчанию: правила
+    // "<busy|error>:<вероятность начала за секунду>:<длительность>[-<макс. длительность>]"
+    // через запятую (пустая строка или "off" - сбоев нет)
+    static constexpr const char* fault_profile = "busy:0.01:1s-3s,error:0.005:2s-10s";
+
+    // Общее зерно генераторов сбоев (0 - случайное при запуске)
+    static constexpr uint64_t fault_seed = 0;
+
+    // Интервал, с которым имитатор сбоев замечает созданные и удаленные каналы (мс)
+    static constexpr int fault_rescan_interval_ms = 1000;
+
+    // Интервал проверки потоков измерений сторожевым таймером (мс)
+    static constexpr int watchdog_interval_ms = 5;
+
+    // Просрочка прохода потока измерений, после которой его каналы переводятся в error_state (мс)
+    static constexpr int watchdog_stall_threshold_ms = 250;
+
+    // Максимальное количество шагов в ответе на запрос по хранилищу
+    static constexpr size_t query_max_steps = 10000;
+
+    // Путь к Unix-сокету выгрузки метрик в текстовом формате Prometheus (пустая строка - выгрузка отключена)
+    static constexpr const char* metrics_socket_path = "/tmp/multimeter_metrics_socket";
+
+    // Максимальная длина команды в построчном режиме (байт); соединение с более длинной командой закрывается
+    static constexpr size_t max_command_length = 4096;
+
+    // Сколько поток пула после ответа ждет следующей команды того же клиента, прежде чем
+    // вернуть соединение главному циклу (мкс); не ждет, если в пуле есть другие задачи
+    static constexpr int client_linger_us = 2000;
+
+    // Сколько ждать запроса от клиента сокета метрик, прежде чем отдать выгрузку без заголовка HTTP (мс)
+    static constexpr int metrics_request_timeout_ms = 100;
+
+    // Включить трассировку запросов и проходов измерений при запуске
+    static constexpr bool trace_at_start = false;
+
+    // Максимальное количество событий трассировки в буфере одного потока (старые вытесняются)
+    static constexpr size_t trace_buffer_events = 65536;
+
+    // Каталог файлов записи для источника replay: источник открывает только файлы из него
+    static constexpr const char* capture_directory = "multimeter_captures";
+
+    // Каталог выгрузки трассировки: команда trace dump пишет только в него
+    static constexpr const char* trace_directory = "multimeter_traces";
+
+    // Файл выгрузки трассировки по умолчанию (команда trace dump)
+    static constexpr const char* trace_file = "multimeter_trace.json";
 };
 
 } 
@@ -0,0 +1,91 @@
+#include "lock_stats.h"
+
+#include <algorithm>
+
+/**
+ * @brief Учитывает исключительный захват.
+ * @param wait Ожидание захвата (нс).
+ * @param was_contended Мьютекс не удалось захватить сразу.
+ */
+void LockStats::Site::add_exclusive(uint64_t wait, bool was_contended) {
+    acquisitions.fetch_add(1, std::memory_order_relaxed);
+    if (was_contended) {
+        contended.fetch_add(1, std::memory_order_relaxed);
+        wait_ns.fetch_add(wait, std::memory_order_relaxed);
+        uint64_t current = max_wait_ns.load(std::memory_order_relaxed);
+        while (wait > current && !max_wait_ns.compare_exchange_weak(current, wait, std::memory_order_relaxed)) {
+        }
+    }
+}
+
+/**
+ * @brief Учитывает разделяемый захват.
+ * @param wait Ожидание захвата (нс).
+ * @param was_contended Мьютекс не удалось захватить сразу.
+ */
+void LockStats::Site::add_shared(uint64_t wait, bool was_contended) {
+    shared_acquisitions.fetch_add(1, std::memory_order_relaxed);
+    if (was_contended) {
+        shared_contended.fetch_add(1, std::memory_order_relaxed);
+        shared_wait_ns.fetch_add(wait, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Возвращает место блокировки, создавая его при первом обращении.
+ */
+LockStats::Site* LockStats::get_site(const std::string& name) {
+    std::lock_guard<std::mutex> lock(sites_mutex);
+    std::unique_ptr<Site>& site = sites[name];
+    if (!site) {
+        site = std::make_unique<Site>();
+    }
+    return site.get();
+}
+
+/**
+ * @brief Снимок статистики мест, имя которых начинается с prefix.
+ */
+std::vector<LockSiteStats> LockStats::snapshot(const std::string& prefix) {
+    std::vector<LockSiteStats> result;
+    {
+        std::lock_guard<std::mutex> lock(sites_mutex);
+        for (const auto& [name, site] : sites) {
+            if (name.compare(0, prefix.size(), prefix) != 0) {
+                continue;
+            }
+            LockSiteStats stats;
+            stats.name = name;
+            stats.acquisitions = site->acquisitions.load(std::memory_order_relaxed);
+            stats.contended = site->contended.load(std::memory_order_relaxed);
+            stats.wait_ns = site->wait_ns.load(std::memory_order_relaxed);
+            stats.max_wait_ns = site->max_wait_ns.load(std::memory_order_relaxed);
+            stats.hold_ns = site->hold_ns.load(std::memory_order_relaxed);
+            stats.shared_acquisitions = site->shared_acquisitions.load(std::memory_order_relaxed);
+            stats.shared_contended = site->shared_contended.load(std::memory_order_relaxed);
+            stats.shared_wait_ns = site->shared_wait_ns.load(std::memory_order_relaxed);
+            result.push_back(std::move(stats));
+        }
+    }
+    std::stable_sort(result.begin(), result.end(), [](const LockSiteStats& a, const LockSiteStats& b) {
+        return a.wait_ns + a.shared_wait_ns > b.wait_ns + b.shared_wait_ns;
+    });
+    return result;
+}
+
+/**
+ * @brief Обнуляет счетчики всех мест.
+ */
+void LockStats::reset() {
+    std::lock_guard<std::mutex> lock(sites_mutex);
+    for (auto& [name, site] : sites) {
+        site->acquisitions.store(0, std::memory_order_relaxed);
+        site->contended.store(0, std::memory_order_relaxed);
+        site->wait_ns.store(0, std::memory_order_relaxed);
+        site->max_wait_ns.store(0, std::memory_order_relaxed);
+        site->hold_ns.store(0, std::memory_order_relaxed);
+        site->shared_acquisitions.store(0, std::memory_order_relaxed);
+        site->shared_contended.store(0, std::memory_order_relaxed);
+        site->shared_wait_ns.store(0, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,278 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/**
+ * @file lock_stats.h
+ * @brief Мьютексы со статистикой захватов по именованным местам блокировки.
+ *
+ * InstrumentedMutex и InstrumentedSharedMutex заменяют std::mutex и std::shared_mutex
+ * и получают в конструкторе имя места блокировки (например, "task_pool.queue").
+ * Экземпляры с одинаковым именем (мьютексы всех каналов) учитываются вместе.
+ *
+ * Статистика собирается только при сборке с MULTIMETER_LOCK_STATS (опция CMake);
+ * без нее типы - тонкие наследники стандартных мьютексов без накладных расходов.
+ * С условной переменной используются InstrumentedConditionVariable и
+ * InstrumentedUniqueLock: при сборе статистики это condition_variable_any и
+ * unique_lock над InstrumentedMutex, иначе - стандартные типы.
+ */
+
+/**
+ * @struct LockSiteStats
+ * @brief Снимок статистики места блокировки.
+ *
+ * Захват считается конкурентным, если мьютекс не удалось захватить сразу;
+ * ожидание - время от начала захвата до получения мьютекса. Время удержания
+ * учитывается только для исключительных захватов.
+ */
+struct LockSiteStats {
+    std::string name; ///< Имя места блокировки
+    uint64_t acquisitions = 0; ///< Исключительные захваты
+    uint64_t contended = 0; ///< Конкурентные исключительные захваты
+    uint64_t wait_ns = 0; ///< Суммарное ожидание исключительных захватов
+    uint64_t max_wait_ns = 0; ///< Наибольшее ожидание исключительного захвата
+    uint64_t hold_ns = 0; ///< Суммарное удержание исключительных захватов
+    uint64_t shared_acquisitions = 0; ///< Разделяемые захваты
+    uint64_t shared_contended = 0; ///< Конкурентные разделяемые захваты
+    uint64_t shared_wait_ns = 0; ///< Суммарное ожидание разделяемых захватов
+};
+
+/**
+ * @class LockStats
+ * @brief Реестр статистики мест блокировки.
+ */
+class LockStats {
+public:
+    /**
+     * @struct Site
+     * @brief Счетчики места блокировки.
+     *
+     * Места живут до конца процесса, мьютексы хранят указатель на свое место.
+     */
+    struct alignas(64) Site {
+        std::atomic<uint64_t> acquisitions{0}; ///< Исключительные захваты
+        std::atomic<uint64_t> contended{0}; ///< Конкурентные исключительные захваты
+        std::atomic<uint64_t> wait_ns{0}; ///< Суммарное ожидание
+        std::atomic<uint64_t> max_wait_ns{0}; ///< Наибольшее ожидание
+        std::atomic<uint64_t> hold_ns{0}; ///< Суммарное удержание
+        std::atomic<uint64_t> shared_acquisitions{0}; ///< Разделяемые захваты
+        std::atomic<uint64_t> shared_contended{0}; ///< Конкурентные разделяемые захваты
+        std::atomic<uint64_t> shared_wait_ns{0}; ///< Суммарное ожидание разделяемых захватов
+
+        /// Учитывает исключительный захват
+        void add_exclusive(uint64_t wait, bool was_contended);
+
+        /// Учитывает разделяемый захват
+        void add_shared(uint64_t wait, bool was_contended);
+    };
+
+    /**
+     * @brief Получить единственный экземпляр реестра.
+     */
+    static LockStats& get_instance() {
+        static LockStats instance;
+        return instance;
+    }
+
+    /**
+     * @brief Статистика собирается (сборка с MULTIMETER_LOCK_STATS).
+     */
+    static constexpr bool is_enabled() {
+#ifdef MULTIMETER_LOCK_STATS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * @brief Возвращает место блокировки, создавая его при первом обращении.
+     */
+    Site* get_site(const std::string& name);
+
+    /**
+     * @brief Снимок статистики мест, имя которых начинается с prefix.
+     *
+     * Места отсортированы по убыванию суммарного ожидания: первыми идут
+     * блокировки, сильнее всего ограничивающие масштабирование.
+     */
+    std::vector<LockSiteStats> snapshot(const std::string& prefix);
+
+    /**
+     * @brief Обнуляет счетчики всех мест.
+     */
+    void reset();
+
+    /**
+     * @brief Время для измерения ожидания и удержания (нс, steady_clock).
+     */
+    static uint64_t now_ns() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+private:
+    LockStats() = default;
+
+    std::mutex sites_mutex; ///< Мьютекс списка мест
+    std::map<std::string, std::unique_ptr<Site>> sites; ///< Места по имени
+};
+
+#ifdef MULTIMETER_LOCK_STATS
+
+/**
+ * @class InstrumentedMutex
+ * @brief Мьютекс со статистикой захватов.
+ */
+class InstrumentedMutex {
+public:
+    /**
+     * @brief Конструктор.
+     * @param name Имя места блокировки.
+     */
+    explicit InstrumentedMutex(const char* name) : site(LockStats::get_instance().get_site(name)) {}
+
+    InstrumentedMutex(const InstrumentedMutex&) = delete;
+    InstrumentedMutex& operator=(const InstrumentedMutex&) = delete;
+
+    void lock() {
+        if (mutex.try_lock()) {
+            site->add_exclusive(0, false);
+        } else {
+            const uint64_t start = LockStats::now_ns();
+            mutex.lock();
+            site->add_exclusive(LockStats::now_ns() - start, true);
+        }
+        locked_at = LockStats::now_ns();
+    }
+
+    bool try_lock() {
+        if (!mutex.try_lock()) {
+            return false;
+        }
+        site->add_exclusive(0, false);
+        locked_at = LockStats::now_ns();
+        return true;
+    }
+
+    void unlock() {
+        site->hold_ns.fetch_add(LockStats::now_ns() - locked_at, std::memory_order_relaxed);
+        mutex.unlock();
+    }
+
+private:
+    std::mutex mutex; ///< Мьютекс
+    LockStats::Site* site; ///< Место блокировки
+    uint64_t locked_at = 0; ///< Момент захвата (пишет владелец)
+};
+
+/**
+ * @class InstrumentedSharedMutex
+ * @brief Мьютекс чтения-записи со статистикой захватов.
+ */
+class InstrumentedSharedMutex {
+public:
+    /**
+     * @brief Конструктор.
+     * @param name Имя места блокировки.
+     */
+    explicit InstrumentedSharedMutex(const char* name) : site(LockStats::get_instance().get_site(name)) {}
+
+    InstrumentedSharedMutex(const InstrumentedSharedMutex&) = delete;
+    InstrumentedSharedMutex& operator=(const InstrumentedSharedMutex&) = delete;
+
+    void lock() {
+        if (mutex.try_lock()) {
+            site->add_exclusive(0, false);
+        } else {
+            const uint64_t start = LockStats::now_ns();
+            mutex.lock();
+            site->add_exclusive(LockStats::now_ns() - start, true);
+        }
+        locked_at = LockStats::now_ns();
+    }
+
+    bool try_lock() {
+        if (!mutex.try_lock()) {
+            return false;
+        }
+        site->add_exclusive(0, false);
+        locked_at = LockStats::now_ns();
+        return true;
+    }
+
+    void unlock() {
+        site->hold_ns.fetch_add(LockStats::now_ns() - locked_at, std::memory_order_relaxed);
+        mutex.unlock();
+    }
+
+    void lock_shared() {
+        if (mutex.try_lock_shared()) {
+            site->add_shared(0, false);
+        } else {
+            const uint64_t start = LockStats::now_ns();
+            mutex.lock_shared();
+            site->add_shared(LockStats::now_ns() - start, true);
+        }
+    }
+
+    bool try_lock_shared() {
+        if (!mutex.try_lock_shared()) {
+            return false;
+        }
+        site->add_shared(0, false);
+        return true;
+    }
+
+    void unlock_shared() {
+        mutex.unlock_shared();
+    }
+
+private:
+    std::shared_mutex mutex; ///< Мьютекс
+    LockStats::Site* site; ///< Место блокировки
+    uint64_t locked_at = 0; ///< Момент исключительного захвата (пишет владелец)
+};
+
+/// Условная переменная для InstrumentedMutex
+using InstrumentedConditionVariable = std::condition_variable_any;
+
+/// Блокировка InstrumentedMutex для ожидания на условной переменной
+using InstrumentedUniqueLock = std::unique_lock<InstrumentedMutex>;
+
+#else
+
+/**
+ * @class InstrumentedMutex
+ * @brief std::mutex с именем места блокировки (статистика не собирается).
+ */
+class InstrumentedMutex : public std::mutex {
+public:
+    explicit InstrumentedMutex(const char*) {}
+};
+
+/**
+ * @class InstrumentedSharedMutex
+ * @brief std::shared_mutex с именем места блокировки (статистика не собирается).
+ */
+class InstrumentedSharedMutex : public std::shared_mutex {
+public:
+    explicit InstrumentedSharedMutex(const char*) {}
+};
+
+/// Условная переменная для InstrumentedMutex
+using InstrumentedConditionVariable = std::condition_variable;
+
+/// Блокировка InstrumentedMutex для ожидания на условной переменной
+using InstrumentedUniqueLock = std::unique_lock<std::mutex>;
+
+#endif
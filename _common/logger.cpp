@@ -29,7 +29,7 @@ ThreadSafeLogger::~ThreadSafeLogger() {
  * Устанавливает флаг `loggingActive` в false и уведомляет рабочий поток о завершении работы.
  */
 void ThreadSafeLogger::stop_logging() {    
-    std::unique_lock<std::mutex> lock(log_mutex);
+    InstrumentedUniqueLock lock(log_mutex);
     logging_active = false;  // Устанавливаем флаг остановки
     log_cond_var.notify_one();  // Уведомляем рабочий поток
 }
@@ -41,11 +41,21 @@ void ThreadSafeLogger::stop_logging() {
  * @param message Сообщение, которое необходимо залоггировать.
  */
 void ThreadSafeLogger::log_msg(const std::string& message) {                       
-    std::unique_lock<std::mutex> lock(log_mutex);  // Захватываем мьютекс для потока безопасности
+    InstrumentedUniqueLock lock(log_mutex);  // Захватываем мьютекс для потока безопасности
     log_queue.push(message);  // Добавляем сообщение в очередь
     log_cond_var.notify_one();  // Уведомляем рабочий поток, что есть новое сообщение
 }
 
+/**
+ * @brief Возвращает количество сообщений, ожидающих вывода.
+ * 
+ * @return Длина очереди сообщений.
+ */
+size_t ThreadSafeLogger::get_backlog() {
+    InstrumentedUniqueLock lock(log_mutex);
+    return log_queue.size();
+}
+
 /**
  * @brief Рабочий поток, который обрабатывает сообщения из очереди и выводит их в консоль.
  * 
@@ -56,7 +66,7 @@ void ThreadSafeLogger::log_worker() {
     while (true) {        
         std::string message;
         {
-            std::unique_lock<std::mutex> lock(log_mutex);  // Захватываем мьютекс для безопасности доступа
+            InstrumentedUniqueLock lock(log_mutex);  // Захватываем мьютекс для безопасности доступа
             log_cond_var.wait(lock, [this] { return !logging_active || !log_queue.empty(); });  // Ожидаем новые сообщения
 
             if (!logging_active && log_queue.empty()) {
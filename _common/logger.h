@@ -7,6 +7,7 @@
 #include <queue>
 #include <atomic>
 #include <memory>
+#include "lock_stats.h"
 
 /**
  * @class ThreadSafeLogger
@@ -57,6 +58,12 @@ public:
      */
     void log_msg(const std::string& message);
 
+    /**
+     * @brief Возвращает количество сообщений, ожидающих вывода.
+     * @return Длина очереди сообщений.
+     */
+    size_t get_backlog();
+
 private:
     /**
      * @brief Рабочий поток, который обрабатывает сообщения из очереди и выводит их в консоль.
@@ -66,8 +73,8 @@ private:
      */
     void log_worker();    
 
-    std::mutex log_mutex; ///< Мьютекс для синхронизации доступа к очереди сообщений
-    std::condition_variable log_cond_var; ///< Условная переменная для уведомления потока о новых сообщениях
+    InstrumentedMutex log_mutex{"logger.queue"}; ///< Мьютекс для синхронизации доступа к очереди сообщений
+    InstrumentedConditionVariable log_cond_var; ///< Условная переменная для уведомления потока о новых сообщениях
     std::queue<std::string> log_queue; ///< Очередь сообщений для логгирования
     std::atomic<bool> logging_active; ///< Флаг, показывающий активность логгирования
     std::thread log_thread; ///< Поток, обрабатывающий логгирование
@@ -3,6 +3,11 @@
 #include <sstream>
 #include <iomanip>
 #include <random>
+#include <chrono>
+#include <stdexcept>
+#include <atomic>
+#include <limits>
+#include <cmath>
 
 namespace MyTools {
 
@@ -35,8 +40,7 @@ std::string float_to_string(float num, int precision) {
  */
 float generate_random_value(float min_value, float max_value) {
     // Создаем генератор случайных чисел на основе случайного устройства
-    std::random_device rd;
-    std::mt19937 gen(rd());  // Инициализируем генератор случайных чисел с помощью случайного устройства
+    std::mt19937 gen(static_cast<uint32_t>(make_seed()));  // Инициализируем генератор случайных чисел
 
     // Создаем равномерное распределение для чисел с плавающей запятой
     std::uniform_real_distribution<float> dist(min_value, max_value);
@@ -45,4 +49,239 @@ float generate_random_value(float min_value, float max_value) {
     return dist(gen);
 }
 
+namespace {
+
+std::atomic<bool> virtual_time_enabled{false}; ///< Включено виртуальное время
+std::atomic<int64_t> virtual_time{0}; ///< Виртуальное время (нс от эпохи)
+std::atomic<uint64_t> seed_base{0}; ///< База детерминированных зерен (0 - случайные зерна)
+std::atomic<uint64_t> seed_counter{0}; ///< Номер очередного детерминированного зерна
+
+} // namespace
+
+/**
+ * @brief Возвращает текущее время в наносекундах от начала эпохи Unix.
+ * 
+ * @return Время в наносекундах.
+ */
+int64_t now_ns() {
+    if (virtual_time_enabled.load(std::memory_order_relaxed)) {
+        return virtual_time.load(std::memory_order_relaxed);
+    }
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Возвращает время монотонных часов (steady_clock) в наносекундах.
+ * 
+ * @return Время в наносекундах.
+ */
+int64_t monotonic_ns() {
+    if (virtual_time_enabled.load(std::memory_order_relaxed)) {
+        return virtual_time.load(std::memory_order_relaxed);
+    }
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Включает виртуальное время и устанавливает его.
+ * 
+ * @param time_ns Время в наносекундах от эпохи.
+ */
+void set_virtual_time(int64_t time_ns) {
+    virtual_time.store(time_ns, std::memory_order_relaxed);
+    virtual_time_enabled.store(true, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Сдвигает виртуальное время вперед.
+ * 
+ * @param delta_ns Сдвиг в наносекундах.
+ */
+void advance_virtual_time(int64_t delta_ns) {
+    virtual_time.fetch_add(delta_ns, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Проверяет, включено ли виртуальное время.
+ */
+bool is_virtual_time() {
+    return virtual_time_enabled.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Задает базу детерминированных зерен генераторов.
+ * 
+ * @param seed База зерен; 0 - случайные зерна.
+ */
+void set_seed_base(uint64_t seed) {
+    seed_base.store(seed, std::memory_order_relaxed);
+    seed_counter.store(0, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Возвращает зерно для нового генератора случайных чисел.
+ * 
+ * Детерминированные зерна - результат перемешивания splitmix64 базы и номера
+ * вызова, поэтому соседние зерна не коррелируют.
+ */
+uint64_t make_seed() {
+    const uint64_t base = seed_base.load(std::memory_order_relaxed);
+    if (base == 0) {
+        return (static_cast<uint64_t>(std::random_device{}()) << 32) | std::random_device{}();
+    }
+    uint64_t z = base + (seed_counter.fetch_add(1, std::memory_order_relaxed) + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+namespace {
+
+/**
+ * @brief Единицы длительности в порядке убывания.
+ */
+struct DurationUnit {
+    const char* suffix;
+    int64_t ns;
+};
+
+constexpr DurationUnit duration_units[] = {
+    {"h", 3600000000000LL},
+    {"m", 60000000000LL},
+    {"s", 1000000000LL},
+    {"ms", 1000000LL},
+    {"us", 1000LL},
+    {"ns", 1LL}
+};
+
+}
+
+/**
+ * @brief Разбирает строку длительности в наносекунды.
+ * 
+ * @param text Строка длительности.
+ * @return Длительность в наносекундах.
+ * @throws std::invalid_argument Если строка некорректна или длительность не положительна.
+ */
+int64_t parse_duration_ns(const std::string& text) {
+    size_t pos = 0;
+    long long number = 0;
+    try {
+        number = std::stoll(text, &pos);
+    } catch (const std::exception&) {
+        throw std::invalid_argument("Invalid duration: " + text);
+    }
+
+    const std::string suffix = text.substr(pos);
+    int64_t unit_ns = 1000000LL; // Без суффикса - миллисекунды
+    if (!suffix.empty()) {
+        unit_ns = 0;
+        for (const auto& unit : duration_units) {
+            if (suffix == unit.suffix) {
+                unit_ns = unit.ns;
+                break;
+            }
+        }
+    }
+
+    if (unit_ns == 0 || number <= 0) {
+        throw std::invalid_argument("Invalid duration: " + text);
+    }
+    // Произведение не должно переполнить int64_t
+    if (number > std::numeric_limits<int64_t>::max() / unit_ns) {
+        throw std::invalid_argument("Duration is too long: " + text);
+    }
+    return static_cast<int64_t>(number) * unit_ns;
+}
+
+/**
+ * @brief Форматирует длительность в наиболее крупных целых единицах.
+ * 
+ * @param duration_ns Длительность в наносекундах.
+ * @return Строка длительности.
+ */
+std::string format_duration(int64_t duration_ns) {
+    for (const auto& unit : duration_units) {
+        if (duration_ns % unit.ns == 0) {
+            return std::to_string(duration_ns / unit.ns) + unit.suffix;
+        }
+    }
+    return std::to_string(duration_ns) + "ns";
+}
+
+/**
+ * @brief Разбирает частоту дискретизации в герцы.
+ * 
+ * @param text Строка частоты.
+ * @return Частота в герцах.
+ * @throws std::invalid_argument Если строка некорректна, частота не положительна или не конечна.
+ */
+double parse_rate_hz(const std::string& text) {
+    size_t pos = 0;
+    double number = 0.0;
+    try {
+        number = std::stod(text, &pos);
+    } catch (const std::exception&) {
+        throw std::invalid_argument("Invalid rate: " + text);
+    }
+
+    const std::string suffix = text.substr(pos);
+    double unit = 0.0;
+    if (suffix.empty() || suffix == "Hz") {
+        unit = 1.0;
+    } else if (suffix == "kHz") {
+        unit = 1e3;
+    } else if (suffix == "MHz") {
+        unit = 1e6;
+    }
+
+    if (unit == 0.0 || !(number > 0.0) || !std::isfinite(number * unit)) {
+        throw std::invalid_argument("Invalid rate: " + text);
+    }
+    return number * unit;
+}
+
+/**
+ * @brief Разбирает момент времени в наносекунды.
+ * 
+ * @param text "now", "-<длительность>" или абсолютное время (нс).
+ * @param now_ns Текущее время (нс).
+ * @return Время в наносекундах от эпохи.
+ * @throws std::invalid_argument Если строка некорректна.
+ */
+int64_t parse_time_ns(const std::string& text, int64_t now_ns) {
+    if (text == "now") {
+        return now_ns;
+    }
+    if (!text.empty() && text[0] == '-') {
+        return now_ns - parse_duration_ns(text.substr(1));
+    }
+    size_t pos = 0;
+    long long timestamp = 0;
+    try {
+        timestamp = std::stoll(text, &pos);
+    } catch (const std::exception&) {
+        throw std::invalid_argument("Invalid time: " + text);
+    }
+    if (pos != text.size() || timestamp < 0) {
+        throw std::invalid_argument("Invalid time: " + text);
+    }
+    return static_cast<int64_t>(timestamp);
+}
+
+/**
+ * @brief Проверяет, что строка - имя файла без пути.
+ * 
+ * @param name Имя файла.
+ * @throws std::invalid_argument Если имя пустое или содержит путь.
+ */
+void check_file_name(const std::string& name) {
+    if (name.empty() || name == "." || name.find('/') != std::string::npos ||
+        name.find("..") != std::string::npos || name.find('\0') != std::string::npos) {
+        throw std::invalid_argument("Invalid file name: " + name);
+    }
+}
+
 }
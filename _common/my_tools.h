@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <cstdint>
 
 namespace MyTools {
 
@@ -28,4 +29,126 @@ std::string float_to_string(float num, int precision);
  */
 float generate_random_value(float min_value, float max_value);
 
+/**
+ * @brief Возвращает текущее время в наносекундах от начала эпохи Unix.
+ * 
+ * Используется как временная метка измеренных значений. В режиме виртуального
+ * времени (set_virtual_time) возвращает виртуальное время.
+ * 
+ * @return Время в наносекундах.
+ */
+int64_t now_ns();
+
+/**
+ * @brief Возвращает время монотонных часов (steady_clock) в наносекундах.
+ * 
+ * Используется для расписаний и сроков: в отличие от now_ns() не прыгает при
+ * переводе системных часов. Начало отсчета не определено, поэтому значение
+ * не годится как временная метка. В режиме виртуального времени возвращает
+ * виртуальное время, как и now_ns().
+ * 
+ * @return Время в наносекундах.
+ */
+int64_t monotonic_ns();
+
+/**
+ * @brief Включает виртуальное время и устанавливает его.
+ * 
+ * После вызова now_ns() и monotonic_ns() возвращают заданное время, пока его не сдвинет
+ * advance_virtual_time(). Используется для имитации: часы идут так быстро,
+ * как позволяет процессор, а результат не зависит от реального времени.
+ * 
+ * @param time_ns Время в наносекундах от эпохи.
+ */
+void set_virtual_time(int64_t time_ns);
+
+/**
+ * @brief Сдвигает виртуальное время вперед.
+ * 
+ * @param delta_ns Сдвиг в наносекундах.
+ */
+void advance_virtual_time(int64_t delta_ns);
+
+/**
+ * @brief Проверяет, включено ли виртуальное время.
+ */
+bool is_virtual_time();
+
+/**
+ * @brief Задает базу детерминированных зерен генераторов.
+ * 
+ * После вызова make_seed() возвращает последовательность зерен, полностью
+ * определяемую базой и порядком вызовов; 0 возвращает случайные зерна.
+ * 
+ * @param seed База зерен.
+ */
+void set_seed_base(uint64_t seed);
+
+/**
+ * @brief Возвращает зерно для нового генератора случайных чисел.
+ * 
+ * @return Случайное зерно (std::random_device) или очередное зерно
+ * детерминированной последовательности, если задана база set_seed_base().
+ */
+uint64_t make_seed();
+
+/**
+ * @brief Разбирает строку длительности в наносекунды.
+ * 
+ * Поддерживаются суффиксы ns, us, ms, s, m, h (например, "500ms", "10s", "1h").
+ * Число без суффикса считается миллисекундами.
+ * 
+ * @param text Строка длительности.
+ * @return Длительность в наносекундах.
+ * @throws std::invalid_argument Если строка некорректна, длительность не положительна или не помещается в int64_t.
+ */
+int64_t parse_duration_ns(const std::string& text);
+
+/**
+ * @brief Форматирует длительность в наиболее крупных целых единицах.
+ * 
+ * Обратная функция к parse_duration_ns: 10000000000 -> "10s", 90000000000 -> "90s".
+ * 
+ * @param duration_ns Длительность в наносекундах.
+ * @return Строка длительности.
+ */
+std::string format_duration(int64_t duration_ns);
+
+/**
+ * @brief Разбирает частоту дискретизации в герцы.
+ * 
+ * Поддерживаются суффиксы Hz, kHz, MHz (например, "500Hz", "10kHz", "1MHz").
+ * Число без суффикса считается герцами.
+ * 
+ * @param text Строка частоты.
+ * @return Частота в герцах.
+ * @throws std::invalid_argument Если строка некорректна или частота не положительна.
+ */
+double parse_rate_hz(const std::string& text);
+
+/**
+ * @brief Разбирает момент времени в наносекунды.
+ * 
+ * Поддерживаются "now", смещение назад от текущего момента ("-10s", "-500ms")
+ * и абсолютное время в наносекундах от эпохи ("1700000000000000000").
+ * 
+ * @param text Строка момента времени.
+ * @param now_ns Текущее время (нс).
+ * @return Время в наносекундах от эпохи.
+ * @throws std::invalid_argument Если строка некорректна.
+ */
+int64_t parse_time_ns(const std::string& text, int64_t now_ns);
+
+/**
+ * @brief Проверяет, что строка - имя файла без пути.
+ * 
+ * Имена файлов из команд клиентов дописываются к каталогу из конфигурации,
+ * поэтому пустые имена, имена с '/' и с ".." отвергаются: иначе клиент мог бы
+ * выйти за пределы каталога.
+ * 
+ * @param name Имя файла.
+ * @throws std::invalid_argument Если имя пустое или содержит путь.
+ */
+void check_file_name(const std::string& name);
+
 }
@@ -0,0 +1,316 @@
+#include "async_client.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+/**
+ * @brief Конструктор.
+ * @param socket_path Путь к сокету сервера.
+ */
+AsyncClient::AsyncClient(const std::string& socket_path)
+    : socket_path(socket_path) {}
+
+/**
+ * @brief Деструктор: закрывает соединение.
+ */
+AsyncClient::~AsyncClient() {
+    close();
+}
+
+/**
+ * @brief Подключается к серверу и запускает поток ввода-вывода.
+ * @throws std::runtime_error Если подключиться не удалось.
+ * @throws std::logic_error Если клиент уже подключался.
+ */
+void AsyncClient::connect() {
+    if (client_socket != -1 || io_thread.joinable()) {
+        throw std::logic_error("client is already connected");
+    }
+    if (socket_path.size() >= sizeof(sockaddr_un::sun_path)) {
+        throw std::runtime_error("socket path is too long: " + socket_path);
+    }
+
+    client_socket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (client_socket == -1) {
+        throw std::runtime_error(std::string("socket: ") + std::strerror(errno));
+    }
+    struct sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strcpy(addr.sun_path, socket_path.c_str());
+    if (::connect(client_socket, (struct sockaddr*)&addr, sizeof(addr)) == -1) {
+        const std::string error = "connect to " + socket_path + ": " + std::strerror(errno);
+        ::close(client_socket);
+        client_socket = -1;
+        throw std::runtime_error(error);
+    }
+
+    wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (wake_fd == -1) {
+        const std::string error = std::string("eventfd: ") + std::strerror(errno);
+        ::close(client_socket);
+        client_socket = -1;
+        throw std::runtime_error(error);
+    }
+
+    connected.store(true);
+    io_thread = std::thread(&AsyncClient::io_loop, this);
+}
+
+/**
+ * @brief Закрывает соединение и останавливает поток ввода-вывода.
+ */
+void AsyncClient::close() {
+    if (io_thread.joinable()) {
+        stopping.store(true);
+        wake();
+        io_thread.join();
+    }
+    if (client_socket != -1) {
+        ::close(client_socket);
+        client_socket = -1;
+    }
+    if (wake_fd != -1) {
+        ::close(wake_fd);
+        wake_fd = -1;
+    }
+}
+
+/**
+ * @brief Отправляет команду.
+ * @param command Команда без перевода строки.
+ * @return Будущий ответ.
+ * @throws std::invalid_argument Если команда содержит перевод строки.
+ */
+std::future<std::string> AsyncClient::send(const std::string& command) {
+    Request request;
+    std::future<std::string> response = request.promise.get_future();
+    if (!enqueue(command, request)) {
+        complete(request, false, "not connected");
+    }
+    return response;
+}
+
+/**
+ * @brief Отправляет команду с обратным вызовом.
+ * @param command Команда без перевода строки.
+ * @param callback Вызывается с ответом или ошибкой.
+ * @throws std::invalid_argument Если команда содержит перевод строки.
+ */
+void AsyncClient::send(const std::string& command, Callback callback) {
+    Request request;
+    request.callback = std::move(callback);
+    if (!enqueue(command, request)) {
+        complete(request, false, "not connected");
+    }
+}
+
+/**
+ * @brief Отправляет команду с обратным вызовом, если соединение есть.
+ * @param command Команда без перевода строки.
+ * @param callback Вызывается с ответом или ошибкой.
+ * @return false, если соединения нет.
+ * @throws std::invalid_argument Если команда содержит перевод строки.
+ */
+bool AsyncClient::try_send(const std::string& command, Callback callback) {
+    Request request;
+    request.callback = std::move(callback);
+    return enqueue(command, request);
+}
+
+/**
+ * @brief Соединение установлено и не разорвано.
+ */
+bool AsyncClient::is_connected() const {
+    return connected.load();
+}
+
+/**
+ * @brief Количество команд, ответ на которые еще не получен.
+ */
+size_t AsyncClient::get_in_flight() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return in_flight.size();
+}
+
+/**
+ * @brief Ставит команду в очередь отправки.
+ *
+ * Поток ввода-вывода будится только первой командой после его прошлого обращения
+ * к очереди: остальные уйдут той же записью.
+ */
+bool AsyncClient::enqueue(const std::string& command, Request& request) {
+    if (command.find('\n') != std::string::npos) {
+        throw std::invalid_argument("command must not contain a line break");
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!connected.load()) {
+        return false;
+    }
+    const bool was_empty = outgoing.empty();
+    outgoing += command;
+    outgoing += '\n';
+    in_flight.push_back(std::move(request));
+    if (was_empty) {
+        wake();
+    }
+    return true;
+}
+
+/**
+ * @brief Цикл потока ввода-вывода.
+ *
+ * Забирает накопившиеся команды из очереди, пишет их в сокет без блокировки
+ * (недописанный остаток - при готовности сокета) и сопоставляет прочитанные
+ * ответы с ожидающими запросами по порядку.
+ */
+void AsyncClient::io_loop() {
+    std::string write_buffer;
+    size_t written = 0;
+    std::string partial; // Начало незавершенного ответа
+    std::vector<char> buffer(65536);
+    std::vector<Request> done;
+    std::vector<std::string> responses;
+    std::string error = "connection closed";
+
+    while (!stopping.load()) {
+        struct pollfd fds[2];
+        fds[0] = {client_socket, static_cast<short>(POLLIN | (written < write_buffer.size() ? POLLOUT : 0)), 0};
+        fds[1] = {wake_fd, POLLIN, 0};
+        if (poll(fds, 2, -1) == -1) {
+            if (errno == EINTR) continue;
+            error = std::string("poll: ") + std::strerror(errno);
+            break;
+        }
+
+        // Счетчик пробуждений сбрасывается до чтения очереди, иначе команда,
+        // поставленная между чтением очереди и сбросом, осталась бы без пробуждения
+        if (fds[1].revents & POLLIN) {
+            uint64_t value;
+            while (read(wake_fd, &value, sizeof(value)) == -1 && errno == EINTR) {
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!outgoing.empty()) {
+                if (written == write_buffer.size()) {
+                    write_buffer.swap(outgoing);
+                    written = 0;
+                } else {
+                    write_buffer += outgoing;
+                }
+                outgoing.clear();
+            }
+        }
+
+        bool failed = false;
+        while (written < write_buffer.size()) {
+            const ssize_t n = ::send(client_socket, write_buffer.data() + written, write_buffer.size() - written,
+                                     MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (n > 0) {
+                written += static_cast<size_t>(n);
+            } else if (n == -1 && errno == EINTR) {
+                continue;
+            } else if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            } else {
+                error = std::string("send: ") + std::strerror(errno);
+                failed = true;
+                break;
+            }
+        }
+        if (failed) break;
+
+        if (fds[0].revents & (POLLIN | POLLHUP | POLLERR)) {
+            const ssize_t n = recv(client_socket, buffer.data(), buffer.size(), MSG_DONTWAIT);
+            if (n == 0) {
+                error = "connection closed by server";
+                break;
+            }
+            if (n == -1) {
+                if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) continue;
+                error = std::string("recv: ") + std::strerror(errno);
+                break;
+            }
+
+            // Ответы разделены '\n' и идут в порядке команд
+            partial.append(buffer.data(), static_cast<size_t>(n));
+            size_t start = 0;
+            size_t end;
+            while ((end = partial.find('\n', start)) != std::string::npos) {
+                responses.push_back(partial.substr(start, end - start));
+                start = end + 1;
+            }
+            partial.erase(0, start);
+            if (responses.empty()) continue;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (responses.size() > in_flight.size()) {
+                    failed = true;
+                } else {
+                    for (size_t i = 0; i != responses.size(); ++i) {
+                        done.push_back(std::move(in_flight.front()));
+                        in_flight.pop_front();
+                    }
+                }
+            }
+            if (failed) {
+                error = "unexpected response from server";
+                break;
+            }
+            for (size_t i = 0; i != done.size(); ++i) {
+                complete(done[i], true, responses[i]);
+            }
+            done.clear();
+            responses.clear();
+        }
+    }
+
+    fail_all(error);
+}
+
+/**
+ * @brief Завершает запрос ответом или ошибкой.
+ */
+void AsyncClient::complete(Request& request, bool ok, const std::string& response) {
+    if (request.callback) {
+        request.callback(ok, response);
+    } else if (ok) {
+        request.promise.set_value(response);
+    } else {
+        request.promise.set_exception(std::make_exception_ptr(std::runtime_error(response)));
+    }
+}
+
+/**
+ * @brief Завершает ошибкой все ожидающие запросы и запрещает новые.
+ */
+void AsyncClient::fail_all(const std::string& reason) {
+    std::deque<Request> failed;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        connected.store(false);
+        failed.swap(in_flight);
+        outgoing.clear();
+    }
+    for (Request& request : failed) {
+        complete(request, false, reason);
+    }
+}
+
+/**
+ * @brief Будит поток ввода-вывода.
+ */
+void AsyncClient::wake() {
+    const uint64_t value = 1;
+    while (write(wake_fd, &value, sizeof(value)) == -1 && errno == EINTR) {
+    }
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/**
+ * @class AsyncClient
+ * @brief Асинхронный клиент сервера с конвейерной отправкой команд.
+ *
+ * Команды отправляются построчно ('\n' в конце), поэтому в одном соединении может
+ * выполняться сколько угодно команд одновременно: сервер отвечает в порядке команд,
+ * и ответы сопоставляются с запросами по порядку. Сокет обслуживает фоновый поток
+ * ввода-вывода: команды, поставленные в очередь с момента прошлой записи, уходят
+ * одной записью, ответы читаются большими блоками.
+ *
+ * Методы отправки потокобезопасны. Обратные вызовы выполняются в потоке
+ * ввода-вывода: они должны быть короткими и не должны ждать ответов этого клиента.
+ * При разрыве соединения все ожидающие запросы завершаются ошибкой.
+ */
+class AsyncClient {
+public:
+    /**
+     * @brief Обратный вызов с результатом команды.
+     *
+     * ok - ответ получен (response - ответ сервера), иначе response - описание ошибки.
+     * Не должен бросать исключений.
+     */
+    using Callback = std::function<void(bool ok, const std::string& response)>;
+
+    /**
+     * @brief Конструктор.
+     * @param socket_path Путь к сокету сервера.
+     */
+    explicit AsyncClient(const std::string& socket_path);
+
+    /**
+     * @brief Деструктор: закрывает соединение, ожидающие запросы завершаются ошибкой.
+     */
+    ~AsyncClient();
+
+    AsyncClient(const AsyncClient&) = delete;
+    AsyncClient& operator=(const AsyncClient&) = delete;
+
+    /**
+     * @brief Подключается к серверу и запускает поток ввода-вывода.
+     * @throws std::runtime_error Если подключиться не удалось.
+     * @throws std::logic_error Если клиент уже подключался.
+     */
+    void connect();
+
+    /**
+     * @brief Закрывает соединение и останавливает поток ввода-вывода.
+     *
+     * Ожидающие запросы завершаются ошибкой.
+     */
+    void close();
+
+    /**
+     * @brief Отправляет команду.
+     * @param command Команда без перевода строки.
+     * @return Будущий ответ; при разрыве соединения - исключение std::runtime_error.
+     * @throws std::invalid_argument Если команда содержит перевод строки.
+     */
+    std::future<std::string> send(const std::string& command);
+
+    /**
+     * @brief Отправляет команду с обратным вызовом.
+     * @param command Команда без перевода строки.
+     * @param callback Вызывается в потоке ввода-вывода с ответом или ошибкой
+     *                 (сразу в вызывающем потоке, если соединения нет).
+     * @throws std::invalid_argument Если команда содержит перевод строки.
+     */
+    void send(const std::string& command, Callback callback);
+
+    /**
+     * @brief Отправляет команду с обратным вызовом, если соединение есть.
+     * @param command Команда без перевода строки.
+     * @param callback Вызывается в потоке ввода-вывода с ответом или ошибкой.
+     * @return false, если соединения нет (команда не отправлена, callback не вызывается).
+     * @throws std::invalid_argument Если команда содержит перевод строки.
+     */
+    bool try_send(const std::string& command, Callback callback);
+
+    /**
+     * @brief Соединение установлено и не разорвано.
+     */
+    bool is_connected() const;
+
+    /**
+     * @brief Количество команд, ответ на которые еще не получен.
+     */
+    size_t get_in_flight() const;
+
+private:
+    /**
+     * @struct Request
+     * @brief Ожидающий ответа запрос: либо обещание, либо обратный вызов.
+     */
+    struct Request {
+        std::promise<std::string> promise; ///< Обещание ответа (если нет обратного вызова)
+        Callback callback; ///< Обратный вызов
+    };
+
+    /**
+     * @brief Ставит команду в очередь отправки.
+     * @return false, если соединения нет (запрос не перемещается).
+     */
+    bool enqueue(const std::string& command, Request& request);
+
+    /**
+     * @brief Цикл потока ввода-вывода.
+     */
+    void io_loop();
+
+    /**
+     * @brief Завершает запрос ответом или ошибкой.
+     */
+    static void complete(Request& request, bool ok, const std::string& response);
+
+    /**
+     * @brief Завершает ошибкой все ожидающие запросы и запрещает новые.
+     */
+    void fail_all(const std::string& reason);
+
+    /**
+     * @brief Будит поток ввода-вывода.
+     */
+    void wake();
+
+    std::string socket_path; ///< Путь к сокету сервера
+    int client_socket = -1; ///< Дескриптор сокета
+    int wake_fd = -1; ///< eventfd для пробуждения потока ввода-вывода
+    std::thread io_thread; ///< Поток ввода-вывода
+
+    mutable std::mutex mutex; ///< Защищает очередь отправки и ожидающие запросы
+    std::string outgoing; ///< Команды, еще не переданные потоку ввода-вывода
+    std::deque<Request> in_flight; ///< Ожидающие запросы в порядке отправки
+    std::atomic<bool> connected{false}; ///< Соединение установлено и не разорвано
+    std::atomic<bool> stopping{false}; ///< Запрошена остановка потока ввода-вывода
+};
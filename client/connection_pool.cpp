@@ -0,0 +1,414 @@
+#include "connection_pool.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+/// Период цикла обслуживания (мс): точность пауз переподключения и сроков ожидания
+constexpr int maintenance_interval_ms = 10;
+
+constexpr int64_t ns_per_ms = 1000000;
+
+/**
+ * @brief Время (нс, steady_clock).
+ */
+int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+/**
+ * @brief Конструктор.
+ * @param socket_path Путь к сокету сервера.
+ * @param options Параметры пула.
+ * @throws std::invalid_argument Если размер пула нулевой.
+ */
+ConnectionPool::ConnectionPool(const std::string& socket_path, ConnectionPoolOptions options)
+    : socket_path(socket_path), options(options), jitter(std::random_device{}()) {
+    if (options.size == 0) {
+        throw std::invalid_argument("connection pool size must be positive");
+    }
+    for (size_t i = 0; i != options.size; ++i) {
+        slots.push_back(std::make_unique<Slot>());
+    }
+}
+
+/**
+ * @brief Деструктор: останавливает пул.
+ */
+ConnectionPool::~ConnectionPool() {
+    stop();
+}
+
+/**
+ * @brief Открывает соединения и запускает поток обслуживания.
+ * @return Количество открытых соединений.
+ * @throws std::logic_error Если пул уже запущен.
+ */
+size_t ConnectionPool::start() {
+    if (maintenance_thread.joinable() || stopping.load()) {
+        throw std::logic_error("connection pool is already started");
+    }
+    const int64_t now = now_ns();
+    size_t opened = 0;
+    for (auto& slot : slots) {
+        if (connect_slot(*slot, now)) {
+            ++opened;
+        }
+    }
+    flush_waiting();
+    maintenance_thread = std::thread(&ConnectionPool::maintenance_loop, this);
+    return opened;
+}
+
+/**
+ * @brief Останавливает пул.
+ *
+ * Запросы в закрываемых соединениях не повторяются и завершаются ошибкой.
+ */
+void ConnectionPool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping.store(true);
+    }
+    wake_cond.notify_all();
+    if (maintenance_thread.joinable()) {
+        maintenance_thread.join();
+    }
+
+    for (auto& slot : slots) {
+        std::shared_ptr<AsyncClient> client;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            client.swap(slot->client);
+        }
+        if (client) {
+            client->close();
+        }
+    }
+
+    std::deque<RequestPtr> pending;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.swap(waiting);
+    }
+    for (const RequestPtr& request : pending) {
+        complete(*request, false, "connection pool is stopped");
+    }
+}
+
+/**
+ * @brief Отправляет команду.
+ * @param command Команда без перевода строки.
+ * @return Будущий ответ.
+ * @throws std::invalid_argument Если команда содержит перевод строки.
+ */
+std::future<std::string> ConnectionPool::send(const std::string& command) {
+    if (command.find('\n') != std::string::npos) {
+        throw std::invalid_argument("command must not contain a line break");
+    }
+    auto request = std::make_shared<Request>();
+    request->command = command;
+    request->idempotent = is_idempotent(command);
+    std::future<std::string> response = request->promise.get_future();
+    dispatch(request);
+    return response;
+}
+
+/**
+ * @brief Отправляет команду с обратным вызовом.
+ * @param command Команда без перевода строки.
+ * @param callback Вызывается с ответом или ошибкой.
+ * @throws std::invalid_argument Если команда содержит перевод строки.
+ */
+void ConnectionPool::send(const std::string& command, AsyncClient::Callback callback) {
+    if (command.find('\n') != std::string::npos) {
+        throw std::invalid_argument("command must not contain a line break");
+    }
+    auto request = std::make_shared<Request>();
+    request->command = command;
+    request->idempotent = is_idempotent(command);
+    request->callback = std::move(callback);
+    dispatch(request);
+}
+
+/**
+ * @brief Возвращает счетчики пула.
+ */
+ConnectionPoolStats ConnectionPool::get_stats() const {
+    ConnectionPoolStats stats;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& slot : slots) {
+            if (slot->client && slot->client->is_connected()) {
+                ++stats.connected;
+            }
+        }
+        stats.waiting = waiting.size();
+    }
+    stats.reconnects = reconnects.load();
+    stats.reissued = reissued.load();
+    stats.failed_pings = failed_pings.load();
+    stats.timed_out = timed_out.load();
+    return stats;
+}
+
+/**
+ * @brief Проверяет, можно ли безопасно повторить команду.
+ * @param command Команда.
+ * @return true, если повтор команды не меняет состояние сервера.
+ */
+bool ConnectionPool::is_idempotent(const std::string& command) {
+    const size_t space = command.find(' ');
+    const std::string name = command.substr(0, space);
+    if (name != "query" && name != "ping" && name.compare(0, 4, "get_") != 0) {
+        return false;
+    }
+    if (space == std::string::npos) {
+        return true;
+    }
+
+    // Выгрузка с параметром reset (get_lock_stats <prefix>, reset) сбрасывает счетчики
+    std::stringstream params(command.substr(space + 1));
+    std::string param;
+    while (std::getline(params, param, ',')) {
+        param.erase(param.begin(), std::find_if(param.begin(), param.end(), [](unsigned char ch) { return !std::isspace(ch); }));
+        param.erase(std::find_if(param.rbegin(), param.rend(), [](unsigned char ch) { return !std::isspace(ch); }).base(), param.end());
+        if (param == "reset") {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Отправляет запрос в наименее загруженное соединение или ставит в ожидание.
+ *
+ * Загрузка соединения - количество команд без ответа. Если соединение закрылось
+ * между выбором и отправкой, команда в него не попала и выбирается другое.
+ */
+void ConnectionPool::dispatch(const RequestPtr& request) {
+    std::vector<std::shared_ptr<AsyncClient>> clients;
+    while (true) {
+        clients.clear();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!stopping.load()) {
+                for (const auto& slot : slots) {
+                    if (slot->client && slot->client->is_connected()) {
+                        clients.push_back(slot->client);
+                    }
+                }
+                if (clients.empty()) {
+                    if (request->deadline_ns == 0) {
+                        request->deadline_ns = now_ns() + static_cast<int64_t>(options.queue_timeout_ms) * ns_per_ms;
+                    }
+                    waiting.push_back(request);
+                    return;
+                }
+            }
+        }
+        if (clients.empty()) {
+            complete(*request, false, "connection pool is stopped");
+            return;
+        }
+
+        std::shared_ptr<AsyncClient> best;
+        size_t best_load = std::numeric_limits<size_t>::max();
+        for (const auto& client : clients) {
+            const size_t load = client->get_in_flight();
+            if (load < best_load) {
+                best_load = load;
+                best = client;
+            }
+        }
+
+        ++request->attempts;
+        if (best->try_send(request->command, [this, request](bool ok, const std::string& response) {
+                on_response(request, ok, response);
+            })) {
+            return;
+        }
+        --request->attempts;
+    }
+}
+
+/**
+ * @brief Обрабатывает ответ или разрыв соединения.
+ *
+ * При разрыве неизвестно, выполнил ли сервер команду, поэтому повторяются
+ * только идемпотентные запросы и не больше max_attempts раз. Повтор отправляет
+ * поток обслуживания на следующем проходе.
+ */
+void ConnectionPool::on_response(const RequestPtr& request, bool ok, const std::string& response) {
+    if (ok) {
+        complete(*request, true, response);
+        return;
+    }
+    if (request->idempotent && request->attempts < options.max_attempts) {
+        // Повтор - через очередь ожидания: при перезапуске сервера рвутся все соединения,
+        // и немедленный повтор потратил бы попытки на еще не замеченные разрывы
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!stopping.load()) {
+            ++reissued;
+            request->deadline_ns = now_ns() + static_cast<int64_t>(options.queue_timeout_ms) * ns_per_ms;
+            waiting.push_back(request);
+            return;
+        }
+    }
+    complete(*request, false, response);
+}
+
+/**
+ * @brief Завершает запрос ответом или ошибкой.
+ */
+void ConnectionPool::complete(Request& request, bool ok, const std::string& response) {
+    if (request.callback) {
+        request.callback(ok, response);
+    } else if (ok) {
+        request.promise.set_value(response);
+    } else {
+        request.promise.set_exception(std::make_exception_ptr(std::runtime_error(response)));
+    }
+}
+
+/**
+ * @brief Цикл потока обслуживания.
+ *
+ * Соединение без ответа на ping дольше ping_timeout_ms (или с чужим ответом)
+ * закрывается: его запросы повторяются в других соединениях, а само оно
+ * переподключается. Закрытое сервером соединение переподключается сразу,
+ * а после неудачной попытки - с растущей паузой.
+ */
+void ConnectionPool::maintenance_loop() {
+    const int64_t ping_interval_ns = static_cast<int64_t>(options.ping_interval_ms) * ns_per_ms;
+    const int64_t ping_timeout_ns = static_cast<int64_t>(options.ping_timeout_ms) * ns_per_ms;
+
+    while (!stopping.load()) {
+        const int64_t now = now_ns();
+        size_t connected = 0;
+        for (auto& slot_ptr : slots) {
+            Slot& slot = *slot_ptr;
+            std::shared_ptr<AsyncClient> client;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                client = slot.client;
+            }
+
+            if (client && client->is_connected()) {
+                const int64_t ping_sent = slot.ping_sent_ns.load();
+                if (slot.broken.load() || (ping_sent != 0 && now - ping_sent > ping_timeout_ns)) {
+                    ++failed_pings;
+                } else {
+                    if (ping_sent == 0 && now - slot.last_ping_ns >= ping_interval_ns) {
+                        const std::string token = std::to_string(++ping_sequence);
+                        slot.last_ping_ns = now;
+                        slot.ping_sent_ns.store(now);
+                        Slot* target = &slot;
+                        const bool sent = client->try_send("ping " + token, [target, token](bool ok, const std::string& response) {
+                            if (ok && response == "ok, " + token) {
+                                target->ping_sent_ns.store(0);
+                            } else if (ok) {
+                                target->broken.store(true);
+                            }
+                        });
+                        if (!sent) {
+                            slot.ping_sent_ns.store(0);
+                        }
+                    }
+                    ++connected;
+                    continue;
+                }
+            }
+
+            // Соединение закрыто сервером или не прошло проверку: закрываем без
+            // удержания мьютекса пула (обратные вызовы закрываемого соединения его берут)
+            if (client) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    slot.client.reset();
+                }
+                client->close();
+                slot.next_attempt_ns = now;
+            }
+            if (now >= slot.next_attempt_ns && connect_slot(slot, now)) {
+                ++connected;
+            }
+        }
+        if (connected != 0) {
+            flush_waiting();
+        }
+
+        // Запросы, не дождавшиеся соединения
+        std::vector<RequestPtr> expired;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto keep = std::stable_partition(waiting.begin(), waiting.end(),
+                                              [now](const RequestPtr& request) { return request->deadline_ns > now; });
+            expired.assign(keep, waiting.end());
+            waiting.erase(keep, waiting.end());
+        }
+        for (const RequestPtr& request : expired) {
+            ++timed_out;
+            complete(*request, false, "no connection to server");
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        wake_cond.wait_for(lock, std::chrono::milliseconds(maintenance_interval_ms), [this] { return stopping.load(); });
+    }
+}
+
+/**
+ * @brief Подключает соединение пула, при неудаче откладывает следующую попытку.
+ *
+ * Пауза удваивается после каждой неудачи (до reconnect_max_backoff_ms) и
+ * выбирается случайно из [пауза/2, пауза].
+ *
+ * @return true, если соединение открыто.
+ */
+bool ConnectionPool::connect_slot(Slot& slot, int64_t now) {
+    auto client = std::make_shared<AsyncClient>(socket_path);
+    try {
+        client->connect();
+    } catch (const std::exception&) {
+        const int64_t min_backoff = static_cast<int64_t>(options.reconnect_min_backoff_ms) * ns_per_ms;
+        const int64_t max_backoff = static_cast<int64_t>(options.reconnect_max_backoff_ms) * ns_per_ms;
+        slot.backoff_ns = slot.backoff_ns == 0 ? min_backoff : std::min(slot.backoff_ns * 2, max_backoff);
+        std::uniform_int_distribution<int64_t> delay(slot.backoff_ns / 2, slot.backoff_ns);
+        slot.next_attempt_ns = now + delay(jitter);
+        return false;
+    }
+
+    if (slot.connected_before) {
+        ++reconnects;
+    }
+    slot.connected_before = true;
+    slot.backoff_ns = 0;
+    slot.last_ping_ns = now;
+    slot.ping_sent_ns.store(0);
+    slot.broken.store(false);
+    std::lock_guard<std::mutex> lock(mutex);
+    slot.client = std::move(client);
+    return true;
+}
+
+/**
+ * @brief Отправляет ожидающие запросы в открытые соединения.
+ */
+void ConnectionPool::flush_waiting() {
+    std::deque<RequestPtr> pending;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.swap(waiting);
+    }
+    for (const RequestPtr& request : pending) {
+        dispatch(request);
+    }
+}
@@ -0,0 +1,212 @@
+#pragma once
+
+#include "async_client.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @struct ConnectionPoolOptions
+ * @brief Параметры пула соединений.
+ *
+ * Сервер не закрепляет поток за соединением, поэтому соединений может быть больше,
+ * чем потоков сервера (по умолчанию у сервера их 3), но параллельно команды
+ * выполняются не более чем в стольких потоках: size больше числа потоков сервера
+ * не ускоряет обработку.
+ */
+struct ConnectionPoolOptions {
+    size_t size = 2; ///< Количество соединений (не больше числа потоков сервера)
+    int ping_interval_ms = 1000; ///< Период проверки соединения командой ping
+    int ping_timeout_ms = 3000; ///< Срок ответа на ping, после которого соединение переоткрывается
+    int reconnect_min_backoff_ms = 50; ///< Начальная пауза между попытками подключения
+    int reconnect_max_backoff_ms = 5000; ///< Максимальная пауза между попытками подключения
+    int queue_timeout_ms = 10000; ///< Сколько запрос ждет соединения, прежде чем завершиться ошибкой
+    int max_attempts = 3; ///< Попыток выполнения идемпотентного запроса при разрывах соединения
+};
+
+/**
+ * @struct ConnectionPoolStats
+ * @brief Счетчики пула соединений.
+ */
+struct ConnectionPoolStats {
+    size_t connected = 0; ///< Открытых соединений
+    size_t waiting = 0; ///< Запросов, ожидающих соединения
+    uint64_t reconnects = 0; ///< Успешных переподключений
+    uint64_t reissued = 0; ///< Повторно отправленных идемпотентных запросов
+    uint64_t failed_pings = 0; ///< Соединений, закрытых из-за ping без ответа или с чужим ответом
+    uint64_t timed_out = 0; ///< Запросов, не дождавшихся соединения
+};
+
+/**
+ * @class ConnectionPool
+ * @brief Пул асинхронных соединений с сервером.
+ *
+ * Запросы многих потоков распределяются по нескольким соединениям AsyncClient:
+ * каждый уходит в соединение с наименьшим числом ожидающих ответа команд.
+ * Фоновый поток обслуживания проверяет соединения командой ping, закрывает
+ * соединения без ответа и переподключается к серверу с экспоненциальной паузой
+ * (со случайным разбросом, чтобы клиенты не подключались к перезапущенному
+ * серверу одновременно).
+ *
+ * При разрыве соединения идемпотентные запросы (чтение: get_*, query, ping;
+ * кроме выгрузки со сбросом счетчиков) отправляются повторно через другое
+ * соединение, остальные завершаются ошибкой: неизвестно, выполнил ли их сервер.
+ * Пока открытых соединений нет, запросы ждут переподключения не дольше
+ * queue_timeout_ms.
+ */
+class ConnectionPool {
+public:
+    /**
+     * @brief Конструктор.
+     * @param socket_path Путь к сокету сервера.
+     * @param options Параметры пула.
+     * @throws std::invalid_argument Если размер пула нулевой.
+     */
+    explicit ConnectionPool(const std::string& socket_path, ConnectionPoolOptions options = {});
+
+    /**
+     * @brief Деструктор: останавливает пул.
+     */
+    ~ConnectionPool();
+
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+    /**
+     * @brief Открывает соединения и запускает поток обслуживания.
+     *
+     * Недоступный сервер не считается ошибкой: соединения откроются, когда он появится.
+     * Запросы, отправленные до запуска, ждут его.
+     *
+     * @return Количество открытых соединений.
+     * @throws std::logic_error Если пул уже запускался.
+     */
+    size_t start();
+
+    /**
+     * @brief Останавливает пул: закрывает соединения, ожидающие запросы завершаются ошибкой.
+     */
+    void stop();
+
+    /**
+     * @brief Отправляет команду.
+     * @param command Команда без перевода строки.
+     * @return Будущий ответ; при ошибке - исключение std::runtime_error.
+     * @throws std::invalid_argument Если команда содержит перевод строки.
+     */
+    std::future<std::string> send(const std::string& command);
+
+    /**
+     * @brief Отправляет команду с обратным вызовом.
+     *
+     * Обратный вызов выполняется в потоке ввода-вывода соединения или в потоке
+     * обслуживания и должен быть коротким.
+     *
+     * @param command Команда без перевода строки.
+     * @param callback Вызывается с ответом или ошибкой.
+     * @throws std::invalid_argument Если команда содержит перевод строки.
+     */
+    void send(const std::string& command, AsyncClient::Callback callback);
+
+    /**
+     * @brief Возвращает счетчики пула.
+     */
+    ConnectionPoolStats get_stats() const;
+
+    /**
+     * @brief Проверяет, можно ли безопасно повторить команду.
+     *
+     * Повторять можно чтение: get_*, query и ping; выгрузку со сбросом
+     * счетчиков (параметр reset) - нельзя.
+     *
+     * @param command Команда.
+     * @return true, если повтор команды не меняет состояние сервера.
+     */
+    static bool is_idempotent(const std::string& command);
+
+private:
+    /**
+     * @struct Request
+     * @brief Запрос пула: команда, попытки и получатель ответа.
+     */
+    struct Request {
+        std::string command; ///< Команда
+        bool idempotent = false; ///< Команду можно повторить
+        int attempts = 0; ///< Отправок в соединения
+        int64_t deadline_ns = 0; ///< Срок ожидания соединения (0 - не ждет)
+        std::promise<std::string> promise; ///< Обещание ответа (если нет обратного вызова)
+        AsyncClient::Callback callback; ///< Обратный вызов
+    };
+    using RequestPtr = std::shared_ptr<Request>;
+
+    /**
+     * @struct Slot
+     * @brief Соединение пула и состояние его переподключения и проверки.
+     */
+    struct Slot {
+        std::shared_ptr<AsyncClient> client; ///< Соединение (пусто - не открыто)
+        int64_t next_attempt_ns = 0; ///< Время следующей попытки подключения
+        int64_t backoff_ns = 0; ///< Текущая пауза между попытками
+        int64_t last_ping_ns = 0; ///< Время отправки последнего ping
+        std::atomic<int64_t> ping_sent_ns{0}; ///< Время отправки ping без ответа (0 - ответ получен)
+        std::atomic<bool> broken{false}; ///< Ответ на ping не совпал с запросом
+        bool connected_before = false; ///< Соединение уже открывалось (следующее - переподключение)
+    };
+
+    /**
+     * @brief Отправляет запрос в наименее загруженное соединение или ставит в ожидание.
+     */
+    void dispatch(const RequestPtr& request);
+
+    /**
+     * @brief Обрабатывает ответ или разрыв соединения.
+     */
+    void on_response(const RequestPtr& request, bool ok, const std::string& response);
+
+    /**
+     * @brief Завершает запрос ответом или ошибкой.
+     */
+    static void complete(Request& request, bool ok, const std::string& response);
+
+    /**
+     * @brief Цикл потока обслуживания: переподключение, ping, сроки ожидания.
+     */
+    void maintenance_loop();
+
+    /**
+     * @brief Подключает соединение пула, при неудаче откладывает следующую попытку.
+     * @return true, если соединение открыто.
+     */
+    bool connect_slot(Slot& slot, int64_t now);
+
+    /**
+     * @brief Отправляет ожидающие запросы в открытые соединения.
+     */
+    void flush_waiting();
+
+    std::string socket_path; ///< Путь к сокету сервера
+    ConnectionPoolOptions options; ///< Параметры пула
+    std::vector<std::unique_ptr<Slot>> slots; ///< Соединения пула
+
+    mutable std::mutex mutex; ///< Защищает соединения слотов и очередь ожидания
+    std::condition_variable wake_cond; ///< Будит поток обслуживания
+    std::deque<RequestPtr> waiting; ///< Запросы, ожидающие соединения
+    std::thread maintenance_thread; ///< Поток обслуживания
+    std::atomic<bool> stopping{false}; ///< Пул останавливается
+    std::mt19937_64 jitter; ///< Разброс пауз переподключения (только поток обслуживания)
+    uint64_t ping_sequence = 0; ///< Токен следующего ping (только поток обслуживания)
+
+    std::atomic<uint64_t> reconnects{0}; ///< Счетчик переподключений
+    std::atomic<uint64_t> reissued{0}; ///< Счетчик повторных отправок
+    std::atomic<uint64_t> failed_pings{0}; ///< Счетчик неудачных проверок
+    std::atomic<uint64_t> timed_out{0}; ///< Счетчик запросов без соединения
+};
@@ -0,0 +1,570 @@
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <errno.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * @file load_generator.cpp
+ * @brief Генератор нагрузки с открытым циклом.
+ *
+ * Запросы планируются на фиксированной частоте независимо от того, успевает ли
+ * сервер отвечать (открытый цикл). Запрос, для которого нет свободного соединения,
+ * ждет в очереди, и его задержка считается от запланированного момента отправки,
+ * а не от фактического: так учитывается ожидание, которое закрытый цикл прячет
+ * (coordinated omission). Для сравнения печатается и время обслуживания - от
+ * фактической отправки до ответа.
+ *
+ * get_result запрашивается с временем измерения значения, и генератор печатает
+ * свежесть - возраст значения в момент получения ответа (часы system_clock
+ * клиента минус время измерения на сервере; сервер и клиент на одной машине).
+ *
+ * Генератор пользуется протоколом без разделителей сообщений, поэтому в каждом
+ * соединении одновременно выполняется не больше одного запроса (конвейерную отправку
+ * построчных команд реализует AsyncClient). Сервер не закрепляет поток пула за
+ * соединением (простаивающие соединения ждет его главный цикл), поэтому соединений
+ * может быть больше, чем потоков пула, но команды одновременно выполняются не более
+ * чем в стольких потоках: лишние соединения лишь переносят очередь с клиента на сервер.
+ *
+ * Результат печатается строками `key=value`, которые удобно сравнивать между запусками.
+ */
+
+namespace {
+
+/**
+ * @brief Время (нс, steady_clock).
+ */
+int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Время (нс от эпохи, system_clock) - в шкале времени измерения значений сервера.
+ */
+int64_t wall_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @class LatencyHistogram
+ * @brief Гистограмма задержек с лог-линейными корзинами.
+ *
+ * Каждая степень двойки делится на 32 корзины (погрешность не больше 1/32),
+ * поэтому память не зависит от количества запросов.
+ */
+class LatencyHistogram {
+public:
+    static constexpr int sub_bucket_bits = 5; ///< log2 количества корзин на степень двойки
+    static constexpr uint64_t sub_bucket_count = uint64_t{1} << sub_bucket_bits; ///< Корзин на степень двойки
+    static constexpr int max_magnitude = 42; ///< Старший учитываемый бит значения
+
+    LatencyHistogram() : buckets((max_magnitude - sub_bucket_bits + 2) * sub_bucket_count) {}
+
+    /**
+     * @brief Добавляет значение (нс).
+     */
+    void record(int64_t value_ns) {
+        const uint64_t v = value_ns > 0 ? static_cast<uint64_t>(value_ns) : 0;
+        ++buckets[bucket_of(v)];
+        ++count;
+        max_value = std::max(max_value, v);
+    }
+
+    /**
+     * @brief Оценка квантиля сверху (нс).
+     * @param q Уровень квантиля [0, 1].
+     */
+    uint64_t quantile(double q) const {
+        if (count == 0) {
+            return 0;
+        }
+        const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * static_cast<double>(count))));
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i != buckets.size(); ++i) {
+            cumulative += buckets[i];
+            if (cumulative >= rank) {
+                return std::min(bucket_upper(i) - 1, max_value);
+            }
+        }
+        return max_value;
+    }
+
+    uint64_t get_count() const { return count; }
+    uint64_t get_max() const { return max_value; }
+
+private:
+    size_t bucket_of(uint64_t value) const {
+        if (value < sub_bucket_count) {
+            return static_cast<size_t>(value);
+        }
+        const int magnitude = std::min(63 - __builtin_clzll(value), max_magnitude);
+        const int shift = magnitude - sub_bucket_bits;
+        const uint64_t sub = std::min((value >> shift) - sub_bucket_count, sub_bucket_count - 1);
+        return static_cast<size_t>(shift + 1) * sub_bucket_count + static_cast<size_t>(sub);
+    }
+
+    static uint64_t bucket_upper(size_t bucket) {
+        if (bucket < sub_bucket_count) {
+            return bucket + 1;
+        }
+        const size_t shift = bucket / sub_bucket_count - 1;
+        return (sub_bucket_count + bucket % sub_bucket_count + 1) << shift;
+    }
+
+    std::vector<uint64_t> buckets; ///< Количество значений по корзинам
+    uint64_t count = 0; ///< Количество значений
+    uint64_t max_value = 0; ///< Максимальное значение
+};
+
+/**
+ * @struct CommandKind
+ * @brief Вид команды в смеси нагрузки.
+ */
+struct CommandKind {
+    std::string name; ///< Имя команды (get_result, get_status, set_range)
+    unsigned weight = 0; ///< Доля в смеси
+    LatencyHistogram latency; ///< Задержка от запланированной отправки
+    LatencyHistogram service; ///< Время обслуживания от фактической отправки
+    uint64_t failed = 0; ///< Ответы "fail" и ошибки соединения
+};
+
+/**
+ * @struct Options
+ * @brief Параметры запуска.
+ */
+struct Options {
+    std::string socket_path = "/tmp/multimeter_socket"; ///< Путь к сокету сервера
+    double rate = 1000; ///< Целевая частота запросов (в секунду)
+    double duration_s = 10; ///< Длительность измерения (с)
+    double warmup_s = 1; ///< Длительность прогрева, не попадающего в результат (с)
+    size_t connections = 2; ///< Количество соединений
+    std::string mix = "get_result:80,get_status:15,set_range:5"; ///< Смесь команд
+    std::vector<std::string> channels = {"channel0"}; ///< Каналы
+    uint64_t seed = 1; ///< Зерно выбора команд и каналов
+};
+
+/**
+ * @struct Request
+ * @brief Запланированный запрос.
+ */
+struct Request {
+    int64_t intended_ns; ///< Запланированный момент отправки
+    bool measured; ///< Запрос после прогрева
+};
+
+/**
+ * @struct Connection
+ * @brief Соединение с сервером.
+ */
+struct Connection {
+    int fd = -1; ///< Дескриптор сокета
+    bool busy = false; ///< Выполняется запрос
+    Request request{}; ///< Выполняемый запрос
+    int64_t sent_ns = 0; ///< Фактический момент отправки
+    size_t kind = 0; ///< Вид выполняемой команды
+};
+
+/**
+ * @brief Разбивает строку по разделителю.
+ */
+std::vector<std::string> split(const std::string& text, char delimiter) {
+    std::vector<std::string> parts;
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t end = text.find(delimiter, start);
+        if (end == std::string::npos) end = text.size();
+        if (end > start) parts.push_back(text.substr(start, end - start));
+        start = end + 1;
+    }
+    return parts;
+}
+
+/**
+ * @brief Разбирает смесь команд "<имя>:<доля>,...".
+ * @throws std::invalid_argument Если смесь некорректна.
+ */
+std::vector<CommandKind> parse_mix(const std::string& mix) {
+    std::vector<CommandKind> kinds;
+    for (const std::string& item : split(mix, ',')) {
+        const size_t colon = item.find(':');
+        CommandKind kind;
+        kind.name = item.substr(0, colon);
+        if (kind.name != "get_result" && kind.name != "get_status" && kind.name != "set_range") {
+            throw std::invalid_argument("unsupported command in mix: " + kind.name);
+        }
+        kind.weight = colon == std::string::npos ? 1 : static_cast<unsigned>(std::stoul(item.substr(colon + 1)));
+        if (kind.weight) kinds.push_back(std::move(kind));
+    }
+    if (kinds.empty()) {
+        throw std::invalid_argument("empty command mix");
+    }
+    return kinds;
+}
+
+/**
+ * @brief Разбирает аргументы командной строки вида --key=value.
+ * @throws std::invalid_argument Если аргумент неизвестен или некорректен.
+ */
+Options parse_options(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const size_t eq = arg.find('=');
+        if (arg.compare(0, 2, "--") != 0 || eq == std::string::npos) {
+            throw std::invalid_argument("bad argument: " + arg);
+        }
+        const std::string key = arg.substr(2, eq - 2);
+        const std::string value = arg.substr(eq + 1);
+        if (key == "socket") options.socket_path = value;
+        else if (key == "rate") options.rate = std::stod(value);
+        else if (key == "duration") options.duration_s = std::stod(value);
+        else if (key == "warmup") options.warmup_s = std::stod(value);
+        else if (key == "connections") options.connections = std::stoul(value);
+        else if (key == "mix") options.mix = value;
+        else if (key == "channels") options.channels = split(value, ',');
+        else if (key == "seed") options.seed = std::stoull(value);
+        else throw std::invalid_argument("unknown option: " + key);
+    }
+    if (options.rate <= 0 || options.duration_s <= 0 || options.warmup_s < 0 || options.connections == 0 ||
+        options.channels.empty()) {
+        throw std::invalid_argument("rate, duration and connections must be positive, channels must not be empty");
+    }
+    return options;
+}
+
+/**
+ * @brief Подключается к серверу.
+ * @return Дескриптор сокета или -1.
+ */
+int connect_to_server(const std::string& socket_path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1) {
+        return -1;
+    }
+    struct sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == -1) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Отправляет команду и ждет ответа (для подготовки перед запуском).
+ */
+std::string call(int fd, const std::string& command) {
+    if (send(fd, command.c_str(), command.size(), MSG_NOSIGNAL) <= 0) {
+        return "";
+    }
+    char buffer[4096];
+    ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+    return n > 0 ? std::string(buffer, static_cast<size_t>(n)) : "";
+}
+
+/**
+ * @brief Печатает строку результата по гистограмме.
+ */
+void print_latency(const char* metric, const std::string& command, const LatencyHistogram& histogram) {
+    auto us = [](uint64_t ns) { return static_cast<double>(ns) / 1000.0; };
+    std::printf("%s command=%s count=%llu p50_us=%.1f p99_us=%.1f p999_us=%.1f max_us=%.1f\n", metric, command.c_str(),
+                static_cast<unsigned long long>(histogram.get_count()), us(histogram.quantile(0.5)),
+                us(histogram.quantile(0.99)), us(histogram.quantile(0.999)), us(histogram.get_max()));
+}
+
+/**
+ * @class LoadGenerator
+ * @brief Открытый цикл нагрузки по нескольким соединениям.
+ */
+class LoadGenerator {
+public:
+    LoadGenerator(Options options, std::vector<CommandKind> kinds)
+        : options(std::move(options)), kinds(std::move(kinds)), random(this->options.seed) {
+        for (const CommandKind& kind : this->kinds) {
+            total_weight += kind.weight;
+        }
+    }
+
+    ~LoadGenerator() {
+        for (Connection& connection : connections) {
+            if (connection.fd != -1) close(connection.fd);
+        }
+    }
+
+    /**
+     * @brief Открывает соединения и запускает измерения на каналах.
+     * @throws std::runtime_error Если подключиться не удалось.
+     */
+    void prepare() {
+        for (size_t i = 0; i != options.connections; ++i) {
+            Connection connection;
+            connection.fd = connect_to_server(options.socket_path);
+            if (connection.fd == -1) {
+                throw std::runtime_error("cannot connect to " + options.socket_path + ": " + std::strerror(errno));
+            }
+            connections.push_back(connection);
+            ++alive;
+        }
+        // get_result отвечает значением только в режиме измерения
+        for (const std::string& channel : options.channels) {
+            call(connections[0].fd, "start_measure " + channel);
+        }
+        for (Connection& connection : connections) {
+            fcntl(connection.fd, F_SETFL, fcntl(connection.fd, F_GETFL, 0) | O_NONBLOCK);
+        }
+    }
+
+    /**
+     * @brief Выполняет прогрев и измерение и печатает результат.
+     */
+    void run() {
+        const int64_t interval_ns = static_cast<int64_t>(1e9 / options.rate);
+        const int64_t start_ns = now_ns();
+        const int64_t measure_ns = start_ns + static_cast<int64_t>(options.warmup_s * 1e9);
+        const int64_t end_ns = measure_ns + static_cast<int64_t>(options.duration_s * 1e9);
+        measure_start_ns = measure_ns;
+        // После конца расписания ждем ответов на уже отправленные запросы
+        const int64_t drain_deadline_ns = end_ns + 5000000000LL;
+
+        uint64_t scheduled = 0;
+        std::vector<struct pollfd> fds(connections.size());
+
+        for (;;) {
+            const int64_t now = now_ns();
+
+            // Планируем все запросы, срок которых наступил
+            int64_t next_ns = start_ns + static_cast<int64_t>(scheduled) * interval_ns;
+            while (next_ns <= now && next_ns < end_ns) {
+                pending.push_back({next_ns, next_ns >= measure_ns});
+                measured_scheduled += next_ns >= measure_ns;
+                ++scheduled;
+                next_ns = start_ns + static_cast<int64_t>(scheduled) * interval_ns;
+            }
+
+            dispatch(now);
+
+            size_t busy = 0;
+            for (size_t i = 0; i != connections.size(); ++i) {
+                fds[i] = {connections[i].fd, static_cast<short>(connections[i].busy ? POLLIN : 0), 0};
+                busy += connections[i].busy;
+            }
+            const bool schedule_done = next_ns >= end_ns;
+            if (schedule_done && (busy == 0 || now >= drain_deadline_ns)) {
+                break;
+            }
+            if (alive == 0) {
+                std::fprintf(stderr, "all connections are closed by the server\n");
+                break;
+            }
+
+            // Спим до следующего запланированного запроса или ответа
+            const int64_t wait_ns = schedule_done ? drain_deadline_ns - now : std::max<int64_t>(0, next_ns - now);
+            struct timespec timeout = {static_cast<time_t>(wait_ns / 1000000000), static_cast<long>(wait_ns % 1000000000)};
+            if (ppoll(fds.data(), fds.size(), &timeout, nullptr) > 0) {
+                const int64_t received = now_ns();
+                for (size_t i = 0; i != connections.size(); ++i) {
+                    if (fds[i].revents) {
+                        receive(connections[i], received);
+                    }
+                }
+            }
+        }
+
+        report();
+    }
+
+private:
+    /**
+     * @brief Отправляет ожидающие запросы в свободные соединения.
+     */
+    void dispatch(int64_t now) {
+        for (Connection& connection : connections) {
+            if (pending.empty()) {
+                return;
+            }
+            if (connection.busy || connection.fd == -1) {
+                continue;
+            }
+            const Request request = pending.front();
+            pending.pop_front();
+
+            const size_t kind = choose_kind();
+            const std::string command = make_command(kind);
+            connection.busy = true;
+            connection.request = request;
+            connection.kind = kind;
+            connection.sent_ns = now;
+            if (send(connection.fd, command.c_str(), command.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(command.size())) {
+                fail_connection(connection);
+            }
+        }
+    }
+
+    /**
+     * @brief Принимает ответ на запрос соединения.
+     */
+    void receive(Connection& connection, int64_t received_ns) {
+        char buffer[65536];
+        const ssize_t n = recv(connection.fd, buffer, sizeof(buffer), 0);
+        if (n == -1 && (errno == EAGAIN || errno == EINTR)) {
+            return;
+        }
+        if (n <= 0) {
+            fail_connection(connection);
+            return;
+        }
+        CommandKind& kind = kinds[connection.kind];
+        if (connection.request.measured) {
+            kind.latency.record(received_ns - connection.request.intended_ns);
+            kind.service.record(received_ns - connection.sent_ns);
+            all_latency.record(received_ns - connection.request.intended_ns);
+            all_service.record(received_ns - connection.sent_ns);
+            ++completed;
+            last_received_ns = received_ns;
+            if (n >= 4 && std::strncmp(buffer, "fail", 4) == 0) {
+                ++kind.failed;
+            } else if (kind.name == "get_result") {
+                record_freshness(buffer, static_cast<size_t>(n));
+            }
+        }
+        connection.busy = false;
+    }
+
+    /**
+     * @brief Учитывает возраст значения из ответа "ok, <value>, <time_ns>".
+     */
+    void record_freshness(const char* response, size_t size) {
+        const std::string text(response, size);
+        const size_t comma = text.rfind(", ");
+        if (comma == std::string::npos || comma < 3) {
+            return;
+        }
+        const int64_t sample_ns = std::strtoll(text.c_str() + comma + 2, nullptr, 10);
+        if (sample_ns > 0) {
+            freshness.record(wall_now_ns() - sample_ns);
+        }
+    }
+
+    /**
+     * @brief Закрывает соединение после ошибки; выполняемый запрос считается неудачным.
+     */
+    void fail_connection(Connection& connection) {
+        if (connection.busy && connection.request.measured) {
+            ++kinds[connection.kind].failed;
+        }
+        close(connection.fd);
+        connection.fd = -1;
+        connection.busy = false;
+        --alive;
+    }
+
+    /**
+     * @brief Выбирает вид команды по весам смеси.
+     */
+    size_t choose_kind() {
+        unsigned r = std::uniform_int_distribution<unsigned>(0, total_weight - 1)(random);
+        for (size_t i = 0; i != kinds.size(); ++i) {
+            if (r < kinds[i].weight) return i;
+            r -= kinds[i].weight;
+        }
+        return kinds.size() - 1;
+    }
+
+    /**
+     * @brief Строит строку команды со случайным каналом.
+     */
+    std::string make_command(size_t kind) {
+        const std::string& channel =
+            options.channels[std::uniform_int_distribution<size_t>(0, options.channels.size() - 1)(random)];
+        if (kinds[kind].name == "set_range") {
+            return "set_range " + channel + ", " + std::to_string(std::uniform_int_distribution<int>(0, 3)(random));
+        }
+        if (kinds[kind].name == "get_result") {
+            return "get_result " + channel + ", time";
+        }
+        return kinds[kind].name + " " + channel;
+    }
+
+    /**
+     * @brief Печатает результат.
+     */
+    void report() {
+        uint64_t failed = 0;
+        for (const CommandKind& kind : kinds) {
+            failed += kind.failed;
+        }
+
+        std::printf("load socket=%s rate=%.1f duration_s=%.1f warmup_s=%.1f connections=%zu mix=%s\n",
+                    options.socket_path.c_str(), options.rate, options.duration_s, options.warmup_s,
+                    options.connections, options.mix.c_str());
+        // Пропускная способность - по фактическому времени ответов: при перегрузке
+        // ответы на запланированные запросы приходят и после конца расписания
+        const double elapsed_s = completed ? static_cast<double>(last_received_ns - measure_start_ns) / 1e9 : options.duration_s;
+        std::printf("result scheduled=%llu completed=%llu failed=%llu unanswered=%llu throughput=%.1f\n",
+                    static_cast<unsigned long long>(measured_scheduled), static_cast<unsigned long long>(completed),
+                    static_cast<unsigned long long>(failed),
+                    static_cast<unsigned long long>(measured_scheduled > completed ? measured_scheduled - completed : 0),
+                    static_cast<double>(completed) / std::max(elapsed_s, options.duration_s));
+        print_latency("latency", "all", all_latency);
+        for (const CommandKind& kind : kinds) {
+            print_latency("latency", kind.name, kind.latency);
+        }
+        print_latency("service", "all", all_service);
+        if (freshness.get_count()) {
+            print_latency("freshness", "get_result", freshness);
+        }
+    }
+
+    Options options; ///< Параметры запуска
+    std::vector<CommandKind> kinds; ///< Смесь команд
+    unsigned total_weight = 0; ///< Сумма весов смеси
+    std::mt19937_64 random; ///< Выбор команд и каналов
+    std::vector<Connection> connections; ///< Соединения
+    size_t alive = 0; ///< Открытые соединения
+    std::deque<Request> pending; ///< Запросы, ждущие свободного соединения
+    LatencyHistogram all_latency; ///< Задержка всех запросов от запланированной отправки
+    LatencyHistogram all_service; ///< Время обслуживания всех запросов
+    LatencyHistogram freshness; ///< Возраст значений get_result в момент получения ответа
+    uint64_t measured_scheduled = 0; ///< Запланированные запросы после прогрева
+    uint64_t completed = 0; ///< Ответы на измеряемые запросы
+    int64_t measure_start_ns = 0; ///< Начало измерения (после прогрева)
+    int64_t last_received_ns = 0; ///< Момент последнего ответа на измеряемый запрос
+};
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    signal(SIGPIPE, SIG_IGN);
+    try {
+        Options options = parse_options(argc, argv);
+        std::vector<CommandKind> kinds = parse_mix(options.mix);
+        LoadGenerator generator(std::move(options), std::move(kinds));
+        generator.prepare();
+        generator.run();
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        std::fprintf(stderr, "usage: %s [--socket=PATH] [--rate=REQ_PER_S] [--duration=S] [--warmup=S] "
+                             "[--connections=N] [--mix=get_result:80,get_status:15,set_range:5] "
+                             "[--channels=channel0,...] [--seed=N]\n", argv[0]);
+        return 1;
+    }
+    return 0;
+}
@@ -1,8 +1,36 @@
 #include "client.h"
 #include <iostream>
+#include <chrono>
+#include <cstdlib>
 
 #define SOCKET_PATH "/tmp/multimeter_socket"
 
+/**
+ * @brief Печатает возраст значения для ответа на `get_result <channel>, time`.
+ * 
+ * Ответ "ok, <value>, <time_ns>" содержит время измерения значения на сервере
+ * (нс от эпохи, system_clock); возраст - разница с текущим временем клиента.
+ * 
+ * @param command Отправленная команда.
+ * @param response Ответ сервера.
+ */
+void print_sample_age(const std::string& command, const std::string& response) {
+    if (command.rfind("get_result", 0) != 0 || response.rfind("ok, ", 0) != 0) {
+        return;
+    }
+    const size_t comma = response.rfind(", ");
+    if (comma == 2) {
+        return; // Ответ без времени измерения
+    }
+    const long long sample_ns = std::strtoll(response.c_str() + comma + 2, nullptr, 10);
+    if (sample_ns <= 0) {
+        return;
+    }
+    const long long now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    std::cout << "Sample age: " << static_cast<double>(now_ns - sample_ns) / 1e6 << " ms" << std::endl;
+}
+
 /**
  * @brief Основная функция клиента.
  * 
@@ -54,6 +82,7 @@ int main() {
             break;
         } else {
             std::cout << "Server response: " << response << std::endl;
+            print_sample_age(command, response);
         }
     }
 
@@ -2,10 +2,18 @@
 #include "ranges.h"
 #include "my_tools.h"
 #include "config.h"
+#include "tracing.h"
 
 #include <stdexcept>
 #include <thread>
 #include <chrono>
+#include <algorithm>
+
+namespace {
+
+constexpr int64_t ns_per_ms = 1000000;
+
+}
 
 /**
  * @brief Конструктор класса AnalogInput.
@@ -16,8 +24,11 @@
  * @param name Имя канала.
  */
 AnalogInput::AnalogInput(const std::string& name)
-    : Channel(name), range(MyConfig::DefaultConfig::range), frequency(MyConfig::DefaultConfig::polling_frequency), 
-        running(false), measuring_value(0.0f) {
+    : Channel(name), range(MyConfig::DefaultConfig::range), period_ns(static_cast<int64_t>(MyConfig::DefaultConfig::polling_frequency) * ns_per_ms), 
+        running(false), measuring_value(0.0f), stats(std::make_shared<ChannelStats>()),
+        quantiles(std::make_shared<ChannelQuantiles>()),
+        waveform(std::make_shared<ChannelWaveform>()), health(std::make_shared<ChannelHealth>()),
+        source(std::make_shared<NoiseSource>()) {
     state = ChannelStateManager::ChannelState::Idle;
 }
 
@@ -40,7 +51,7 @@ AnalogInput::~AnalogInput() {
  * @throws std::out_of_range Если диапазон некорректен.
  */
 void AnalogInput::set_range(int new_range) { 
-    std::lock_guard<std::mutex> lock(mtx);   
+    std::lock_guard<InstrumentedMutex> lock(mtx);   
     if (new_range < 0 || new_range >= RangeManager::size()) {
         throw std::out_of_range("Invalid range value");
     }    
@@ -53,7 +64,7 @@ void AnalogInput::set_range(int new_range) {
  * @return Текущий диапазон канала.
  */
 int AnalogInput::get_range() const {
-    std::lock_guard<std::mutex> lock(mtx);
+    std::lock_guard<InstrumentedMutex> lock(mtx);
     return range;
 }
 
@@ -67,21 +78,49 @@ int AnalogInput::get_range() const {
  * @throws std::invalid_argument Если частота некорректна.
  */
 void AnalogInput::set_frequency(int freq) {
-    std::lock_guard<std::mutex> lock(mtx);
     if (freq <= 0) {
         throw std::invalid_argument("Frequency must be positive");
     }
-    frequency = freq;
+    set_period_ns(static_cast<int64_t>(freq) * ns_per_ms);
 }
 
 /**
  * @brief Возвращает текущую частоту измерений.
  * 
- * @return Частота измерений.
+ * @return Период измерений в миллисекундах (0, если период короче миллисекунды).
  */
 int AnalogInput::get_frequency() const {
-    std::lock_guard<std::mutex> lock(mtx);
-    return frequency;
+    return static_cast<int>(period_ns.load() / ns_per_ms);
+}
+
+/**
+ * @brief Устанавливает период измерений в наносекундах.
+ * 
+ * Поток измерений будится, чтобы новый период вступил в силу сразу, а не после
+ * окончания текущего (возможно, длинного) ожидания.
+ * 
+ * @param new_period_ns Период измерений (нс).
+ * @throws std::invalid_argument Если период меньше минимального.
+ */
+void AnalogInput::set_period_ns(int64_t new_period_ns) {
+    if (new_period_ns < MyConfig::DefaultConfig::min_period_ns) {
+        throw std::invalid_argument("Period is shorter than " + MyTools::format_duration(MyConfig::DefaultConfig::min_period_ns));
+    }
+    {
+        std::lock_guard<std::mutex> sleep_lock(sleep_mutex);
+        period_ns.store(new_period_ns);
+        wake_pending = true;
+    }
+    sleep_cond_var.notify_all();
+}
+
+/**
+ * @brief Возвращает период измерений в наносекундах.
+ * 
+ * @return Период измерений (нс).
+ */
+int64_t AnalogInput::get_period_ns() const {
+    return period_ns.load();
 }
 
 /**
@@ -90,9 +129,12 @@ int AnalogInput::get_frequency() const {
  * Запускает новый поток для измерений. Канал начинает работать и изменяет свое состояние.
  */
 void AnalogInput::start() {
-    std::lock_guard<std::mutex> lock(mtx);
+    std::lock_guard<InstrumentedMutex> lock(mtx);
     if (running.load()) return;        
     running.store(true);
+    // Первый проход ожидается сразу после запуска потока
+    const int64_t now = MyTools::monotonic_ns();
+    health->progress(now, now);
     channel_thread = std::thread(&AnalogInput::channel_loop, this);    
     set_state(ChannelStateManager::ChannelState::Measure);
 }
@@ -103,14 +145,19 @@ void AnalogInput::start() {
  * Останавливает работу канала и завершает поток измерений.
  */
 void AnalogInput::stop() {        
-    std::lock_guard<std::mutex> lock(mtx);
+    std::lock_guard<InstrumentedMutex> lock(mtx);
     
     if (!running.load()) return;
 
-    running.store(false);
+    {
+        std::lock_guard<std::mutex> sleep_lock(sleep_mutex);
+        running.store(false);
+    }
+    sleep_cond_var.notify_all();  // Прерываем ожидание потока измерений
     if (channel_thread.joinable()) {
         channel_thread.join();
     }
+    health->disarm();
     set_state(ChannelStateManager::ChannelState::Idle);
 }
 
@@ -125,21 +172,165 @@ float AnalogInput::get_measuring_value() const {
     return measuring_value.load();
 }
 
+int64_t AnalogInput::get_measuring_time() const {
+    return measuring_time.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief Возвращает оконную статистику канала.
+ * 
+ * @return Статистика канала.
+ */
+std::shared_ptr<ChannelStats> AnalogInput::get_stats() {
+    return stats;
+}
+
+/**
+ * @brief Возвращает оконные скетчи квантилей канала.
+ * 
+ * @return Скетчи квантилей канала.
+ */
+std::shared_ptr<ChannelQuantiles> AnalogInput::get_quantiles() {
+    return quantiles;
+}
+
+/**
+ * @brief Возвращает историю значений канала для осциллограмм.
+ * 
+ * @return История значений канала.
+ */
+std::shared_ptr<ChannelWaveform> AnalogInput::get_waveform() {
+    return waveform;
+}
+
+/**
+ * @brief Возвращает сведения о работе потока измерений.
+ * 
+ * @return Сведения о работе потока измерений.
+ */
+std::shared_ptr<ChannelHealth> AnalogInput::get_health() {
+    return health;
+}
+
+/**
+ * @brief Устанавливает источник сигнала канала.
+ * 
+ * @param new_source Источник сигнала.
+ * @throws std::invalid_argument Если источник не задан.
+ */
+void AnalogInput::set_source(std::shared_ptr<ISignalSource> new_source) {
+    if (!new_source) {
+        throw std::invalid_argument("Signal source is not specified");
+    }
+    std::lock_guard<std::mutex> lock(source_mutex);
+    source = std::move(new_source);
+}
+
+/**
+ * @brief Возвращает источник сигнала канала.
+ * 
+ * @return Источник сигнала.
+ */
+std::shared_ptr<ISignalSource> AnalogInput::get_source() const {
+    std::lock_guard<std::mutex> lock(source_mutex);
+    return source;
+}
+
 /**
  * @brief Внутренний метод для работы канала.
  * 
- * Циклически генерирует случайные значения в пределах текущего диапазона и обновляет
- * измеряемое значение с заданной частотой.
+ * Значения идут по сетке времени с заданным периодом. При каждом пробуждении
+ * источник генерирует одним блоком все значения, срок которых наступил, а их
+ * времена интерполируются по сетке. Поток просыпается не чаще интервала
+ * пробуждения, поэтому на высоких частотах опроса (кГц-МГц) число пробуждений
+ * не зависит от частоты.
+ *
+ * Сетка идет по монотонным часам, поэтому перевод системных часов не сбивает
+ * расписание; временные метки - узлы сетки, сдвинутые к системному времени
+ * на разность часов, измеренную при запуске потока.
  */
 void AnalogInput::channel_loop() {    
+    const int64_t wakeup_interval = MyConfig::DefaultConfig::block_wakeup_interval_ns;
+    next_sample_ns = MyTools::monotonic_ns();
+    wall_offset_ns = MyTools::now_ns() - next_sample_ns;
+    Tracer::get_instance().set_thread_name("acquisition " + get_name());
+
     while (running.load()) {        
-        const auto& current_range = RangeManager::get_range(range);
-        
-        // Генерируем случайное значение в пределах диапазона
-        float value = MyTools::generate_random_value(current_range.min_value, current_range.max_value);
-
-        measuring_value.store(value);
-        
-        std::this_thread::sleep_for(std::chrono::milliseconds(frequency));
+        const int64_t now = MyTools::monotonic_ns();
+        acquire(now);
+
+        // Ждем следующего значения (но не меньше интервала пробуждения), просыпаемся
+        // сразу при остановке канала или смене периода
+        const int64_t wake_at = std::max(next_sample_ns, now + wakeup_interval);
+        health->progress(now, wake_at);
+        std::unique_lock<std::mutex> sleep_lock(sleep_mutex);
+        sleep_cond_var.wait_for(sleep_lock, std::chrono::nanoseconds(wake_at - MyTools::monotonic_ns()),
+                                [this] { return !running.load() || wake_pending; });
+        if (wake_pending) {
+            wake_pending = false;
+            next_sample_ns = std::min(next_sample_ns, MyTools::monotonic_ns());
+        }
+    }
+}
+
+/**
+ * @brief Выполняет в вызывающем потоке измерения, срок которых наступил к now_ns.
+ * 
+ * @param now_ns Текущее время (нс от эпохи).
+ * @throws std::logic_error Если канал запущен.
+ */
+void AnalogInput::acquire_until(int64_t now_ns) {
+    if (running.load()) {
+        throw std::logic_error("Channel " + get_name() + " is running");
+    }
+    if (next_sample_ns == 0) {
+        next_sample_ns = now_ns;
+    }
+    // Время задает вызывающий, сетка идет прямо в его шкале
+    wall_offset_ns = 0;
+    acquire(now_ns);
+}
+
+/**
+ * @brief Генерирует блок значений, срок которых наступил к now, и передает его в статистику.
+ * 
+ * Если поток отстал больше чем на максимальный блок, пропущенные значения
+ * не генерируются.
+ * 
+ * @param now Текущее время в шкале сетки значений (нс).
+ */
+void AnalogInput::acquire(int64_t now) {
+    if (now < next_sample_ns) {
+        return;
     }
+    TraceSpan span("acquire", "acquisition");
+    const RangeManager::RangeID range_id = static_cast<RangeManager::RangeID>(range.load());
+    const auto& current_range = RangeManager::get_range(range_id);
+    const int64_t period = period_ns.load();
+    const size_t max_block = MyConfig::DefaultConfig::max_block_samples;
+
+    size_t due = static_cast<size_t>((now - next_sample_ns) / period) + 1;
+    if (due > max_block) {
+        next_sample_ns += static_cast<int64_t>(due - max_block) * period;
+        due = max_block;
+    }
+
+    // Получаем блок значений от источника сигнала в пределах диапазона
+    block_values.resize(due);
+    block_timestamps.resize(due);
+    const int64_t start_ns = next_sample_ns + wall_offset_ns;
+    SignalBlock block{start_ns, period, current_range.min_value, current_range.max_value,
+                      block_values.data(), due};
+    get_source()->generate(block);
+    for (size_t i = 0; i != due; ++i) {
+        block_timestamps[i] = start_ns + static_cast<int64_t>(i) * period;
+    }
+    next_sample_ns += static_cast<int64_t>(due) * period;
+
+    measuring_value.store(block_values.back());
+    measuring_time.store(block_timestamps.back(), std::memory_order_release);
+    stats->add_samples(block_timestamps.data(), block_values.data(), due);
+    quantiles->add_samples(block_timestamps.data(), block_values.data(), due);
+    waveform->add_samples(block_timestamps.data(), block_values.data(), due, range_id);
+    health->add_samples(due);
 }
@@ -7,7 +7,14 @@
 #include <random>
 #include <stdexcept>
 #include <mutex>
+#include <condition_variable>
+#include "lock_stats.h"
 #include "channel.h"
+#include "channel_stats.h"
+#include "quantile_sketch.h"
+#include "waveform.h"
+#include "channel_health.h"
+#include "signal_source.h"
 
 /**
  * @class AnalogInput
@@ -68,10 +75,28 @@ public:
     /**
      * @brief Возвращает текущую частоту измерений.
      * 
-     * @return Частота измерений.
+     * @return Период измерений в миллисекундах (0, если период короче миллисекунды).
      */
     int get_frequency() const;
 
+    /**
+     * @brief Устанавливает период измерений в наносекундах.
+     * 
+     * При периодах короче интервала пробуждения канал работает в блочном режиме:
+     * за одно пробуждение источник генерирует все накопившиеся значения одним блоком.
+     * 
+     * @param new_period_ns Период измерений (нс).
+     * @throws std::invalid_argument Если период меньше минимального.
+     */
+    void set_period_ns(int64_t new_period_ns) override;
+
+    /**
+     * @brief Возвращает период измерений в наносекундах.
+     * 
+     * @return Период измерений (нс).
+     */
+    int64_t get_period_ns() const override;
+
     /**
      * @brief Запускает процесс измерений.
      * 
@@ -87,6 +112,17 @@ public:
      */
     void stop() override;
 
+    /**
+     * @brief Выполняет в вызывающем потоке измерения, срок которых наступил к now_ns.
+     * 
+     * Используется для имитации в виртуальном времени: канал не запускается,
+     * а время сдвигает имитатор. Первый вызов начинает сетку значений с now_ns.
+     * 
+     * @param now_ns Текущее время (нс от эпохи).
+     * @throws std::logic_error Если канал запущен (измерения выполняет его поток).
+     */
+    void acquire_until(int64_t now_ns);
+
     /**
      * @brief Возвращает текущее измеряемое значение.
      * 
@@ -94,6 +130,56 @@ public:
      */
     float get_measuring_value() const;
 
+    /**
+     * @brief Возвращает время измерения текущего значения.
+     * 
+     * @return Время измерения (нс от эпохи) или 0, если значений еще не было.
+     */
+    int64_t get_measuring_time() const;
+
+    /**
+     * @brief Возвращает оконную статистику канала.
+     * 
+     * @return Статистика канала.
+     */
+    std::shared_ptr<ChannelStats> get_stats() override;
+
+    /**
+     * @brief Возвращает оконные скетчи квантилей канала.
+     * 
+     * @return Скетчи квантилей канала.
+     */
+    std::shared_ptr<ChannelQuantiles> get_quantiles() override;
+
+    /**
+     * @brief Возвращает историю значений канала для осциллограмм.
+     * 
+     * @return История значений канала.
+     */
+    std::shared_ptr<ChannelWaveform> get_waveform() override;
+
+    /**
+     * @brief Возвращает сведения о работе потока измерений.
+     * 
+     * @return Сведения о работе потока измерений.
+     */
+    std::shared_ptr<ChannelHealth> get_health() override;
+
+    /**
+     * @brief Устанавливает источник сигнала канала.
+     * 
+     * @param new_source Источник сигнала.
+     * @throws std::invalid_argument Если источник не задан.
+     */
+    void set_source(std::shared_ptr<ISignalSource> new_source) override;
+
+    /**
+     * @brief Возвращает источник сигнала канала.
+     * 
+     * @return Источник сигнала.
+     */
+    std::shared_ptr<ISignalSource> get_source() const override;
+
 private:
     /**
      * @brief Текущий диапазон канала.
@@ -103,11 +189,11 @@ private:
     std::atomic<int> range;
 
     /**
-     * @brief Частота опроса канала.
+     * @brief Период опроса канала.
      * 
-     * Частота в миллисекундах, с которой будет производиться получение данных.
+     * Период в наносекундах, с которым будет производиться получение данных.
      */
-    std::atomic<int> frequency;
+    std::atomic<int64_t> period_ns;
 
     /**
      * @brief Флаг работы канала.
@@ -123,10 +209,78 @@ private:
      */
     std::atomic<float> measuring_value;
 
+    /**
+     * @brief Время измерения текущего значения (нс от эпохи).
+     */
+    std::atomic<int64_t> measuring_time{0};
+
+    /**
+     * @brief Оконная статистика канала.
+     * 
+     * Обновляется в потоке измерений при каждом новом значении.
+     */
+    std::shared_ptr<ChannelStats> stats;
+
+    /**
+     * @brief Оконные скетчи квантилей канала.
+     * 
+     * Обновляются в потоке измерений при каждом новом значении.
+     */
+    std::shared_ptr<ChannelQuantiles> quantiles;
+
+    /**
+     * @brief История значений канала для осциллограмм.
+     * 
+     * Обновляется в потоке измерений при каждом новом значении.
+     */
+    std::shared_ptr<ChannelWaveform> waveform;
+
+    /**
+     * @brief Сведения о работе потока измерений (для сторожевого таймера).
+     */
+    std::shared_ptr<ChannelHealth> health;
+
+    /**
+     * @brief Источник сигнала канала.
+     * 
+     * Защищен отдельным мьютексом: mtx удерживается в stop() на время join()
+     * потока измерений, который читает источник.
+     */
+    std::shared_ptr<ISignalSource> source;
+    mutable std::mutex source_mutex;
+
     /**
      * @brief Мьютекс для синхронизации доступа к данным канала.
      */
-    mutable std::mutex mtx;
+    mutable InstrumentedMutex mtx{"analog_input.mtx"};
+
+    /**
+     * @brief Мьютекс и условная переменная для прерываемого ожидания между измерениями.
+     *
+     * Позволяют остановить канал сразу, не дожидаясь окончания периода опроса.
+     */
+    std::mutex sleep_mutex;
+    std::condition_variable sleep_cond_var;
+    bool wake_pending = false; ///< Запрос на пересчет срока пробуждения (после смены периода)
+
+    /**
+     * @brief Буферы блока значений (только для потока измерений).
+     */
+    std::vector<float> block_values;
+    std::vector<int64_t> block_timestamps;
+
+    /**
+     * @brief Срок следующего значения (только для потока измерений или имитатора).
+     *
+     * В потоке измерений - по монотонным часам, в имитаторе - в шкале его времени.
+     */
+    int64_t next_sample_ns = 0;
+
+    /**
+     * @brief Сдвиг от сетки значений к временным меткам: системное время минус монотонное
+     * (только для потока измерений или имитатора; 0 в имитаторе).
+     */
+    int64_t wall_offset_ns = 0;
 
     /**
      * @brief Поток для выполнения измерений с заданной частотой.
@@ -136,8 +290,16 @@ private:
     /**
      * @brief Внутренний метод для работы канала.
      * 
-     * Этот метод выполняет циклическое измерение значений с заданной частотой.
-     * Измеряемые значения генерируются случайным образом в пределах текущего диапазона.
+     * Этот метод выполняет циклическое измерение значений с заданным периодом.
+     * Измеряемые значения генерируются источником сигнала в пределах текущего диапазона
+     * блоками: за одно пробуждение - все значения, срок которых наступил.
      */
     void channel_loop();
+
+    /**
+     * @brief Генерирует блок значений, срок которых наступил к now, и передает его в статистику.
+     * 
+     * @param now Текущее время в шкале сетки значений (нс).
+     */
+    void acquire(int64_t now);
 };
@@ -0,0 +1,285 @@
+#include "multimeter.h"
+#include "command_factory.h"
+#include "channel_factory.h"
+#include "task_pool.h"
+#include "logger.h"
+#include "my_tools.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @file multimeter_bench.cpp
+ * @brief Бенчмарки горячих путей сервера.
+ *
+ * Каждый путь измеряется отдельно: разбор строки команды, поиск в фабрике команд,
+ * выполнение команды с форматированием ответа, float_to_string, пул задач и логгер.
+ * Для каждого бенчмарка печатается строка
+ * `bench name=<имя> iterations=<n> ns_per_op=<время> allocs_per_op=<выделения> bytes_per_op=<байты>`,
+ * которую удобно сравнивать между сборками. Время - медиана нескольких замеров,
+ * выделения памяти считаются замещенным глобальным operator new во всех потоках.
+ * Необязательный аргумент - подстрока имени: запускаются только подходящие бенчмарки.
+ *
+ * Вывод логгера на время работы перенаправляется в никуда, чтобы не мешать
+ * результатам и не измерять скорость терминала.
+ */
+
+namespace {
+
+std::atomic<uint64_t> alloc_count{0}; ///< Количество выделений памяти
+std::atomic<uint64_t> alloc_bytes{0}; ///< Объем выделенной памяти
+
+/**
+ * @brief Буфер потока вывода, отбрасывающий все данные.
+ */
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+/**
+ * @brief Время в наносекундах (steady_clock).
+ */
+double now_ns() {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Измеряет бенчмарк и печатает строку результата.
+ *
+ * Количество итераций подбирается так, чтобы один замер шел около 50 мс;
+ * время на операцию - медиана пяти замеров.
+ *
+ * @param name Имя бенчмарка.
+ * @param filter Подстрока имени для запуска (пустая - все).
+ * @param body Тело: выполняет n операций.
+ */
+void run(const std::string& name, const std::string& filter, const std::function<void(size_t)>& body) {
+    if (!filter.empty() && name.find(filter) == std::string::npos) {
+        return;
+    }
+
+    // Прогрев и подбор количества итераций: удваиваем, пока замер не станет
+    // достаточно длинным, чтобы разовые задержки (пробуждение потоков) не влияли на оценку
+    body(1);
+    size_t n = 1;
+    for (;;) {
+        const double start = now_ns();
+        body(n);
+        const double elapsed = now_ns() - start;
+        if (elapsed > 2e7 || n >= (size_t{1} << 30)) {
+            n = std::max<size_t>(1, static_cast<size_t>(static_cast<double>(n) * 5e7 / std::max(elapsed, 1.0)));
+            break;
+        }
+        n *= 2;
+    }
+
+    const int samples = 5;
+    std::vector<double> per_op;
+    const uint64_t count_before = alloc_count.load();
+    const uint64_t bytes_before = alloc_bytes.load();
+    for (int i = 0; i != samples; ++i) {
+        const double start = now_ns();
+        body(n);
+        per_op.push_back((now_ns() - start) / static_cast<double>(n));
+    }
+    const double ops = static_cast<double>(n) * samples;
+    const double allocs = static_cast<double>(alloc_count.load() - count_before) / ops;
+    const double bytes = static_cast<double>(alloc_bytes.load() - bytes_before) / ops;
+
+    std::sort(per_op.begin(), per_op.end());
+    std::printf("bench name=%s iterations=%zu ns_per_op=%.2f allocs_per_op=%.3f bytes_per_op=%.1f\n",
+                name.c_str(), n, per_op[samples / 2], allocs, bytes);
+    std::fflush(stdout);
+}
+
+/**
+ * @brief Ждет, пока логгер выведет все сообщения.
+ */
+void drain_logger() {
+    while (ThreadSafeLogger::get_instance().get_backlog() != 0) {
+        std::this_thread::yield();
+    }
+}
+
+/**
+ * @brief Бенчмарки разбора строки команды.
+ */
+void bench_parse(const std::string& filter) {
+    const std::pair<const char*, std::string> inputs[] = {
+        {"parse/get_result", "get_result channel0"},
+        {"parse/set_range", "set_range channel0, 2"},
+        {"parse/query", "query channel0, -1m, now, 1s, mean, min, max"},
+    };
+    for (const auto& [name, input] : inputs) {
+        run(name, filter, [&input = input](size_t n) {
+            std::string command_name;
+            std::vector<std::string> parameters;
+            for (size_t i = 0; i != n; ++i) {
+                command_name.clear();
+                parameters.clear();
+                Multimeter::parse_command_string(input, command_name, parameters);
+            }
+        });
+    }
+}
+
+/**
+ * @brief Бенчмарки фабрики команд и выполнения команд с форматированием ответа.
+ */
+void bench_dispatch(const std::string& filter, const std::shared_ptr<IChannel>& channel) {
+    const std::vector<std::string> params = {channel->get_name()};
+    volatile size_t sink = 0;
+
+    run("dispatch/factory_get_status", filter, [&](size_t n) {
+        for (size_t i = 0; i != n; ++i) {
+            sink = sink + (CommandFactory::create_command("get_status", channel, params) != nullptr);
+        }
+    });
+    run("dispatch/factory_miss", filter, [&](size_t n) {
+        for (size_t i = 0; i != n; ++i) {
+            sink = sink + (CommandFactory::create_command("no_such_command", channel, params) != nullptr);
+        }
+    });
+    run("dispatch/has_command", filter, [&](size_t n) {
+        for (size_t i = 0; i != n; ++i) {
+            sink = sink + CommandFactory::has_command("get_result");
+        }
+    });
+
+    const std::pair<std::string, std::vector<std::string>> commands[] = {
+        {"get_status", params},
+        {"get_result", params},
+        {"get_stats", {channel->get_name(), "1s"}},
+    };
+    for (const auto& [command_name, command_params] : commands) {
+        run("dispatch/execute_" + command_name, filter, [&, &command_name = command_name, &command_params = command_params](size_t n) {
+            for (size_t i = 0; i != n; ++i) {
+                sink = sink + CommandFactory::create_command(command_name, channel, command_params)->execute().size();
+            }
+        });
+    }
+}
+
+/**
+ * @brief Бенчмарки форматирования значений.
+ */
+void bench_format(const std::string& filter) {
+    std::vector<float> values(1024);
+    for (size_t i = 0; i != values.size(); ++i) {
+        values[i] = static_cast<float>(i) * 0.37f - 150.0f;
+    }
+    volatile size_t sink = 0;
+    for (int precision : {3, 6}) {
+        run("format/float_to_string_p" + std::to_string(precision), filter, [&](size_t n) {
+            for (size_t i = 0; i != n; ++i) {
+                sink = sink + MyTools::float_to_string(values[i & 1023], precision).size();
+            }
+        });
+    }
+}
+
+/**
+ * @brief Бенчмарки пула задач: постановка задачи и ее выполнение.
+ */
+void bench_pool(const std::string& filter) {
+    for (size_t threads : {1, 4}) {
+        TaskPool pool(threads);
+        run("pool/enqueue_execute_" + std::to_string(threads) + "t", filter, [&](size_t n) {
+            std::atomic<size_t> done{0};
+            for (size_t i = 0; i != n; ++i) {
+                pool.enqueue([&done] { done.fetch_add(1, std::memory_order_relaxed); });
+            }
+            while (done.load() != n) {
+                std::this_thread::yield();
+            }
+        });
+    }
+}
+
+/**
+ * @brief Бенчмарки логгера: стоимость вызова и пропускная способность с выводом.
+ */
+void bench_logger(const std::string& filter) {
+    const std::string message = "--> [ Client 7 ] send command [get_result channel0]";
+    drain_logger();
+    run("logger/log_msg", filter, [&](size_t n) {
+        for (size_t i = 0; i != n; ++i) {
+            Log::log(message);
+        }
+        // Очередь не должна расти от замера к замеру
+        drain_logger();
+    });
+    run("logger/log_msg_4t", filter, [&](size_t n) {
+        std::vector<std::thread> producers;
+        for (int t = 0; t != 4; ++t) {
+            producers.emplace_back([&message, n] {
+                for (size_t i = 0; i < n / 4; ++i) {
+                    Log::log(message);
+                }
+            });
+        }
+        for (auto& producer : producers) {
+            producer.join();
+        }
+        drain_logger();
+    });
+}
+
+} // namespace
+
+void* operator new(std::size_t size) {
+    alloc_count.fetch_add(1, std::memory_order_relaxed);
+    alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+int main(int argc, char** argv) {
+    const std::string filter = argc > 1 ? argv[1] : "";
+
+#ifdef __OPTIMIZE__
+    std::printf("info optimized=1\n");
+#else
+    std::printf("info optimized=0\n");
+#endif
+
+    NullBuffer null_buffer;
+    std::streambuf* saved = std::cout.rdbuf(&null_buffer);
+
+    std::shared_ptr<IChannel> channel = ChannelFactory::create_analog_input_channel("bench0");
+    channel->start();
+
+    bench_parse(filter);
+    bench_dispatch(filter, channel);
+    bench_format(filter);
+    bench_pool(filter);
+    bench_logger(filter);
+
+    channel->stop();
+    drain_logger();
+    std::cout.rdbuf(saved);
+    return 0;
+}
@@ -0,0 +1,424 @@
+#include "multimeter.h"
+#include "analog_input.h"
+#include "metrics.h"
+#include "logger.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <signal.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @file multimeter_perf.cpp
+ * @brief Проверка производительности сервера против сохраненных базовых значений.
+ *
+ * Использование: multimeter_perf --baseline=<файл> [--update] [--threshold=0.25] [--latency-threshold=0.5]
+ *
+ * Сервер запускается в этом же процессе на временном сокете (во временном каталоге,
+ * выгрузка метрик отключена), клиенты в отдельных потоках выполняют фиксированную
+ * нагрузку get_result/get_status, после чего отдельно измеряется путь измерений:
+ * генерация блоков значений и их учет в статистике, квантилях и истории.
+ *
+ * Результаты нормируются калибровочным циклом (фиксированная вычислительная работа):
+ * пропускная способность - в операциях за время калибровки, задержка - в долях этого
+ * времени, поэтому базовые значения переносимы между машинами разной скорости.
+ * Проверка не проходит (код 1), если пропускная способность упала больше чем на
+ * threshold или p99 выросла больше чем на latency-threshold. С --update результаты
+ * записываются как новые базовые значения. Базовые значения сравнимы только для
+ * сборки с той же оптимизацией (ключ optimized).
+ */
+
+namespace {
+
+constexpr size_t client_count = 2; ///< Клиентские соединения (каждое отправляет команды по одной)
+constexpr size_t warmup_requests = 1000; ///< Запросы прогрева на клиента
+constexpr size_t measured_requests = 20000; ///< Измеряемые запросы на клиента
+constexpr size_t acquisition_channels = 16; ///< Каналы в проверке пути измерений
+constexpr size_t acquisition_steps = 100; ///< Шаги времени в проверке пути измерений
+constexpr size_t samples_per_step = 1000; ///< Значений канала за шаг
+constexpr int runs = 3; ///< Повторы каждой проверки (берется медиана)
+
+/**
+ * @brief Буфер потока вывода, отбрасывающий все данные.
+ */
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+/**
+ * @struct Options
+ * @brief Параметры проверки.
+ */
+struct Options {
+    std::string baseline_path; ///< Файл базовых значений
+    bool update = false; ///< Записать результаты как базовые значения
+    double threshold = 0.25; ///< Допустимое падение пропускной способности
+    double latency_threshold = 0.5; ///< Допустимый рост задержки
+};
+
+/**
+ * @brief Разбирает аргументы командной строки.
+ * @throws std::invalid_argument Если аргумент неизвестен или некорректен.
+ */
+Options parse_options(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--update") {
+            options.update = true;
+            continue;
+        }
+        const size_t eq = arg.find('=');
+        if (arg.compare(0, 2, "--") != 0 || eq == std::string::npos) {
+            throw std::invalid_argument("bad argument: " + arg);
+        }
+        const std::string key = arg.substr(2, eq - 2);
+        const std::string value = arg.substr(eq + 1);
+        if (key == "baseline") options.baseline_path = value;
+        else if (key == "threshold") options.threshold = std::stod(value);
+        else if (key == "latency-threshold") options.latency_threshold = std::stod(value);
+        else throw std::invalid_argument("unknown option: " + key);
+    }
+    if (options.baseline_path.empty()) {
+        throw std::invalid_argument("baseline file is not specified");
+    }
+    return options;
+}
+
+/**
+ * @brief Время в секундах (steady_clock).
+ */
+double now_s() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Медиана значений.
+ */
+double median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+/**
+ * @brief Калибровочный цикл: время фиксированной вычислительной работы (с), медиана пяти замеров.
+ */
+double calibrate() {
+    std::vector<double> times;
+    volatile uint64_t sink = 0;
+    for (int run = 0; run != 5; ++run) {
+        const double start = now_s();
+        uint64_t x = 1;
+        double y = 0.0;
+        for (uint32_t i = 0; i != (1u << 24); ++i) {
+            x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+            y += static_cast<double>(x >> 40) * 1e-9;
+        }
+        sink = sink + x + static_cast<uint64_t>(y);
+        times.push_back(now_s() - start);
+    }
+    return median(times);
+}
+
+/**
+ * @brief Подключается к серверу, ожидая появления сокета.
+ * @throws std::runtime_error Если подключиться не удалось.
+ */
+int connect_to_server(const std::string& socket_path) {
+    for (int attempt = 0; attempt != 200; ++attempt) {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        struct sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+        if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0) {
+            return fd;
+        }
+        close(fd);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    throw std::runtime_error("cannot connect to " + socket_path);
+}
+
+/**
+ * @brief Отправляет команду и ждет ответа.
+ * @throws std::runtime_error Если сервер закрыл соединение.
+ */
+std::string call(int fd, const std::string& command) {
+    if (send(fd, command.c_str(), command.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(command.size())) {
+        throw std::runtime_error("send failed");
+    }
+    char buffer[4096];
+    const ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+    if (n <= 0) {
+        throw std::runtime_error("connection closed by server");
+    }
+    return std::string(buffer, static_cast<size_t>(n));
+}
+
+/**
+ * @struct RequestResult
+ * @brief Результат проверки пути запросов.
+ */
+struct RequestResult {
+    double throughput = 0; ///< Запросов в секунду
+    double p99_s = 0; ///< 99-й перцентиль задержки (с)
+};
+
+/**
+ * @brief Выполняет фиксированную нагрузку на сервер.
+ *
+ * Клиенты работают замкнутым циклом (следующий запрос после ответа), поэтому
+ * пропускная способность и задержка отражают стоимость обработки запроса.
+ */
+RequestResult run_requests(const std::string& socket_path) {
+    Histogram latency(1e-9, 10, 34);
+    std::vector<double> starts(client_count), ends(client_count);
+    std::vector<std::string> errors(client_count);
+    std::vector<std::thread> clients;
+    for (size_t c = 0; c != client_count; ++c) {
+        clients.emplace_back([&, c] {
+            try {
+                const int fd = connect_to_server(socket_path);
+                for (size_t i = 0; i != warmup_requests + measured_requests; ++i) {
+                    if (i == warmup_requests) {
+                        starts[c] = now_s();
+                    }
+                    // Детерминированная смесь: 4 из 5 запросов - get_result
+                    const std::string channel = "channel" + std::to_string(i % 4);
+                    const std::string command = (i % 5 == 4 ? "get_status " : "get_result ") + channel;
+                    const int64_t sent = Metrics::now_ns();
+                    const std::string response = call(fd, command);
+                    if (i >= warmup_requests) {
+                        latency.record(Metrics::now_ns() - sent);
+                    }
+                    if (response.compare(0, 2, "ok") != 0) {
+                        throw std::runtime_error("unexpected response to " + command + ": " + response);
+                    }
+                }
+                ends[c] = now_s();
+                close(fd);
+            } catch (const std::exception& e) {
+                errors[c] = e.what();
+            }
+        });
+    }
+    for (auto& client : clients) {
+        client.join();
+    }
+    for (const std::string& error : errors) {
+        if (!error.empty()) {
+            throw std::runtime_error(error);
+        }
+    }
+
+    RequestResult result;
+    const double elapsed = *std::max_element(ends.begin(), ends.end()) - *std::min_element(starts.begin(), starts.end());
+    result.throughput = static_cast<double>(client_count * measured_requests) / elapsed;
+    result.p99_s = static_cast<double>(latency.snapshot().quantile(0.99)) * 1e-9;
+    return result;
+}
+
+/**
+ * @brief Проверка пути измерений: значений в секунду.
+ *
+ * Каналы не запускаются: блоки значений генерируются в этом потоке по
+ * искусственной шкале времени (AnalogInput::acquire_until).
+ */
+double run_acquisition() {
+    const int64_t period_ns = 10000;
+    std::vector<std::shared_ptr<AnalogInput>> channels;
+    for (size_t i = 0; i != acquisition_channels; ++i) {
+        auto channel = std::make_shared<AnalogInput>("perf" + std::to_string(i));
+        channel->set_period_ns(period_ns);
+        channels.push_back(std::move(channel));
+    }
+    int64_t now = 1700000000LL * 1000000000LL;
+    for (const auto& channel : channels) {
+        channel->acquire_until(now);
+    }
+    const double start = now_s();
+    for (size_t step = 0; step != acquisition_steps; ++step) {
+        now += static_cast<int64_t>(samples_per_step) * period_ns;
+        for (const auto& channel : channels) {
+            channel->acquire_until(now);
+        }
+    }
+    const double elapsed = now_s() - start;
+    return static_cast<double>(acquisition_channels * acquisition_steps * samples_per_step) / elapsed;
+}
+
+/**
+ * @brief Читает базовые значения (строки key=value, # - комментарий).
+ */
+std::map<std::string, std::string> read_baseline(const std::string& path) {
+    std::map<std::string, std::string> values;
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        const size_t eq = line.find('=');
+        if (line.empty() || line[0] == '#' || eq == std::string::npos) {
+            continue;
+        }
+        values[line.substr(0, eq)] = line.substr(eq + 1);
+    }
+    return values;
+}
+
+/**
+ * @struct Metric
+ * @brief Нормированный результат проверки.
+ */
+struct Metric {
+    const char* name; ///< Имя в файле базовых значений
+    double value; ///< Нормированное значение
+    bool higher_is_better; ///< Рост значения - улучшение (пропускная способность)
+};
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    try {
+        options = parse_options(argc, argv);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        std::fprintf(stderr, "usage: %s --baseline=<file> [--update] [--threshold=0.25] [--latency-threshold=0.5]\n", argv[0]);
+        return 2;
+    }
+    options.baseline_path = std::filesystem::absolute(options.baseline_path).string();
+
+#ifdef __OPTIMIZE__
+    const int optimized = 1;
+#else
+    const int optimized = 0;
+#endif
+
+    // Сокет и хранилище значений сервера - во временном каталоге
+    char directory_template[] = "/tmp/multimeter_perf_XXXXXX";
+    if (!mkdtemp(directory_template)) {
+        std::perror("mkdtemp");
+        return 1;
+    }
+    const std::filesystem::path directory = directory_template;
+    std::filesystem::current_path(directory);
+    const std::string socket_path = (directory / "socket").string();
+
+    NullBuffer null_buffer;
+    std::streambuf* saved = std::cout.rdbuf(&null_buffer);
+
+    const double calibration_s = calibrate();
+    std::vector<double> throughputs, p99s, acquisitions;
+    std::string error;
+    {
+        Multimeter multimeter(socket_path, client_count + 1, 4);
+        multimeter.set_metrics_socket_path("");
+        std::thread server([&multimeter] { multimeter.run(); });
+        try {
+            const int fd = connect_to_server(socket_path);
+            // Случайные сбои каналов сделали бы нагрузку невоспроизводимой
+            call(fd, "clear_faults *");
+            for (int i = 0; i != 4; ++i) {
+                call(fd, "start_measure channel" + std::to_string(i));
+            }
+            close(fd);
+            for (int run = 0; run != runs; ++run) {
+                const RequestResult result = run_requests(socket_path);
+                throughputs.push_back(result.throughput);
+                p99s.push_back(result.p99_s);
+            }
+        } catch (const std::exception& e) {
+            error = e.what();
+        }
+        multimeter.stop();
+        server.join();
+    }
+    if (error.empty()) {
+        for (int run = 0; run != runs; ++run) {
+            acquisitions.push_back(run_acquisition());
+        }
+    }
+
+    while (ThreadSafeLogger::get_instance().get_backlog() != 0) {
+        std::this_thread::yield();
+    }
+    std::cout.rdbuf(saved);
+    std::filesystem::current_path("/");
+    std::filesystem::remove_all(directory);
+    if (!error.empty()) {
+        std::fprintf(stderr, "perf check failed: %s\n", error.c_str());
+        return 1;
+    }
+
+    const Metric metrics[] = {
+        {"request_throughput", median(throughputs) * calibration_s, true},
+        {"request_p99", median(p99s) / calibration_s, false},
+        {"acquisition_throughput", median(acquisitions) * calibration_s, true},
+    };
+    std::printf("perf calibration_ms=%.2f optimized=%d request_throughput=%.0f request_p99_us=%.1f acquisition_throughput=%.0f\n",
+                calibration_s * 1e3, optimized, median(throughputs), median(p99s) * 1e6, median(acquisitions));
+
+    if (options.update) {
+        std::ofstream file(options.baseline_path, std::ios::trunc);
+        file << "# Базовые значения multimeter_perf (обновление: multimeter_perf --baseline=<файл> --update).\n"
+             << "# Значения нормированы калибровочным циклом: пропускная способность - операций за\n"
+             << "# время калибровки, задержка - в долях времени калибровки.\n"
+             << "optimized=" << optimized << "\n";
+        for (const Metric& metric : metrics) {
+            file << metric.name << "=" << metric.value << "\n";
+        }
+        if (!file) {
+            std::fprintf(stderr, "cannot write %s\n", options.baseline_path.c_str());
+            return 1;
+        }
+        std::printf("baseline updated: %s\n", options.baseline_path.c_str());
+        return 0;
+    }
+
+    const std::map<std::string, std::string> baseline = read_baseline(options.baseline_path);
+    if (baseline.empty()) {
+        std::fprintf(stderr, "no baseline in %s, record one with --update\n", options.baseline_path.c_str());
+        return 1;
+    }
+    auto found = baseline.find("optimized");
+    if (found == baseline.end() || std::stoi(found->second) != optimized) {
+        std::fprintf(stderr, "baseline was recorded for a build with different optimization (optimized=%s)\n",
+                     found == baseline.end() ? "?" : found->second.c_str());
+        return 2;
+    }
+
+    bool regressed = false;
+    for (const Metric& metric : metrics) {
+        found = baseline.find(metric.name);
+        if (found == baseline.end()) {
+            std::printf("check metric=%s normalized=%.6g baseline=none status=skipped\n", metric.name, metric.value);
+            continue;
+        }
+        const double reference = std::stod(found->second);
+        const double change = metric.value / reference - 1.0;
+        const bool failed = metric.higher_is_better ? change < -options.threshold : change > options.latency_threshold;
+        regressed = regressed || failed;
+        std::printf("check metric=%s normalized=%.6g baseline=%.6g change=%+.1f%% status=%s\n", metric.name, metric.value,
+                    reference, change * 100.0, failed ? "regressed" : "ok");
+    }
+    return regressed ? 1 : 0;
+}
@@ -0,0 +1,166 @@
+#include "simd_kernels.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <vector>
+#include <functional>
+
+/**
+ * @file simd_bench.cpp
+ * @brief Проверка и бенчмарк векторных ядер.
+ *
+ * Сначала каждый поддерживаемый процессором вариант ядер сверяется со скалярным
+ * побитово (на разных длинах, включая хвосты и специальные значения). При
+ * расхождении программа завершается с ненулевым кодом. Затем измеряется время
+ * каждого ядра на каждом наборе инструкций.
+ *
+ * Использование: simd_bench [--verify]. С --verify выполняется только проверка
+ * (без замеров времени) - так программа запускается из ctest.
+ */
+
+namespace {
+
+const Simd::Isa all_isas[] = {Simd::Isa::Scalar, Simd::Isa::Sse2, Simd::Isa::Avx2, Simd::Isa::Avx512};
+
+/**
+ * @brief Побитовое сравнение двух массивов.
+ */
+template <typename T>
+bool same_bits(const std::vector<T>& a, const std::vector<T>& b) {
+    return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0;
+}
+
+bool same_bits(const Simd::Reduction& a, const Simd::Reduction& b) {
+    return std::memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+/**
+ * @brief Входные данные для проверки: случайные значения и специальные случаи.
+ */
+std::vector<float> make_input(size_t n) {
+    std::vector<float> data(n);
+    Simd::set_isa(Simd::Isa::Scalar);
+    Simd::generate_in_range(data.data(), n, -1000.0f, 1000.0f, 12345, 0);
+    const float specials[] = {0.0f, -0.0f, 0.5f, 1.5f, 2.5f, -2.5f, 3e9f, -3e9f,
+        std::numeric_limits<float>::quiet_NaN(), std::numeric_limits<float>::infinity(),
+        -std::numeric_limits<float>::infinity(), std::numeric_limits<float>::denorm_min()};
+    for (size_t i = 0; i < n && i < sizeof(specials) / sizeof(specials[0]); ++i) {
+        data[(i * 7919) % n] = specials[i];
+    }
+    return data;
+}
+
+/**
+ * @brief Сверяет все варианты ядер со скалярными.
+ * @return Количество расхождений.
+ */
+int verify() {
+    int failures = 0;
+    const size_t sizes[] = {0, 1, 3, 4, 7, 8, 15, 16, 17, 31, 33, 64, 100, 1000, 4099};
+
+    for (size_t n : sizes) {
+        std::vector<float> input = make_input(std::max<size_t>(n, 1));
+        input.resize(n);
+
+        // Эталонные результаты
+        Simd::set_isa(Simd::Isa::Scalar);
+        std::vector<float> ref_gen(n), ref_scaled(n);
+        std::vector<int32_t> ref_fixed(n);
+        Simd::generate_in_range(ref_gen.data(), n, 0.001f, 1.0f, 42, 1000);
+        Simd::scale_offset(input.data(), ref_scaled.data(), n, 1.25f, -3.5f);
+        Simd::Reduction ref_red = Simd::reduce(input.data(), n);
+        Simd::to_fixed(input.data(), ref_fixed.data(), n, 1000.0f);
+
+        for (Simd::Isa isa : all_isas) {
+            if (isa == Simd::Isa::Scalar || !Simd::is_supported(isa)) continue;
+            Simd::set_isa(isa);
+
+            std::vector<float> gen(n), scaled(n);
+            std::vector<int32_t> fixed(n);
+            Simd::generate_in_range(gen.data(), n, 0.001f, 1.0f, 42, 1000);
+            Simd::scale_offset(input.data(), scaled.data(), n, 1.25f, -3.5f);
+            Simd::Reduction red = Simd::reduce(input.data(), n);
+            Simd::to_fixed(input.data(), fixed.data(), n, 1000.0f);
+
+            auto check = [&](bool ok, const char* kernel) {
+                if (!ok) {
+                    std::printf("MISMATCH kernel=%s isa=%s n=%zu\n", kernel, Simd::to_string(isa).c_str(), n);
+                    ++failures;
+                }
+            };
+            check(same_bits(gen, ref_gen), "generate_in_range");
+            check(same_bits(scaled, ref_scaled), "scale_offset");
+            check(same_bits(red, ref_red), "reduce");
+            check(same_bits(fixed, ref_fixed), "to_fixed");
+        }
+    }
+    return failures;
+}
+
+/**
+ * @brief Измеряет среднее время на элемент.
+ */
+double time_per_element(size_t n, const std::function<void()>& body) {
+    const int repeats = 200;
+    body(); // Прогрев
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r != repeats; ++r) {
+        body();
+    }
+    auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    return elapsed / (static_cast<double>(repeats) * n);
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    bool verify_only = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--verify") != 0) {
+            std::fprintf(stderr, "usage: %s [--verify]\n", argv[0]);
+            return 2;
+        }
+        verify_only = true;
+    }
+
+    const Simd::Isa detected = Simd::get_isa();
+
+    int failures = verify();
+    if (failures) {
+        std::printf("verify failures=%d\n", failures);
+        return 1;
+    }
+    std::printf("verify ok detected=%s\n", Simd::to_string(detected).c_str());
+    if (verify_only) {
+        Simd::set_isa(detected);
+        return 0;
+    }
+
+    const size_t n = 1 << 16;
+    std::vector<float> input = make_input(n);
+    std::vector<float> out(n);
+    std::vector<int32_t> fixed(n);
+    volatile float sink = 0.0f;
+
+    for (Simd::Isa isa : all_isas) {
+        if (!Simd::is_supported(isa)) continue;
+        Simd::set_isa(isa);
+        const std::string name = Simd::to_string(isa);
+
+        std::printf("bench kernel=generate_in_range isa=%s n=%zu ns_per_elem=%.4f\n", name.c_str(), n,
+            time_per_element(n, [&] { Simd::generate_in_range(out.data(), n, 0.0f, 1.0f, 7, 0); }));
+        std::printf("bench kernel=scale_offset isa=%s n=%zu ns_per_elem=%.4f\n", name.c_str(), n,
+            time_per_element(n, [&] { Simd::scale_offset(input.data(), out.data(), n, 2.0f, 1.0f); }));
+        std::printf("bench kernel=reduce isa=%s n=%zu ns_per_elem=%.4f\n", name.c_str(), n,
+            time_per_element(n, [&] { sink = sink + Simd::reduce(input.data(), n).sum; }));
+        std::printf("bench kernel=to_fixed isa=%s n=%zu ns_per_elem=%.4f\n", name.c_str(), n,
+            time_per_element(n, [&] { Simd::to_fixed(input.data(), fixed.data(), n, 1000.0f); }));
+    }
+
+    Simd::set_isa(detected);
+    return 0;
+}
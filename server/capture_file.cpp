@@ -0,0 +1,94 @@
+#include "capture_file.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <cstdio>
+#include <stdexcept>
+
+/**
+ * @brief Открывает и отображает файл записи.
+ *
+ * Размер файла сверяется с количеством записей из заголовка. Ядру сообщается
+ * о последовательном чтении, чтобы оно читало страницы наперед.
+ *
+ * @throws std::runtime_error Если файл не открывается или имеет неверный формат.
+ */
+CaptureFile::CaptureFile(const std::string& path) : path(path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        throw std::runtime_error("open " + path + ": " + strerror(errno));
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == -1) {
+        int error = errno;
+        close(fd);
+        throw std::runtime_error("fstat " + path + ": " + strerror(error));
+    }
+    mapping_size = static_cast<size_t>(file_stat.st_size);
+    if (mapping_size < header_size) {
+        close(fd);
+        throw std::runtime_error("Invalid capture file: " + path);
+    }
+    mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    int error = errno;
+    close(fd); // Отображение остается действительным после закрытия дескриптора
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        throw std::runtime_error("mmap " + path + ": " + strerror(error));
+    }
+
+    const char* base = static_cast<const char*>(mapping);
+    uint32_t file_version = 0;
+    uint64_t file_count = 0;
+    std::memcpy(&file_version, base + 8, sizeof(file_version));
+    std::memcpy(&file_count, base + 16, sizeof(file_count));
+    const uint64_t expected_size = header_size + file_count * (sizeof(int64_t) + sizeof(float));
+    if (std::memcmp(base, signature, sizeof(signature)) != 0 || file_version != version
+        || file_count == 0 || file_count > mapping_size || expected_size != mapping_size) {
+        munmap(mapping, mapping_size);
+        mapping = nullptr;
+        throw std::runtime_error("Invalid capture file: " + path);
+    }
+
+    count = static_cast<size_t>(file_count);
+    timestamp_column = reinterpret_cast<const int64_t*>(base + header_size);
+    value_column = reinterpret_cast<const float*>(base + header_size + count * sizeof(int64_t));
+    madvise(mapping, mapping_size, MADV_SEQUENTIAL);
+}
+
+/**
+ * @brief Деструктор. Снимает отображение.
+ */
+CaptureFile::~CaptureFile() {
+    if (mapping) {
+        munmap(mapping, mapping_size);
+    }
+}
+
+/**
+ * @brief Записывает файл записи.
+ * @throws std::runtime_error Если файл не удалось записать.
+ */
+void CaptureFile::write(const std::string& path, const int64_t* timestamps, const float* values, size_t count) {
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        throw std::runtime_error("open " + path + ": " + strerror(errno));
+    }
+    char header[header_size] = {};
+    const uint64_t file_count = count;
+    std::memcpy(header, signature, sizeof(signature));
+    std::memcpy(header + 8, &version, sizeof(version));
+    std::memcpy(header + 16, &file_count, sizeof(file_count));
+
+    bool ok = std::fwrite(header, 1, header_size, file) == header_size
+        && std::fwrite(timestamps, sizeof(int64_t), count, file) == count
+        && std::fwrite(values, sizeof(float), count, file) == count;
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok) {
+        throw std::runtime_error("write " + path + " failed");
+    }
+}
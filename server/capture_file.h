@@ -0,0 +1,70 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @class CaptureFile
+ * @brief Файл записи канала, отображенный в память только для чтения.
+ *
+ * Формат файла (little-endian):
+ * - заголовок 32 байта: сигнатура "MMCAPTR1", версия (uint32), резерв (uint32),
+ *   количество записей N (uint64), резерв (uint64);
+ * - столбец времен: N значений int64 (нс, неубывающие);
+ * - столбец значений: N значений float.
+ *
+ * Столбцы читаются прямо из отображения, без копирования в кучу, поэтому
+ * размер файла ограничен только адресным пространством.
+ */
+class CaptureFile {
+public:
+    /**
+     * @brief Открывает и отображает файл записи.
+     * @param path Путь к файлу.
+     * @throws std::runtime_error Если файл не открывается или имеет неверный формат.
+     */
+    explicit CaptureFile(const std::string& path);
+
+    /**
+     * @brief Деструктор. Снимает отображение.
+     */
+    ~CaptureFile();
+
+    CaptureFile(const CaptureFile&) = delete;
+    CaptureFile& operator=(const CaptureFile&) = delete;
+
+    /// Количество записей
+    size_t size() const { return count; }
+
+    /// Столбец времен (нс)
+    const int64_t* timestamps() const { return timestamp_column; }
+
+    /// Столбец значений
+    const float* values() const { return value_column; }
+
+    /// Путь к файлу
+    const std::string& get_path() const { return path; }
+
+    /**
+     * @brief Записывает файл записи.
+     * @param path Путь к файлу.
+     * @param timestamps Времена (нс, неубывающие).
+     * @param values Значения.
+     * @param count Количество записей.
+     * @throws std::runtime_error Если файл не удалось записать.
+     */
+    static void write(const std::string& path, const int64_t* timestamps, const float* values, size_t count);
+
+    static constexpr char signature[8] = {'M', 'M', 'C', 'A', 'P', 'T', 'R', '1'}; ///< Сигнатура файла
+    static constexpr uint32_t version = 1; ///< Версия формата
+    static constexpr size_t header_size = 32; ///< Размер заголовка
+
+private:
+    std::string path; ///< Путь к файлу
+    void* mapping = nullptr; ///< Начало отображения
+    size_t mapping_size = 0; ///< Размер отображения
+    size_t count = 0; ///< Количество записей
+    const int64_t* timestamp_column = nullptr; ///< Столбец времен
+    const float* value_column = nullptr; ///< Столбец значений
+};
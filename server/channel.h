@@ -6,6 +6,14 @@
 #include <mutex>
 #include <atomic>
 #include <memory>
+#include <cstdint>
+#include "lock_stats.h"
+
+class ChannelStats;
+class ChannelQuantiles;
+class ChannelWaveform;
+class ChannelHealth;
+class ISignalSource;
 
 /**
  * @class ChannelStateManager
@@ -136,6 +144,22 @@ public:
      */
     virtual int get_frequency() const = 0;
 
+    /**
+     * @brief Устанавливает период опроса канала в наносекундах.
+     * 
+     * В отличие от set_frequency позволяет задавать периоды короче миллисекунды.
+     * 
+     * @param period_ns Период опроса (нс).
+     */
+    virtual void set_period_ns(int64_t period_ns) = 0;
+
+    /**
+     * @brief Получает период опроса канала в наносекундах.
+     * 
+     * @return Период опроса (нс).
+     */
+    virtual int64_t get_period_ns() const = 0;
+
     /**
      * @brief Получает значение измерения канала.
      * 
@@ -145,6 +169,16 @@ public:
      */
     virtual float get_measuring_value() const = 0;
 
+    /**
+     * @brief Получает время измерения последнего значения.
+     * 
+     * Время публикуется после значения, поэтому значение, прочитанное после
+     * времени, не старше его: возраст по этому времени - оценка сверху.
+     * 
+     * @return Время измерения (нс от эпохи, MyTools::now_ns()) или 0, если значений еще не было.
+     */
+    virtual int64_t get_measuring_time() const = 0;
+
     /**
      * @brief Получает текущее состояние канала.
      * 
@@ -162,6 +196,58 @@ public:
      * @param new_state Новое состояние канала.
      */
     virtual void set_state(ChannelStateManager::ChannelState new_state) = 0;
+
+    /**
+     * @brief Получает оконную статистику канала.
+     * 
+     * Эта функция возвращает набор окон статистики (min/max/mean/RMS/stddev),
+     * который обновляется при каждом измерении.
+     * 
+     * @return Статистика канала.
+     */
+    virtual std::shared_ptr<ChannelStats> get_stats() = 0;
+
+    /**
+     * @brief Получает оконные скетчи квантилей канала.
+     * 
+     * Скетчи обновляются при каждом измерении, память на канал ограничена.
+     * 
+     * @return Скетчи квантилей канала.
+     */
+    virtual std::shared_ptr<ChannelQuantiles> get_quantiles() = 0;
+
+    /**
+     * @brief Получает историю значений канала для осциллограмм.
+     * 
+     * @return История значений канала.
+     */
+    virtual std::shared_ptr<ChannelWaveform> get_waveform() = 0;
+
+    /**
+     * @brief Получает сведения о работе потока измерений канала.
+     * 
+     * Используются сторожевым таймером для обнаружения зависаний и содержат
+     * гистограммы задержек.
+     * 
+     * @return Сведения о работе потока измерений.
+     */
+    virtual std::shared_ptr<ChannelHealth> get_health() = 0;
+
+    /**
+     * @brief Устанавливает источник сигнала канала.
+     * 
+     * Новый источник используется начиная со следующего измерения.
+     * 
+     * @param source Источник сигнала.
+     */
+    virtual void set_source(std::shared_ptr<ISignalSource> source) = 0;
+
+    /**
+     * @brief Получает источник сигнала канала.
+     * 
+     * @return Источник сигнала.
+     */
+    virtual std::shared_ptr<ISignalSource> get_source() const = 0;
 };
 
 /**
@@ -231,7 +317,7 @@ public:
     virtual void stop() override = 0;
 
 protected:
-    mutable std::shared_mutex mtx; ///< Мьютекс для потокобезопасного доступа к данным канала.
+    mutable InstrumentedSharedMutex mtx{"channel.mtx"}; ///< Мьютекс для потокобезопасного доступа к данным канала.
     std::string name;               ///< Имя канала.
     std::atomic<ChannelStateManager::ChannelState> state; ///< Состояние канала.
 };
@@ -1,33 +1,72 @@
 #include "channel_controller.h"
 #include "logger.h" 
+#include "config.h"
+
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+
+namespace {
+
+/**
+ * @brief Емкость плотной таблицы: начальные каналы и запас под создаваемые, не больше предела.
+ * @throws std::length_error Если начальных каналов больше предельной емкости.
+ */
+size_t table_capacity_for(size_t table_channel_count) {
+    const size_t limit = MyConfig::DefaultConfig::channel_table_capacity;
+    if (table_channel_count > limit) {
+        throw std::length_error("Too many table channels, the limit is " + std::to_string(limit));
+    }
+    return std::min(table_channel_count + MyConfig::DefaultConfig::channel_table_reserve, limit);
+}
+
+}
 
 /**
  * @brief Конструктор ChannelController.
  * 
- * Инициализирует контроллер с указанным количеством каналов и запускает поток,
- * генерирующий случайные состояния для каналов.
+ * Инициализирует контроллер с указанным количеством каналов и запускает
+ * имитатор сбоев с профилем из конфигурации.
  * 
  * @param channel_count Количество каналов, которые будут добавлены в контроллер.
+ * @param table_channel_count Количество каналов в плотной таблице.
+ * @throws std::length_error Если каналов плотной таблицы больше предельной емкости.
  */
-ChannelController::ChannelController(size_t channel_count) : stop_state_gen(false) {
+ChannelController::ChannelController(size_t channel_count, size_t table_channel_count)
+    : channel_table(std::make_shared<ChannelTable>(table_capacity_for(table_channel_count))) {
+    // Начальный реестр собирается целиком и публикуется один раз
+    auto initial = std::make_shared<ChannelMap>();
     for (size_t i = 0; i != channel_count; ++i) {
-        add_channel(ChannelFactory::create_analog_input_channel("channel" + std::to_string(i)));
+        std::string name = "channel" + std::to_string(i);
+        std::shared_ptr<IChannel> channel = ChannelFactory::create_analog_input_channel(name);
+        watchdog.watch(channel);
+        (*initial)[name] = std::move(channel);
+        Log::log("ChannelController Channel " + name + " added");
+    }
+    for (size_t i = channel_count; i != channel_count + table_channel_count; ++i) {
+        std::string name = "channel" + std::to_string(i);
+        (*initial)[name] = ChannelFactory::create_table_channel(channel_table, name);
     }
+    watchdog.watch_table(channel_table);
+    if (table_channel_count) {
+        Log::log("ChannelController " + std::to_string(table_channel_count) + " table channels added");
+    }
+    std::atomic_store(&channels, std::shared_ptr<const ChannelMap>(std::move(initial)));
 
-    // Запуск потока генерации состояний
-    thread_state_gen = std::thread(&ChannelController::state_generator, this);
+    fault_injector = std::make_unique<FaultInjector>(*this, FaultProfile::parse(MyConfig::DefaultConfig::fault_profile),
+                                                     MyConfig::DefaultConfig::fault_seed);
+    metrics_collector_id = Metrics::registry().add_collector(
+        [this](std::vector<MetricSample>& samples) { collect_metrics(samples); });
 }
 
 /**
  * @brief Деструктор ChannelController.
  * 
- * Останавливает поток генерации состояний и завершает работу с каналами.
+ * Снимает сборщик метрик, останавливает имитатор сбоев и завершает работу с каналами.
  */
 ChannelController::~ChannelController() {
-    stop_state_gen = true;
-    if (thread_state_gen.joinable()) {
-        thread_state_gen.join();
-    }
+    Metrics::registry().remove_collector(metrics_collector_id);
+    fault_injector->stop();
 }
 
 /**
@@ -39,21 +78,90 @@ ChannelController::~ChannelController() {
  */
 void ChannelController::add_channel(std::shared_ptr<IChannel>&& channel) {
     std::string channel_name = channel->get_name();
+    watchdog.watch(channel);
     {            
-        std::unique_lock lock(map_mutex);
-        channels[channel_name] = std::move(channel);   
+        std::lock_guard<InstrumentedMutex> lock(update_mutex);
+        auto updated = std::make_shared<ChannelMap>(*get_snapshot());
+        (*updated)[channel_name] = std::move(channel);
+        std::atomic_store(&channels, std::shared_ptr<const ChannelMap>(std::move(updated)));
     }
     Log::log("ChannelController Channel " + channel_name + " added");     
 }
 
+/**
+ * @brief Создает канал во время работы.
+ *
+ * Имя проверяется на допустимые символы: оно используется в командах
+ * и в именах файлов хранилища.
+ *
+ * @param channel_name Имя канала.
+ * @param channel_type Тип канала ("analog" или "table").
+ * @return Указатель на созданный канал.
+ * @throws std::invalid_argument Если имя некорректно или занято, либо тип неизвестен.
+ * @throws std::length_error Если плотная таблица каналов заполнена.
+ */
+std::shared_ptr<IChannel> ChannelController::create_channel(const std::string& channel_name, const std::string& channel_type) {
+    const bool valid_name = !channel_name.empty() && std::all_of(channel_name.begin(), channel_name.end(), [](unsigned char ch) {
+        return std::isalnum(ch) || ch == '_' || ch == '-';
+    });
+    if (!valid_name) {
+        throw std::invalid_argument("Invalid channel name: " + channel_name);
+    }
+
+    std::shared_ptr<IChannel> channel;
+    {
+        std::lock_guard<InstrumentedMutex> lock(update_mutex);
+        std::shared_ptr<const ChannelMap> current = get_snapshot();
+        if (current->count(channel_name)) {
+            throw std::invalid_argument("Channel already exists: " + channel_name);
+        }
+        // Канал создается до копирования карты: при ошибке реестр не меняется
+        channel = ChannelFactory::create_channel(channel_type, channel_name, channel_table);
+        if (channel_type != "table") {
+            watchdog.watch(channel); // каналы таблицы наблюдаются вместе с таблицей
+        }
+        auto updated = std::make_shared<ChannelMap>(*current);
+        (*updated)[channel_name] = channel;
+        std::atomic_store(&channels, std::shared_ptr<const ChannelMap>(std::move(updated)));
+    }
+    Log::log("ChannelController Channel " + channel_name + " (" + channel_type + ") created");
+    return channel;
+}
+
+/**
+ * @brief Удаляет канал из реестра.
+ *
+ * Новый снимок реестра публикуется без канала. Ссылки на канал остаются
+ * у выполняющихся команд и у старых снимков; канал останавливается в деструкторе,
+ * когда отпускается последняя из них.
+ *
+ * @param channel_name Имя канала.
+ * @throws std::invalid_argument Если канал не найден.
+ */
+void ChannelController::remove_channel(const std::string& channel_name) {
+    {
+        std::lock_guard<InstrumentedMutex> lock(update_mutex);
+        std::shared_ptr<const ChannelMap> current = get_snapshot();
+        if (!current->count(channel_name)) {
+            throw std::invalid_argument("There is no such channel: " + channel_name);
+        }
+        auto updated = std::make_shared<ChannelMap>(*current);
+        updated->erase(channel_name);
+        std::atomic_store(&channels, std::shared_ptr<const ChannelMap>(std::move(updated)));
+    }
+    Log::log("ChannelController Channel " + channel_name + " removed");
+}
+
 /**
  * @brief Останавливает все каналы в контроллере.
  * 
- * Эта функция останавливает все каналы, управляемые контроллером.
+ * Эта функция останавливает имитатор сбоев и все каналы, управляемые контроллером.
+ * Имитатор останавливается первым, чтобы не переводить останавливаемые каналы в сбой.
  */
 void ChannelController::stop() {
-    std::unique_lock lock(map_mutex);
-    for (const auto& channel : channels) {
+    fault_injector->stop();
+    watchdog.stop();
+    for (const auto& channel : *get_snapshot()) {
         channel.second->stop();
     }
 }
@@ -68,9 +176,9 @@ void ChannelController::stop() {
  * @return Указатель на канал или nullptr, если канал не найден.
  */
 std::shared_ptr<IChannel> ChannelController::find_channel(const std::string& channel_name) const {
-    std::shared_lock lock(map_mutex);
-    auto it = channels.find(channel_name);        
-    if (it != channels.end()) {
+    std::shared_ptr<const ChannelMap> snapshot = get_snapshot();
+    auto it = snapshot->find(channel_name);        
+    if (it != snapshot->end()) {
         return it->second;  
     }
 
@@ -78,24 +186,85 @@ std::shared_ptr<IChannel> ChannelController::find_channel(const std::string& cha
 }
 
 /**
- * @brief Функция для генерации случайных состояний для каналов.
+ * @brief Возвращает снимок списка каналов.
+ *
+ * @return Указатели на все каналы контроллера.
+ */
+std::vector<std::shared_ptr<IChannel>> ChannelController::get_channels() const {
+    std::shared_ptr<const ChannelMap> snapshot = get_snapshot();
+    std::vector<std::shared_ptr<IChannel>> result;
+    result.reserve(snapshot->size());
+    for (const auto& channel : *snapshot) {
+        result.push_back(channel.second);
+    }
+    return result;
+}
+
+/**
+ * @brief Возвращает плотную таблицу каналов.
  * 
- * Этот поток генерирует случайные состояния для всех каналов в контроллере
- * и обновляет их состояния с определенной периодичностью.
+ * @return Указатель на таблицу каналов.
  */
-void ChannelController::state_generator() {
-    std::mt19937 rng(std::random_device{}());
-    std::uniform_int_distribution<int> state_dist(0, ChannelStateManager::size() - 1);
-
-    while (!stop_state_gen) {
-        {
-            std::unique_lock lock(map_mutex);
-            for (auto& [name, channel] : channels) {
-                ChannelStateManager::ChannelState random_state = static_cast<ChannelStateManager::ChannelState>(state_dist(rng));
-                channel->set_state(random_state);
-                Log::log("Channel [" + name + "] state updated to " + ChannelStateManager::to_string(random_state));
-            }
+std::shared_ptr<ChannelTable> ChannelController::get_channel_table() const {
+    return channel_table;
+}
+
+/**
+ * @brief Возвращает имитатор сбоев каналов.
+ * 
+ * @return Ссылка на имитатор сбоев.
+ */
+FaultInjector& ChannelController::get_fault_injector() {
+    return *fault_injector;
+}
+
+/**
+ * @brief Возвращает текущий снимок реестра каналов.
+ *
+ * Снимок неизменяем и остается действительным, пока на него есть ссылка,
+ * даже если реестр уже изменен.
+ */
+std::shared_ptr<const ChannelController::ChannelMap> ChannelController::get_snapshot() const {
+    return std::atomic_load(&channels);
+}
+
+/**
+ * @brief Добавляет в выгрузку метрик количество каналов и значений по каналам.
+ *
+ * Счетчики значений ведут потоки измерений (ChannelHealth), поэтому выгрузка
+ * не добавляет работы в измерения. Каналы плотной таблицы обслуживает один
+ * поток, и их значения выгружаются одним счетчиком таблицы: на тысячах каналов
+ * отдельные счетчики сделали бы выгрузку большой без пользы для наблюдения.
+ */
+void ChannelController::collect_metrics(std::vector<MetricSample>& samples) const {
+    std::shared_ptr<const ChannelMap> snapshot = get_snapshot();
+    const ChannelHealth* table_health = &channel_table->get_health();
+
+    MetricSample channel_count;
+    channel_count.name = "multimeter_channels";
+    channel_count.help = "Registered channels";
+    channel_count.type = MetricSample::Type::Gauge;
+    channel_count.value = static_cast<double>(snapshot->size());
+    samples.push_back(std::move(channel_count));
+
+    MetricSample table_samples;
+    table_samples.name = "multimeter_table_samples_total";
+    table_samples.help = "Samples acquired by the dense channel table";
+    table_samples.type = MetricSample::Type::Counter;
+    table_samples.value = static_cast<double>(table_health->get_samples());
+    samples.push_back(std::move(table_samples));
+
+    for (const auto& [name, channel] : *snapshot) {
+        std::shared_ptr<ChannelHealth> health = channel->get_health();
+        if (health.get() == table_health) {
+            continue;
         }
-        std::this_thread::sleep_for(std::chrono::seconds(10)); // Пауза в 10 секунд между обновлениями
+        MetricSample channel_samples;
+        channel_samples.name = "multimeter_channel_samples_total";
+        channel_samples.help = "Samples acquired by a channel";
+        channel_samples.type = MetricSample::Type::Counter;
+        channel_samples.labels = "channel=\"" + Metrics::escape_label(name) + "\"";
+        channel_samples.value = static_cast<double>(health->get_samples());
+        samples.push_back(std::move(channel_samples));
     }
 }
@@ -2,40 +2,57 @@
 
 #include "channel.h"
 #include "channel_factory.h"
+#include "fault_injector.h"
+#include "watchdog.h"
+#include "metrics.h"
 #include <stdexcept>
 #include <mutex>
-#include <shared_mutex>
 #include <unordered_map>
+#include <vector>
 #include <memory>
-#include <thread>
-#include <atomic>
-#include <random>
-#include <chrono>
+#include <string>
 
 /**
  * @class ChannelController
  * @brief Контроллер управления каналами.
  * 
  * Этот класс управляет коллекцией каналов, предоставляет методы для добавления,
- * поиска и остановки каналов. Также генерирует случайные состояния для каждого канала
- * в отдельном потоке.
+ * поиска и остановки каналов. Сбои каналов (временные состояния busy и error)
+ * имитирует FaultInjector, зависания потоков измерений отслеживает AcquisitionWatchdog.
+ * Количество полученных значений по каналам выгружается в метрики.
+ *
+ * Реестр каналов устроен по схеме read-copy-update: читатели берут неизменяемый
+ * снимок карты каналов атомарной загрузкой указателя и не ждут изменений реестра,
+ * а изменения (сериализованные отдельным мьютексом) строят новую карту и публикуют ее
+ * атомарной заменой указателя. Удаленный канал исчезает из новых снимков сразу,
+ * а останавливается и уничтожается, когда его отпустят все выполняющиеся команды
+ * и старые снимки.
  */
 class ChannelController {
 public:
     /**
      * @brief Конструктор ChannelController.
      * 
-     * Инициализирует контроллер с указанным количеством каналов и запускает поток,
-     * генерирующий случайные состояния для каналов.
+     * Инициализирует контроллер с указанным количеством каналов и запускает
+     * имитатор сбоев с профилем из конфигурации.
+     * 
+     * Первые `channel_count` каналов создаются как самостоятельные объекты `AnalogInput`,
+     * следующие `table_channel_count` — в плотной таблице `ChannelTable`. Нумерация
+     * имен сквозная: channel0, channel1, ...
+     * 
+     * Емкость таблицы - начальные каналы плюс запас channel_table_reserve под
+     * создаваемые каналы, но не больше channel_table_capacity.
      * 
      * @param channel_count Количество каналов, которые будут добавлены в контроллер.
+     * @param table_channel_count Количество каналов в плотной таблице.
+     * @throws std::length_error Если каналов плотной таблицы больше предельной емкости.
      */
-    ChannelController(size_t channel_count);
+    ChannelController(size_t channel_count, size_t table_channel_count = 0);
 
     /**
      * @brief Деструктор ChannelController.
      * 
-     * Останавливает поток генерации состояний и завершает работу с каналами.
+     * Снимает сборщик метрик, останавливает имитатор сбоев и завершает работу с каналами.
      */
     ~ChannelController();
 
@@ -48,10 +65,32 @@ public:
      */
     void add_channel(std::shared_ptr<IChannel>&& channel);
 
+    /**
+     * @brief Создает канал во время работы.
+     *
+     * @param channel_name Имя канала (латинские буквы, цифры, '_' и '-').
+     * @param channel_type Тип канала ("analog" или "table").
+     * @return Указатель на созданный канал.
+     * @throws std::invalid_argument Если имя некорректно или занято, либо тип неизвестен.
+     * @throws std::length_error Если плотная таблица каналов заполнена.
+     */
+    std::shared_ptr<IChannel> create_channel(const std::string& channel_name, const std::string& channel_type);
+
+    /**
+     * @brief Удаляет канал из реестра.
+     *
+     * Канал сразу перестает находиться по имени; остановка и освобождение канала
+     * откладываются до того, как его отпустят выполняющиеся команды.
+     *
+     * @param channel_name Имя канала.
+     * @throws std::invalid_argument Если канал не найден.
+     */
+    void remove_channel(const std::string& channel_name);
+
     /**
      * @brief Останавливает все каналы в контроллере.
      * 
-     * Эта функция останавливает все каналы, управляемые контроллером.
+     * Эта функция останавливает имитатор сбоев и все каналы, управляемые контроллером.
      */
     void stop();
 
@@ -66,24 +105,59 @@ public:
      */
     std::shared_ptr<IChannel> find_channel(const std::string& channel_name) const;
 
-private:
     /**
-     * @brief Функция для генерации случайных состояний для каналов.
+     * @brief Возвращает снимок списка каналов.
+     *
+     * @return Указатели на все каналы контроллера.
+     */
+    std::vector<std::shared_ptr<IChannel>> get_channels() const;
+
+    /**
+     * @brief Возвращает плотную таблицу каналов.
+     * 
+     * Используется для пакетных операций над всеми каналами таблицы.
+     * 
+     * @return Указатель на таблицу каналов.
+     */
+    std::shared_ptr<ChannelTable> get_channel_table() const;
+
+    /**
+     * @brief Возвращает имитатор сбоев каналов.
      * 
-     * Этот поток генерирует случайные состояния для всех каналов в контроллере
-     * и обновляет их состояния с определенной периодичностью.
+     * @return Ссылка на имитатор сбоев.
+     */
+    FaultInjector& get_fault_injector();
+
+private:
+    /// Карта имен каналов на каналы (снимок реестра)
+    using ChannelMap = std::unordered_map<std::string, std::shared_ptr<IChannel>>;
+
+    /**
+     * @brief Возвращает текущий снимок реестра каналов.
      */
-    void state_generator();
+    std::shared_ptr<const ChannelMap> get_snapshot() const;
+
+    /**
+     * @brief Добавляет в выгрузку метрик количество каналов и значений по каналам.
+     */
+    void collect_metrics(std::vector<MetricSample>& samples) const;
+
+    // Плотная таблица каналов
+    std::shared_ptr<ChannelTable> channel_table;
+
+    // Текущий снимок реестра: маппинг имени канала на его указатель
+    // (читается и заменяется только через std::atomic_load/std::atomic_store)
+    std::shared_ptr<const ChannelMap> channels;
 
-    // Маппинг имени канала на его указатель
-    std::unordered_map<std::string, std::shared_ptr<IChannel>> channels;
+    // Мьютекс, сериализующий изменения реестра (читатели его не берут)
+    InstrumentedMutex update_mutex{"channel_controller.update"};
 
-    // Мьютекс для потокобезопасного доступа к каналам
-    mutable std::shared_mutex map_mutex;
+    // Сторожевой таймер потоков измерений
+    AcquisitionWatchdog watchdog;
 
-    // Поток генерации состояний
-    std::thread thread_state_gen;
+    // Имитатор сбоев каналов (создается после заполнения реестра)
+    std::unique_ptr<FaultInjector> fault_injector;
 
-    // Флаг для остановки генерации состояний
-    std::atomic<bool> stop_state_gen;
+    // Идентификатор сборщика метрик каналов в реестре метрик
+    size_t metrics_collector_id;
 };
@@ -2,8 +2,11 @@
 
 #include "channel.h"
 #include "analog_input.h"
+#include "channel_table.h"
 
 #include <memory>
+#include <string>
+#include <stdexcept>
 
 /**
  * @class ChannelFactory
@@ -27,4 +30,41 @@ public:
     static std::shared_ptr<IChannel> create_analog_input_channel(const std::string& name) {
         return std::make_shared<AnalogInput>(name);
     }
+
+    /**
+     * @brief Создает канал в плотной таблице каналов.
+     * 
+     * Канал добавляется в таблицу `ChannelTable`, а наружу возвращается тонкий
+     * адаптер `TableChannel`, реализующий интерфейс `IChannel`.
+     * 
+     * @param table Таблица каналов.
+     * @param name Имя канала.
+     * @return Умный указатель на адаптер канала.
+     * @throws std::length_error Если таблица заполнена.
+     */
+    static std::shared_ptr<IChannel> create_table_channel(const std::shared_ptr<ChannelTable>& table, const std::string& name) {
+        ChannelTable::ChannelID id = table->add_channel(name);
+        return std::make_shared<TableChannel>(table, id);
+    }
+
+    /**
+     * @brief Создает канал по имени типа.
+     * 
+     * @param type Тип канала: "analog" (`AnalogInput`) или "table" (канал плотной таблицы).
+     * @param name Имя канала.
+     * @param table Таблица каналов (для типа "table").
+     * @return Умный указатель на созданный канал.
+     * @throws std::invalid_argument Если тип неизвестен.
+     * @throws std::length_error Если таблица заполнена.
+     */
+    static std::shared_ptr<IChannel> create_channel(const std::string& type, const std::string& name,
+                                                    const std::shared_ptr<ChannelTable>& table) {
+        if (type == "analog") {
+            return create_analog_input_channel(name);
+        }
+        if (type == "table") {
+            return create_table_channel(table, name);
+        }
+        throw std::invalid_argument("Unknown channel type: " + type);
+    }
 };
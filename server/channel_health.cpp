@@ -0,0 +1,110 @@
+#include "channel_health.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+/**
+ * @brief Оценка квантиля сверху (верхняя граница корзины).
+ */
+int64_t LagHistogram::Snapshot::quantile(double q) const {
+    if (count == 0) {
+        return 0;
+    }
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * static_cast<double>(count))));
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i != bucket_count; ++i) {
+        cumulative += buckets[i];
+        if (cumulative >= rank) {
+            return std::min(bucket_upper_ns(i), max_ns);
+        }
+    }
+    return max_ns;
+}
+
+/**
+ * @brief Добавляет значение.
+ */
+void LagHistogram::record(int64_t lag_ns) {
+    lag_ns = std::max<int64_t>(lag_ns, 0);
+    const uint64_t lag_us = static_cast<uint64_t>(lag_ns / 1000);
+    // Номер корзины - количество значащих бит задержки в микросекундах
+    size_t bucket = 0;
+    for (uint64_t v = lag_us; v != 0; v >>= 1) {
+        ++bucket;
+    }
+    bucket = std::min(bucket, bucket_count - 1);
+
+    buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    sum_ns.fetch_add(lag_ns, std::memory_order_relaxed);
+    int64_t current_max = max_ns.load(std::memory_order_relaxed);
+    while (lag_ns > current_max && !max_ns.compare_exchange_weak(current_max, lag_ns, std::memory_order_relaxed)) {
+    }
+}
+
+/**
+ * @brief Возвращает снимок гистограммы.
+ *
+ * Счетчики читаются по отдельности, поэтому при параллельной записи снимок
+ * может быть несогласован на несколько последних значений.
+ */
+LagHistogram::Snapshot LagHistogram::snapshot() const {
+    Snapshot result;
+    for (size_t i = 0; i != bucket_count; ++i) {
+        result.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+    }
+    result.count = count.load(std::memory_order_relaxed);
+    result.sum_ns = sum_ns.load(std::memory_order_relaxed);
+    result.max_ns = max_ns.load(std::memory_order_relaxed);
+    return result;
+}
+
+/**
+ * @brief Верхняя граница корзины (нс).
+ */
+int64_t LagHistogram::bucket_upper_ns(size_t bucket) {
+    if (bucket + 1 >= bucket_count) {
+        return std::numeric_limits<int64_t>::max();
+    }
+    return (int64_t{1} << bucket) * 1000;
+}
+
+/**
+ * @brief Отмечает проход потока измерений.
+ *
+ * Задержка считается относительно срока, опубликованного предыдущим проходом.
+ */
+void ChannelHealth::progress(int64_t now_ns, int64_t next_deadline_ns) {
+    const int64_t previous = deadline_ns.exchange(next_deadline_ns, std::memory_order_acq_rel);
+    if (previous != 0) {
+        lag.record(now_ns - previous);
+    }
+}
+
+/**
+ * @brief Отмечает начало зависания.
+ */
+void ChannelHealth::set_stalled(const std::string& new_reason) {
+    {
+        std::lock_guard<std::mutex> lock(reason_mutex);
+        reason = new_reason;
+    }
+    stalled.store(true, std::memory_order_release);
+}
+
+/**
+ * @brief Отмечает конец зависания.
+ */
+void ChannelHealth::set_recovered(int64_t stall_ns) {
+    stalls.record(stall_ns);
+    stalled.store(false, std::memory_order_release);
+}
+
+/**
+ * @brief Причина последнего зависания.
+ */
+std::string ChannelHealth::get_reason() const {
+    std::lock_guard<std::mutex> lock(reason_mutex);
+    return reason;
+}
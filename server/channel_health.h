@@ -0,0 +1,140 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @class LagHistogram
+ * @brief Гистограмма задержек с логарифмическими корзинами.
+ *
+ * Корзина 0 - задержки меньше 1 мкс, корзина i - [2^(i-1), 2^i) мкс, последняя
+ * корзина открыта сверху. Запись - несколько relaxed-атомарных операций без
+ * блокировок, поэтому гистограмму можно обновлять из потока измерений на каждом проходе.
+ */
+class LagHistogram {
+public:
+    static constexpr size_t bucket_count = 40; ///< Количество корзин
+
+    /**
+     * @struct Snapshot
+     * @brief Снимок гистограммы.
+     */
+    struct Snapshot {
+        std::array<uint64_t, bucket_count> buckets{}; ///< Количество значений по корзинам
+        uint64_t count = 0; ///< Количество значений
+        int64_t sum_ns = 0; ///< Сумма значений (нс)
+        int64_t max_ns = 0; ///< Максимальное значение (нс)
+
+        /**
+         * @brief Оценка квантиля сверху (верхняя граница корзины).
+         * @param q Уровень квантиля [0, 1].
+         * @return Значение (нс) или 0, если значений нет.
+         */
+        int64_t quantile(double q) const;
+    };
+
+    /**
+     * @brief Добавляет значение.
+     * @param lag_ns Задержка (нс); отрицательные значения считаются нулевыми.
+     */
+    void record(int64_t lag_ns);
+
+    /**
+     * @brief Возвращает снимок гистограммы.
+     */
+    Snapshot snapshot() const;
+
+    /**
+     * @brief Верхняя граница корзины (нс); для последней корзины - INT64_MAX.
+     */
+    static int64_t bucket_upper_ns(size_t bucket);
+
+private:
+    std::array<std::atomic<uint64_t>, bucket_count> buckets{}; ///< Количество значений по корзинам
+    std::atomic<uint64_t> count{0}; ///< Количество значений
+    std::atomic<int64_t> sum_ns{0}; ///< Сумма значений (нс)
+    std::atomic<int64_t> max_ns{0}; ///< Максимальное значение (нс)
+};
+
+/**
+ * @class ChannelHealth
+ * @brief Сведения о работе потока измерений канала для сторожевого таймера.
+ *
+ * Поток измерений после каждого прохода публикует срок, к которому он обязуется
+ * сделать следующий проход, и записывает в гистограмму, насколько опоздал текущий,
+ * а также ведет счетчик полученных значений.
+ * Сторожевой таймер (AcquisitionWatchdog) сравнивает срок с текущим временем
+ * и отмечает зависание. Время - монотонное MyTools::monotonic_ns(), чтобы перевод
+ * системных часов не выглядел как зависание или не скрывал его.
+ */
+class ChannelHealth {
+public:
+    /**
+     * @brief Отмечает проход потока измерений.
+     * @param now_ns Время прохода (нс, MyTools::monotonic_ns()).
+     * @param next_deadline_ns Срок следующего прохода (нс, MyTools::monotonic_ns()); 0 - проходов не ожидается.
+     */
+    void progress(int64_t now_ns, int64_t next_deadline_ns);
+
+    /**
+     * @brief Снимает ожидание проходов (измерения остановлены).
+     */
+    void disarm() { deadline_ns.store(0, std::memory_order_release); }
+
+    /**
+     * @brief Срок следующего прохода (нс); 0 - проходов не ожидается.
+     */
+    int64_t get_deadline_ns() const { return deadline_ns.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Отмечает начало зависания (вызывает сторожевой таймер).
+     * @param reason Причина.
+     */
+    void set_stalled(const std::string& reason);
+
+    /**
+     * @brief Отмечает конец зависания (вызывает сторожевой таймер).
+     * @param stall_ns Длительность зависания (нс).
+     */
+    void set_recovered(int64_t stall_ns);
+
+    /**
+     * @brief Канал сейчас считается зависшим.
+     */
+    bool is_stalled() const { return stalled.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Причина последнего зависания (пустая строка, если зависаний не было).
+     */
+    std::string get_reason() const;
+
+    /**
+     * @brief Учитывает значения, полученные потоком измерений.
+     * @param n Количество значений.
+     */
+    void add_samples(uint64_t n) { samples.fetch_add(n, std::memory_order_relaxed); }
+
+    /**
+     * @brief Количество значений, полученных потоком измерений.
+     */
+    uint64_t get_samples() const { return samples.load(std::memory_order_relaxed); }
+
+    /// Задержки проходов потока измерений относительно обещанного срока
+    const LagHistogram& get_lag() const { return lag; }
+
+    /// Длительности зависаний
+    const LagHistogram& get_stalls() const { return stalls; }
+
+private:
+    std::atomic<int64_t> deadline_ns{0}; ///< Срок следующего прохода (нс), 0 - не ожидается
+    std::atomic<bool> stalled{false}; ///< Канал считается зависшим
+    std::atomic<uint64_t> samples{0}; ///< Количество полученных значений
+    LagHistogram lag; ///< Задержки проходов
+    LagHistogram stalls; ///< Длительности зависаний
+    mutable std::mutex reason_mutex; ///< Мьютекс причины
+    std::string reason; ///< Причина последнего зависания
+};
@@ -0,0 +1,103 @@
+#include "channel_stats.h"
+#include "my_tools.h"
+#include "config.h"
+
+#include <cmath>
+#include <stdexcept>
+
+/**
+ * @brief Добавляет значение в накопитель.
+ * @param value Значение.
+ */
+void StatsAccumulator::add(float value) {
+    if (count == 0) {
+        min = value;
+        max = value;
+    } else {
+        if (value < min) min = value;
+        if (value > max) max = value;
+    }
+    ++count;
+    sum += value;
+    sum_sq += static_cast<double>(value) * value;
+}
+
+/**
+ * @brief Добавляет значения другого накопителя.
+ * @param other Накопитель.
+ */
+void StatsAccumulator::merge(const StatsAccumulator& other) {
+    if (other.count == 0) return;
+    if (count == 0) {
+        *this = other;
+        return;
+    }
+    if (other.min < min) min = other.min;
+    if (other.max > max) max = other.max;
+    count += other.count;
+    sum += other.sum;
+    sum_sq += other.sum_sq;
+}
+
+/**
+ * @brief Сбрасывает накопитель.
+ */
+void StatsAccumulator::reset() {
+    *this = StatsAccumulator();
+}
+
+double StatsAccumulator::mean() const {
+    return count ? sum / count : 0.0;
+}
+
+double StatsAccumulator::rms() const {
+    return count ? std::sqrt(sum_sq / count) : 0.0;
+}
+
+double StatsAccumulator::stddev() const {
+    if (count == 0) return 0.0;
+    double m = mean();
+    double variance = sum_sq / count - m * m;
+    return variance > 0.0 ? std::sqrt(variance) : 0.0; // Защита от отрицательной дисперсии из-за округления
+}
+
+/**
+ * @brief Приводит спецификацию окна к каноническому виду.
+ * @param spec Спецификация окна.
+ * @return Нормализованная спецификация.
+ * @throws std::invalid_argument Если спецификация некорректна.
+ */
+std::string WindowSpec::normalize(const std::string& spec) {
+    static const std::string tumbling = "tumbling:";
+    static const std::string sliding = "sliding:";
+
+    if (spec.compare(0, tumbling.size(), tumbling) == 0) {
+        return tumbling + MyTools::format_duration(MyTools::parse_duration_ns(spec.substr(tumbling.size())));
+    }
+    if (spec.compare(0, sliding.size(), sliding) == 0) {
+        return MyTools::format_duration(MyTools::parse_duration_ns(spec.substr(sliding.size())));
+    }
+    return MyTools::format_duration(MyTools::parse_duration_ns(spec));
+}
+
+/**
+ * @brief Проверяет, задает ли нормализованная спецификация неперекрывающееся окно.
+ */
+bool WindowSpec::is_tumbling(const std::string& normalized_spec) {
+    return normalized_spec.compare(0, 9, "tumbling:") == 0;
+}
+
+/**
+ * @brief Возвращает длину окна по нормализованной спецификации.
+ * @return Длина окна (нс).
+ */
+int64_t WindowSpec::length_ns(const std::string& normalized_spec) {
+    return MyTools::parse_duration_ns(is_tumbling(normalized_spec) ? normalized_spec.substr(9) : normalized_spec);
+}
+
+/**
+ * @brief Конструктор. Создает окна по умолчанию из конфигурации.
+ */
+ChannelStats::ChannelStats()
+    : WindowSet<StatsAccumulator>(MyConfig::DefaultConfig::stats_windows, MyConfig::DefaultConfig::stats_window_buckets,
+                                   MyConfig::DefaultConfig::max_stats_windows) {}
@@ -0,0 +1,393 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include "lock_stats.h"
+
+/**
+ * @struct StatsAccumulator
+ * @brief Инкрементальный накопитель статистики по выборке.
+ *
+ * Добавление значения и слияние двух накопителей выполняются за O(1).
+ */
+struct StatsAccumulator {
+    uint64_t count = 0; ///< Количество значений
+    double sum = 0.0; ///< Сумма значений
+    double sum_sq = 0.0; ///< Сумма квадратов значений
+    float min = 0.0f; ///< Минимальное значение
+    float max = 0.0f; ///< Максимальное значение
+
+    /**
+     * @brief Добавляет значение.
+     * @param value Значение.
+     */
+    void add(float value);
+
+    /**
+     * @brief Добавляет значения другого накопителя.
+     * @param other Накопитель.
+     */
+    void merge(const StatsAccumulator& other);
+
+    /**
+     * @brief Сбрасывает накопитель.
+     */
+    void reset();
+
+    /// Среднее значение
+    double mean() const;
+
+    /// Среднеквадратичное значение
+    double rms() const;
+
+    /// Стандартное отклонение (по генеральной совокупности)
+    double stddev() const;
+};
+
+/**
+ * @class WindowSpec
+ * @brief Разбор спецификаций окон.
+ *
+ * Спецификация: "<длительность>" или "sliding:<длительность>" для скользящего окна,
+ * "tumbling:<длительность>" для неперекрывающегося. Длительность: 500ms, 10s, 5m, 1h.
+ */
+class WindowSpec {
+public:
+    /**
+     * @brief Приводит спецификацию окна к каноническому виду.
+     *
+     * Скользящее окно записывается одной длительностью ("10s"), неперекрывающееся -
+     * с префиксом ("tumbling:1m"). Длительность приводится к наиболее крупным единицам.
+     *
+     * @param spec Спецификация окна.
+     * @return Нормализованная спецификация.
+     * @throws std::invalid_argument Если спецификация некорректна.
+     */
+    static std::string normalize(const std::string& spec);
+
+    /**
+     * @brief Проверяет, задает ли нормализованная спецификация неперекрывающееся окно.
+     */
+    static bool is_tumbling(const std::string& normalized_spec);
+
+    /**
+     * @brief Возвращает длину окна по нормализованной спецификации.
+     * @return Длина окна (нс).
+     */
+    static int64_t length_ns(const std::string& normalized_spec);
+};
+
+/**
+ * @class StatsWindow
+ * @brief Интерфейс окна статистики.
+ *
+ * Окно получает значения с временными метками и по запросу возвращает сводку
+ * за свой интервал. Тип сводки (Accumulator) должен поддерживать add(float),
+ * merge() и reset(); добавление значения в окно стоит одного вызова add().
+ */
+template <typename Accumulator>
+class StatsWindow {
+public:
+    /**
+     * @brief Конструктор.
+     * @param spec Спецификация окна.
+     */
+    explicit StatsWindow(const std::string& spec) : spec(spec) {}
+
+    virtual ~StatsWindow() = default;
+
+    /**
+     * @brief Добавляет значение.
+     * @param timestamp_ns Время значения (нс).
+     * @param value Значение.
+     */
+    virtual void add(int64_t timestamp_ns, float value) = 0;
+
+    /**
+     * @brief Возвращает сводку за окно.
+     * @param now_ns Текущее время (нс).
+     * @return Накопитель со статистикой окна.
+     */
+    virtual Accumulator summary(int64_t now_ns) const = 0;
+
+    /**
+     * @brief Возвращает спецификацию окна (например, "10s" или "tumbling:1m").
+     * @return Строка спецификации.
+     */
+    const std::string& get_spec() const { return spec; }
+
+protected:
+    std::string spec; ///< Спецификация окна
+};
+
+/**
+ * @class TumblingStatsWindow
+ * @brief Неперекрывающееся (tumbling) окно.
+ *
+ * Время делится на выровненные интервалы заданной длины. Сводка возвращается
+ * за последний завершенный интервал.
+ */
+template <typename Accumulator>
+class TumblingStatsWindow : public StatsWindow<Accumulator> {
+public:
+    /**
+     * @brief Конструктор.
+     * @param spec Спецификация окна.
+     * @param length_ns Длина окна (нс).
+     */
+    TumblingStatsWindow(const std::string& spec, int64_t length_ns)
+        : StatsWindow<Accumulator>(spec), length(length_ns) {}
+
+    /**
+     * @brief Добавляет значение.
+     *
+     * При переходе в новый интервал текущая статистика становится завершенной.
+     */
+    void add(int64_t timestamp_ns, float value) override {
+        int64_t index = timestamp_ns / length;
+        if (index != current_index) {
+            if (current_index >= 0) {
+                std::swap(completed, current);
+                completed_index = current_index;
+            }
+            current.reset();
+            current_index = index;
+        }
+        current.add(value);
+    }
+
+    /**
+     * @brief Возвращает статистику за последний завершенный интервал.
+     *
+     * Если в последнем завершенном интервале не было значений, возвращается пустой накопитель.
+     */
+    Accumulator summary(int64_t now_ns) const override {
+        int64_t last_completed = now_ns / length - 1;
+        if (current_index == last_completed) {
+            return current;
+        }
+        if (completed_index == last_completed) {
+            return completed;
+        }
+        return Accumulator();
+    }
+
+private:
+    int64_t length; ///< Длина окна (нс)
+    int64_t current_index = -1; ///< Номер текущего интервала
+    Accumulator current; ///< Статистика текущего интервала
+    int64_t completed_index = -1; ///< Номер последнего завершенного интервала
+    Accumulator completed; ///< Статистика последнего завершенного интервала
+};
+
+/**
+ * @class SlidingStatsWindow
+ * @brief Скользящее окно.
+ *
+ * Окно делится на фиксированное число корзин. Значение попадает в корзину своего
+ * интервала, сводка собирается слиянием корзин, попадающих в окно. Точность
+ * скольжения равна ширине одной корзины.
+ */
+template <typename Accumulator>
+class SlidingStatsWindow : public StatsWindow<Accumulator> {
+public:
+    /**
+     * @brief Конструктор.
+     * @param spec Спецификация окна.
+     * @param length_ns Длина окна (нс).
+     * @param bucket_count Количество корзин.
+     */
+    SlidingStatsWindow(const std::string& spec, int64_t length_ns, size_t bucket_count)
+        : StatsWindow<Accumulator>(spec),
+          bucket_width(std::max<int64_t>(1, length_ns / static_cast<int64_t>(bucket_count))),
+          buckets(bucket_count) {}
+
+    /**
+     * @brief Добавляет значение в корзину его интервала.
+     *
+     * Корзина, оставшаяся от предыдущего оборота кольца, сбрасывается.
+     */
+    void add(int64_t timestamp_ns, float value) override {
+        int64_t index = timestamp_ns / bucket_width;
+        Bucket& bucket = buckets[static_cast<size_t>(index) % buckets.size()];
+        if (bucket.index != index) {
+            bucket.index = index;
+            bucket.stats.reset();
+        }
+        bucket.stats.add(value);
+    }
+
+    /**
+     * @brief Сливает корзины, попадающие в окно, заканчивающееся текущим моментом.
+     */
+    Accumulator summary(int64_t now_ns) const override {
+        int64_t newest = now_ns / bucket_width;
+        int64_t oldest = newest - static_cast<int64_t>(buckets.size());
+        Accumulator result;
+        for (const auto& bucket : buckets) {
+            if (bucket.index > oldest && bucket.index <= newest) {
+                result.merge(bucket.stats);
+            }
+        }
+        return result;
+    }
+
+private:
+    /**
+     * @struct Bucket
+     * @brief Корзина скользящего окна.
+     */
+    struct Bucket {
+        int64_t index = -1; ///< Номер интервала корзины
+        Accumulator stats; ///< Статистика корзины
+    };
+
+    int64_t bucket_width; ///< Ширина корзины (нс)
+    std::vector<Bucket> buckets; ///< Кольцо корзин
+};
+
+/**
+ * @class WindowSet
+ * @brief Набор окон статистики канала.
+ *
+ * Обновляется потоком измерений канала и читается командами. Окна можно
+ * добавлять во время работы.
+ */
+template <typename Accumulator>
+class WindowSet {
+public:
+    /**
+     * @brief Конструктор.
+     * @param default_specs Окна по умолчанию через запятую.
+     * @param bucket_count Количество корзин в скользящих окнах.
+     * @param max_windows Максимальное количество окон (каждое окно обновляется каждым значением).
+     */
+    WindowSet(const std::string& default_specs, size_t bucket_count, size_t max_windows)
+        : bucket_count(bucket_count), max_windows(max_windows) {
+        std::stringstream specs(default_specs);
+        std::string spec;
+        while (std::getline(specs, spec, ',')) {
+            windows.push_back(create_window(WindowSpec::normalize(spec)));
+        }
+    }
+
+    /**
+     * @brief Добавляет значение во все окна.
+     * @param timestamp_ns Время значения (нс).
+     * @param value Значение.
+     */
+    void add_sample(int64_t timestamp_ns, float value) {
+        std::lock_guard<InstrumentedMutex> lock(mtx);
+        for (auto& window : windows) {
+            window->add(timestamp_ns, value);
+        }
+    }
+
+    /**
+     * @brief Добавляет блок значений во все окна.
+     *
+     * Мьютекс захватывается один раз на блок.
+     *
+     * @param timestamps_ns Времена значений (нс).
+     * @param values Значения.
+     * @param count Количество значений.
+     */
+    void add_samples(const int64_t* timestamps_ns, const float* values, size_t count) {
+        std::lock_guard<InstrumentedMutex> lock(mtx);
+        for (auto& window : windows) {
+            for (size_t i = 0; i != count; ++i) {
+                window->add(timestamps_ns[i], values[i]);
+            }
+        }
+    }
+
+    /**
+     * @brief Добавляет окно по спецификации.
+     *
+     * Повторное добавление существующего окна ничего не меняет.
+     *
+     * @param spec Спецификация окна.
+     * @return Нормализованная спецификация окна.
+     * @throws std::invalid_argument Если спецификация некорректна.
+     * @throws std::length_error Если окон уже максимальное количество.
+     */
+    std::string add_window(const std::string& spec) {
+        std::string normalized = WindowSpec::normalize(spec);
+        std::lock_guard<InstrumentedMutex> lock(mtx);
+        for (const auto& window : windows) {
+            if (window->get_spec() == normalized) {
+                return normalized;
+            }
+        }
+        if (windows.size() >= max_windows) {
+            throw std::length_error("too many windows, the limit is " + std::to_string(max_windows));
+        }
+        windows.push_back(create_window(normalized));
+        return normalized;
+    }
+
+    /**
+     * @brief Возвращает сводку за окно.
+     * @param spec Спецификация окна.
+     * @param now_ns Текущее время (нс).
+     * @param result Статистика окна.
+     * @return true, если окно найдено.
+     */
+    bool get_summary(const std::string& spec, int64_t now_ns, Accumulator& result) const {
+        std::string normalized = WindowSpec::normalize(spec);
+        std::lock_guard<InstrumentedMutex> lock(mtx);
+        for (const auto& window : windows) {
+            if (window->get_spec() == normalized) {
+                result = window->summary(now_ns);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Возвращает спецификацию первого окна набора (окно по умолчанию).
+     * @return Спецификация окна или пустая строка, если окон нет.
+     */
+    std::string get_default_window() const {
+        std::lock_guard<InstrumentedMutex> lock(mtx);
+        return windows.empty() ? std::string() : windows.front()->get_spec();
+    }
+
+private:
+    /**
+     * @brief Создает окно по нормализованной спецификации.
+     */
+    std::unique_ptr<StatsWindow<Accumulator>> create_window(const std::string& normalized_spec) const {
+        int64_t length = WindowSpec::length_ns(normalized_spec);
+        if (WindowSpec::is_tumbling(normalized_spec)) {
+            return std::make_unique<TumblingStatsWindow<Accumulator>>(normalized_spec, length);
+        }
+        return std::make_unique<SlidingStatsWindow<Accumulator>>(normalized_spec, length, bucket_count);
+    }
+
+    const size_t bucket_count; ///< Количество корзин в скользящих окнах
+    const size_t max_windows; ///< Максимальное количество окон
+    mutable InstrumentedMutex mtx{"channel_stats.mtx"}; ///< Мьютекс доступа к окнам
+    std::vector<std::unique_ptr<StatsWindow<Accumulator>>> windows; ///< Окна статистики
+};
+
+/**
+ * @class ChannelStats
+ * @brief Оконная статистика канала (min/max/mean/RMS/stddev).
+ *
+ * Окна по умолчанию берутся из конфигурации.
+ */
+class ChannelStats : public WindowSet<StatsAccumulator> {
+public:
+    /**
+     * @brief Конструктор. Создает окна по умолчанию из конфигурации.
+     */
+    ChannelStats();
+};
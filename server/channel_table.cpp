@@ -0,0 +1,612 @@
+#include "channel_table.h"
+#include "ranges.h"
+#include "config.h"
+#include "my_tools.h"
+#include "simd_kernels.h"
+#include "tracing.h"
+
+#include <stdexcept>
+#include <chrono>
+#include <random>
+#include <limits>
+#include <algorithm>
+
+namespace {
+
+constexpr int64_t ns_per_ms = 1000000;
+
+}
+
+/**
+ * @brief Конструктор. Выделяет массивы заданной емкости и запускает поток измерений.
+ * @param capacity Максимальное количество каналов в таблице.
+ */
+ChannelTable::ChannelTable(size_t capacity)
+    : table_capacity(capacity),
+      names(new std::string[capacity]),
+      ranges(new std::atomic<int>[capacity]),
+      frequencies(new std::atomic<int>[capacity]),
+      values(new std::atomic<float>[capacity]),
+      value_times(new std::atomic<int64_t>[capacity]),
+      states(new std::atomic<ChannelStateManager::ChannelState>[capacity]),
+      active(new std::atomic<bool>[capacity]),
+      used(new std::atomic<bool>[capacity]()),
+      stats(new std::atomic<ChannelStats*>[capacity]()),
+      quantiles(new std::atomic<ChannelQuantiles*>[capacity]()),
+      waveforms(new std::atomic<ChannelWaveform*>[capacity]()),
+      row_objects(new RowObjects[capacity]),
+      custom_source(new std::atomic<bool>[capacity]()),
+      next_deadline(new int64_t[capacity]()),
+      random_seed(static_cast<uint32_t>(MyTools::make_seed())) {
+    acquisition_thread = std::thread(&ChannelTable::acquisition_loop, this);
+}
+
+/**
+ * @brief Деструктор. Останавливает поток измерений.
+ */
+ChannelTable::~ChannelTable() {
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex);
+        stopping = true;
+    }
+    wake_cond_var.notify_all();
+    if (acquisition_thread.joinable()) {
+        acquisition_thread.join();
+    }
+}
+
+/**
+ * @brief Добавляет канал в таблицу.
+ *
+ * Ячейки новой строки заполняются до публикации счетчика, поэтому читатели
+ * никогда не видят частично инициализированный канал. Свободная строка уже
+ * сброшена потоком измерений и до возврата идентификатора никем не читается.
+ *
+ * @param name Имя канала.
+ * @return Идентификатор нового канала.
+ * @throws std::length_error Если таблица заполнена.
+ */
+ChannelTable::ChannelID ChannelTable::add_channel(const std::string& name) {
+    std::lock_guard<std::mutex> lock(add_mutex);
+    const size_t row_count = count.load(std::memory_order_relaxed);
+    ChannelID id = row_count;
+    if (!free_ids.empty()) {
+        id = free_ids.back();
+        free_ids.pop_back();
+    } else if (id >= table_capacity) {
+        throw std::length_error("Channel table is full");
+    }
+
+    names[id] = name;
+    ranges[id].store(MyConfig::DefaultConfig::range, std::memory_order_relaxed);
+    frequencies[id].store(MyConfig::DefaultConfig::polling_frequency, std::memory_order_relaxed);
+    values[id].store(0.0f, std::memory_order_relaxed);
+    value_times[id].store(0, std::memory_order_relaxed);
+    states[id].store(ChannelStateManager::ChannelState::Idle, std::memory_order_relaxed);
+    active[id].store(false, std::memory_order_relaxed);
+    used[id].store(true, std::memory_order_relaxed);
+
+    if (id == row_count) {
+        count.store(id + 1, std::memory_order_release);
+    }
+    return id;
+}
+
+/**
+ * @brief Удаляет канал из таблицы.
+ *
+ * Строка передается потоку измерений на сброс; свободной она станет после него.
+ */
+void ChannelTable::remove_channel(ChannelID id) {
+    stop(id);
+    {
+        std::lock_guard<std::mutex> lock(add_mutex);
+        removed_ids.push_back(id);
+        rows_removed.store(true, std::memory_order_release);
+    }
+    wake_acquisition();
+}
+
+/**
+ * @brief Сбрасывает строки удаленных каналов и делает их свободными.
+ *
+ * Источники сигнала снимаются до того, как строка станет свободной, чтобы не
+ * снять источник нового канала. Объекты, создаваемые по запросу, отпускаются
+ * вне мьютекса: их могут еще держать команды или хранилище.
+ */
+void ChannelTable::reset_removed_rows() {
+    if (!rows_removed.load(std::memory_order_acquire)) return;
+
+    std::vector<ChannelID> ids;
+    {
+        std::lock_guard<std::mutex> lock(add_mutex);
+        ids.swap(removed_ids);
+        rows_removed.store(false, std::memory_order_relaxed);
+    }
+    {
+        std::lock_guard<std::mutex> lock(source_mutex);
+        for (ChannelID id : ids) {
+            sources.erase(id);
+        }
+    }
+
+    std::vector<RowObjects> released;
+    released.reserve(ids.size());
+    std::lock_guard<std::mutex> lock(add_mutex);
+    for (ChannelID id : ids) {
+        stats[id].store(nullptr, std::memory_order_relaxed);
+        quantiles[id].store(nullptr, std::memory_order_relaxed);
+        waveforms[id].store(nullptr, std::memory_order_relaxed);
+        released.push_back(std::move(row_objects[id]));
+        row_objects[id] = RowObjects();
+
+        names[id].clear();
+        ranges[id].store(MyConfig::DefaultConfig::range, std::memory_order_relaxed);
+        frequencies[id].store(MyConfig::DefaultConfig::polling_frequency, std::memory_order_relaxed);
+        values[id].store(0.0f, std::memory_order_relaxed);
+        value_times[id].store(0, std::memory_order_relaxed);
+        states[id].store(ChannelStateManager::ChannelState::Idle, std::memory_order_relaxed);
+        active[id].store(false, std::memory_order_relaxed);
+        used[id].store(false, std::memory_order_relaxed);
+        custom_source[id].store(false, std::memory_order_relaxed);
+        next_deadline[id] = 0;
+        free_ids.push_back(id);
+    }
+}
+
+/**
+ * @brief Возвращает количество строк таблицы, когда-либо занятых каналами.
+ * @return Количество строк.
+ */
+size_t ChannelTable::size() const {
+    return count.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief Возвращает емкость таблицы.
+ * @return Максимальное количество каналов.
+ */
+size_t ChannelTable::capacity() const {
+    return table_capacity;
+}
+
+/**
+ * @brief Проверяет идентификатор канала.
+ * @throws std::out_of_range Если идентификатор некорректен.
+ */
+void ChannelTable::check_id(ChannelID id) const {
+    if (id >= size()) {
+        throw std::out_of_range("Invalid ChannelID");
+    }
+}
+
+const std::string& ChannelTable::get_name(ChannelID id) const {
+    check_id(id);
+    return names[id];
+}
+
+/**
+ * @brief Устанавливает диапазон канала.
+ * @throws std::out_of_range Если диапазон некорректен.
+ */
+void ChannelTable::set_range(ChannelID id, int range) {
+    check_id(id);
+    if (range < 0 || range >= static_cast<int>(RangeManager::size())) {
+        throw std::out_of_range("Invalid range value");
+    }
+    ranges[id].store(range, std::memory_order_relaxed);
+}
+
+int ChannelTable::get_range(ChannelID id) const {
+    check_id(id);
+    return ranges[id].load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Устанавливает период опроса канала.
+ *
+ * Поток измерений будится, чтобы более короткий период вступил в силу сразу.
+ *
+ * @throws std::invalid_argument Если частота некорректна.
+ */
+void ChannelTable::set_frequency(ChannelID id, int frequency) {
+    check_id(id);
+    if (frequency <= 0) {
+        throw std::invalid_argument("Frequency must be positive");
+    }
+    frequencies[id].store(frequency, std::memory_order_relaxed);
+    // Новый период должен вступить в силу сразу, а не после сна по старому периоду
+    wake_acquisition();
+}
+
+int ChannelTable::get_frequency(ChannelID id) const {
+    check_id(id);
+    return frequencies[id].load(std::memory_order_relaxed);
+}
+
+float ChannelTable::get_measuring_value(ChannelID id) const {
+    check_id(id);
+    return values[id].load(std::memory_order_relaxed);
+}
+
+int64_t ChannelTable::get_measuring_time(ChannelID id) const {
+    check_id(id);
+    return value_times[id].load(std::memory_order_acquire);
+}
+
+ChannelStateManager::ChannelState ChannelTable::get_state(ChannelID id) const {
+    check_id(id);
+    return states[id].load(std::memory_order_relaxed);
+}
+
+void ChannelTable::set_state(ChannelID id, ChannelStateManager::ChannelState state) {
+    check_id(id);
+    states[id].store(state, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Атомарно меняет состояние канала, если оно равно ожидаемому.
+ * @return true, если состояние изменено.
+ */
+bool ChannelTable::exchange_state(ChannelID id, ChannelStateManager::ChannelState expected, ChannelStateManager::ChannelState desired) {
+    check_id(id);
+    return states[id].compare_exchange_strong(expected, desired, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Запускает измерения на канале.
+ *
+ * Канал будет опрошен потоком измерений при ближайшем проходе.
+ */
+void ChannelTable::start(ChannelID id) {
+    check_id(id);
+    if (active[id].exchange(true)) return;
+    states[id].store(ChannelStateManager::ChannelState::Measure, std::memory_order_relaxed);
+    wake_acquisition();
+}
+
+/**
+ * @brief Останавливает измерения на канале.
+ */
+void ChannelTable::stop(ChannelID id) {
+    check_id(id);
+    if (!active[id].exchange(false)) return;
+    states[id].store(ChannelStateManager::ChannelState::Idle, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Возвращает оконную статистику канала, создавая ее при первом обращении.
+ * @return Статистика (таблица владеет ею, пока канал не удален).
+ */
+std::shared_ptr<ChannelStats> ChannelTable::get_stats(ChannelID id) {
+    check_id(id);
+    std::lock_guard<std::mutex> lock(add_mutex);
+    std::shared_ptr<ChannelStats>& channel_stats = row_objects[id].stats;
+    if (!channel_stats) {
+        channel_stats = std::make_shared<ChannelStats>();
+        stats[id].store(channel_stats.get(), std::memory_order_release);
+    }
+    return channel_stats;
+}
+
+/**
+ * @brief Возвращает оконные скетчи квантилей канала, создавая их при первом обращении.
+ * @return Скетчи (таблица владеет ими, пока канал не удален).
+ */
+std::shared_ptr<ChannelQuantiles> ChannelTable::get_quantiles(ChannelID id) {
+    check_id(id);
+    std::lock_guard<std::mutex> lock(add_mutex);
+    std::shared_ptr<ChannelQuantiles>& channel_quantiles = row_objects[id].quantiles;
+    if (!channel_quantiles) {
+        channel_quantiles = std::make_shared<ChannelQuantiles>();
+        quantiles[id].store(channel_quantiles.get(), std::memory_order_release);
+    }
+    return channel_quantiles;
+}
+
+/**
+ * @brief Возвращает историю значений канала, создавая ее при первом обращении.
+ * @return История (таблица владеет ею, пока канал не удален).
+ */
+std::shared_ptr<ChannelWaveform> ChannelTable::get_waveform(ChannelID id) {
+    check_id(id);
+    std::lock_guard<std::mutex> lock(add_mutex);
+    std::shared_ptr<ChannelWaveform>& channel_waveform = row_objects[id].waveform;
+    if (!channel_waveform) {
+        channel_waveform = std::make_shared<ChannelWaveform>();
+        waveforms[id].store(channel_waveform.get(), std::memory_order_release);
+    }
+    return channel_waveform;
+}
+
+/**
+ * @brief Устанавливает источник сигнала канала.
+ * @throws std::invalid_argument Если источник не задан.
+ */
+void ChannelTable::set_source(ChannelID id, std::shared_ptr<ISignalSource> source) {
+    check_id(id);
+    if (!source) {
+        throw std::invalid_argument("Signal source is not specified");
+    }
+    std::lock_guard<std::mutex> lock(source_mutex);
+    sources[id] = std::move(source);
+    custom_source[id].store(true, std::memory_order_release);
+}
+
+/**
+ * @brief Возвращает источник сигнала канала.
+ * @return Источник или nullptr, если канал использует шум по умолчанию.
+ */
+std::shared_ptr<ISignalSource> ChannelTable::get_source(ChannelID id) const {
+    check_id(id);
+    std::lock_guard<std::mutex> lock(source_mutex);
+    auto it = sources.find(id);
+    return it != sources.end() ? it->second : nullptr;
+}
+
+/**
+ * @brief Получает значение канала от его собственного источника сигнала.
+ */
+float ChannelTable::generate_from_source(ChannelID id, int64_t timestamp_ns, const RangeManager::RangeConfig& range) {
+    std::shared_ptr<ISignalSource> source;
+    {
+        std::lock_guard<std::mutex> lock(source_mutex);
+        source = sources[id];
+    }
+    float value = 0.0f;
+    SignalBlock block{timestamp_ns, frequencies[id].load(std::memory_order_relaxed) * ns_per_ms,
+                      range.min_value, range.max_value, &value, 1};
+    source->generate(block);
+    return value;
+}
+
+/**
+ * @brief Запускает измерения на всех каналах таблицы.
+ */
+void ChannelTable::start_all() {
+    const size_t n = size();
+    for (size_t id = 0; id != n; ++id) {
+        if (used[id].load(std::memory_order_relaxed) && !active[id].exchange(true)) {
+            states[id].store(ChannelStateManager::ChannelState::Measure, std::memory_order_relaxed);
+        }
+    }
+    wake_acquisition();
+}
+
+/**
+ * @brief Останавливает измерения на всех каналах таблицы.
+ */
+void ChannelTable::stop_all() {
+    const size_t n = size();
+    for (size_t id = 0; id != n; ++id) {
+        if (active[id].exchange(false)) {
+            states[id].store(ChannelStateManager::ChannelState::Idle, std::memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * @brief Снимает снимок значений, диапазонов и состояний всех каналов.
+ *
+ * Каждый массив читается одним последовательным проходом.
+ *
+ * @return Снимок таблицы.
+ */
+ChannelTable::Snapshot ChannelTable::snapshot() const {
+    const size_t n = size();
+    Snapshot result;
+    result.values.resize(n);
+    result.ranges.resize(n);
+    result.states.resize(n);
+    for (size_t id = 0; id != n; ++id) {
+        result.values[id] = values[id].load(std::memory_order_relaxed);
+    }
+    for (size_t id = 0; id != n; ++id) {
+        result.ranges[id] = ranges[id].load(std::memory_order_relaxed);
+    }
+    for (size_t id = 0; id != n; ++id) {
+        result.states[id] = states[id].load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+/**
+ * @brief Выполняет измерения для всех каналов, срок опроса которых наступил.
+ *
+ * Первый линейный проход отбирает каналы, срок которых наступил, затем случайные
+ * значения для всех отобранных каналов генерируются одним вызовом векторного ядра
+ * и раскладываются по их диапазонам. Конфигурации диапазонов копируются один раз
+ * на проход, чтобы не захватывать мьютекс RangeManager для каждого канала.
+ *
+ * @param now_ns Текущее время (нс).
+ * @return Ближайший срок следующего измерения (нс) или INT64_MAX.
+ */
+int64_t ChannelTable::acquire_due(int64_t now_ns) {
+    std::vector<RangeManager::RangeConfig> range_configs;
+    const size_t range_count = RangeManager::size();
+    range_configs.reserve(range_count);
+    for (size_t i = 0; i != range_count; ++i) {
+        range_configs.push_back(RangeManager::get_range(i));
+    }
+
+    // Отбираем каналы, срок опроса которых наступил
+    int64_t earliest = std::numeric_limits<int64_t>::max();
+    due_ids.clear();
+    const size_t n = size();
+    for (size_t id = 0; id != n; ++id) {
+        if (!active[id].load(std::memory_order_relaxed)) continue;
+
+        const int64_t period = frequencies[id].load(std::memory_order_relaxed) * ns_per_ms;
+        // Срок, назначенный по прежнему (более длинному) периоду, подтягивается к новому
+        next_deadline[id] = std::min(next_deadline[id], now_ns + period);
+        if (next_deadline[id] <= now_ns) {
+            due_ids.push_back(id);
+            // Если проход опоздал больше чем на период, не пытаемся наверстать пропущенные опросы
+            next_deadline[id] = std::max(next_deadline[id] + period, now_ns);
+        }
+        earliest = std::min(earliest, next_deadline[id]);
+    }
+
+    // Генерируем значения [0, 1) для всех отобранных каналов одним пакетом
+    const size_t due_count = due_ids.size();
+    due_units.resize(due_count);
+    Simd::generate_in_range(due_units.data(), due_count, 0.0f, 1.0f, random_seed, sample_counter);
+    sample_counter += static_cast<uint32_t>(due_count);
+
+    const int64_t timestamp = MyTools::now_ns();
+    for (size_t k = 0; k != due_count; ++k) {
+        const ChannelID id = due_ids[k];
+        const RangeManager::RangeID range_id = static_cast<RangeManager::RangeID>(ranges[id].load(std::memory_order_relaxed));
+        const auto& range = range_configs[range_id];
+        float value = custom_source[id].load(std::memory_order_acquire)
+            ? generate_from_source(id, timestamp, range)
+            : range.min_value + due_units[k] * (range.max_value - range.min_value);
+        values[id].store(value, std::memory_order_relaxed);
+        value_times[id].store(timestamp, std::memory_order_release);
+        if (ChannelStats* channel_stats = stats[id].load(std::memory_order_acquire)) {
+            channel_stats->add_sample(timestamp, value);
+        }
+        if (ChannelQuantiles* channel_quantiles = quantiles[id].load(std::memory_order_acquire)) {
+            channel_quantiles->add_sample(timestamp, value);
+        }
+        if (ChannelWaveform* channel_waveform = waveforms[id].load(std::memory_order_acquire)) {
+            channel_waveform->add_sample(timestamp, value, range_id);
+        }
+    }
+    health.add_samples(due_count);
+    return earliest;
+}
+
+/**
+ * @brief Будит поток измерений для пересчета ближайшего срока.
+ */
+void ChannelTable::wake_acquisition() {
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex);
+        wake_pending = true;
+    }
+    wake_cond_var.notify_one();
+}
+
+/**
+ * @brief Цикл потока измерений таблицы.
+ *
+ * Выполняет проход по таблице и спит до ближайшего срока опроса или до
+ * запуска нового канала.
+ */
+void ChannelTable::acquisition_loop() {
+    Tracer::get_instance().set_thread_name("acquisition table");
+    std::unique_lock<std::mutex> lock(wake_mutex);
+    while (!stopping) {
+        wake_pending = false;
+        lock.unlock();
+        reset_removed_rows();
+        const int64_t now = MyTools::monotonic_ns();
+        int64_t earliest;
+        {
+            TraceSpan span("acquire_table", "acquisition");
+            earliest = acquire_due(now);
+        }
+        health.progress(now, earliest == std::numeric_limits<int64_t>::max() ? 0 : earliest);
+        lock.lock();
+
+        if (earliest == std::numeric_limits<int64_t>::max()) {
+            wake_cond_var.wait(lock, [this] { return stopping || wake_pending; });
+        } else {
+            auto timeout = std::chrono::nanoseconds(earliest - MyTools::monotonic_ns());
+            wake_cond_var.wait_for(lock, timeout, [this] { return stopping || wake_pending; });
+        }
+    }
+}
+
+/**
+ * @brief Конструктор адаптера.
+ * @param table Таблица каналов.
+ * @param id Идентификатор канала в таблице.
+ */
+TableChannel::TableChannel(std::shared_ptr<ChannelTable> table, ChannelTable::ChannelID id)
+    : table(std::move(table)), id(id) {}
+
+TableChannel::~TableChannel() {
+    table->remove_channel(id);
+}
+
+const std::string& TableChannel::get_name() const {
+    return table->get_name(id);
+}
+
+void TableChannel::start() {
+    table->start(id);
+}
+
+void TableChannel::stop() {
+    table->stop(id);
+}
+
+void TableChannel::set_range(int range) {
+    table->set_range(id, range);
+}
+
+int TableChannel::get_range() const {
+    return table->get_range(id);
+}
+
+void TableChannel::set_frequency(int frequency) {
+    table->set_frequency(id, frequency);
+}
+
+int TableChannel::get_frequency() const {
+    return table->get_frequency(id);
+}
+
+void TableChannel::set_period_ns(int64_t period_ns) {
+    if (period_ns <= 0 || period_ns % ns_per_ms != 0) {
+        throw std::invalid_argument("Table channels support whole-millisecond periods only");
+    }
+    table->set_frequency(id, static_cast<int>(period_ns / ns_per_ms));
+}
+
+int64_t TableChannel::get_period_ns() const {
+    return table->get_frequency(id) * ns_per_ms;
+}
+
+float TableChannel::get_measuring_value() const {
+    return table->get_measuring_value(id);
+}
+
+int64_t TableChannel::get_measuring_time() const {
+    return table->get_measuring_time(id);
+}
+
+ChannelStateManager::ChannelState TableChannel::get_state() const {
+    return table->get_state(id);
+}
+
+void TableChannel::set_state(ChannelStateManager::ChannelState new_state) {
+    table->set_state(id, new_state);
+}
+
+std::shared_ptr<ChannelStats> TableChannel::get_stats() {
+    return table->get_stats(id);
+}
+
+std::shared_ptr<ChannelQuantiles> TableChannel::get_quantiles() {
+    return table->get_quantiles(id);
+}
+
+std::shared_ptr<ChannelWaveform> TableChannel::get_waveform() {
+    return table->get_waveform(id);
+}
+
+std::shared_ptr<ChannelHealth> TableChannel::get_health() {
+    return std::shared_ptr<ChannelHealth>(table, &table->get_health());
+}
+
+void TableChannel::set_source(std::shared_ptr<ISignalSource> source) {
+    table->set_source(id, std::move(source));
+}
+
+std::shared_ptr<ISignalSource> TableChannel::get_source() const {
+    std::shared_ptr<ISignalSource> source = table->get_source(id);
+    return source ? source : std::make_shared<NoiseSource>();
+}
@@ -0,0 +1,340 @@
+#pragma once
+
+#include "channel.h"
+#include "ranges.h"
+#include "channel_stats.h"
+#include "quantile_sketch.h"
+#include "waveform.h"
+#include "channel_health.h"
+#include "signal_source.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <unordered_map>
+#include <cstdint>
+
+/**
+ * @class ChannelTable
+ * @brief Плотное хранилище каналов в виде структуры массивов (SoA).
+ *
+ * Предназначено для очень большого числа (10k+) моделируемых каналов. Вместо отдельного
+ * объекта с собственными мьютексами и потоком на каждый канал все параметры хранятся
+ * в параллельных массивах, индексом в которых служит идентификатор канала. Измерения
+ * для всех каналов выполняет один поток, проходящий таблицу линейно, поэтому обход
+ * и снятие снимка всех каналов не требуют виртуальных вызовов и блокировок.
+ *
+ * Емкость таблицы задается при создании и не меняется, поэтому массивы никогда
+ * не перераспределяются и читаются без блокировок. Строки удаленных каналов
+ * сбрасываются и используются для новых каналов.
+ */
+class ChannelTable {
+public:
+    using ChannelID = size_t; ///< Идентификатор канала (индекс в таблице)
+
+    /**
+     * @struct Snapshot
+     * @brief Снимок состояния всех каналов таблицы.
+     */
+    struct Snapshot {
+        std::vector<float> values; ///< Последние измеренные значения
+        std::vector<int> ranges; ///< Диапазоны
+        std::vector<ChannelStateManager::ChannelState> states; ///< Состояния
+    };
+
+    /**
+     * @brief Конструктор. Выделяет массивы заданной емкости и запускает поток измерений.
+     * @param capacity Максимальное количество каналов в таблице.
+     */
+    explicit ChannelTable(size_t capacity);
+
+    /**
+     * @brief Деструктор. Останавливает поток измерений.
+     */
+    ~ChannelTable();
+
+    ChannelTable(const ChannelTable&) = delete;
+    ChannelTable& operator=(const ChannelTable&) = delete;
+
+    /**
+     * @brief Добавляет канал в таблицу.
+     *
+     * Сначала занимается свободная строка удаленного канала, затем новая.
+     *
+     * @param name Имя канала.
+     * @return Идентификатор нового канала.
+     * @throws std::length_error Если таблица заполнена.
+     */
+    ChannelID add_channel(const std::string& name);
+
+    /**
+     * @brief Удаляет канал из таблицы.
+     *
+     * Канал останавливается сразу, а строку сбрасывает поток измерений перед
+     * следующим проходом, после чего она становится свободной. Статистика, скетчи
+     * и история канала освобождаются, когда их отпустят и остальные владельцы.
+     * После вызова идентификатор использовать нельзя.
+     */
+    void remove_channel(ChannelID id);
+
+    /**
+     * @brief Возвращает количество строк таблицы, когда-либо занятых каналами.
+     *
+     * Идентификаторы всех каналов меньше этого значения; среди строк могут
+     * быть свободные (в состоянии Idle, без измерений).
+     *
+     * @return Количество строк.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Возвращает емкость таблицы.
+     * @return Максимальное количество каналов.
+     */
+    size_t capacity() const;
+
+    /// @name Доступ к отдельному каналу
+    /// @{
+    const std::string& get_name(ChannelID id) const;
+    void set_range(ChannelID id, int range);
+    int get_range(ChannelID id) const;
+    void set_frequency(ChannelID id, int frequency);
+    int get_frequency(ChannelID id) const;
+    float get_measuring_value(ChannelID id) const;
+    int64_t get_measuring_time(ChannelID id) const;
+    ChannelStateManager::ChannelState get_state(ChannelID id) const;
+    void set_state(ChannelID id, ChannelStateManager::ChannelState state);
+    void start(ChannelID id);
+    void stop(ChannelID id);
+
+    /**
+     * @brief Атомарно меняет состояние канала, если оно равно ожидаемому.
+     * @return true, если состояние изменено.
+     */
+    bool exchange_state(ChannelID id, ChannelStateManager::ChannelState expected, ChannelStateManager::ChannelState desired);
+
+    /**
+     * @brief Возвращает оконную статистику канала.
+     *
+     * Статистика создается при первом обращении, чтобы каналы, которые никто
+     * не запрашивает, не тратили на нее память и время.
+     *
+     * @return Статистика (таблица владеет ею, пока канал не удален).
+     */
+    std::shared_ptr<ChannelStats> get_stats(ChannelID id);
+
+    /**
+     * @brief Возвращает оконные скетчи квантилей канала.
+     *
+     * Как и статистика, создаются при первом обращении.
+     *
+     * @return Скетчи (таблица владеет ими, пока канал не удален).
+     */
+    std::shared_ptr<ChannelQuantiles> get_quantiles(ChannelID id);
+
+    /**
+     * @brief Возвращает историю значений канала для осциллограмм.
+     *
+     * История создается при первом обращении и накапливается с этого момента.
+     *
+     * @return История (таблица владеет ею, пока канал не удален).
+     */
+    std::shared_ptr<ChannelWaveform> get_waveform(ChannelID id);
+
+    /**
+     * @brief Устанавливает источник сигнала канала.
+     *
+     * Каналы без собственного источника генерируют равномерный шум общим
+     * векторным пакетом; каналы с источником опрашивают его по одному значению.
+     *
+     * @param source Источник сигнала.
+     * @throws std::invalid_argument Если источник не задан.
+     */
+    void set_source(ChannelID id, std::shared_ptr<ISignalSource> source);
+
+    /**
+     * @brief Возвращает источник сигнала канала.
+     * @return Источник или nullptr, если канал использует шум по умолчанию.
+     */
+    std::shared_ptr<ISignalSource> get_source(ChannelID id) const;
+    /// @}
+
+    /**
+     * @brief Возвращает сведения о работе потока измерений таблицы (общие для всех ее каналов).
+     */
+    ChannelHealth& get_health() { return health; }
+
+    /// @name Пакетные операции над всеми каналами
+    /// @{
+
+    /**
+     * @brief Запускает измерения на всех каналах таблицы.
+     */
+    void start_all();
+
+    /**
+     * @brief Останавливает измерения на всех каналах таблицы.
+     */
+    void stop_all();
+
+    /**
+     * @brief Снимает снимок значений, диапазонов и состояний всех каналов одним линейным проходом.
+     * @return Снимок таблицы.
+     */
+    Snapshot snapshot() const;
+
+    /**
+     * @brief Выполняет измерения для всех каналов, срок опроса которых наступил.
+     *
+     * Один линейный проход по таблице. Вызывается потоком измерений.
+     *
+     * @param now_ns Текущее время (нс, MyTools::monotonic_ns()).
+     * @return Ближайший срок следующего измерения (нс) или INT64_MAX, если активных каналов нет.
+     */
+    int64_t acquire_due(int64_t now_ns);
+    /// @}
+
+private:
+    /**
+     * @brief Цикл потока измерений таблицы.
+     */
+    void acquisition_loop();
+
+    /**
+     * @brief Будит поток измерений для пересчета ближайшего срока.
+     */
+    void wake_acquisition();
+
+    /**
+     * @brief Сбрасывает строки удаленных каналов и делает их свободными.
+     *
+     * Вызывается потоком измерений между проходами, поэтому проход не видит
+     * строку сброшенной наполовину.
+     */
+    void reset_removed_rows();
+
+    /**
+     * @brief Проверяет идентификатор канала.
+     * @throws std::out_of_range Если идентификатор некорректен.
+     */
+    void check_id(ChannelID id) const;
+
+    /**
+     * @brief Получает значение канала от его собственного источника сигнала.
+     */
+    float generate_from_source(ChannelID id, int64_t timestamp_ns, const RangeManager::RangeConfig& range);
+
+    /**
+     * @struct RowObjects
+     * @brief Объекты канала, создаваемые по запросу.
+     *
+     * Поток измерений обращается к ним через атомарные указатели stats, quantiles
+     * и waveforms; владеет ими строка вместе с получившими их командами и хранилищем.
+     */
+    struct RowObjects {
+        std::shared_ptr<ChannelStats> stats; ///< Оконная статистика
+        std::shared_ptr<ChannelQuantiles> quantiles; ///< Скетчи квантилей
+        std::shared_ptr<ChannelWaveform> waveform; ///< История значений
+    };
+
+    const size_t table_capacity; ///< Емкость таблицы
+    std::atomic<size_t> count{0}; ///< Количество когда-либо занятых строк
+
+    std::unique_ptr<std::string[]> names; ///< Имена каналов
+    std::unique_ptr<std::atomic<int>[]> ranges; ///< Диапазоны
+    std::unique_ptr<std::atomic<int>[]> frequencies; ///< Периоды опроса (мс)
+    std::unique_ptr<std::atomic<float>[]> values; ///< Последние измеренные значения
+    std::unique_ptr<std::atomic<int64_t>[]> value_times; ///< Время последних значений (нс от эпохи)
+    std::unique_ptr<std::atomic<ChannelStateManager::ChannelState>[]> states; ///< Состояния
+    std::unique_ptr<std::atomic<bool>[]> active; ///< Признаки работы измерений
+    std::unique_ptr<std::atomic<bool>[]> used; ///< Признаки занятости строки каналом
+    std::unique_ptr<std::atomic<ChannelStats*>[]> stats; ///< Оконная статистика (создается по запросу)
+    std::unique_ptr<std::atomic<ChannelQuantiles*>[]> quantiles; ///< Скетчи квантилей (создаются по запросу)
+    std::unique_ptr<std::atomic<ChannelWaveform*>[]> waveforms; ///< Истории значений (создаются по запросу)
+    std::unique_ptr<RowObjects[]> row_objects; ///< Владение объектами, создаваемыми по запросу (под add_mutex)
+    std::unique_ptr<std::atomic<bool>[]> custom_source; ///< Признаки собственного источника сигнала
+    std::unique_ptr<int64_t[]> next_deadline; ///< Сроки следующего измерения (нс), только для потока измерений
+
+    // Рабочие буферы прохода измерений (только для потока измерений)
+    std::vector<ChannelID> due_ids; ///< Каналы, срок опроса которых наступил
+    std::vector<float> due_units; ///< Случайные значения [0, 1) для отобранных каналов
+    uint32_t random_seed; ///< Зерно генератора значений
+    uint32_t sample_counter = 0; ///< Номер следующего значения генератора
+
+    std::mutex add_mutex; ///< Мьютекс добавления и удаления каналов
+    std::vector<ChannelID> free_ids; ///< Свободные строки (под add_mutex)
+    std::vector<ChannelID> removed_ids; ///< Строки удаленных каналов, ожидающие сброса (под add_mutex)
+    std::atomic<bool> rows_removed{false}; ///< Есть строки, ожидающие сброса
+
+    mutable std::mutex source_mutex; ///< Мьютекс источников сигнала
+    std::unordered_map<ChannelID, std::shared_ptr<ISignalSource>> sources; ///< Собственные источники сигнала каналов
+
+    std::mutex wake_mutex; ///< Мьютекс ожидания потока измерений
+    std::condition_variable wake_cond_var; ///< Условная переменная ожидания потока измерений
+    bool wake_pending = false; ///< Запрос на внеочередной проход
+    bool stopping = false; ///< Флаг остановки потока измерений
+    ChannelHealth health; ///< Сведения о работе потока измерений
+    std::thread acquisition_thread; ///< Поток измерений
+};
+
+/**
+ * @class TableChannel
+ * @brief Тонкий адаптер канала таблицы к интерфейсу IChannel.
+ *
+ * Позволяет использовать каналы из ChannelTable в существующих командах и контроллере.
+ * Хранит только указатель на таблицу и идентификатор канала.
+ *
+ * При уничтожении адаптера (удалении канала из контроллера) канал удаляется
+ * из таблицы, и его строка освобождается для новых каналов.
+ */
+class TableChannel : public IChannel {
+public:
+    /**
+     * @brief Конструктор.
+     * @param table Таблица каналов.
+     * @param id Идентификатор канала в таблице.
+     */
+    TableChannel(std::shared_ptr<ChannelTable> table, ChannelTable::ChannelID id);
+
+    /**
+     * @brief Деструктор. Удаляет канал из таблицы.
+     */
+    ~TableChannel() override;
+
+    const std::string& get_name() const override;
+    void start() override;
+    void stop() override;
+    void set_range(int range) override;
+    int get_range() const override;
+    void set_frequency(int frequency) override;
+    int get_frequency() const override;
+
+    /**
+     * @brief Устанавливает период опроса.
+     *
+     * Таблица планирует опросы с точностью до миллисекунды, поэтому период
+     * должен быть кратен миллисекунде.
+     *
+     * @throws std::invalid_argument Если период не кратен миллисекунде.
+     */
+    void set_period_ns(int64_t period_ns) override;
+    int64_t get_period_ns() const override;
+    float get_measuring_value() const override;
+    int64_t get_measuring_time() const override;
+    ChannelStateManager::ChannelState get_state() const override;
+    void set_state(ChannelStateManager::ChannelState new_state) override;
+    std::shared_ptr<ChannelStats> get_stats() override;
+    std::shared_ptr<ChannelQuantiles> get_quantiles() override;
+    std::shared_ptr<ChannelWaveform> get_waveform() override;
+    std::shared_ptr<ChannelHealth> get_health() override;
+    void set_source(std::shared_ptr<ISignalSource> source) override;
+    std::shared_ptr<ISignalSource> get_source() const override;
+
+private:
+    std::shared_ptr<ChannelTable> table; ///< Таблица каналов
+    ChannelTable::ChannelID id; ///< Идентификатор канала в таблице
+};
@@ -6,6 +6,7 @@
 #include <memory>
 #include <functional>
 #include <shared_mutex>
+#include "lock_stats.h"
 
 /**
  * @class CommandFactory
@@ -26,6 +27,12 @@ public:
     /// Тип команды (функция, которая создает команду на основе канала и параметров)
     using TypeCommand = std::function<std::shared_ptr<ICommand>(TypeChannel, TypeParams)>;
 
+    /// Тип контроллера, с которым работают команды реестра каналов
+    using TypeController = ChannelController&;
+
+    /// Тип команды реестра каналов (функция, которая создает команду на основе контроллера и параметров)
+    using TypeControllerCommand = std::function<std::shared_ptr<ICommand>(TypeController, TypeParams)>;
+
     /**
      * @brief Создает команду на основе имени команды и переданных параметров.
      * 
@@ -48,7 +55,83 @@ public:
         return nullptr; // Команда не найдена
     }
 
+    /**
+     * @brief Создает команду реестра каналов.
+     * 
+     * Такие команды работают с контроллером каналов, а не с найденным каналом:
+     * канала, названного в первом параметре, может еще не существовать.
+     * 
+     * @param command_name Имя команды для создания.
+     * @param controller Контроллер каналов.
+     * @param params Параметры, передаваемые в команду.
+     * @return Умный указатель на созданную команду или `nullptr`, если это не команда реестра.
+     */
+    static std::shared_ptr<ICommand> create_controller_command(
+        const std::string& command_name, TypeController controller, TypeParams params) {
+        const auto& command_map = get_controller_command_map();
+        auto it = command_map.find(command_name);
+        if (it != command_map.end()) {
+            return it->second(controller, params);
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief Проверяет, что команда с таким именем существует.
+     *
+     * Используется для меток метрик: имена неизвестных команд приходят от клиентов
+     * и не должны порождать новые метрики.
+     *
+     * @param command_name Имя команды.
+     * @return true, если команда есть в одной из карт команд.
+     */
+    static bool has_command(const std::string& command_name) {
+        if (get_controller_command_map().count(command_name)) {
+            return true;
+        }
+        std::shared_lock lock(get_mutex());
+        return get_command_map().count(command_name) != 0;
+    }
+
 private:
+    /**
+     * @brief Возвращает ссылку на карту команд реестра каналов.
+     *
+     * @return Ссылка на карту команд.
+     */
+    static const std::unordered_map<std::string, TypeControllerCommand>& get_controller_command_map() {
+        static const std::unordered_map<std::string, TypeControllerCommand> command_map = {
+            {"create_channel", [](TypeController controller, TypeParams params) {
+                return std::make_shared<CreateChannelCommand>(controller, params);
+            }},
+            {"remove_channel", [](TypeController controller, TypeParams params) {
+                return std::make_shared<RemoveChannelCommand>(controller, params);
+            }},
+            {"set_faults", [](TypeController controller, TypeParams params) {
+                return std::make_shared<SetFaultsCommand>(controller, params);
+            }},
+            {"clear_faults", [](TypeController controller, TypeParams params) {
+                return std::make_shared<ClearFaultsCommand>(controller, params);
+            }},
+            {"get_faults", [](TypeController controller, TypeParams params) {
+                return std::make_shared<GetFaultsCommand>(controller, params);
+            }},
+            {"get_metrics", [](TypeController controller, TypeParams params) {
+                return std::make_shared<GetMetricsCommand>(controller, params);
+            }},
+            {"get_lock_stats", [](TypeController controller, TypeParams params) {
+                return std::make_shared<GetLockStatsCommand>(controller, params);
+            }},
+            {"trace", [](TypeController controller, TypeParams params) {
+                return std::make_shared<TraceCommand>(controller, params);
+            }},
+            {"ping", [](TypeController controller, TypeParams params) {
+                return std::make_shared<PingCommand>(controller, params);
+            }}
+        };
+        return command_map;
+    }
+
     /**
      * @brief Возвращает ссылку на карту команд.
      * 
@@ -78,6 +161,42 @@ private:
             }},
             {"set_frequency", [](TypeChannel channel, TypeParams params) {
                 return std::make_shared<SetFrequencyCommand>(channel, params);
+            }},
+            {"set_period", [](TypeChannel channel, TypeParams params) {
+                return std::make_shared<SetPeriodCommand>(channel, params, false);
+            }},
+            {"set_sample_rate", [](TypeChannel channel, TypeParams params) {
+                return std::make_shared<SetPeriodCommand>(channel, params, true);
+            }},
+            {"get_stats", [](TypeChannel channel, TypeParams params) {
+                return std::make_shared<GetStatsCommand>(channel, params);
+            }},
+            {"add_stats_window", [](TypeChannel channel, TypeParams params) {
+                return std::make_shared<AddStatsWindowCommand>(channel, params);
+            }},
+            {"get_quantiles", [](TypeChannel channel, TypeParams params) {
+                return std::make_shared<GetQuantilesCommand>(channel, params);
+            }},
+            {"get_waveform", [](TypeChannel channel, TypeParams params) {
+                return std::make_shared<GetWaveformCommand>(channel, params);
+            }},
+            {"get_health", [](TypeChannel channel, TypeParams params) {
+                return std::make_shared<GetHealthCommand>(channel, params);
+            }},
+            {"get_lag_histogram", [](TypeChannel channel, TypeParams params) {
+                return std::make_shared<GetLagHistogramCommand>(channel, params);
+            }},
+            {"set_source", [](TypeChannel channel, TypeParams params) {
+                return std::make_shared<SetSourceCommand>(channel, params);
+            }},
+            {"get_source", [](TypeChannel channel, TypeParams params) {
+                return std::make_shared<GetSourceCommand>(channel, params);
+            }},
+            {"seek_source", [](TypeChannel channel, TypeParams params) {
+                return std::make_shared<SeekSourceCommand>(channel, params);
+            }},
+            {"query", [](TypeChannel channel, TypeParams params) {
+                return std::make_shared<QueryCommand>(channel, params);
             }}
         };
 
@@ -93,8 +212,8 @@ private:
      * 
      * @return Ссылка на мьютекс.
      */
-    static std::shared_mutex& get_mutex() {
-        static std::shared_mutex mutex;
+    static InstrumentedSharedMutex& get_mutex() {
+        static InstrumentedSharedMutex mutex{"command_factory.mutex"};
         return mutex;
     }
 };
@@ -1,12 +1,28 @@
 #pragma once
 
 #include "channel.h"
+#include "channel_controller.h"
 #include "ranges.h"
 #include "my_tools.h"
+#include "channel_stats.h"
+#include "quantile_sketch.h"
+#include "waveform.h"
+#include "channel_health.h"
+#include "signal_source.h"
+#include "series_query.h"
+#include "tracing.h"
+#include "lock_stats.h"
+#include "config.h"
 
 #include <string>
+#include <stdexcept>
 #include <memory>
 #include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <cerrno>
+#include <sys/stat.h>
 
 using TypeCmdParams = const std::vector<std::string>&;
 
@@ -48,6 +64,441 @@ protected:
     std::shared_ptr<IChannel> channel;
 };
 
+/**
+ * @class ControllerCommand
+ * @brief Базовый класс команд, работающих с реестром каналов, а не с отдельным каналом.
+ */
+class ControllerCommand : public ICommand {
+public:
+    /**
+     * @brief Конструктор.
+     * @param controller Контроллер каналов.
+     */
+    explicit ControllerCommand(ChannelController& controller) : ICommand(nullptr), controller(controller) {}
+
+protected:
+    /// Контроллер каналов
+    ChannelController& controller;
+};
+
+/**
+ * @class CreateChannelCommand
+ * @brief Команда создания канала во время работы.
+ *
+ * Формат: `create_channel <channel>, <analog|table>`. Ответ: "ok".
+ */
+class CreateChannelCommand : public ControllerCommand {
+private:
+    std::string channel_name; ///< Имя нового канала
+    std::string channel_type; ///< Тип нового канала
+
+public:
+    /**
+     * @brief Конструктор.
+     * @param controller Контроллер каналов.
+     * @param params Параметры команды: имя и тип канала.
+     * @throws std::invalid_argument Если тип не указан.
+     */
+    CreateChannelCommand(ChannelController& controller, TypeCmdParams params)
+        : ControllerCommand(controller) {
+        if (params.size() < 2) {
+            throw std::invalid_argument("channel type is not specified");
+        }
+        channel_name = params[0];
+        channel_type = params[1];
+    }
+
+    /**
+     * @brief Создает канал.
+     * @return Строка с результатом выполнения команды.
+     */
+    std::string execute() override {
+        controller.create_channel(channel_name, channel_type);
+        return get_response();
+    }
+
+    /**
+     * @brief Получает ответ на выполнение команды.
+     * @return Строка с результатом выполнения команды.
+     */
+    std::string get_response() override {
+        return "ok";
+    }
+};
+
+/**
+ * @class RemoveChannelCommand
+ * @brief Команда удаления канала.
+ *
+ * Формат: `remove_channel <channel>`. Ответ: "ok". Команды, уже получившие
+ * канал, выполняются до конца; канал останавливается после них.
+ */
+class RemoveChannelCommand : public ControllerCommand {
+private:
+    std::string channel_name; ///< Имя удаляемого канала
+
+public:
+    /**
+     * @brief Конструктор.
+     * @param controller Контроллер каналов.
+     * @param params Параметры команды: имя канала.
+     */
+    RemoveChannelCommand(ChannelController& controller, TypeCmdParams params)
+        : ControllerCommand(controller), channel_name(params[0]) {}
+
+    /**
+     * @brief Удаляет канал из реестра.
+     * @return Строка с результатом выполнения команды.
+     */
+    std::string execute() override {
+        controller.remove_channel(channel_name);
+        return get_response();
+    }
+
+    /**
+     * @brief Получает ответ на выполнение команды.
+     * @return Строка с результатом выполнения команды.
+     */
+    std::string get_response() override {
+        return "ok";
+    }
+};
+
+/**
+ * @class FaultsCommand
+ * @brief Базовый класс команд управления имитацией сбоев.
+ *
+ * Первый параметр - имя канала или "*" для общего профиля.
+ */
+class FaultsCommand : public ControllerCommand {
+public:
+    /**
+     * @brief Конструктор.
+     * @param controller Контроллер каналов.
+     * @param params Параметры команды: имя канала или "*".
+     * @throws std::invalid_argument Если канал не найден.
+     */
+    FaultsCommand(ChannelController& controller, TypeCmdParams params)
+        : ControllerCommand(controller), channel_name(params[0]) {
+        if (!is_default() && !controller.find_channel(channel_name)) {
+            throw std::invalid_argument("There is no such channel: " + channel_name);
+        }
+    }
+
+    /**
+     * @brief Получает ответ на выполнение команды.
+     * @return "ok, <профиль>[, <состояние сбоя>, <количество сбоев>]".
+     */
+    std::string get_response() override {
+        FaultInjector& injector = controller.get_fault_injector();
+        return "ok, " + (is_default() ? injector.describe_default() : injector.describe(channel_name));
+    }
+
+protected:
+    /// Команда относится к общему профилю
+    bool is_default() const { return channel_name == "*"; }
+
+    std::string channel_name; ///< Имя канала или "*"
+};
+
+/**
+ * @class SetFaultsCommand
+ * @brief Команда установки профиля сбоев.
+ *
+ * Формат: `set_faults <channel|*>, <правило>[, <правило>...][, seed=<n>]`, например
+ * `set_faults channel0, busy:0.05:200ms-1s, error:0.01:2s, seed=42`; `off` отключает сбои.
+ */
+class SetFaultsCommand : public FaultsCommand {
+private:
+    FaultProfile profile; ///< Новый профиль
+
+public:
+    /**
+     * @brief Конструктор.
+     * @param controller Контроллер каналов.
+     * @param params Параметры команды: канал и спецификации профиля.
+     * @throws std::invalid_argument Если канал не найден или профиль некорректен.
+     */
+    SetFaultsCommand(ChannelController& controller, TypeCmdParams params)
+        : FaultsCommand(controller, params) {
+        if (params.size() < 2) {
+            throw std::invalid_argument("fault profile is not specified");
+        }
+        profile = FaultProfile::parse(std::vector<std::string>(params.begin() + 1, params.end()));
+    }
+
+    /**
+     * @brief Устанавливает профиль.
+     * @return Строка с результатом выполнения команды.
+     */
+    std::string execute() override {
+        FaultInjector& injector = controller.get_fault_injector();
+        if (is_default()) {
+            injector.set_default_profile(std::move(profile));
+        } else {
+            injector.set_profile(channel_name, std::move(profile));
+        }
+        return get_response();
+    }
+};
+
+/**
+ * @class ClearFaultsCommand
+ * @brief Команда сброса профиля сбоев.
+ *
+ * Формат: `clear_faults <channel|*>`. Для канала удаляет собственный профиль
+ * (канал переходит на общий), для "*" отключает сбои у всех каналов.
+ */
+class ClearFaultsCommand : public FaultsCommand {
+public:
+    using FaultsCommand::FaultsCommand;
+
+    /**
+     * @brief Сбрасывает профиль.
+     * @return Строка с результатом выполнения команды.
+     */
+    std::string execute() override {
+        FaultInjector& injector = controller.get_fault_injector();
+        if (is_default()) {
+            injector.set_default_profile(FaultProfile{}, true);
+        } else {
+            injector.clear_profile(channel_name);
+        }
+        return get_response();
+    }
+};
+
+/**
+ * @class GetFaultsCommand
+ * @brief Команда получения профиля и состояния сбоев.
+ *
+ * Формат: `get_faults <channel|*>`. Ответ для канала:
+ * "ok, <профиль>, <состояние сбоя или none>, <количество сбоев>".
+ */
+class GetFaultsCommand : public FaultsCommand {
+public:
+    using FaultsCommand::FaultsCommand;
+
+    /**
+     * @brief Выполняет команду.
+     * @return Строка с результатом выполнения команды.
+     */
+    std::string execute() override {
+        return get_response();
+    }
+};
+
+/**
+ * @class GetMetricsCommand
+ * @brief Команда выгрузки метрик сервера.
+ *
+ * Формат: `get_metrics <prefix|*>`, где prefix - начало имен выгружаемых
+ * семейств (например, multimeter_command). Ответ: "ok, <n>, <имя>, <значение>, ...";
+ * длительности - в секундах, гистограммы выгружаются строками _count, _sum,
+ * _p50, _p99, _p999 и _max.
+ */
+class GetMetricsCommand : public ControllerCommand {
+private:
+    std::string prefix; ///< Префикс имен семейств
+
+public:
+    /**
+     * @brief Конструктор.
+     * @param controller Контроллер каналов.
+     * @param params Параметры команды: префикс имен или "*".
+     */
+    GetMetricsCommand(ChannelController& controller, TypeCmdParams params)
+        : ControllerCommand(controller), prefix(params[0] == "*" ? "" : params[0]) {}
+
+    /**
+     * @brief Выполняет команду.
+     * @return Строка с результатом выполнения команды.
+     */
+    std::string execute() override {
+        return get_response();
+    }
+
+    /**
+     * @brief Получает ответ на выполнение команды.
+     * @return Строка с результатом выполнения команды.
+     */
+    std::string get_response() override {
+        return Metrics::registry().render_summary(prefix);
+    }
+};
+
+/**
+ * @class GetLockStatsCommand
+ * @brief Команда выгрузки статистики блокировок.
+ *
+ * Формат: `get_lock_stats <prefix|*>[, reset]`, где prefix - начало имен мест
+ * блокировки (например, channel). Ответ: "ok, <n>" и для каждого места
+ * "<имя>, <захваты>, <конкурентные>, <ожидание_нс>, <макс_ожидание_нс>, <удержание_нс>,
+ * <разделяемые захваты>, <конкурентные разделяемые>, <ожидание разделяемых_нс>";
+ * места отсортированы по убыванию суммарного ожидания. С reset счетчики
+ * обнуляются после выгрузки. Статистика есть только в сборке с MULTIMETER_LOCK_STATS.
+ */
+class GetLockStatsCommand : public ControllerCommand {
+private:
+    std::string prefix; ///< Префикс имен мест блокировки
+    bool reset = false; ///< Обнулить счетчики после выгрузки
+
+public:
+    /**
+     * @brief Конструктор.
+     * @param controller Контроллер каналов.
+     * @param params Параметры команды: префикс имен или "*" и необязательный reset.
+     * @throws std::invalid_argument Если второй параметр не reset.
+     * @throws std::runtime_error Если статистика блокировок не собирается.
+     */
+    GetLockStatsCommand(ChannelController& controller, TypeCmdParams params)
+        : ControllerCommand(controller), prefix(params[0] == "*" ? "" : params[0]) {
+        if (params.size() > 1) {
+            if (params[1] != "reset") {
+                throw std::invalid_argument("unknown get_lock_stats option " + params[1]);
+            }
+            reset = true;
+        }
+        if (!LockStats::is_enabled()) {
+            throw std::runtime_error("lock statistics are disabled, build with MULTIMETER_LOCK_STATS=ON");
+        }
+    }
+
+    /**
+     * @brief Выполняет команду.
+     * @return Строка с результатом выполнения команды.
+     */
+    std::string execute() override {
+        std::string response = get_response();
+        if (reset) {
+            LockStats::get_instance().reset();
+        }
+        return response;
+    }
+
+    /**
+     * @brief Получает ответ на выполнение команды.
+     * @return Строка с результатом выполнения команды.
+     */
+    std::string get_response() override {
+        const std::vector<LockSiteStats> sites = LockStats::get_instance().snapshot(prefix);
+        std::string response = "ok, " + std::to_string(sites.size());
+        for (const LockSiteStats& site : sites) {
+            for (const std::string& field : {site.name, std::to_string(site.acquisitions), std::to_string(site.contended),
+                                             std::to_string(site.wait_ns), std::to_string(site.max_wait_ns),
+                                             std::to_string(site.hold_ns), std::to_string(site.shared_acquisitions),
+                                             std::to_string(site.shared_contended), std::to_string(site.shared_wait_ns)}) {
+                response += ", " + field;
+            }
+        }
+        return response;
+    }
+};
+
+/**
+ * @class TraceCommand
+ * @brief Команда управления трассировкой запросов.
+ *
+ * Формат: `trace <on|off|clear|dump>[, <file>]`. on/off включают и выключают
+ * запись интервалов (ответ "ok, on" / "ok, off"), clear очищает буферы ("ok"),
+ * dump записывает накопленные интервалы в файл формата Chrome trace-event
+ * в каталоге trace_directory (по умолчанию trace_file) и отвечает
+ * "ok, <количество интервалов>, <путь>". Имя файла - без пути.
+ */
+class TraceCommand : public ControllerCommand {
+private:
+    std::string action; ///< Действие
+    std::string path; ///< Файл выгрузки (в каталоге trace_directory)
+
+public:
+    /**
+     * @brief Конструктор.
+     * @param controller Контроллер каналов.
+     * @param params Параметры команды: действие и необязательное имя файла для dump.
+     * @throws std::invalid_argument Если действие неизвестно или имя файла содержит путь.
+     */
+    TraceCommand(ChannelController& controller, TypeCmdParams params)
+        : ControllerCommand(controller), action(params[0]) {
+        if (action != "on" && action != "off" && action != "clear" && action != "dump") {
+            throw std::invalid_argument("unknown trace action " + action);
+        }
+        const std::string file = params.size() > 1 ? params[1] : MyConfig::DefaultConfig::trace_file;
+        MyTools::check_file_name(file);
+        path = std::string(MyConfig::DefaultConfig::trace_directory) + "/" + file;
+    }
+
+    /**
+     * @brief Выполняет команду.
+     * @return Строка с результатом выполнения команды.
+     * @throws std::runtime_error Если файл выгрузки не удалось записать.
+     */
+    std::string execute() override {
+        Tracer& tracer = Tracer::get_instance();
+        if (action == "on" || action == "off") {
+            Tracer::set_enabled(action == "on");
+            return get_response();
+        }
+        if (action == "clear") {
+            tracer.clear();
+            return get_response();
+        }
+        const std::string directory = MyConfig::DefaultConfig::trace_directory;
+        if (mkdir(directory.c_str(), 0755) == -1 && errno != EEXIST) {
+            throw std::runtime_error("mkdir " + directory + ": " + std::strerror(errno));
+        }
+        const size_t count = tracer.write_json(path);
+        return get_response() + ", " + std::to_string(count) + ", " + path;
+    }
+
+    /**
+     * @brief Получает ответ на выполнение команды.
+     * @return Строка с результатом выполнения команды.
+     */
+    std::string get_response() override {
+        if (action == "on" || action == "off") {
+            return "ok, " + action;
+        }
+        return "ok";
+    }
+};
+
+/**
+ * @class PingCommand
+ * @brief Команда проверки соединения.
+ *
+ * Формат: `ping <token>`. Ответ: "ok, <token>"; по токену клиент сверяет,
+ * что ответы сопоставляются с запросами правильно.
+ */
+class PingCommand : public ControllerCommand {
+private:
+    std::string token; ///< Токен запроса
+
+public:
+    /**
+     * @brief Конструктор.
+     * @param controller Контроллер каналов.
+     * @param params Параметры команды: токен.
+     */
+    PingCommand(ChannelController& controller, TypeCmdParams params)
+        : ControllerCommand(controller), token(params[0]) {}
+
+    /**
+     * @brief Выполняет команду.
+     * @return Строка с результатом выполнения команды.
+     */
+    std::string execute() override {
+        return get_response();
+    }
+
+    /**
+     * @brief Получает ответ на выполнение команды.
+     * @return Строка с результатом выполнения команды.
+     */
+    std::string get_response() override {
+        return "ok, " + token;
+    }
+};
+
 /**
  * @class StartMeasureCommand
  * @brief Команда для начала измерений.
@@ -225,10 +676,16 @@ public:
  * @brief Команда для получения результата измерений.
  *
  * Этот класс реализует команду, которая запрашивает результат измерений с канала.
+ * Формат: `get_result <channel>[, time]`. С параметром time ответ дополняется временем
+ * измерения значения: "ok, <value>, <time_ns>" (нс от эпохи, часы system_clock сервера),
+ * по которому клиент считает возраст значения. Возраст значения в момент ответа
+ * сервер учитывает в гистограмме multimeter_sample_age_seconds.
  */
 class GetResultCommand : public ICommand {
 private:
     float value = 0.0f; ///< Значение измерения
+    int64_t time_ns = 0; ///< Время измерения значения
+    bool with_time = false; ///< Добавлять время измерения в ответ
     int range; ///< Диапазон
     ChannelStateManager::ChannelState state; ///< Текущее состояние канала
 
@@ -236,11 +693,18 @@ public:
     /**
      * @brief Конструктор.
      * @param channel Канал, с которым будет работать команда.
-     * @param params Параметры команды (не используются в данной команде).
+     * @param params Параметры команды: имя канала и необязательный признак time.
+     * @throws std::invalid_argument Если второй параметр не time.
      */
     GetResultCommand(std::shared_ptr<IChannel> channel, TypeCmdParams params)
         : ICommand(channel) {
         range = channel->get_range();
+        if (params.size() > 1) {
+            if (params[1] != "time") {
+                throw std::invalid_argument("unknown get_result option " + params[1]);
+            }
+            with_time = true;
+        }
     }
 
     /**
@@ -252,9 +716,16 @@ public:
     std::string execute() override {           
         state = channel->get_state();     
         if (state == ChannelStateManager::ChannelState::Measure) {
+            // Время читается до значения: значение не старше времени
+            time_ns = channel->get_measuring_time();
             value = channel->get_measuring_value();      
             return get_response();
         }              
+        // Если поток измерений завис, значение устарело: сообщаем причину
+        std::shared_ptr<ChannelHealth> health = channel->get_health();
+        if (state == ChannelStateManager::ChannelState::Error && health->is_stalled()) {
+            return "fail, " + ChannelStateManager::to_string(state) + ", " + health->get_reason();
+        }
         return "fail, " + ChannelStateManager::to_string(state);
     }
 
@@ -265,9 +736,18 @@ public:
      * @return Строка с результатом выполнения команды.
      */
     std::string get_response() override {                
+        TraceSpan span("format", "request");
         std::string ok_fail = "fail, ";
         if (state == ChannelStateManager::ChannelState::Measure) {
             ok_fail = "ok, " + MyTools::float_to_string(value, RangeManager::get_range(range).precision);
+            if (time_ns != 0) {
+                static Histogram& sample_age = Metrics::registry().duration_histogram(
+                    "multimeter_sample_age_seconds", "Age of the value returned by get_result at response time.");
+                sample_age.record(MyTools::now_ns() - time_ns);
+            }
+            if (with_time) {
+                ok_fail += ", " + std::to_string(time_ns);
+            }
         }
         else {
             ok_fail += ChannelStateManager::to_string(state);
@@ -322,3 +802,637 @@ public:
         return ok_fail + ", " + std::to_string(new_frequency);
     }
 };
+
+/**
+ * @class SetPeriodCommand
+ * @brief Команда для установки периода опроса канала в наносекундном разрешении.
+ *
+ * Форматы: `set_period <channel>, <duration>` ("1us", "250ns", "10ms") и
+ * `set_sample_rate <channel>, <rate>` ("1MHz", "10kHz", "500Hz").
+ * Ответ: "ok, <период>".
+ */
+class SetPeriodCommand : public ICommand {
+private:
+    int64_t new_period_ns = 0; ///< Новый период (нс)
+
+public:
+    /**
+     * @brief Конструктор.
+     * @param channel Канал, с которым будет работать команда.
+     * @param params Параметры команды, где второй элемент - период или частота.
+     * @param is_rate Параметр задает частоту дискретизации, а не период.
+     * @throws std::invalid_argument Если параметр не указан или некорректен.
+     */
+    SetPeriodCommand(std::shared_ptr<IChannel> channel, TypeCmdParams params, bool is_rate)
+        : ICommand(channel) {
+        if (params.size() < 2) {
+            throw std::invalid_argument(is_rate ? "rate is not specified" : "period is not specified");
+        }
+        if (is_rate) {
+            // Период проверяется до приведения к целому: у слишком малой частоты он не помещается в int64_t
+            const double period_ns = 1e9 / MyTools::parse_rate_hz(params[1]) + 0.5;
+            if (!(period_ns >= static_cast<double>(MyConfig::DefaultConfig::min_period_ns) &&
+                  period_ns < static_cast<double>(std::numeric_limits<int64_t>::max()))) {
+                throw std::invalid_argument("Rate is out of range: " + params[1]);
+            }
+            new_period_ns = static_cast<int64_t>(period_ns);
+        } else {
+            new_period_ns = MyTools::parse_duration_ns(params[1]);
+        }
+    }
+
+    /**
+     * @brief Выполняет команду установки периода.
+     * 
+     * Как и set_frequency, период меняется только в состоянии Idle или Measure.
+     * @return Строка с результатом выполнения команды.
+     */
+    std::string execute() override {
+        ChannelStateManager::ChannelState state = channel->get_state();
+        if (state == ChannelStateManager::ChannelState::Idle || state == ChannelStateManager::ChannelState::Measure) {
+            channel->set_period_ns(new_period_ns);
+            return get_response();
+        }
+        return "fail, " + ChannelStateManager::to_string(state);
+    }
+
+    /**
+     * @brief Получает ответ на выполнение команды.
+     * @return Строка с результатом выполнения команды.
+     */
+    std::string get_response() override {
+        return "ok, " + MyTools::format_duration(channel->get_period_ns());
+    }
+};
+
+/**
+ * @class GetStatsCommand
+ * @brief Команда для получения оконной статистики канала.
+ *
+ * Формат: `get_stats <channel>, <window>`, где окно задается спецификацией вида
+ * "10s" (скользящее) или "tumbling:1m" (неперекрывающееся, последний завершенный интервал).
+ * Ответ: "ok, <count>, <min>, <max>, <mean>, <rms>, <stddev>".
+ */
+class GetStatsCommand : public ICommand {
+private:
+    std::string window; ///< Спецификация окна
+    StatsAccumulator stats; ///< Статистика окна
+    bool found = false; ///< Признак того, что окно найдено
+
+public:
+    /**
+     * @brief Конструктор.
+     * @param channel Канал, с которым будет работать команда.
+     * @param params Параметры команды, где второй элемент - спецификация окна.
+     * @throws std::invalid_argument Если окно не указано.
+     */
+    GetStatsCommand(std::shared_ptr<IChannel> channel, TypeCmdParams params)
+        : ICommand(channel) {
+        if (params.size() < 2) {
+            throw std::invalid_argument("window is not specified");
+        }
+        window = params[1];
+    }
+
+    /**
+     * @brief Выполняет команду получения статистики.
+     * @return Строка с результатом выполнения команды.
+     */
+    std::string execute() override {
+        found = channel->get_stats()->get_summary(window, MyTools::now_ns(), stats);
+        return get_response();
+    }
+
+    /**
+     * @brief Получает ответ на выполнение команды.
+     * 
+     * Значения форматируются с точностью текущего диапазона канала.
+     * @return Строка с результатом выполнения команды.
+     */
+    std::string get_response() override {
+        if (!found) {
+            return "fail, unknown window " + window;
+        }
+        if (stats.count == 0) {
+            return "fail, no data";
+        }
+        int precision = RangeManager::get_range(channel->get_range()).precision;
+        return "ok, " + std::to_string(stats.count)
+            + ", " + MyTools::float_to_string(stats.min, precision)
+            + ", " + MyTools::float_to_string(stats.max, precision)
+            + ", " + MyTools::float_to_string(static_cast<float>(stats.mean()), precision)
+            + ", " + MyTools::float_to_string(static_cast<float>(stats.rms()), precision)
+            + ", " + MyTools::float_to_string(static_cast<float>(stats.stddev()), precision);
+    }
+};
+
+/**
+ * @class AddStatsWindowCommand
+ * @brief Команда для добавления окна статистики канала.
+ *
+ * Формат: `add_stats_window <channel>, <window>`. Окон у канала не больше
+ * MyConfig::DefaultConfig::max_stats_windows.
+ */
+class AddStatsWindowCommand : public ICommand {
+private:
+    std::string window; ///< Спецификация окна
+
+public:
+    /**
+     * @brief Конструктор.
+     * @param channel Канал, с которым будет работать команда.
+     * @param params Параметры команды, где второй элемент - спецификация окна.
+     * @throws std::invalid_argument Если окно не указано.
+     */
+    AddStatsWindowCommand(std::shared_ptr<IChannel> channel, TypeCmdParams params)
+        : ICommand(channel) {
+        if (params.size() < 2) {
+            throw std::invalid_argument("window is not specified");
+        }
+        window = params[1];
+    }
+
+    /**
+     * @brief Выполняет команду добавления окна.
+     * @return Строка с результатом выполнения команды.
+     */
+    std::string execute() override {
+        window = channel->get_stats()->add_window(window);
+        return get_response();
+    }
+
+    /**
+     * @brief Получает ответ на выполнение команды.
+     * @return Строка с результатом выполнения команды.
+     */
+    std::string get_response() override {
+        return "ok, " + window;
+    }
+};
+
+/**
+ * @class GetQuantilesCommand
+ * @brief Команда для получения квантилей значений канала.
+ *
+ * Формат: `get_quantiles <channel>, [<window>,] <q>...`, где квантиль задается долей
+ * ("0.5", "0.99") или процентилем ("p50", "p99.9"). Если окно не указано, используется
+ * окно скетчей по умолчанию. Ответ: "ok, <count>, <v1>, <v2>, ...".
+ */
+class GetQuantilesCommand : public ICommand {
+private:
+    std::string window; ///< Спецификация окна
+    std::vector<double> fractions; ///< Запрошенные доли
+    std::vector<float> values; ///< Оценки квантилей
+    uint64_t count = 0; ///< Количество значений в окне
+    bool found = false; ///< Признак того, что окно найдено
+
+    /**
+     * @brief Разбирает квантиль.
+     * @param text Доля ("0.95") или процентиль ("p95").
+     * @param fraction Доля в диапазоне [0, 1].
+     * @return true, если строка является квантилем.
+     */
+    static bool parse_quantile(const std::string& text, double& fraction) {
+        const bool percent = !text.empty() && (text[0] == 'p' || text[0] == 'P');
+        const char* begin = text.c_str() + (percent ? 1 : 0);
+        char* end = nullptr;
+        double value = std::strtod(begin, &end);
+        if (end == begin || *end != '\0') {
+            return false;
+        }
+        fraction = percent ? value / 100.0 : value;
+        return fraction >= 0.0 && fraction <= 1.0;
+    }
+
+public:
+    /**
+     * @brief Конструктор.
+     * @param channel Канал, с которым будет работать команда.
+     * @param params Параметры команды: необязательное окно и квантили.
+     * @throws std::invalid_argument Если квантили не указаны или некорректны.
+     */
+    GetQuantilesCommand(std::shared_ptr<IChannel> channel, TypeCmdParams params)
+        : ICommand(channel) {
+        size_t first = 1;
+        double fraction = 0.0;
+        // Окно - первый параметр, не похожий на квантиль (процентили начинаются с "p")
+        if (params.size() > 1 && !parse_quantile(params[1], fraction) && params[1][0] != 'p' && params[1][0] != 'P') {
+            window = params[1];
+            first = 2;
+        }
+        for (size_t i = first; i < params.size(); ++i) {
+            if (!parse_quantile(params[i], fraction)) {
+                throw std::invalid_argument("invalid quantile " + params[i]);
+            }
+            fractions.push_back(fraction);
+        }
+        if (fractions.empty()) {
+            throw std::invalid_argument("quantiles are not specified");
+        }
+    }
+
+    /**
+     * @brief Выполняет команду получения квантилей.
+     * @return Строка с результатом выполнения команды.
+     */
+    std::string execute() override {
+        auto quantiles = channel->get_quantiles();
+        if (window.empty()) {
+            window = quantiles->get_default_window();
+        }
+        KllSketch sketch;
+        found = quantiles->get_summary(window, MyTools::now_ns(), sketch);
+        count = sketch.count();
+        values = sketch.quantiles(fractions);
+        return get_response();
+    }
+
+    /**
+     * @brief Получает ответ на выполнение команды.
+     * 
+     * Значения форматируются с точностью текущего диапазона канала.
+     * @return Строка с результатом выполнения команды.
+     */
+    std::string get_response() override {
+        if (!found) {
+            return "fail, unknown window " + window;
+        }
+        if (count == 0) {
+            return "fail, no data";
+        }
+        int precision = RangeManager::get_range(channel->get_range()).precision;
+        std::string response = "ok, " + std::to_string(count);
+        for (float value : values) {
+            response += ", " + MyTools::float_to_string(value, precision);
+        }
+        return response;
+    }
+};
+
+/**
+ * @class GetWaveformCommand
+ * @brief Команда для получения прореженной осциллограммы канала.
+ *
+ * Формат: `get_waveform <channel>, <t0>, <t1>, <points>[, minmax|lttb]`, где время
+ * задается как "now", "-10s" (относительно текущего момента) или в наносекундах от эпохи.
+ * Ответ: "ok, <n>, <t1>, <v1>, ..., <tn>, <vn>" (время в наносекундах от эпохи).
+ */
+class GetWaveformCommand : public ICommand {
+private:
+    std::string t0_text; ///< Начало интервала
+    std::string t1_text; ///< Конец интервала
+    size_t points = 0; ///< Максимальное количество точек
+    ChannelWaveform::Mode mode = ChannelWaveform::Mode::MinMax; ///< Способ прореживания
+    std::vector<WaveformPoint> waveform; ///< Точки осциллограммы
+
+public:
+    /**
+     * @brief Конструктор.
+     * @param channel Канал, с которым будет работать команда.
+     * @param params Параметры команды: начало, конец, количество точек и способ прореживания.
+     * @throws std::invalid_argument Если параметры не указаны или некорректны.
+     */
+    GetWaveformCommand(std::shared_ptr<IChannel> channel, TypeCmdParams params)
+        : ICommand(channel) {
+        if (params.size() < 4) {
+            throw std::invalid_argument("expected <t0>, <t1>, <points>");
+        }
+        t0_text = params[1];
+        t1_text = params[2];
+        points = std::stoul(params[3]);
+        if (params.size() > 4) {
+            mode = ChannelWaveform::parse_mode(params[4]);
+        }
+    }
+
+    /**
+     * @brief Выполняет команду получения осциллограммы.
+     * @return Строка с результатом выполнения команды.
+     */
+    std::string execute() override {
+        const int64_t now = MyTools::now_ns();
+        waveform = channel->get_waveform()->get_waveform(
+            MyTools::parse_time_ns(t0_text, now), MyTools::parse_time_ns(t1_text, now), points, mode);
+        return get_response();
+    }
+
+    /**
+     * @brief Получает ответ на выполнение команды.
+     * 
+     * Значения форматируются с точностью текущего диапазона канала.
+     * @return Строка с результатом выполнения команды.
+     */
+    std::string get_response() override {
+        int precision = RangeManager::get_range(channel->get_range()).precision;
+        std::string response = "ok, " + std::to_string(waveform.size());
+        for (const WaveformPoint& point : waveform) {
+            response += ", " + std::to_string(point.timestamp_ns) + ", " + MyTools::float_to_string(point.value, precision);
+        }
+        return response;
+    }
+};
+
+/**
+ * @class GetHealthCommand
+ * @brief Команда получения сведений о работе потока измерений канала.
+ *
+ * Формат: `get_health <channel>`. Ответ: "ok, <ok|stalled>, <причина последнего
+ * зависания или none>, <проходов>, <задержка p50>, <p99>, <max>, <зависаний>, <макс. зависание>";
+ * длительности в наносекундах.
+ */
+class GetHealthCommand : public ICommand {
+private:
+    std::shared_ptr<ChannelHealth> health; ///< Сведения о работе потока измерений
+
+public:
+    /**
+     * @brief Конструктор.
+     * @param channel Канал, с которым будет работать команда.
+     * @param params Параметры команды (не используются).
+     */
+    GetHealthCommand(std::shared_ptr<IChannel> channel, TypeCmdParams /*params*/)
+        : ICommand(channel) {}
+
+    /**
+     * @brief Выполняет команду.
+     * @return Строка с результатом выполнения команды.
+     */
+    std::string execute() override {
+        health = channel->get_health();
+        return get_response();
+    }
+
+    /**
+     * @brief Получает ответ на выполнение команды.
+     * @return Строка с результатом выполнения команды.
+     */
+    std::string get_response() override {
+        const LagHistogram::Snapshot lag = health->get_lag().snapshot();
+        const LagHistogram::Snapshot stalls = health->get_stalls().snapshot();
+        const std::string reason = health->get_reason();
+        return std::string("ok, ") + (health->is_stalled() ? "stalled" : "ok") + ", " + (reason.empty() ? "none" : reason) +
+               ", " + std::to_string(lag.count) + ", " + std::to_string(lag.quantile(0.5)) + ", " + std::to_string(lag.quantile(0.99)) +
+               ", " + std::to_string(lag.max_ns) + ", " + std::to_string(stalls.count) + ", " + std::to_string(stalls.max_ns);
+    }
+};
+
+/**
+ * @class GetLagHistogramCommand
+ * @brief Команда выгрузки гистограммы задержек потока измерений канала.
+ *
+ * Формат: `get_lag_histogram <channel>[, lag|stalls]`. Ответ: "ok, <n>, <граница 1>, <количество 1>, ...",
+ * где граница - верхняя граница корзины в наносекундах ("inf" для последней);
+ * пустые корзины пропускаются.
+ */
+class GetLagHistogramCommand : public ICommand {
+private:
+    bool stalls = false; ///< Выгружать гистограмму зависаний
+    LagHistogram::Snapshot histogram; ///< Снимок гистограммы
+
+public:
+    /**
+     * @brief Конструктор.
+     * @param channel Канал, с которым будет работать команда.
+     * @param params Параметры команды: вид гистограммы (lag по умолчанию).
+     * @throws std::invalid_argument Если вид гистограммы неизвестен.
+     */
+    GetLagHistogramCommand(std::shared_ptr<IChannel> channel, TypeCmdParams params)
+        : ICommand(channel) {
+        if (params.size() > 1) {
+            if (params[1] == "stalls") {
+                stalls = true;
+            } else if (params[1] != "lag") {
+                throw std::invalid_argument("unknown histogram " + params[1]);
+            }
+        }
+    }
+
+    /**
+     * @brief Выполняет команду.
+     * @return Строка с результатом выполнения команды.
+     */
+    std::string execute() override {
+        std::shared_ptr<ChannelHealth> health = channel->get_health();
+        histogram = (stalls ? health->get_stalls() : health->get_lag()).snapshot();
+        return get_response();
+    }
+
+    /**
+     * @brief Получает ответ на выполнение команды.
+     * @return Строка с результатом выполнения команды.
+     */
+    std::string get_response() override {
+        std::string body;
+        size_t n = 0;
+        for (size_t i = 0; i != LagHistogram::bucket_count; ++i) {
+            if (!histogram.buckets[i]) {
+                continue;
+            }
+            const bool last = i + 1 == LagHistogram::bucket_count;
+            body += ", " + (last ? std::string("inf") : std::to_string(LagHistogram::bucket_upper_ns(i))) +
+                    ", " + std::to_string(histogram.buckets[i]);
+            ++n;
+        }
+        return "ok, " + std::to_string(n) + body;
+    }
+};
+
+/**
+ * @class SetSourceCommand
+ * @brief Команда для установки источника сигнала канала.
+ *
+ * Формат: `set_source <channel>, <source>[, <param>...]`, например
+ * `set_source channel0, sine, 5, 0.8`. Ответ: "ok, <описание источника>".
+ */
+class SetSourceCommand : public ICommand {
+private:
+    std::shared_ptr<ISignalSource> source; ///< Новый источник сигнала
+
+public:
+    /**
+     * @brief Конструктор.
+     * @param channel Канал, с которым будет работать команда.
+     * @param params Параметры команды: имя источника и его параметры.
+     * @throws std::invalid_argument Если источник не указан, неизвестен или параметры некорректны.
+     */
+    SetSourceCommand(std::shared_ptr<IChannel> channel, TypeCmdParams params)
+        : ICommand(channel) {
+        if (params.size() < 2) {
+            throw std::invalid_argument("source is not specified");
+        }
+        std::vector<std::string> source_params(params.begin() + 2, params.end());
+        source = SignalSourceFactory::create_source(params[1], source_params);
+        if (!source) {
+            throw std::invalid_argument("unknown source " + params[1]);
+        }
+    }
+
+    /**
+     * @brief Выполняет команду установки источника.
+     * @return Строка с результатом выполнения команды.
+     */
+    std::string execute() override {
+        channel->set_source(source);
+        return get_response();
+    }
+
+    /**
+     * @brief Получает ответ на выполнение команды.
+     * @return Строка с результатом выполнения команды.
+     */
+    std::string get_response() override {
+        return "ok, " + source->describe();
+    }
+};
+
+/**
+ * @class GetSourceCommand
+ * @brief Команда для получения источника сигнала канала.
+ *
+ * Формат: `get_source <channel>`. Ответ: "ok, <описание источника>".
+ */
+class GetSourceCommand : public ICommand {
+private:
+    std::string description; ///< Описание источника
+
+public:
+    /**
+     * @brief Конструктор.
+     * @param channel Канал, с которым будет работать команда.
+     * @param params Параметры команды (не используются).
+     */
+    GetSourceCommand(std::shared_ptr<IChannel> channel, TypeCmdParams /*params*/)
+        : ICommand(channel) {}
+
+    /**
+     * @brief Выполняет команду получения источника.
+     * @return Строка с результатом выполнения команды.
+     */
+    std::string execute() override {
+        description = channel->get_source()->describe();
+        return get_response();
+    }
+
+    /**
+     * @brief Получает ответ на выполнение команды.
+     * @return Строка с результатом выполнения команды.
+     */
+    std::string get_response() override {
+        return "ok, " + description;
+    }
+};
+
+/**
+ * @class SeekSourceCommand
+ * @brief Команда для перемещения воспроизведения записи канала.
+ *
+ * Формат: `seek_source <channel>, <position>`, где позиция - длительность от
+ * начала записи ("0", "90s", "1500ms"). Поддерживается только источником replay.
+ */
+class SeekSourceCommand : public ICommand {
+private:
+    int64_t position_ns = 0; ///< Позиция от начала записи (нс)
+
+public:
+    /**
+     * @brief Конструктор.
+     * @param channel Канал, с которым будет работать команда.
+     * @param params Параметры команды, где второй элемент - позиция.
+     * @throws std::invalid_argument Если позиция не указана или некорректна.
+     */
+    SeekSourceCommand(std::shared_ptr<IChannel> channel, TypeCmdParams params)
+        : ICommand(channel) {
+        if (params.size() < 2) {
+            throw std::invalid_argument("position is not specified");
+        }
+        position_ns = params[1] == "0" ? 0 : MyTools::parse_duration_ns(params[1]);
+    }
+
+    /**
+     * @brief Выполняет команду перемещения.
+     * @return Строка с результатом выполнения команды.
+     */
+    std::string execute() override {
+        channel->get_source()->seek(position_ns);
+        return get_response();
+    }
+
+    /**
+     * @brief Получает ответ на выполнение команды.
+     * @return Строка с результатом выполнения команды.
+     */
+    std::string get_response() override {
+        return "ok";
+    }
+};
+
+/**
+ * @class QueryCommand
+ * @brief Команда агрегирующего запроса по сохраненной истории канала.
+ *
+ * Формат: `query <channel>, <t0>, <t1>, <min|max|avg|sum|count>, <step>`, например
+ * `query channel3, -6h, now, avg, 1m`. Время задается как в get_waveform, шаг - длительностью.
+ * Ответ: "ok, <n>, <начало шага 1>, <значение 1>, ..." (пустые шаги пропускаются).
+ */
+class QueryCommand : public ICommand {
+private:
+    std::string t0_text; ///< Начало интервала
+    std::string t1_text; ///< Конец интервала
+    SeriesQuery::Aggregate aggregate = SeriesQuery::Aggregate::Avg; ///< Агрегат
+    int64_t step_ns = 0; ///< Шаг (нс)
+    std::vector<SeriesQueryPoint> points; ///< Результат запроса
+
+public:
+    /**
+     * @brief Конструктор.
+     * @param channel Канал, с которым будет работать команда.
+     * @param params Параметры команды: начало, конец, агрегат и шаг.
+     * @throws std::invalid_argument Если параметры не указаны или некорректны.
+     */
+    QueryCommand(std::shared_ptr<IChannel> channel, TypeCmdParams params)
+        : ICommand(channel) {
+        if (params.size() < 5) {
+            throw std::invalid_argument("expected <t0>, <t1>, <aggregate>, <step>");
+        }
+        t0_text = params[1];
+        t1_text = params[2];
+        aggregate = SeriesQuery::parse_aggregate(params[3]);
+        step_ns = MyTools::parse_duration_ns(params[4]);
+    }
+
+    /**
+     * @brief Выполняет запрос по хранилищу.
+     * @return Строка с результатом выполнения команды.
+     * @throws std::runtime_error Если хранилище отключено.
+     */
+    std::string execute() override {
+        const std::string directory = MyConfig::DefaultConfig::store_directory;
+        if (directory.empty()) {
+            throw std::runtime_error("series store is disabled");
+        }
+        const int64_t now = MyTools::now_ns();
+        points = SeriesQuery(directory, channel->get_name()).run(
+            MyTools::parse_time_ns(t0_text, now), MyTools::parse_time_ns(t1_text, now), aggregate, step_ns);
+        return get_response();
+    }
+
+    /**
+     * @brief Получает ответ на выполнение команды.
+     *
+     * Количество выводится целым, остальные агрегаты - с точностью текущего диапазона канала.
+     * @return Строка с результатом выполнения команды.
+     */
+    std::string get_response() override {
+        int precision = RangeManager::get_range(channel->get_range()).precision;
+        std::string response = "ok, " + std::to_string(points.size());
+        for (const SeriesQueryPoint& point : points) {
+            response += ", " + std::to_string(point.start_ns) + ", ";
+            if (aggregate == SeriesQuery::Aggregate::Count) {
+                response += std::to_string(static_cast<uint64_t>(point.value));
+            } else {
+                response += MyTools::float_to_string(static_cast<float>(point.value), precision);
+            }
+        }
+        return response;
+    }
+};
@@ -0,0 +1,97 @@
+#include "events.h"
+
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <signal.h>
+#include <unistd.h>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#include <string>
+
+/**
+ * @brief Конструктор. Создает неблокирующий eventfd.
+ */
+WakeupEvent::WakeupEvent() : fd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) {
+    if (fd == -1) {
+        throw std::runtime_error(std::string("eventfd: ") + strerror(errno));
+    }
+}
+
+/**
+ * @brief Деструктор. Закрывает дескриптор.
+ */
+WakeupEvent::~WakeupEvent() {
+    close(fd);
+}
+
+/**
+ * @brief Взводит событие.
+ *
+ * Счетчик eventfd не вычитывается, поэтому дескриптор остается готовым к чтению
+ * для всех ожидающих потоков.
+ */
+void WakeupEvent::notify() {
+    uint64_t one = 1;
+    ssize_t result = write(fd, &one, sizeof(one));
+    (void)result; // Переполнение счетчика (EAGAIN) означает, что событие уже взведено
+}
+
+/**
+ * @brief Возвращает дескриптор eventfd.
+ * @return Дескриптор.
+ */
+int WakeupEvent::get_fd() const {
+    return fd;
+}
+
+/**
+ * @brief Конструктор. Блокирует сигналы и создает signalfd.
+ * @param signals Список сигналов для перехвата.
+ */
+SignalEvent::SignalEvent(std::initializer_list<int> signals) {
+    sigset_t mask;
+    sigemptyset(&mask);
+    for (int signum : signals) {
+        sigaddset(&mask, signum);
+    }
+
+    // Блокируем сигналы, чтобы они доставлялись только через дескриптор
+    if (pthread_sigmask(SIG_BLOCK, &mask, nullptr) != 0) {
+        throw std::runtime_error("pthread_sigmask failed");
+    }
+
+    fd = signalfd(-1, &mask, SFD_CLOEXEC | SFD_NONBLOCK);
+    if (fd == -1) {
+        throw std::runtime_error(std::string("signalfd: ") + strerror(errno));
+    }
+}
+
+/**
+ * @brief Деструктор. Закрывает дескриптор.
+ */
+SignalEvent::~SignalEvent() {
+    close(fd);
+}
+
+/**
+ * @brief Вычитывает пришедший сигнал.
+ * @return Номер сигнала или 0, если сигналов нет.
+ */
+int SignalEvent::read_signal() {
+    struct signalfd_siginfo info{};
+    ssize_t bytes_read = read(fd, &info, sizeof(info));
+    if (bytes_read != sizeof(info)) {
+        return 0;
+    }
+    return static_cast<int>(info.ssi_signo);
+}
+
+/**
+ * @brief Возвращает дескриптор signalfd.
+ * @return Дескриптор.
+ */
+int SignalEvent::get_fd() const {
+    return fd;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <initializer_list>
+
+/**
+ * @class WakeupEvent
+ * @brief Межпоточное событие пробуждения на основе eventfd.
+ *
+ * Событие работает как "защелка": после вызова notify() дескриптор остается
+ * доступным для чтения, поэтому все потоки, ожидающие его в poll(), просыпаются
+ * одновременно. Используется для мгновенной остановки цикла сервера.
+ */
+class WakeupEvent {
+public:
+    /**
+     * @brief Конструктор. Создает eventfd.
+     * @throws std::runtime_error Если дескриптор не удалось создать.
+     */
+    WakeupEvent();
+
+    /**
+     * @brief Деструктор. Закрывает дескриптор.
+     */
+    ~WakeupEvent();
+
+    WakeupEvent(const WakeupEvent&) = delete;
+    WakeupEvent& operator=(const WakeupEvent&) = delete;
+
+    /**
+     * @brief Взводит событие и будит всех ожидающих.
+     *
+     * Функция безопасна для вызова из любого потока.
+     */
+    void notify();
+
+    /**
+     * @brief Возвращает дескриптор для ожидания в poll().
+     * @return Дескриптор eventfd.
+     */
+    int get_fd() const;
+
+private:
+    int fd; ///< Дескриптор eventfd.
+};
+
+/**
+ * @class SignalEvent
+ * @brief Синхронная доставка сигналов через signalfd.
+ *
+ * Конструктор блокирует указанные сигналы в вызывающем потоке, поэтому объект должен
+ * создаваться до запуска остальных потоков: они унаследуют маску и сигналы будут
+ * приходить только через дескриптор. Это избавляет от асинхронного обработчика,
+ * в котором нельзя безопасно логгировать.
+ */
+class SignalEvent {
+public:
+    /**
+     * @brief Конструктор. Блокирует сигналы и создает signalfd.
+     * @param signals Список сигналов для перехвата.
+     * @throws std::runtime_error Если дескриптор не удалось создать.
+     */
+    explicit SignalEvent(std::initializer_list<int> signals);
+
+    /**
+     * @brief Деструктор. Закрывает дескриптор.
+     */
+    ~SignalEvent();
+
+    SignalEvent(const SignalEvent&) = delete;
+    SignalEvent& operator=(const SignalEvent&) = delete;
+
+    /**
+     * @brief Вычитывает пришедший сигнал.
+     * @return Номер сигнала или 0, если сигналов нет.
+     */
+    int read_signal();
+
+    /**
+     * @brief Возвращает дескриптор для ожидания в poll().
+     * @return Дескриптор signalfd.
+     */
+    int get_fd() const;
+
+private:
+    int fd; ///< Дескриптор signalfd.
+};
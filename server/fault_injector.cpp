@@ -0,0 +1,503 @@
+#include "fault_injector.h"
+#include "channel_controller.h"
+#include "my_tools.h"
+#include "logger.h"
+#include "config.h"
+
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+/**
+ * @brief Хэш FNV-1a имени канала (не зависит от реализации std::hash).
+ */
+uint64_t name_hash(const std::string& name) {
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char ch : name) {
+        hash = (hash ^ ch) * 1099511628211ull;
+    }
+    return hash;
+}
+
+/**
+ * @brief Разбивает строку по разделителю.
+ */
+std::vector<std::string> split(const std::string& text, char delimiter) {
+    std::vector<std::string> parts;
+    std::stringstream stream(text);
+    std::string part;
+    while (std::getline(stream, part, delimiter)) {
+        parts.push_back(part);
+    }
+    return parts;
+}
+
+}
+
+/**
+ * @brief Разбирает спецификацию правила.
+ * @throws std::invalid_argument Если спецификация некорректна.
+ */
+FaultRule FaultRule::parse(const std::string& spec) {
+    const std::vector<std::string> parts = split(spec, ':');
+    if (parts.size() != 3) {
+        throw std::invalid_argument("Invalid fault rule: " + spec);
+    }
+
+    FaultRule rule;
+    if (parts[0] == "busy") {
+        rule.state = ChannelStateManager::ChannelState::Busy;
+    } else if (parts[0] == "error") {
+        rule.state = ChannelStateManager::ChannelState::Error;
+    } else {
+        throw std::invalid_argument("Invalid fault state: " + parts[0]);
+    }
+
+    size_t pos = 0;
+    try {
+        rule.probability = std::stod(parts[1], &pos);
+    } catch (const std::exception&) {
+        pos = 0;
+    }
+    if (pos == 0 || pos != parts[1].size() || !(rule.probability > 0.0 && rule.probability < 1.0)) {
+        throw std::invalid_argument("Fault probability must be in (0, 1): " + parts[1]);
+    }
+
+    const size_t dash = parts[2].find('-');
+    rule.min_duration_ns = MyTools::parse_duration_ns(parts[2].substr(0, dash));
+    rule.max_duration_ns = dash == std::string::npos ? rule.min_duration_ns : MyTools::parse_duration_ns(parts[2].substr(dash + 1));
+    if (rule.min_duration_ns <= 0 || rule.max_duration_ns < rule.min_duration_ns) {
+        throw std::invalid_argument("Invalid fault duration: " + parts[2]);
+    }
+    return rule;
+}
+
+/**
+ * @brief Интенсивность начала сбоев (1/с).
+ *
+ * Для пуассоновского потока вероятность хотя бы одного события за секунду
+ * равна 1 - exp(-rate).
+ */
+double FaultRule::rate() const {
+    return -std::log1p(-probability);
+}
+
+/**
+ * @brief Возвращает спецификацию правила.
+ */
+std::string FaultRule::to_string() const {
+    std::ostringstream stream;
+    stream << (state == ChannelStateManager::ChannelState::Error ? "error" : "busy") << ':' << probability << ':'
+           << MyTools::format_duration(min_duration_ns);
+    if (max_duration_ns != min_duration_ns) {
+        stream << '-' << MyTools::format_duration(max_duration_ns);
+    }
+    return stream.str();
+}
+
+/**
+ * @brief Разбирает профиль из списка спецификаций.
+ * @throws std::invalid_argument Если спецификация некорректна.
+ */
+FaultProfile FaultProfile::parse(const std::vector<std::string>& specs) {
+    static const std::string seed_prefix = "seed=";
+
+    FaultProfile profile;
+    for (const std::string& spec : specs) {
+        if (spec.empty() || spec == "off") {
+            continue;
+        }
+        if (spec.compare(0, seed_prefix.size(), seed_prefix) == 0) {
+            const std::string value = spec.substr(seed_prefix.size());
+            size_t pos = 0;
+            try {
+                profile.seed = std::stoull(value, &pos);
+            } catch (const std::exception&) {
+                pos = 0;
+            }
+            if (pos == 0 || pos != value.size()) {
+                throw std::invalid_argument("Invalid fault seed: " + value);
+            }
+            continue;
+        }
+        profile.rules.push_back(FaultRule::parse(spec));
+    }
+    return profile;
+}
+
+/**
+ * @brief Разбирает профиль из строки спецификаций через запятую.
+ * @throws std::invalid_argument Если спецификация некорректна.
+ */
+FaultProfile FaultProfile::parse(const std::string& specs) {
+    return parse(split(specs, ','));
+}
+
+/**
+ * @brief Возвращает спецификацию профиля.
+ */
+std::string FaultProfile::to_string() const {
+    std::string text;
+    for (const FaultRule& rule : rules) {
+        text += (text.empty() ? "" : ", ") + rule.to_string();
+    }
+    if (text.empty()) {
+        text = "off";
+    }
+    if (seed) {
+        text += ", seed=" + std::to_string(*seed);
+    }
+    return text;
+}
+
+/**
+ * @brief Конструктор. Запускает поток имитации.
+ */
+FaultInjector::FaultInjector(const ChannelController& controller, FaultProfile default_profile, uint64_t seed)
+    : controller(controller), seed(seed ? seed : MyTools::make_seed()), default_profile(std::move(default_profile)) {
+    injector_thread = std::thread(&FaultInjector::run, this);
+}
+
+/**
+ * @brief Деструктор. Останавливает поток имитации.
+ */
+FaultInjector::~FaultInjector() {
+    stop();
+}
+
+/**
+ * @brief Останавливает поток имитации и завершает текущие сбои.
+ *
+ * Каналы не остаются в состоянии сбоя после остановки имитатора.
+ */
+void FaultInjector::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping) {
+            return;
+        }
+        stopping = true;
+    }
+    wake_cond_var.notify_all();
+    if (injector_thread.joinable()) {
+        injector_thread.join();
+    }
+
+    std::vector<std::string> log_lines;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& [name, faults] : channels) {
+            end_fault(*faults, log_lines);
+        }
+        channels.clear();
+        events = {};
+    }
+    write_log(log_lines);
+}
+
+/**
+ * @brief Задает собственный профиль канала.
+ */
+void FaultInjector::set_profile(const std::string& channel_name, FaultProfile profile) {
+    std::vector<std::string> log_lines;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        profiles[channel_name] = std::move(profile);
+        auto it = channels.find(channel_name);
+        if (it != channels.end()) {
+            restart(it->second, MyTools::monotonic_ns(), log_lines);
+        }
+    }
+    wake_cond_var.notify_all();
+    write_log(log_lines);
+}
+
+/**
+ * @brief Удаляет собственный профиль канала.
+ */
+void FaultInjector::clear_profile(const std::string& channel_name) {
+    std::vector<std::string> log_lines;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!profiles.erase(channel_name)) {
+            return;
+        }
+        auto it = channels.find(channel_name);
+        if (it != channels.end()) {
+            restart(it->second, MyTools::monotonic_ns(), log_lines);
+        }
+    }
+    wake_cond_var.notify_all();
+    write_log(log_lines);
+}
+
+/**
+ * @brief Задает общий профиль.
+ */
+void FaultInjector::set_default_profile(FaultProfile profile, bool clear_overrides) {
+    std::vector<std::string> log_lines;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        default_profile = std::move(profile);
+        if (clear_overrides) {
+            profiles.clear();
+        }
+        const int64_t now_ns = MyTools::monotonic_ns();
+        for (auto& [name, faults] : channels) {
+            if (!profiles.count(name)) {
+                restart(faults, now_ns, log_lines);
+            }
+        }
+    }
+    wake_cond_var.notify_all();
+    write_log(log_lines);
+}
+
+/**
+ * @brief Описывает профиль и состояние сбоев канала.
+ */
+std::string FaultInjector::describe(const std::string& channel_name) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::string text = get_profile(channel_name).to_string();
+    auto it = channels.find(channel_name);
+    if (it != channels.end() && it->second->active) {
+        text += ", " + ChannelStateManager::to_string(it->second->fault_state);
+    } else {
+        text += ", none";
+    }
+    text += ", " + std::to_string(it != channels.end() ? it->second->injected : 0);
+    return text;
+}
+
+/**
+ * @brief Описывает общий профиль.
+ */
+std::string FaultInjector::describe_default() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return default_profile.to_string();
+}
+
+/**
+ * @brief Основной цикл потока имитации.
+ *
+ * Поток спит до ближайшего события или очередного просмотра реестра. Реестр
+ * читается без мьютекса имитатора, лог пишется после его освобождения.
+ */
+void FaultInjector::run() {
+    const int64_t rescan_interval_ns = static_cast<int64_t>(MyConfig::DefaultConfig::fault_rescan_interval_ms) * 1000000;
+    int64_t next_scan_ns = 0;
+    std::vector<std::string> log_lines;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        int64_t now_ns = MyTools::monotonic_ns();
+        if (now_ns >= next_scan_ns) {
+            lock.unlock();
+            const std::vector<std::shared_ptr<IChannel>> snapshot = controller.get_channels();
+            lock.lock();
+            if (stopping) {
+                break;
+            }
+            now_ns = MyTools::monotonic_ns();
+            sync_channels(snapshot, now_ns);
+            next_scan_ns = now_ns + rescan_interval_ns;
+        }
+
+        while (!events.empty() && events.top().time_ns <= now_ns) {
+            Event event = events.top();
+            events.pop();
+            if (event.generation == event.faults->generation) {
+                handle_event(event.faults, now_ns, log_lines);
+            }
+        }
+
+        if (!log_lines.empty()) {
+            lock.unlock();
+            write_log(log_lines);
+            lock.lock();
+            continue;
+        }
+
+        const int64_t wake_ns = events.empty() ? next_scan_ns : std::min(next_scan_ns, events.top().time_ns);
+        wake_cond_var.wait_for(lock, std::chrono::nanoseconds(std::max<int64_t>(wake_ns - now_ns, 0)));
+    }
+}
+
+/**
+ * @brief Сверяет каналы имитатора со снимком реестра.
+ *
+ * Новые (и пересозданные под тем же именем) каналы получают генератор и первое
+ * событие; удаленные каналы забываются вместе с собственным профилем.
+ */
+void FaultInjector::sync_channels(const std::vector<std::shared_ptr<IChannel>>& snapshot, int64_t now_ns) {
+    const uint64_t scan = ++scan_counter;
+    for (const std::shared_ptr<IChannel>& channel : snapshot) {
+        std::shared_ptr<ChannelFaults>& faults = channels[channel->get_name()];
+        if (faults && faults->channel.lock() == channel) {
+            faults->scan = scan;
+            continue;
+        }
+        if (faults) {
+            ++faults->generation; // события прежнего канала устарели
+        }
+        faults = std::make_shared<ChannelFaults>();
+        faults->name = channel->get_name();
+        faults->channel = channel;
+        faults->scan = scan;
+        seed_channel(*faults);
+        schedule_onset(faults, now_ns);
+    }
+
+    for (auto it = channels.begin(); it != channels.end();) {
+        if (it->second->scan != scan) {
+            ++it->second->generation;
+            profiles.erase(it->first);
+            it = channels.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+/**
+ * @brief Обрабатывает событие канала.
+ *
+ * Во время сбоя событие означает его конец, иначе - начало нового сбоя.
+ * Сбой не накладывается на состояние busy/error, установленное не имитатором.
+ */
+void FaultInjector::handle_event(const std::shared_ptr<ChannelFaults>& self, int64_t now_ns, std::vector<std::string>& log_lines) {
+    ChannelFaults& faults = *self;
+    std::shared_ptr<IChannel> channel = faults.channel.lock();
+    if (!channel) {
+        return; // канал удален; запись забудется при следующем просмотре реестра
+    }
+
+    if (faults.active) {
+        end_fault(faults, log_lines);
+        schedule_onset(self, now_ns);
+        return;
+    }
+
+    const FaultProfile& profile = get_profile(faults.name);
+    double total_rate = 0.0;
+    for (const FaultRule& rule : profile.rules) {
+        total_rate += rule.rate();
+    }
+    double pick = next_uniform(faults) * total_rate;
+    const FaultRule* chosen = &profile.rules.back();
+    for (const FaultRule& rule : profile.rules) {
+        pick -= rule.rate();
+        if (pick < 0.0) {
+            chosen = &rule;
+            break;
+        }
+    }
+    const double duration_u = next_uniform(faults);
+
+    const ChannelStateManager::ChannelState state = channel->get_state();
+    if (state == ChannelStateManager::ChannelState::Busy || state == ChannelStateManager::ChannelState::Error) {
+        schedule_onset(self, now_ns);
+        return;
+    }
+
+    const int64_t duration_ns = chosen->min_duration_ns +
+        static_cast<int64_t>(duration_u * static_cast<double>(chosen->max_duration_ns - chosen->min_duration_ns));
+    faults.active = true;
+    faults.prior_state = state;
+    faults.fault_state = chosen->state;
+    ++faults.injected;
+    channel->set_state(chosen->state);
+    events.push({now_ns + duration_ns, faults.generation, self});
+    log_lines.push_back("Channel [" + faults.name + "] fault " + ChannelStateManager::to_string(chosen->state) +
+                        " for " + std::to_string(duration_ns / 1000000) + "ms");
+}
+
+/**
+ * @brief Завершает текущий сбой канала.
+ *
+ * Прежнее состояние восстанавливается, только если канал все еще в состоянии
+ * сбоя (например, остановленный канал уже сам перешел в idle_state).
+ */
+void FaultInjector::end_fault(ChannelFaults& faults, std::vector<std::string>& log_lines) {
+    if (!faults.active) {
+        return;
+    }
+    faults.active = false;
+    std::shared_ptr<IChannel> channel = faults.channel.lock();
+    if (channel && channel->get_state() == faults.fault_state) {
+        channel->set_state(faults.prior_state);
+        log_lines.push_back("Channel [" + faults.name + "] recovered to " + ChannelStateManager::to_string(faults.prior_state));
+    }
+}
+
+/**
+ * @brief Завершает сбой и заново планирует сбои канала.
+ *
+ * Генератор засевается заново, чтобы последовательность сбоев после смены
+ * профиля с зерном была воспроизводимой.
+ */
+void FaultInjector::restart(const std::shared_ptr<ChannelFaults>& faults, int64_t now_ns, std::vector<std::string>& log_lines) {
+    end_fault(*faults, log_lines);
+    ++faults->generation;
+    seed_channel(*faults);
+    schedule_onset(faults, now_ns);
+}
+
+/**
+ * @brief Планирует начало следующего сбоя канала.
+ *
+ * Интервал до сбоя распределен экспоненциально с суммарной интенсивностью правил.
+ */
+void FaultInjector::schedule_onset(const std::shared_ptr<ChannelFaults>& faults, int64_t now_ns) {
+    double total_rate = 0.0;
+    for (const FaultRule& rule : get_profile(faults->name).rules) {
+        total_rate += rule.rate();
+    }
+    if (total_rate <= 0.0) {
+        return;
+    }
+    const double interval_s = -std::log1p(-next_uniform(*faults)) / total_rate;
+    const int64_t interval_ns = static_cast<int64_t>(std::min(interval_s * 1e9, 1e17));
+    events.push({now_ns + interval_ns, faults->generation, faults});
+}
+
+/**
+ * @brief Возвращает действующий профиль канала.
+ */
+const FaultProfile& FaultInjector::get_profile(const std::string& channel_name) const {
+    auto it = profiles.find(channel_name);
+    return it != profiles.end() ? it->second : default_profile;
+}
+
+/**
+ * @brief Засевает генератор канала зерном профиля (или общим) и именем канала.
+ */
+void FaultInjector::seed_channel(ChannelFaults& faults) const {
+    const FaultProfile& profile = get_profile(faults.name);
+    faults.rng_state = profile.seed.value_or(seed) ^ name_hash(faults.name);
+}
+
+/**
+ * @brief Равномерное случайное число в [0, 1) (генератор splitmix64).
+ */
+double FaultInjector::next_uniform(ChannelFaults& faults) {
+    uint64_t z = (faults.rng_state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    z ^= z >> 31;
+    return static_cast<double>(z >> 11) * 0x1.0p-53;
+}
+
+/**
+ * @brief Пишет строки в лог.
+ */
+void FaultInjector::write_log(std::vector<std::string>& log_lines) {
+    for (const std::string& line : log_lines) {
+        Log::log(line);
+    }
+    log_lines.clear();
+}
@@ -0,0 +1,251 @@
+#pragma once
+
+#include "channel.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <queue>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <optional>
+#include <cstdint>
+
+class ChannelController;
+
+/**
+ * @struct FaultRule
+ * @brief Правило имитации сбоя канала.
+ *
+ * Спецификация: "<busy|error>:<вероятность>:<длительность>[-<макс. длительность>]",
+ * например "busy:0.01:1s-3s". Вероятность - вероятность начала сбоя за секунду
+ * (0 < p < 1); длительность сбоя выбирается равномерно из заданного интервала.
+ */
+struct FaultRule {
+    ChannelStateManager::ChannelState state = ChannelStateManager::ChannelState::Busy; ///< Состояние канала во время сбоя
+    double probability = 0.0; ///< Вероятность начала сбоя за секунду
+    int64_t min_duration_ns = 0; ///< Минимальная длительность сбоя (нс)
+    int64_t max_duration_ns = 0; ///< Максимальная длительность сбоя (нс)
+
+    /**
+     * @brief Разбирает спецификацию правила.
+     * @throws std::invalid_argument Если спецификация некорректна.
+     */
+    static FaultRule parse(const std::string& spec);
+
+    /**
+     * @brief Интенсивность начала сбоев (1/с), соответствующая вероятности за секунду.
+     */
+    double rate() const;
+
+    /**
+     * @brief Возвращает спецификацию правила.
+     */
+    std::string to_string() const;
+};
+
+/**
+ * @struct FaultProfile
+ * @brief Набор правил сбоев канала и зерно генератора.
+ */
+struct FaultProfile {
+    std::vector<FaultRule> rules; ///< Правила (пустой набор - сбоев нет)
+    std::optional<uint64_t> seed; ///< Зерно генератора (если не задано - общее зерно имитатора)
+
+    /**
+     * @brief Разбирает профиль из списка спецификаций.
+     *
+     * Элементы списка - правила FaultRule, "seed=<n>" или "off" (сбоев нет).
+     *
+     * @throws std::invalid_argument Если спецификация некорректна.
+     */
+    static FaultProfile parse(const std::vector<std::string>& specs);
+
+    /**
+     * @brief Разбирает профиль из строки спецификаций через запятую.
+     * @throws std::invalid_argument Если спецификация некорректна.
+     */
+    static FaultProfile parse(const std::string& specs);
+
+    /**
+     * @brief Возвращает спецификацию профиля (правила и зерно через запятую или "off").
+     */
+    std::string to_string() const;
+};
+
+/**
+ * @class FaultInjector
+ * @brief Имитатор сбоев каналов.
+ *
+ * Для каждого канала по его профилю (собственному или общему) разыгрываются
+ * моменты начала сбоев (пуассоновский поток с интенсивностью, соответствующей
+ * вероятностям правил) и их длительности. На время сбоя канал переводится
+ * в состояние правила (busy_state или error_state), после сбоя возвращается
+ * прежнее состояние, если его за это время никто не изменил.
+ *
+ * События всех каналов обрабатывает один поток по очереди с приоритетом
+ * по времени, поэтому стоимость не зависит от числа каналов без событий.
+ * Список каналов поток берет снимком реестра контроллера раз в
+ * fault_rescan_interval_ms и не блокирует поиск каналов; собственный мьютекс
+ * имитатора берут только его поток и команды управления сбоями.
+ *
+ * У каждого канала свой генератор, засеянный зерном профиля (или общим зерном)
+ * и именем канала, поэтому при заданном зерне последовательность сбоев канала
+ * воспроизводима и не зависит от других каналов.
+ */
+class FaultInjector {
+public:
+    /**
+     * @brief Конструктор. Запускает поток имитации.
+     * @param controller Контроллер каналов (должен пережить имитатор).
+     * @param default_profile Общий профиль каналов без собственного профиля.
+     * @param seed Общее зерно генераторов (0 - случайное).
+     */
+    FaultInjector(const ChannelController& controller, FaultProfile default_profile, uint64_t seed);
+
+    /**
+     * @brief Деструктор. Останавливает поток имитации.
+     */
+    ~FaultInjector();
+
+    FaultInjector(const FaultInjector&) = delete;
+    FaultInjector& operator=(const FaultInjector&) = delete;
+
+    /**
+     * @brief Останавливает поток имитации и завершает текущие сбои.
+     */
+    void stop();
+
+    /**
+     * @brief Задает собственный профиль канала.
+     *
+     * Текущий сбой канала завершается, розыгрыш начинается заново.
+     *
+     * @param channel_name Имя канала.
+     * @param profile Профиль.
+     */
+    void set_profile(const std::string& channel_name, FaultProfile profile);
+
+    /**
+     * @brief Удаляет собственный профиль канала (канал переходит на общий профиль).
+     * @param channel_name Имя канала.
+     */
+    void clear_profile(const std::string& channel_name);
+
+    /**
+     * @brief Задает общий профиль.
+     *
+     * Сбои каналов с общим профилем завершаются, розыгрыш начинается заново.
+     *
+     * @param profile Профиль.
+     * @param clear_overrides Удалить собственные профили всех каналов.
+     */
+    void set_default_profile(FaultProfile profile, bool clear_overrides = false);
+
+    /**
+     * @brief Описывает профиль и состояние сбоев канала.
+     *
+     * @param channel_name Имя канала.
+     * @return "<профиль>, <состояние сбоя или none>, <количество сбоев>".
+     */
+    std::string describe(const std::string& channel_name) const;
+
+    /**
+     * @brief Описывает общий профиль.
+     */
+    std::string describe_default() const;
+
+private:
+    /**
+     * @struct ChannelFaults
+     * @brief Состояние имитации сбоев одного канала.
+     */
+    struct ChannelFaults {
+        std::string name; ///< Имя канала
+        std::weak_ptr<IChannel> channel; ///< Канал (не продлевает его жизнь)
+        uint64_t rng_state = 0; ///< Состояние генератора (splitmix64)
+        uint64_t generation = 0; ///< Поколение расписания (устаревшие события пропускаются)
+        uint64_t scan = 0; ///< Номер последнего просмотра реестра, в котором канал был найден
+        bool active = false; ///< Идет сбой
+        ChannelStateManager::ChannelState fault_state = ChannelStateManager::ChannelState::Busy; ///< Состояние сбоя
+        ChannelStateManager::ChannelState prior_state = ChannelStateManager::ChannelState::Idle; ///< Состояние до сбоя
+        uint64_t injected = 0; ///< Количество сбоев
+    };
+
+    /**
+     * @struct Event
+     * @brief Запланированное событие канала (начало или конец сбоя).
+     */
+    struct Event {
+        int64_t time_ns; ///< Время события (нс, монотонные часы)
+        uint64_t generation; ///< Поколение расписания канала
+        std::shared_ptr<ChannelFaults> faults; ///< Канал
+
+        bool operator>(const Event& other) const { return time_ns > other.time_ns; }
+    };
+
+    /**
+     * @brief Основной цикл потока имитации.
+     */
+    void run();
+
+    /**
+     * @brief Сверяет каналы имитатора со снимком реестра.
+     */
+    void sync_channels(const std::vector<std::shared_ptr<IChannel>>& channels, int64_t now_ns);
+
+    /**
+     * @brief Обрабатывает событие канала.
+     */
+    void handle_event(const std::shared_ptr<ChannelFaults>& faults, int64_t now_ns, std::vector<std::string>& log_lines);
+
+    /**
+     * @brief Завершает текущий сбой канала, восстанавливая прежнее состояние.
+     */
+    void end_fault(ChannelFaults& faults, std::vector<std::string>& log_lines);
+
+    /**
+     * @brief Завершает сбой и заново планирует сбои канала (после смены профиля).
+     */
+    void restart(const std::shared_ptr<ChannelFaults>& faults, int64_t now_ns, std::vector<std::string>& log_lines);
+
+    /**
+     * @brief Планирует начало следующего сбоя канала.
+     */
+    void schedule_onset(const std::shared_ptr<ChannelFaults>& faults, int64_t now_ns);
+
+    /**
+     * @brief Возвращает действующий профиль канала.
+     */
+    const FaultProfile& get_profile(const std::string& channel_name) const;
+
+    /**
+     * @brief Засевает генератор канала.
+     */
+    void seed_channel(ChannelFaults& faults) const;
+
+    /**
+     * @brief Равномерное случайное число в [0, 1).
+     */
+    static double next_uniform(ChannelFaults& faults);
+
+    /**
+     * @brief Пишет строки в лог (вызывается без мьютекса имитатора).
+     */
+    static void write_log(std::vector<std::string>& log_lines);
+
+    const ChannelController& controller; ///< Контроллер каналов
+    uint64_t seed; ///< Общее зерно генераторов
+
+    mutable std::mutex mutex; ///< Мьютекс состояния имитатора
+    std::condition_variable wake_cond_var; ///< Пробуждение потока (новые события, остановка)
+    bool stopping = false; ///< Флаг остановки
+    FaultProfile default_profile; ///< Общий профиль
+    std::unordered_map<std::string, FaultProfile> profiles; ///< Собственные профили каналов
+    std::unordered_map<std::string, std::shared_ptr<ChannelFaults>> channels; ///< Каналы имитатора
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events; ///< События по времени
+    uint64_t scan_counter = 0; ///< Счетчик просмотров реестра
+    std::thread injector_thread; ///< Поток имитации
+};
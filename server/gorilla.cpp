@@ -0,0 +1,274 @@
+#include "gorilla.h"
+#include "sample_quantizer.h"
+
+#include <cstring>
+
+namespace {
+
+/**
+ * @brief Классы знаковых разностей (времен и кодов): префикс и ширина поля.
+ *
+ * Порядок важен: выбирается первый класс, в который помещается значение.
+ * Последний класс хранит разность целиком.
+ */
+struct DodClass {
+    uint64_t prefix; ///< Префикс класса
+    unsigned prefix_bits; ///< Длина префикса
+    unsigned value_bits; ///< Ширина поля значения
+};
+
+constexpr DodClass dod_classes[] = {
+    {0b10, 2, 7},
+    {0b110, 3, 14},
+    {0b1110, 4, 24},
+    {0b1111, 4, 64}
+};
+
+/**
+ * @brief Проверяет, помещается ли знаковое значение в bits бит.
+ */
+bool fits_signed(int64_t value, unsigned bits) {
+    if (bits >= 64) return true;
+    const int64_t limit = int64_t(1) << (bits - 1);
+    return value >= -limit && value < limit;
+}
+
+/**
+ * @brief Расширяет знак поля bits бит.
+ */
+int64_t sign_extend(uint64_t value, unsigned bits) {
+    if (bits >= 64) return static_cast<int64_t>(value);
+    const uint64_t sign = uint64_t(1) << (bits - 1);
+    return static_cast<int64_t>((value ^ sign) - sign);
+}
+
+/**
+ * @brief Записывает знаковую разность: '0' для нуля, иначе префикс класса и поле.
+ */
+void write_signed(BitWriter& writer, int64_t value) {
+    if (value == 0) {
+        writer.write(0, 1);
+        return;
+    }
+    for (const DodClass& dod_class : dod_classes) {
+        if (fits_signed(value, dod_class.value_bits)) {
+            writer.write(dod_class.prefix, dod_class.prefix_bits);
+            writer.write(static_cast<uint64_t>(value), dod_class.value_bits);
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Читает знаковую разность, записанную write_signed.
+ */
+int64_t read_signed(BitReader& reader) {
+    if (!reader.read_bit()) {
+        return 0;
+    }
+    unsigned value_bits = 64;
+    if (!reader.read_bit()) {
+        value_bits = 7;
+    } else if (!reader.read_bit()) {
+        value_bits = 14;
+    } else if (!reader.read_bit()) {
+        value_bits = 24;
+    }
+    return sign_extend(reader.read(value_bits), value_bits);
+}
+
+uint32_t float_bits(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+float bits_float(uint32_t bits) {
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+}
+
+/**
+ * @brief Дописывает младшие bits бит значения.
+ */
+void BitWriter::write(uint64_t value, unsigned bits) {
+    while (bits > 0) {
+        // Дописываем не больше, чем помещается до полного байта и в накопитель
+        const unsigned take = bits > 56 ? bits - 56 : bits;
+        const uint64_t part = take == 64 ? value : (value >> (bits - take)) & ((uint64_t(1) << take) - 1);
+        pending = (pending << take) | part;
+        pending_bits += take;
+        bits -= take;
+        while (pending_bits >= 8) {
+            pending_bits -= 8;
+            bytes.push_back(static_cast<uint8_t>(pending >> pending_bits));
+        }
+        pending &= (uint64_t(1) << pending_bits) - 1;
+    }
+}
+
+/**
+ * @brief Дописывает недописанные биты и возвращает буфер.
+ */
+const std::vector<uint8_t>& BitWriter::finish() {
+    if (pending_bits > 0) {
+        bytes.push_back(static_cast<uint8_t>(pending << (8 - pending_bits)));
+        pending = 0;
+        pending_bits = 0;
+    }
+    return bytes;
+}
+
+void BitWriter::clear() {
+    bytes.clear();
+    pending = 0;
+    pending_bits = 0;
+}
+
+/**
+ * @brief Читает bits бит.
+ */
+uint64_t BitReader::read(unsigned bits) {
+    uint64_t value = 0;
+    while (bits > 0) {
+        const size_t byte_index = position / 8;
+        const unsigned bit_offset = static_cast<unsigned>(position % 8);
+        const unsigned available = 8 - bit_offset;
+        const unsigned take = bits < available ? bits : available;
+        const uint8_t byte = byte_index < size ? data[byte_index] : 0;
+        const uint64_t part = (byte >> (available - take)) & ((1U << take) - 1);
+        value = (value << take) | part;
+        position += take;
+        bits -= take;
+    }
+    return value;
+}
+
+/**
+ * @brief Добавляет значение.
+ *
+ * Первое значение блока хранится целиком (64 бита времени и 32 бита значения
+ * или 64 бита кода).
+ */
+void GorillaEncoder::append(int64_t timestamp_ns, float value) {
+    if (value_count == 0) {
+        writer.write(static_cast<uint64_t>(timestamp_ns), 64);
+        previous_timestamp = timestamp_ns;
+        previous_delta = 0;
+    } else {
+        // Время: разность второго порядка
+        const int64_t delta = timestamp_ns - previous_timestamp;
+        write_signed(writer, delta - previous_delta);
+        previous_timestamp = timestamp_ns;
+        previous_delta = delta;
+    }
+
+    if (precision >= 0) {
+        // Значение: разность кодов с фиксированной точкой
+        const int64_t code = SampleQuantizer::to_code(value, precision);
+        if (value_count == 0) {
+            writer.write(static_cast<uint64_t>(code), 64);
+        } else {
+            write_signed(writer, code - previous_code);
+        }
+        previous_code = code;
+        ++value_count;
+        return;
+    }
+
+    const uint32_t bits = float_bits(value);
+    if (value_count == 0) {
+        writer.write(bits, 32);
+        previous_bits = bits;
+        ++value_count;
+        return;
+    }
+
+    // Значение: XOR с предыдущим
+    const uint32_t x = bits ^ previous_bits;
+    if (x == 0) {
+        writer.write(0, 1);
+    } else {
+        unsigned leading = static_cast<unsigned>(__builtin_clz(x));
+        const unsigned trailing = static_cast<unsigned>(__builtin_ctz(x));
+        if (leading > 31) leading = 31;
+        if (previous_leading != 0xFF && leading >= previous_leading && trailing >= previous_trailing) {
+            // Значащие биты помещаются в окно предыдущего значения
+            writer.write(0b10, 2);
+            writer.write(x >> previous_trailing, 32 - previous_leading - previous_trailing);
+        } else {
+            const unsigned meaningful = 32 - leading - trailing;
+            writer.write(0b11, 2);
+            writer.write(leading, 5);
+            writer.write(meaningful - 1, 5);
+            writer.write(x >> trailing, meaningful);
+            previous_leading = leading;
+            previous_trailing = trailing;
+        }
+    }
+    previous_bits = bits;
+    ++value_count;
+}
+
+/**
+ * @brief Сбрасывает кодировщик для нового блока.
+ */
+void GorillaEncoder::reset(int new_precision) {
+    writer.clear();
+    precision = new_precision;
+    previous_code = 0;
+    value_count = 0;
+    previous_timestamp = 0;
+    previous_delta = 0;
+    previous_bits = 0;
+    previous_leading = 0xFF;
+    previous_trailing = 0;
+}
+
+/**
+ * @brief Читает следующее значение.
+ */
+bool GorillaDecoder::next(int64_t& timestamp_ns, float& value) {
+    if (remaining == 0) {
+        return false;
+    }
+    --remaining;
+
+    if (first) {
+        previous_timestamp = static_cast<int64_t>(reader.read(64));
+    } else {
+        previous_delta += read_signed(reader);
+        previous_timestamp += previous_delta;
+    }
+    timestamp_ns = previous_timestamp;
+
+    if (precision >= 0) {
+        previous_code = first ? static_cast<int64_t>(reader.read(64)) : previous_code + read_signed(reader);
+        first = false;
+        value = SampleQuantizer::from_code(previous_code, precision);
+        return true;
+    }
+
+    if (first) {
+        first = false;
+        previous_bits = static_cast<uint32_t>(reader.read(32));
+        value = bits_float(previous_bits);
+        return true;
+    }
+
+    // Значение
+    if (reader.read_bit()) {
+        if (reader.read_bit()) {
+            previous_leading = static_cast<unsigned>(reader.read(5));
+            const unsigned meaningful = static_cast<unsigned>(reader.read(5)) + 1;
+            previous_trailing = 32 - previous_leading - meaningful;
+        }
+        const unsigned meaningful = 32 - previous_leading - previous_trailing;
+        previous_bits ^= static_cast<uint32_t>(reader.read(meaningful)) << previous_trailing;
+    }
+    value = bits_float(previous_bits);
+    return true;
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @class BitWriter
+ * @brief Запись битового потока (старшие биты первыми).
+ */
+class BitWriter {
+public:
+    /**
+     * @brief Дописывает младшие bits бит значения.
+     * @param value Значение.
+     * @param bits Количество бит (0..64).
+     */
+    void write(uint64_t value, unsigned bits);
+
+    /**
+     * @brief Дописывает недописанные биты и возвращает буфер.
+     * @return Байты потока (последний байт дополнен нулями).
+     */
+    const std::vector<uint8_t>& finish();
+
+    /**
+     * @brief Количество записанных бит.
+     */
+    size_t bit_count() const { return bytes.size() * 8 + pending_bits; }
+
+    /**
+     * @brief Очищает поток.
+     */
+    void clear();
+
+private:
+    std::vector<uint8_t> bytes; ///< Полные байты
+    uint64_t pending = 0; ///< Накопленные биты (младшие pending_bits бит)
+    unsigned pending_bits = 0; ///< Количество накопленных бит (< 8 после записи)
+};
+
+/**
+ * @class BitReader
+ * @brief Чтение битового потока, записанного BitWriter.
+ */
+class BitReader {
+public:
+    /**
+     * @brief Конструктор.
+     * @param data Байты потока.
+     * @param size Размер потока (байт).
+     */
+    BitReader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+    /**
+     * @brief Читает bits бит.
+     * @param bits Количество бит (0..64).
+     * @return Значение (за концом потока читаются нули).
+     */
+    uint64_t read(unsigned bits);
+
+    /**
+     * @brief Читает один бит.
+     */
+    bool read_bit() { return read(1) != 0; }
+
+private:
+    const uint8_t* data; ///< Байты потока
+    size_t size; ///< Размер потока (байт)
+    size_t position = 0; ///< Позиция (бит)
+};
+
+/**
+ * @class GorillaEncoder
+ * @brief Сжатие последовательности (время, значение) по схеме Gorilla.
+ *
+ * Времена кодируются разностью второго порядка (delta-of-delta): для равномерной
+ * сетки это один бит на значение. Значения float кодируются XOR с предыдущим:
+ * повтор - один бит, иначе значащие биты XOR в окне ведущих/хвостовых нулей.
+ * Схема из статьи Gorilla адаптирована к 32-битным float.
+ *
+ * Если задана точность, значения вместо этого хранятся кодами с фиксированной
+ * точкой (SampleQuantizer::to_code), а в поток пишутся разности кодов тем же
+ * способом, что и разности времен. Для измерений, ограниченных точностью
+ * диапазона, это заметно плотнее XOR.
+ */
+class GorillaEncoder {
+public:
+    /**
+     * @brief Добавляет значение.
+     * @param timestamp_ns Время (нс, не убывает).
+     * @param value Значение.
+     */
+    void append(int64_t timestamp_ns, float value);
+
+    /**
+     * @brief Завершает поток и возвращает закодированные байты.
+     */
+    const std::vector<uint8_t>& finish() { return writer.finish(); }
+
+    /**
+     * @brief Количество закодированных значений.
+     */
+    size_t count() const { return value_count; }
+
+    /**
+     * @brief Текущий размер потока (бит).
+     */
+    size_t bit_count() const { return writer.bit_count(); }
+
+    /**
+     * @brief Точность кодов значений (-1 - значения хранятся как float).
+     */
+    int get_precision() const { return precision; }
+
+    /**
+     * @brief Сбрасывает кодировщик для нового блока.
+     * @param new_precision Точность кодов значений (-1 - значения хранятся как float).
+     */
+    void reset(int new_precision = -1);
+
+private:
+    BitWriter writer; ///< Битовый поток
+    int precision = -1; ///< Точность кодов значений (-1 - float)
+    int64_t previous_code = 0; ///< Предыдущий код значения
+    size_t value_count = 0; ///< Количество значений
+    int64_t previous_timestamp = 0; ///< Предыдущее время
+    int64_t previous_delta = 0; ///< Предыдущая разность времен
+    uint32_t previous_bits = 0; ///< Биты предыдущего значения
+    unsigned previous_leading = 0xFF; ///< Ведущие нули предыдущего окна XOR (0xFF - окна нет)
+    unsigned previous_trailing = 0; ///< Хвостовые нули предыдущего окна XOR
+};
+
+/**
+ * @class GorillaDecoder
+ * @brief Распаковка потока GorillaEncoder.
+ */
+class GorillaDecoder {
+public:
+    /**
+     * @brief Конструктор.
+     * @param data Байты потока.
+     * @param size Размер потока (байт).
+     * @param count Количество значений в потоке.
+     * @param precision Точность кодов значений (-1 - значения хранятся как float).
+     */
+    GorillaDecoder(const uint8_t* data, size_t size, size_t count, int precision = -1)
+        : reader(data, size), remaining(count), precision(precision) {}
+
+    /**
+     * @brief Читает следующее значение.
+     * @param timestamp_ns Время (нс).
+     * @param value Значение.
+     * @return false, если значения закончились.
+     */
+    bool next(int64_t& timestamp_ns, float& value);
+
+private:
+    BitReader reader; ///< Битовый поток
+    size_t remaining; ///< Осталось значений
+    int precision; ///< Точность кодов значений (-1 - float)
+    int64_t previous_code = 0; ///< Предыдущий код значения
+    bool first = true; ///< Следующее значение - первое в потоке
+    int64_t previous_timestamp = 0; ///< Предыдущее время
+    int64_t previous_delta = 0; ///< Предыдущая разность времен
+    uint32_t previous_bits = 0; ///< Биты предыдущего значения
+    unsigned previous_leading = 0; ///< Ведущие нули окна XOR
+    unsigned previous_trailing = 0; ///< Хвостовые нули окна XOR
+};
@@ -0,0 +1,371 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+/**
+ * @brief Форматирует число для выгрузки.
+ */
+std::string format_value(double value) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+    return buffer;
+}
+
+/**
+ * @brief Имя метрики с метками: `name{labels}` или `name`.
+ */
+std::string with_labels(const std::string& name, const std::string& labels) {
+    return labels.empty() ? name : name + "{" + labels + "}";
+}
+
+/**
+ * @brief Добавляет метку к списку меток.
+ */
+std::string add_label(const std::string& labels, const std::string& label) {
+    return labels.empty() ? label : labels + "," + label;
+}
+
+/**
+ * @brief Имя типа метрики в формате Prometheus.
+ */
+const char* type_name(MetricSample::Type type) {
+    switch (type) {
+        case MetricSample::Type::Counter: return "counter";
+        case MetricSample::Type::Gauge: return "gauge";
+        case MetricSample::Type::Histogram: return "histogram";
+    }
+    return "untyped";
+}
+
+} // namespace
+
+/**
+ * @brief Текущее значение (сумма ячеек).
+ */
+uint64_t Counter::value() const {
+    uint64_t total = 0;
+    for (const Shard& shard : shards) {
+        total += shard.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+/**
+ * @brief Номер ячейки вызывающего потока.
+ */
+size_t Counter::shard_index() {
+    static std::atomic<size_t> next_index{0};
+    thread_local const size_t index = next_index.fetch_add(1, std::memory_order_relaxed) % shard_count;
+    return index;
+}
+
+/**
+ * @brief Оценка квантиля сверху (верхняя граница корзины).
+ */
+uint64_t Histogram::Snapshot::quantile(double q) const {
+    if (count == 0) {
+        return 0;
+    }
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * static_cast<double>(count))));
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i != buckets.size(); ++i) {
+        cumulative += buckets[i];
+        if (cumulative >= rank) {
+            return i + 1 == bucket_count ? bucket_lower(i) : bucket_upper(i) - 1;
+        }
+    }
+    return bucket_lower(bucket_count - 1);
+}
+
+/**
+ * @brief Количество значений меньше bound.
+ */
+uint64_t Histogram::Snapshot::count_below(uint64_t bound) const {
+    uint64_t result = 0;
+    for (size_t i = 0; i != buckets.size() && bucket_upper(i) <= bound; ++i) {
+        result += buckets[i];
+    }
+    return result;
+}
+
+/**
+ * @brief Добавляет значение.
+ */
+void Histogram::record(int64_t value) {
+    const uint64_t v = value > 0 ? static_cast<uint64_t>(value) : 0;
+    buckets[bucket_of(v)].fetch_add(1, std::memory_order_relaxed);
+    sum.add(v);
+}
+
+/**
+ * @brief Возвращает снимок гистограммы.
+ *
+ * Количество считается по корзинам, поэтому оно всегда согласовано с ними;
+ * сумма при параллельной записи может расходиться на несколько последних значений.
+ */
+Histogram::Snapshot Histogram::snapshot() const {
+    Snapshot result;
+    result.buckets.resize(bucket_count);
+    for (size_t i = 0; i != bucket_count; ++i) {
+        result.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+        result.count += result.buckets[i];
+    }
+    result.sum = sum.value();
+    return result;
+}
+
+/**
+ * @brief Номер корзины значения.
+ *
+ * Для значения со старшим битом m (m >= sub_bucket_bits) номер степени двойки -
+ * m - sub_bucket_bits + 1, номер корзины внутри нее - следующие sub_bucket_bits бит.
+ */
+size_t Histogram::bucket_of(uint64_t value) {
+    if (value < sub_bucket_count) {
+        return static_cast<size_t>(value);
+    }
+    const int magnitude = 63 - __builtin_clzll(value);
+    if (magnitude > max_magnitude) {
+        return bucket_count - 1;
+    }
+    const int shift = magnitude - sub_bucket_bits;
+    return static_cast<size_t>(shift + 1) * sub_bucket_count + static_cast<size_t>((value >> shift) - sub_bucket_count);
+}
+
+/**
+ * @brief Нижняя граница корзины (включительно).
+ */
+uint64_t Histogram::bucket_lower(size_t bucket) {
+    if (bucket < sub_bucket_count) {
+        return bucket;
+    }
+    const size_t shift = bucket / sub_bucket_count - 1;
+    return static_cast<uint64_t>(sub_bucket_count + bucket % sub_bucket_count) << shift;
+}
+
+/**
+ * @brief Верхняя граница корзины (не включительно); для последней корзины - UINT64_MAX.
+ */
+uint64_t Histogram::bucket_upper(size_t bucket) {
+    if (bucket + 1 >= bucket_count) {
+        return std::numeric_limits<uint64_t>::max();
+    }
+    if (bucket < sub_bucket_count) {
+        return bucket + 1;
+    }
+    const size_t shift = bucket / sub_bucket_count - 1;
+    return bucket_lower(bucket) + (uint64_t{1} << shift);
+}
+
+/**
+ * @brief Находит или создает запись метрики.
+ */
+MetricsRegistry::Entry& MetricsRegistry::get_entry(const std::string& name, const std::string& help,
+                                                   const std::string& labels, MetricSample::Type type) {
+    Entry& entry = metrics[{name, labels}];
+    if (!entry.counter && !entry.gauge && !entry.histogram) {
+        entry.type = type;
+        entry.help = help;
+    } else if (entry.type != type) {
+        throw std::logic_error("metric " + name + " is already registered with another type");
+    }
+    return entry;
+}
+
+/**
+ * @brief Возвращает счетчик, создавая его при первом обращении.
+ */
+Counter& MetricsRegistry::counter(const std::string& name, const std::string& help, const std::string& labels) {
+    std::lock_guard<std::mutex> lock(metrics_mutex);
+    Entry& entry = get_entry(name, help, labels, MetricSample::Type::Counter);
+    if (!entry.counter) {
+        entry.counter = std::make_unique<Counter>();
+    }
+    return *entry.counter;
+}
+
+/**
+ * @brief Возвращает величину, создавая ее при первом обращении.
+ */
+Gauge& MetricsRegistry::gauge(const std::string& name, const std::string& help, const std::string& labels) {
+    std::lock_guard<std::mutex> lock(metrics_mutex);
+    Entry& entry = get_entry(name, help, labels, MetricSample::Type::Gauge);
+    if (!entry.gauge) {
+        entry.gauge = std::make_unique<Gauge>();
+    }
+    return *entry.gauge;
+}
+
+/**
+ * @brief Возвращает гистограмму длительностей.
+ *
+ * Границы в выгрузке Prometheus - степени четверки от ~1 мкс до ~17 с.
+ */
+Histogram& MetricsRegistry::duration_histogram(const std::string& name, const std::string& help, const std::string& labels) {
+    std::lock_guard<std::mutex> lock(metrics_mutex);
+    Entry& entry = get_entry(name, help, labels, MetricSample::Type::Histogram);
+    if (!entry.histogram) {
+        entry.histogram = std::make_unique<Histogram>(1e-9, 10, 34);
+    }
+    return *entry.histogram;
+}
+
+/**
+ * @brief Возвращает гистограмму размеров.
+ *
+ * Границы в выгрузке Prometheus - степени четверки от 16 байт до 64 КиБ.
+ */
+Histogram& MetricsRegistry::size_histogram(const std::string& name, const std::string& help, const std::string& labels) {
+    std::lock_guard<std::mutex> lock(metrics_mutex);
+    Entry& entry = get_entry(name, help, labels, MetricSample::Type::Histogram);
+    if (!entry.histogram) {
+        entry.histogram = std::make_unique<Histogram>(1.0, 4, 16);
+    }
+    return *entry.histogram;
+}
+
+/**
+ * @brief Добавляет сборщик.
+ */
+size_t MetricsRegistry::add_collector(Collector collector) {
+    std::lock_guard<std::mutex> lock(collectors_mutex);
+    const size_t id = next_collector_id++;
+    collectors[id] = std::move(collector);
+    return id;
+}
+
+/**
+ * @brief Удаляет сборщик.
+ *
+ * Сборщики вызываются под тем же мьютексом, поэтому после возврата удаленный
+ * сборщик гарантированно не выполняется.
+ */
+void MetricsRegistry::remove_collector(size_t id) {
+    std::lock_guard<std::mutex> lock(collectors_mutex);
+    collectors.erase(id);
+}
+
+/**
+ * @brief Снимок всех метрик, отсортированный по имени семейства.
+ */
+std::vector<MetricSample> MetricsRegistry::collect() {
+    std::vector<MetricSample> samples;
+    {
+        std::lock_guard<std::mutex> lock(metrics_mutex);
+        samples.reserve(metrics.size());
+        for (const auto& [key, entry] : metrics) {
+            MetricSample sample;
+            sample.name = key.first;
+            sample.labels = key.second;
+            sample.help = entry.help;
+            sample.type = entry.type;
+            if (entry.counter) {
+                sample.value = static_cast<double>(entry.counter->value());
+            } else if (entry.gauge) {
+                sample.value = static_cast<double>(entry.gauge->value());
+            } else {
+                sample.histogram = entry.histogram.get();
+                sample.snapshot = entry.histogram->snapshot();
+            }
+            samples.push_back(std::move(sample));
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(collectors_mutex);
+        for (const auto& collector : collectors) {
+            collector.second(samples);
+        }
+    }
+    std::stable_sort(samples.begin(), samples.end(),
+                     [](const MetricSample& a, const MetricSample& b) { return a.name < b.name; });
+    return samples;
+}
+
+/**
+ * @brief Выгрузка в текстовом формате Prometheus.
+ */
+std::string MetricsRegistry::render_prometheus() {
+    std::string text;
+    const std::vector<MetricSample> samples = collect();
+    for (size_t i = 0; i != samples.size(); ++i) {
+        const MetricSample& sample = samples[i];
+        if (i == 0 || samples[i - 1].name != sample.name) {
+            text += "# HELP " + sample.name + " " + sample.help + "\n";
+            text += "# TYPE " + sample.name + " " + type_name(sample.type) + "\n";
+        }
+        if (sample.type != MetricSample::Type::Histogram) {
+            text += with_labels(sample.name, sample.labels) + " " + format_value(sample.value) + "\n";
+            continue;
+        }
+
+        const Histogram& histogram = *sample.histogram;
+        for (int exp = histogram.first_bound_exp; exp <= histogram.last_bound_exp; exp += 2) {
+            const uint64_t bound = uint64_t{1} << exp;
+            const std::string le = "le=\"" + format_value(static_cast<double>(bound) * histogram.unit) + "\"";
+            text += with_labels(sample.name + "_bucket", add_label(sample.labels, le)) + " " +
+                    std::to_string(sample.snapshot.count_below(bound)) + "\n";
+        }
+        text += with_labels(sample.name + "_bucket", add_label(sample.labels, "le=\"+Inf\"")) + " " +
+                std::to_string(sample.snapshot.count) + "\n";
+        text += with_labels(sample.name + "_sum", sample.labels) + " " +
+                format_value(static_cast<double>(sample.snapshot.sum) * histogram.unit) + "\n";
+        text += with_labels(sample.name + "_count", sample.labels) + " " + std::to_string(sample.snapshot.count) + "\n";
+    }
+    return text;
+}
+
+/**
+ * @brief Краткая выгрузка для команды get_metrics.
+ */
+std::string MetricsRegistry::render_summary(const std::string& prefix) {
+    std::string body;
+    size_t n = 0;
+    auto add = [&](const std::string& name, const std::string& labels, double value) {
+        body += ", " + with_labels(name, labels) + ", " + format_value(value);
+        ++n;
+    };
+
+    for (const MetricSample& sample : collect()) {
+        if (sample.name.compare(0, prefix.size(), prefix) != 0) {
+            continue;
+        }
+        if (sample.type != MetricSample::Type::Histogram) {
+            add(sample.name, sample.labels, sample.value);
+            continue;
+        }
+        const double unit = sample.histogram->unit;
+        const Histogram::Snapshot& snapshot = sample.snapshot;
+        add(sample.name + "_count", sample.labels, static_cast<double>(snapshot.count));
+        add(sample.name + "_sum", sample.labels, static_cast<double>(snapshot.sum) * unit);
+        add(sample.name + "_p50", sample.labels, static_cast<double>(snapshot.quantile(0.5)) * unit);
+        add(sample.name + "_p99", sample.labels, static_cast<double>(snapshot.quantile(0.99)) * unit);
+        add(sample.name + "_p999", sample.labels, static_cast<double>(snapshot.quantile(0.999)) * unit);
+        add(sample.name + "_max", sample.labels, static_cast<double>(snapshot.quantile(1.0)) * unit);
+    }
+    return "ok, " + std::to_string(n) + body;
+}
+
+/**
+ * @brief Экранирует значение метки для формата Prometheus.
+ */
+std::string Metrics::escape_label(const std::string& value) {
+    std::string result;
+    result.reserve(value.size());
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            result += '\\';
+            result += c;
+        } else if (c == '\n') {
+            result += "\\n";
+        } else {
+            result += c;
+        }
+    }
+    return result;
+}
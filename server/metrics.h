@@ -0,0 +1,313 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @class Counter
+ * @brief Монотонный счетчик, разделенный по потокам.
+ *
+ * Каждый поток увеличивает свою ячейку (ячейки выровнены по кэш-линии), поэтому
+ * частое увеличение из многих потоков не приводит к борьбе за одну кэш-линию.
+ * Значение - сумма ячеек, считается только при чтении.
+ */
+class Counter {
+public:
+    static constexpr size_t shard_count = 16; ///< Количество ячеек
+
+    /**
+     * @brief Увеличивает счетчик.
+     * @param n Приращение.
+     */
+    void add(uint64_t n = 1) { shards[shard_index()].value.fetch_add(n, std::memory_order_relaxed); }
+
+    /**
+     * @brief Текущее значение (сумма ячеек).
+     */
+    uint64_t value() const;
+
+    /**
+     * @brief Номер ячейки вызывающего потока.
+     *
+     * Потоки получают номера по кругу при первом обращении.
+     */
+    static size_t shard_index();
+
+private:
+    /**
+     * @struct Shard
+     * @brief Ячейка счетчика.
+     */
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> value{0}; ///< Значение ячейки
+    };
+
+    std::array<Shard, shard_count> shards{}; ///< Ячейки
+};
+
+/**
+ * @class Gauge
+ * @brief Текущее значение величины (например, длины очереди).
+ */
+class Gauge {
+public:
+    /// Устанавливает значение
+    void set(int64_t v) { current.store(v, std::memory_order_relaxed); }
+
+    /// Изменяет значение на delta
+    void add(int64_t delta) { current.fetch_add(delta, std::memory_order_relaxed); }
+
+    /// Текущее значение
+    int64_t value() const { return current.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> current{0}; ///< Значение
+};
+
+/**
+ * @class Histogram
+ * @brief Гистограмма с лог-линейными корзинами (в духе HDR Histogram).
+ *
+ * Значения - неотрицательные целые (наносекунды, байты). Каждая степень двойки
+ * делится на sub_bucket_count равных корзин, поэтому относительная погрешность
+ * не превышает 1/sub_bucket_count при любом масштабе; значения меньше
+ * sub_bucket_count хранятся точно. Значения выше 2^(max_magnitude+1) попадают
+ * в последнюю корзину. Запись - две relaxed-атомарные операции без блокировок.
+ */
+class Histogram {
+public:
+    static constexpr int sub_bucket_bits = 4; ///< log2 количества корзин на степень двойки
+    static constexpr size_t sub_bucket_count = size_t{1} << sub_bucket_bits; ///< Корзин на степень двойки
+    static constexpr int max_magnitude = 42; ///< Старший учитываемый бит значения
+    static constexpr size_t bucket_count = (max_magnitude - sub_bucket_bits + 2) * sub_bucket_count; ///< Количество корзин
+
+    /**
+     * @struct Snapshot
+     * @brief Снимок гистограммы.
+     */
+    struct Snapshot {
+        std::vector<uint64_t> buckets; ///< Количество значений по корзинам
+        uint64_t count = 0; ///< Количество значений
+        uint64_t sum = 0; ///< Сумма значений
+
+        /**
+         * @brief Оценка квантиля сверху (верхняя граница корзины).
+         * @param q Уровень квантиля [0, 1].
+         * @return Значение или 0, если значений нет.
+         */
+        uint64_t quantile(double q) const;
+
+        /**
+         * @brief Количество значений меньше bound.
+         *
+         * Точно, если bound - граница корзины (например, степень двойки).
+         */
+        uint64_t count_below(uint64_t bound) const;
+    };
+
+    /**
+     * @brief Конструктор.
+     * @param unit Множитель перевода значений в единицы выгрузки (1e-9 для наносекунд в секунды).
+     * @param first_bound_exp log2 первой границы корзин в выгрузке Prometheus.
+     * @param last_bound_exp log2 последней границы корзин в выгрузке Prometheus.
+     */
+    Histogram(double unit, int first_bound_exp, int last_bound_exp)
+        : unit(unit), first_bound_exp(first_bound_exp), last_bound_exp(last_bound_exp) {}
+
+    /**
+     * @brief Добавляет значение; отрицательные значения считаются нулевыми.
+     */
+    void record(int64_t value);
+
+    /**
+     * @brief Возвращает снимок гистограммы.
+     */
+    Snapshot snapshot() const;
+
+    /**
+     * @brief Номер корзины значения.
+     */
+    static size_t bucket_of(uint64_t value);
+
+    /**
+     * @brief Нижняя граница корзины (включительно).
+     */
+    static uint64_t bucket_lower(size_t bucket);
+
+    /**
+     * @brief Верхняя граница корзины (не включительно).
+     */
+    static uint64_t bucket_upper(size_t bucket);
+
+    const double unit; ///< Множитель перевода в единицы выгрузки
+    const int first_bound_exp; ///< log2 первой границы корзин в выгрузке
+    const int last_bound_exp; ///< log2 последней границы корзин в выгрузке
+
+private:
+    std::array<std::atomic<uint64_t>, bucket_count> buckets{}; ///< Количество значений по корзинам
+    Counter sum; ///< Сумма значений
+};
+
+/**
+ * @struct MetricSample
+ * @brief Значение метрики, подготовленное к выгрузке.
+ */
+struct MetricSample {
+    /**
+     * @enum Type
+     * @brief Тип метрики.
+     */
+    enum class Type {
+        Counter,
+        Gauge,
+        Histogram
+    };
+
+    std::string name; ///< Имя семейства метрик
+    std::string help; ///< Описание семейства
+    Type type = Type::Counter; ///< Тип метрики
+    std::string labels; ///< Метки в формате Prometheus без скобок: `command="get_result"`
+    double value = 0; ///< Значение счетчика или величины
+    const Histogram* histogram = nullptr; ///< Гистограмма (для типа Histogram)
+    Histogram::Snapshot snapshot; ///< Снимок гистограммы (для типа Histogram)
+};
+
+/**
+ * @class MetricsRegistry
+ * @brief Реестр метрик сервера.
+ *
+ * Метрики создаются по имени и меткам и живут до конца процесса, поэтому ссылку,
+ * полученную один раз, можно хранить и обновлять без обращения к реестру.
+ * Величины, которые дешевле посчитать при выгрузке, чем поддерживать (например,
+ * количество значений по каналам), отдают сборщики: функции, которые вызываются
+ * при каждой выгрузке.
+ */
+class MetricsRegistry {
+public:
+    /// Сборщик метрик: добавляет значения в список при выгрузке
+    using Collector = std::function<void(std::vector<MetricSample>&)>;
+
+    /**
+     * @brief Получить единственный экземпляр реестра.
+     */
+    static MetricsRegistry& get_instance() {
+        static MetricsRegistry instance;
+        return instance;
+    }
+
+    /**
+     * @brief Возвращает счетчик, создавая его при первом обращении.
+     * @param name Имя семейства (например, multimeter_commands_total).
+     * @param help Описание семейства.
+     * @param labels Метки в формате Prometheus без скобок.
+     * @throws std::logic_error Если под этим именем зарегистрирована метрика другого типа.
+     */
+    Counter& counter(const std::string& name, const std::string& help, const std::string& labels = "");
+
+    /**
+     * @brief Возвращает величину, создавая ее при первом обращении.
+     * @throws std::logic_error Если под этим именем зарегистрирована метрика другого типа.
+     */
+    Gauge& gauge(const std::string& name, const std::string& help, const std::string& labels = "");
+
+    /**
+     * @brief Возвращает гистограмму длительностей (значения в наносекундах, выгрузка в секундах).
+     * @throws std::logic_error Если под этим именем зарегистрирована метрика другого типа.
+     */
+    Histogram& duration_histogram(const std::string& name, const std::string& help, const std::string& labels = "");
+
+    /**
+     * @brief Возвращает гистограмму размеров (значения в байтах).
+     * @throws std::logic_error Если под этим именем зарегистрирована метрика другого типа.
+     */
+    Histogram& size_histogram(const std::string& name, const std::string& help, const std::string& labels = "");
+
+    /**
+     * @brief Добавляет сборщик.
+     *
+     * Сборщик вызывается под мьютексом сборщиков и не должен обращаться к реестру.
+     *
+     * @return Идентификатор для remove_collector.
+     */
+    size_t add_collector(Collector collector);
+
+    /**
+     * @brief Удаляет сборщик. После возврата сборщик больше не вызывается.
+     */
+    void remove_collector(size_t id);
+
+    /**
+     * @brief Снимок всех метрик, отсортированный по имени семейства.
+     */
+    std::vector<MetricSample> collect();
+
+    /**
+     * @brief Выгрузка в текстовом формате Prometheus.
+     */
+    std::string render_prometheus();
+
+    /**
+     * @brief Краткая выгрузка для команды get_metrics.
+     *
+     * Ответ: "ok, <n>, <имя>, <значение>, ..."; гистограмма дает строки
+     * _count, _sum, _p50, _p99, _p999 и _max.
+     *
+     * @param prefix Префикс имен выгружаемых семейств; пустой - все.
+     */
+    std::string render_summary(const std::string& prefix);
+
+private:
+    MetricsRegistry() = default;
+
+    /**
+     * @struct Entry
+     * @brief Зарегистрированная метрика.
+     */
+    struct Entry {
+        MetricSample::Type type; ///< Тип метрики
+        std::string help; ///< Описание семейства
+        std::unique_ptr<Counter> counter; ///< Счетчик
+        std::unique_ptr<Gauge> gauge; ///< Величина
+        std::unique_ptr<Histogram> histogram; ///< Гистограмма
+    };
+
+    /**
+     * @brief Находит или создает запись метрики.
+     */
+    Entry& get_entry(const std::string& name, const std::string& help, const std::string& labels, MetricSample::Type type);
+
+    std::mutex metrics_mutex; ///< Мьютекс списка метрик
+    std::map<std::pair<std::string, std::string>, Entry> metrics; ///< Метрики по (имя, метки)
+    std::mutex collectors_mutex; ///< Мьютекс списка сборщиков
+    std::map<size_t, Collector> collectors; ///< Сборщики по идентификатору
+    size_t next_collector_id = 0; ///< Следующий идентификатор сборщика
+};
+
+namespace Metrics {
+    inline MetricsRegistry& registry() {
+        return MetricsRegistry::get_instance();
+    }
+
+    /**
+     * @brief Время для измерения длительностей (нс, steady_clock).
+     */
+    inline int64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /**
+     * @brief Экранирует значение метки для формата Prometheus.
+     */
+    std::string escape_label(const std::string& value);
+}
@@ -3,14 +3,40 @@
 #include <iostream>
 #include <sys/socket.h>
 #include <sys/un.h>
-#include <sys/select.h>
+#include <poll.h>
+#include <sys/epoll.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <cstring>
 #include <sstream>
-#include <signal.h>
+#include <unordered_map>
 #include <errno.h>
 
+namespace {
+
+/// Метка метрик для неизвестных команд
+const std::string unknown_command = "unknown";
+
+/**
+ * @brief Записывает данные в сокет целиком (запись может быть частичной).
+ * 
+ * Соединение, закрытое клиентом, не должно завершать сервер сигналом SIGPIPE.
+ * 
+ * @return false, если соединение разорвано.
+ */
+bool write_all(int socket, const std::string& data) {
+    size_t written = 0;
+    while (written != data.size()) {
+        const ssize_t n = send(socket, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+        if (n == -1 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        written += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+} // namespace
+
 /**
  * @brief Конструктор класса Multimeter.
  * 
@@ -19,20 +45,47 @@
  * @param socket_path Путь к Unix-сокету для соединений.
  * @param thread_count Количество потоков в пуле.
  * @param channel_count Количество каналов.
+ * @param table_channel_count Количество каналов в плотной таблице.
  */
-Multimeter::Multimeter(const std::string& socket_path, size_t thread_count, size_t channel_count)
-    : pool(thread_count), channel_controller(channel_count), socket_path(socket_path) {
+Multimeter::Multimeter(const std::string& socket_path, size_t thread_count, size_t channel_count, size_t table_channel_count)
+    : pool(thread_count), channel_controller(channel_count, table_channel_count), socket_path(socket_path),
+      request_sizes(Metrics::registry().size_histogram("multimeter_client_request_bytes", "Sizes of client requests")),
+      response_sizes(Metrics::registry().size_histogram("multimeter_client_response_bytes", "Sizes of responses to clients")) {
+    metrics_collector_id = Metrics::registry().add_collector([](std::vector<MetricSample>& samples) {
+        MetricSample backlog;
+        backlog.name = "multimeter_logger_backlog";
+        backlog.help = "Log messages waiting to be written";
+        backlog.type = MetricSample::Type::Gauge;
+        backlog.value = static_cast<double>(ThreadSafeLogger::get_instance().get_backlog());
+        samples.push_back(std::move(backlog));
+    });
+
+    const std::string store_directory = MyConfig::DefaultConfig::store_directory;
+    if (!store_directory.empty()) {
+        try {
+            series_store = std::make_unique<SeriesStore>(store_directory, channel_controller);
+        } catch (const std::exception& e) {
+            // Без хранилища сервер остается работоспособным
+            Log::log("Series store is disabled: " + std::string(e.what()));
+        }
+    }
     Log::log("Multimeter is ready to work");
 }
 
 /**
  * @brief Деструктор класса Multimeter.
- * 
- * Останавливает сервер и закрывает сокет.
+ *
+ * Останавливает сервер и закрывает сокет. Хранилище останавливается после
+ * каналов, чтобы дописать их последние значения.
  */
 Multimeter::~Multimeter() {
-    channel_controller.stop();
     stop();
+    channel_controller.stop();
+    if (series_store) {
+        series_store->stop();
+    }
+    close_socket();
+    Metrics::registry().remove_collector(metrics_collector_id);
     Log::log("Multimeter is turned off");
 }
 
@@ -45,81 +98,165 @@ void Multimeter::add_channel(std::shared_ptr<IChannel>&& channel) {
     channel_controller.add_channel(std::move(channel));
 }
 
+/**
+ * @brief Закрывает сокет клиента.
+ */
+Multimeter::ClientConnection::~ClientConnection() {
+    close(socket);
+}
+
 /**
  * @brief Запускает сервер и начинает прослушивание запросов от клиентов.
  * 
  * Эта функция блокирует выполнение и обрабатывает клиентские соединения.
+ * Соединения, ожидающие команд, ждет этот цикл: соединение, приславшее данные,
+ * передается в пул потоков. Соединения зарегистрированы в epoll с EPOLLONESHOT,
+ * поэтому до конца обработки цикл его не ждет и команды одного соединения
+ * обрабатываются по порядку.
  */
 void Multimeter::run() {
-    setup_signal_handler();
     setup_socket();
+    setup_metrics_socket();
 
-    Log::log("Multimeter is running...");
-
-    fd_set readfds;
-    struct timeval timeout;
-
-    while (server_running) {
-        FD_ZERO(&readfds);
-        FD_SET(server_socket, &readfds);
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd == -1) {
+        perror("epoll_create1");
+        exit(1);
+    }
+    for (int fd : {server_socket, signal_event.get_fd(), shutdown_event.get_fd(), metrics_socket}) {
+        // Отрицательный дескриптор - выгрузка метрик отключена
+        if (fd == -1) continue;
+        struct epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1) {
+            perror("epoll_ctl");
+            exit(1);
+        }
+    }
 
-        timeout.tv_sec = 1;
-        timeout.tv_usec = 0;
+    Log::log("Multimeter is running...");
+    Tracer::get_instance().set_thread_name("main");
 
-        int select_result = select(server_socket + 1, &readfds, nullptr, nullptr, &timeout);
+    struct epoll_event events[64];
+    bool stopping = false;
+    while (server_running && !stopping) {
+        // Ждем без тайм-аута: остановку сообщают signalfd и eventfd
+        int event_count = epoll_wait(epoll_fd, events, 64, -1);
 
-        if (select_result == -1) {
+        if (event_count == -1) {
             if (errno == EINTR) {
-                continue; // Если select был прерван сигналом, продолжаем выполнение
+                continue; // Если ожидание было прервано сигналом, продолжаем выполнение
             }
-            perror("select");
+            perror("epoll_wait");
             break;
-        } else if (select_result == 0) {
-            continue; // Тайм-аут, продолжаем
-        } else {
-            if (FD_ISSET(server_socket, &readfds)) {
+        }
+
+        for (int i = 0; i != event_count; ++i) {
+            const int fd = events[i].data.fd;
+            if (fd == signal_event.get_fd()) {
+                handle_signal();
+            } else if (fd == shutdown_event.get_fd()) {
+                stopping = true; // Событие остановки взведено
+            } else if (fd == server_socket) {
+                TraceSpan span("accept", "request");
                 int client_socket = accept(server_socket, nullptr, nullptr);
                 if (client_socket == -1) {
-                    perror("accept");
+                    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                        perror("accept");
+                    }
                     continue;
                 }
-
-                pool.enqueue([this, client_socket] {
-                    handle_client(client_socket);
+                auto client = std::make_shared<ClientConnection>(client_socket);
+                struct epoll_event event{};
+                event.events = EPOLLIN | EPOLLONESHOT;
+                event.data.fd = client_socket;
+                std::lock_guard<InstrumentedMutex> lock(clients_mutex);
+                if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client_socket, &event) == 0) {
+                    clients[client_socket] = std::move(client);
+                }
+            } else if (fd == metrics_socket) {
+                int client_socket = accept(metrics_socket, nullptr, nullptr);
+                if (client_socket != -1) {
+                    pool.enqueue([this, client_socket] {
+                        serve_metrics(client_socket);
+                    });
+                }
+            } else {
+                // Соединение клиента прислало данные или закрыто клиентом
+                ClientPtr client;
+                {
+                    std::lock_guard<InstrumentedMutex> lock(clients_mutex);
+                    auto it = clients.find(fd);
+                    if (it == clients.end()) continue;
+                    client = it->second;
+                }
+                pool.enqueue([this, client = std::move(client)] {
+                    serve_client(*client);
                 });
             }
         }
     }
+
+    // Ожидающие соединения закрываются сразу, обрабатываемые - после обработки
+    {
+        std::lock_guard<InstrumentedMutex> lock(clients_mutex);
+        clients_closed = true;
+        clients.clear();
+        close(epoll_fd);
+        epoll_fd = -1;
+    }
+    close_socket();
 }
 
 /**
- * @brief Останавливает сервер и освобождает ресурсы.
+ * @brief Останавливает сервер.
  * 
- * Закрывает сокет и очищает все ресурсы.
+ * Сбрасывает флаг работы и взводит событие остановки, которое мгновенно будит
+ * главный цикл; он закрывает ожидающие соединения клиентов.
  */
 void Multimeter::stop() {
-    server_running = false;
+    if (server_running.exchange(false)) {
+        shutdown_event.notify();
+        Log::log("Multimeter is stopped");
+    }
+}
+
+/**
+ * @brief Задает путь к сокету выгрузки метрик.
+ * 
+ * @param path Путь к сокету; пустая строка отключает выгрузку метрик.
+ */
+void Multimeter::set_metrics_socket_path(const std::string& path) {
+    metrics_socket_path = path;
+}
+
+/**
+ * @brief Закрывает сокеты сервера и метрик и удаляет их файлы.
+ */
+void Multimeter::close_socket() {
     if (server_socket != -1) {
         close(server_socket);
+        server_socket = -1;
         unlink(socket_path.c_str());
     }
-    Log::log("Multimeter is stopped");
+    if (metrics_socket != -1) {
+        close(metrics_socket);
+        metrics_socket = -1;
+        unlink(metrics_socket_path.c_str());
+    }
 }
 
 /**
- * @brief Настроить обработчик сигнала для безопасного завершения работы сервера.
+ * @brief Обрабатывает сигнал, пришедший через signalfd.
  * 
- * Устанавливает обработчик для сигнала SIGINT, чтобы корректно завершить работу.
+ * Логгирует сигнал и останавливает сервер.
  */
-void Multimeter::setup_signal_handler() {
-    struct sigaction sa{};
-    sa.sa_handler = signal_handler;
-    sigemptyset(&sa.sa_mask);
-    sa.sa_flags = 0;
-
-    if (sigaction(SIGINT, &sa, nullptr) == -1) {
-        perror("sigaction");
-        exit(1);
+void Multimeter::handle_signal() {
+    int signum = signal_event.read_signal();
+    if (signum != 0) {
+        Log::log("Received signal " + std::to_string(signum) + ", stopping the server...");
+        stop();
     }
 }
 
@@ -154,6 +291,41 @@ void Multimeter::setup_socket() {
     set_socket_nonblocking(server_socket);
 }
 
+/**
+ * @brief Настроить сокет выгрузки метрик.
+ * 
+ * Ошибка не останавливает сервер: выгрузка через сокет просто отключается.
+ */
+void Multimeter::setup_metrics_socket() {
+    if (metrics_socket_path.empty()) {
+        return;
+    }
+    struct sockaddr_un addr{};
+    if (metrics_socket_path.size() >= sizeof(addr.sun_path)) {
+        Log::log("Metrics socket is disabled: path is too long");
+        return;
+    }
+
+    metrics_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (metrics_socket == -1) {
+        Log::log("Metrics socket is disabled: " + std::string(strerror(errno)));
+        return;
+    }
+
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, metrics_socket_path.c_str());
+    unlink(metrics_socket_path.c_str());
+
+    if (bind(metrics_socket, (struct sockaddr*)&addr, sizeof(addr)) == -1 || listen(metrics_socket, 5) == -1) {
+        Log::log("Metrics socket is disabled: " + std::string(strerror(errno)));
+        close(metrics_socket);
+        metrics_socket = -1;
+        return;
+    }
+
+    set_socket_nonblocking(metrics_socket);
+}
+
 /**
  * @brief Устанавливает сокет в неблокирующий режим.
  * 
@@ -173,62 +345,238 @@ void Multimeter::set_socket_nonblocking(int socket) {
 }
 
 /**
- * @brief Обработчик сигнала для завершения работы сервера.
+ * @brief Обрабатывает порцию запросов от клиента.
+ * 
+ * Пока от клиента не пришло ни одного перевода строки, одно чтение - одна команда,
+ * а ответ отправляется без разделителя (интерактивный клиент). Первый перевод строки
+ * переводит соединение в построчный режим: команды разделяются '\n' и могут
+ * приходить пачками (конвейер), ответы отправляются в том же порядке, каждый с '\n',
+ * все ответы на прочитанную пачку - одной записью.
  * 
- * @param signum Номер сигнала.
+ * @param client Соединение клиента.
+ * @return false, если соединение нужно закрыть.
  */
-void Multimeter::signal_handler(int signum) {
-    Log::log("Received signal " + std::to_string(signum) + ", stopping the server...");
-    server_running = false;
+bool Multimeter::handle_client(ClientConnection& client) {
+    char buffer[4096];
+    const int client_socket = client.socket;
+
+    auto serve = [this, client_socket](const std::string& command) {
+        Log::log("--> [ Client " + std::to_string(client_socket) + " ] send command [" + command + "]");
+        return process_command(command);
+    };
+
+    // Интервалы трассировки запроса помечаются его идентификатором
+    Tracer::set_current_id(next_request_id.fetch_add(1, std::memory_order_relaxed));
+    ssize_t bytes_received;
+    {
+        TraceSpan span("read", "request");
+        do {
+            bytes_received = read(client_socket, buffer, sizeof(buffer));
+        } while (bytes_received == -1 && errno == EINTR);
+    }
+    bool keep_open = bytes_received > 0;
+
+    if (keep_open && !client.line_mode && std::memchr(buffer, '\n', static_cast<size_t>(bytes_received)) == nullptr) {
+        request_sizes.record(bytes_received);
+        std::string response = serve(std::string(buffer, static_cast<size_t>(bytes_received)));
+        {
+            TraceSpan span("write", "request");
+            keep_open = write_all(client_socket, response);
+        }
+        response_sizes.record(static_cast<int64_t>(response.size()));
+    } else if (keep_open) {
+        client.line_mode = true;
+        std::string& pending = client.pending;
+        pending.append(buffer, static_cast<size_t>(bytes_received));
+        std::string responses;
+        size_t start = 0;
+        size_t end;
+        while ((end = pending.find('\n', start)) != std::string::npos) {
+            std::string command = pending.substr(start, end - start);
+            if (!command.empty() && command.back() == '\r') {
+                command.pop_back();
+            }
+            if (start != 0) {
+                Tracer::set_current_id(next_request_id.fetch_add(1, std::memory_order_relaxed));
+            }
+            start = end + 1;
+            request_sizes.record(static_cast<int64_t>(command.size()) + 1);
+            std::string response = serve(command);
+            response_sizes.record(static_cast<int64_t>(response.size()) + 1);
+            responses += response;
+            responses += '\n';
+        }
+        pending.erase(0, start);
+        if (pending.size() > MyConfig::DefaultConfig::max_command_length) {
+            Log::log("Client " + std::to_string(client_socket) + " sent a command longer than " +
+                     std::to_string(MyConfig::DefaultConfig::max_command_length) + " bytes, closing the connection");
+            keep_open = false;
+        } else if (!responses.empty()) {
+            TraceSpan span("write", "request");
+            keep_open = write_all(client_socket, responses);
+        }
+    }
+    Tracer::set_current_id(-1);
+    return keep_open;
 }
 
 /**
- * @brief Обрабатывает запросы от клиента.
+ * @brief Обслуживает соединение, приславшее данные, в потоке пула.
  * 
- * Читает команду от клиента и обрабатывает её.
+ * После ответа поток еще client_linger_us ждет следующей порции команд от того же
+ * клиента: клиент, отправляющий команды по одной, обслуживается без возврата
+ * соединения в главный цикл. Поток не ждет, если в пуле есть другие задачи, поэтому
+ * соединений может быть больше, чем потоков.
  * 
- * @param client_socket Дескриптор сокета клиента.
+ * @param client Соединение клиента.
  */
-void Multimeter::handle_client(int client_socket) {
-    char buffer[256];
-    while (server_running) {
-        ssize_t bytes_received = read(client_socket, buffer, sizeof(buffer) - 1);
-        if (bytes_received <= 0) break;
-        buffer[bytes_received] = '\0';
-
-        std::string command(buffer);
-        Log::log("--> [ Client " + std::to_string(client_socket) + " ] send command [" + command + "]");
+void Multimeter::serve_client(ClientConnection& client) {
+    const int64_t linger_ns = static_cast<int64_t>(MyConfig::DefaultConfig::client_linger_us) * 1000;
+    const struct timespec linger = {static_cast<time_t>(linger_ns / 1000000000), static_cast<long>(linger_ns % 1000000000)};
+    bool keep_open = handle_client(client);
+    while (keep_open && server_running && !pool.has_queued_tasks()) {
+        struct pollfd fds = {client.socket, POLLIN, 0};
+        if (ppoll(&fds, 1, &linger, nullptr) != 1) break;
+        keep_open = handle_client(client);
+    }
+    release_client(client, keep_open);
+}
 
-        std::string response = process_command(command);
+/**
+ * @brief Снова ставит обслуженное соединение на ожидание в главном цикле или закрывает его.
+ * 
+ * После остановки главного цикла соединения не ожидаются, а закрываются.
+ * Сокет закрывается вместе с последней ссылкой на соединение (ее держит задача пула).
+ * 
+ * @param client Соединение клиента.
+ * @param keep_open Соединение нужно оставить открытым.
+ */
+void Multimeter::release_client(const ClientConnection& client, bool keep_open) {
+    std::lock_guard<InstrumentedMutex> lock(clients_mutex);
+    if (clients_closed) {
+        return;
+    }
+    if (keep_open) {
+        struct epoll_event event{};
+        event.events = EPOLLIN | EPOLLONESHOT;
+        event.data.fd = client.socket;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, client.socket, &event) == 0) {
+            return;
+        }
+    }
+    clients.erase(client.socket);
+}
 
-        write(client_socket, response.c_str(), response.size());
+/**
+ * @brief Отдает выгрузку метрик клиенту сокета метрик и закрывает соединение.
+ * 
+ * Клиенту дается metrics_request_timeout_ms на запрос: HTTP-клиент получает
+ * ответ с заголовком, а клиент, который ничего не прислал (nc, socat), - только текст.
+ * 
+ * @param client_socket Дескриптор сокета клиента.
+ */
+void Multimeter::serve_metrics(int client_socket) {
+    bool http = false;
+    struct pollfd fds = {client_socket, POLLIN, 0};
+    if (poll(&fds, 1, MyConfig::DefaultConfig::metrics_request_timeout_ms) > 0 && (fds.revents & POLLIN)) {
+        char buffer[1024];
+        ssize_t bytes_received = read(client_socket, buffer, sizeof(buffer));
+        http = bytes_received >= 4 && std::string(buffer, 4) == "GET ";
     }
+
+    const std::string body = Metrics::registry().render_prometheus();
+    std::string response;
+    if (http) {
+        response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+                   std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n";
+    }
+    response += body;
+
+    // Выгрузка может не поместиться в буфер сокета за одну запись
+    write_all(client_socket, response);
     close(client_socket);
 }
 
 /**
  * @brief Обрабатывает команду от клиента.
  * 
- * Парсит команду и выполняет её, возвращая результат.
+ * Парсит команду и выполняет её, возвращая результат. Исключения, выброшенные
+ * командой (например, при некорректных параметрах), превращаются в ответ "fail, <причина>".
  * 
  * @param command_string Строка команды.
  * @return Ответ на команду.
  */
-std::string Multimeter::process_command(const std::string& command_string) const {
-    std::string response = "unknown command or parameters";
+std::string Multimeter::process_command(const std::string& command_string) {
+    const int64_t start_ns = Metrics::now_ns();
 
     // парсим строку команды
     std::string command_name;
     std::vector<std::string> parameters;
-    parse_command_string(command_string, command_name, parameters);
+    {
+        TraceSpan span("parse", "request");
+        parse_command_string(command_string, command_name, parameters);
+    }
+
+    std::string response = execute_command(command_name, parameters);
+
+    const CommandMetrics& metrics = get_command_metrics(command_name);
+    metrics.requests.add();
+    if (response.compare(0, 4, "fail") == 0) {
+        metrics.failures.add();
+    }
+    metrics.duration.record(Metrics::now_ns() - start_ns);
+    return response;
+}
+
+/**
+ * @brief Выполняет разобранную команду.
+ * 
+ * Сначала ищется команда реестра каналов, затем - канал из первого параметра
+ * и команда канала.
+ * 
+ * @param command_name Имя команды.
+ * @param parameters Параметры команды.
+ * @return Ответ на команду.
+ */
+std::string Multimeter::execute_command(const std::string& command_name, const std::vector<std::string>& parameters) {
+    std::string response = "unknown command or parameters";
 
     if (parameters.size()) {
-        std::shared_ptr<IChannel> channel = channel_controller.find_channel(parameters[0]);
+        // Команды реестра каналов не требуют существующего канала
+        try {
+            std::shared_ptr<ICommand> command;
+            {
+                TraceSpan span("lookup", "request");
+                command = CommandFactory::create_controller_command(command_name, channel_controller, parameters);
+            }
+            if (command) {
+                TraceSpan span("execute", "request");
+                return command->execute();
+            }
+        } catch (const std::exception& e) {
+            return "fail, " + std::string(e.what());
+        }
+
+        std::shared_ptr<IChannel> channel;
+        {
+            TraceSpan span("lookup", "request");
+            channel = channel_controller.find_channel(parameters[0]);
+        }
 
         if (channel) {
-            std::shared_ptr<ICommand> command = CommandFactory::create_command(command_name, channel, parameters);
-            if (command) {
-                response = command->execute();
+            try {
+                std::shared_ptr<ICommand> command;
+                {
+                    TraceSpan span("lookup", "request");
+                    command = CommandFactory::create_command(command_name, channel, parameters);
+                }
+                if (command) {
+                    TraceSpan span("execute", "request");
+                    response = command->execute();
+                }
+            } catch (const std::exception& e) {
+                // Некорректные параметры не должны завершать рабочий поток
+                response = "fail, " + std::string(e.what());
             }
         }
         else {
@@ -239,6 +587,30 @@ std::string Multimeter::process_command(const std::string& command_string) const
     return response;
 }
 
+/**
+ * @brief Возвращает метрики команды.
+ * 
+ * @param command_name Имя команды; неизвестные имена учитываются как "unknown".
+ * @return Метрики команды.
+ */
+const Multimeter::CommandMetrics& Multimeter::get_command_metrics(const std::string& command_name) {
+    // Имена неизвестных команд приходят от клиентов и сводятся к одной метке,
+    // поэтому кэш и реестр не растут от произвольных запросов
+    const std::string& key = CommandFactory::has_command(command_name) ? command_name : unknown_command;
+    thread_local std::unordered_map<std::string, CommandMetrics> cache;
+    auto it = cache.find(key);
+    if (it == cache.end()) {
+        const std::string label = "command=\"" + Metrics::escape_label(key) + "\"";
+        MetricsRegistry& registry = Metrics::registry();
+        CommandMetrics metrics{
+            registry.counter("multimeter_commands_total", "Commands processed", label),
+            registry.counter("multimeter_command_failures_total", "Commands answered with fail", label),
+            registry.duration_histogram("multimeter_command_duration_seconds", "Command processing time", label)};
+        it = cache.emplace(key, metrics).first;
+    }
+    return it->second;
+}
+
 /**
  * @brief Разбирает строку команды.
  * 
@@ -248,7 +620,7 @@ std::string Multimeter::process_command(const std::string& command_string) const
  * @param command_name Имя команды.
  * @param parameters Список параметров.
  */
-void Multimeter::parse_command_string(const std::string& input, std::string& command_name, std::vector<std::string>& parameters) const {
+void Multimeter::parse_command_string(const std::string& input, std::string& command_name, std::vector<std::string>& parameters) {
     std::istringstream stream(input);
 
     std::getline(stream, command_name, ' ');
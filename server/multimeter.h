@@ -3,11 +3,18 @@
 #include <string>
 #include <memory>
 #include <vector>
+#include <unordered_map>
 #include <atomic>
+#include <mutex>
+#include <signal.h>
 #include "task_pool.h"
 #include "logger.h"
 #include "command_factory.h"
 #include "channel_controller.h"
+#include "series_store.h"
+#include "events.h"
+#include "metrics.h"
+#include "tracing.h"
 #include "config.h"
 
 /**
@@ -17,6 +24,15 @@
  * Этот класс реализует сервер, который слушает Unix-сокет, обрабатывает команды от клиентов, 
  * а также управляет набором каналов. Сервер использует пул потоков для асинхронной обработки 
  * запросов.
+ *
+ * Соединения, ожидающие команд, ждет главный цикл (epoll); поток пула занимается
+ * соединением только на время обработки команд (и короткого ожидания следующих),
+ * после чего снова ставит его на ожидание. Поэтому открытых соединений может быть
+ * сколько угодно больше, чем потоков пула.
+ *
+ * Количество, длительность и ошибки команд, размеры запросов и ответов и длина очереди
+ * логгера выгружаются в метрики: командой get_metrics и в текстовом формате Prometheus
+ * через отдельный Unix-сокет (MyConfig::DefaultConfig::metrics_socket_path).
  */
 class Multimeter {
 public:
@@ -28,8 +44,10 @@ public:
      * @param socket_path Путь к Unix-сокету для соединения с клиентами.
      * @param thread_count Количество потоков в пуле задач для обработки запросов.
      * @param channel_count Количество каналов, которые может обслуживать сервер.
+     * @param table_channel_count Количество дополнительных каналов в плотной таблице (для больших конфигураций).
      */
-    explicit Multimeter(const std::string& socket_path, size_t thread_count, size_t channel_count = MyConfig::DefaultConfig::num_channels);
+    explicit Multimeter(const std::string& socket_path, size_t thread_count, size_t channel_count = MyConfig::DefaultConfig::num_channels,
+        size_t table_channel_count = 0);
 
     /**
      * @brief Деструктор класса Multimeter.
@@ -54,21 +72,48 @@ public:
     void run();
 
     /**
-     * @brief Останавливает сервер и освобождает ресурсы.
+     * @brief Останавливает сервер.
      * 
-     * Завершает работу сервера, закрывает сокет и очищает ресурсы.
+     * Сбрасывает флаг работы и будит главный цикл, который закрывает ожидающие соединения.
+     * Безопасна для вызова из любого потока.
      */
     void stop();
 
-private:
     /**
-     * @brief Обработчик сигнала для корректного завершения работы сервера.
+     * @brief Задает путь к сокету выгрузки метрик.
      * 
-     * Этот метод вызывается при получении сигнала (например, SIGINT).
+     * Вызывается до run(). Нужен, когда в одной системе работает несколько
+     * серверов (например, встроенный сервер проверки производительности).
      * 
-     * @param signum Номер сигнала.
+     * @param path Путь к сокету; пустая строка отключает выгрузку метрик.
      */
-    static void signal_handler(int signum);
+    void set_metrics_socket_path(const std::string& path);
+
+    /**
+     * @brief Разбирает строку команды на имя команды и параметры.
+     * 
+     * Эта функция разделяет строку команды на её имя и список параметров.
+     * Не зависит от состояния сервера (используется и в бенчмарках).
+     * 
+     * @param input Строка с командой от клиента.
+     * @param command_name Имя команды.
+     * @param parameters Список параметров для команды.
+     */
+    static void parse_command_string(const std::string& input, std::string& command_name, std::vector<std::string>& parameters);
+
+private:
+    /**
+     * @brief Обрабатывает сигнал, пришедший через signalfd.
+     * 
+     * Вызывается из главного цикла (не из асинхронного обработчика), поэтому
+     * в ней можно безопасно логгировать.
+     */
+    void handle_signal();
+
+    /**
+     * @brief Закрывает сокет сервера и удаляет файл сокета.
+     */
+    void close_socket();
 
     /**
      * @brief Устанавливает сокет в неблокирующий режим.
@@ -80,27 +125,76 @@ private:
     static void set_socket_nonblocking(int socket);
 
     /**
-     * @brief Настроить обработчик сигнала.
+     * @brief Настроить сокет сервера.
      * 
-     * Эта функция настраивает обработчик сигнала SIGINT (например, для безопасного завершения работы).
+     * Этот метод создает сокет, привязывает его к указанному пути и начинает прослушивание входящих соединений.
      */
-    void setup_signal_handler();
+    void setup_socket();
 
     /**
-     * @brief Настроить сокет сервера.
+     * @brief Настроить сокет выгрузки метрик.
      * 
-     * Этот метод создает сокет, привязывает его к указанному пути и начинает прослушивание входящих соединений.
+     * Ошибка не останавливает сервер: выгрузка через сокет просто отключается.
      */
-    void setup_socket();
+    void setup_metrics_socket();
 
     /**
-     * @brief Обрабатывает запросы от клиента.
+     * @brief Отдает выгрузку метрик клиенту сокета метрик и закрывает соединение.
      * 
-     * Читает команду от клиента и обрабатывает её.
+     * Если клиент прислал HTTP-запрос (например, curl --unix-socket), ответ
+     * снабжается заголовком HTTP.
      * 
      * @param client_socket Дескриптор сокета клиента.
      */
-    void handle_client(int client_socket);
+    void serve_metrics(int client_socket);
+
+    /**
+     * @struct ClientConnection
+     * @brief Соединение клиента и состояние разбора его команд.
+     *
+     * Сокет закрывается вместе с последней ссылкой на соединение.
+     */
+    struct ClientConnection {
+        int socket; ///< Дескриптор сокета клиента
+        bool line_mode = false; ///< Соединение в построчном режиме
+        std::string pending; ///< Начало незавершенной команды (построчный режим)
+
+        explicit ClientConnection(int socket) : socket(socket) {}
+        ~ClientConnection();
+        ClientConnection(const ClientConnection&) = delete;
+        ClientConnection& operator=(const ClientConnection&) = delete;
+    };
+    using ClientPtr = std::shared_ptr<ClientConnection>;
+
+    /**
+     * @brief Обрабатывает порцию запросов от клиента.
+     * 
+     * Читает то, что прислал клиент (сокет готов к чтению), и отвечает на все полученные
+     * команды. Команды, разделенные '\n', можно отправлять конвейером: ответы приходят
+     * в порядке команд, каждый с '\n'.
+     * 
+     * @param client Соединение клиента.
+     * @return false, если соединение нужно закрыть.
+     */
+    bool handle_client(ClientConnection& client);
+
+    /**
+     * @brief Обслуживает соединение, приславшее данные, в потоке пула.
+     * 
+     * Отвечает на полученные команды и, пока в пуле нет других задач, недолго ждет
+     * следующих команд того же клиента.
+     * 
+     * @param client Соединение клиента.
+     */
+    void serve_client(ClientConnection& client);
+
+    /**
+     * @brief Снова ставит обслуженное соединение на ожидание в главном цикле или закрывает его.
+     * 
+     * @param client Соединение клиента.
+     * @param keep_open Соединение нужно оставить открытым.
+     */
+    void release_client(const ClientConnection& client, bool keep_open);
 
     /**
      * @brief Обрабатывает строку команды и возвращает соответствующий ответ.
@@ -110,22 +204,53 @@ private:
      * @param command_string Строка, представляющая команду от клиента.
      * @return Ответ на команду.
      */
-    std::string process_command(const std::string& command_string) const;
+    std::string process_command(const std::string& command_string);
 
     /**
-     * @brief Разбирает строку команды на имя команды и параметры.
-     * 
-     * Эта функция разделяет строку команды на её имя и список параметров.
+     * @brief Выполняет разобранную команду.
      * 
-     * @param input Строка с командой от клиента.
      * @param command_name Имя команды.
-     * @param parameters Список параметров для команды.
+     * @param parameters Параметры команды.
+     * @return Ответ на команду.
+     */
+    std::string execute_command(const std::string& command_name, const std::vector<std::string>& parameters);
+
+    /**
+     * @struct CommandMetrics
+     * @brief Метрики команды одного типа.
+     */
+    struct CommandMetrics {
+        Counter& requests; ///< Количество команд
+        Counter& failures; ///< Количество ответов "fail"
+        Histogram& duration; ///< Длительность выполнения
+    };
+
+    /**
+     * @brief Возвращает метрики команды.
+     * 
+     * Ссылки кэшируются в каждом потоке, поэтому реестр метрик опрашивается
+     * один раз на тип команды и поток.
+     * 
+     * @param command_name Имя команды; неизвестные имена учитываются как "unknown".
      */
-    void parse_command_string(const std::string& input, std::string& command_name, std::vector<std::string>& parameters) const;
+    static const CommandMetrics& get_command_metrics(const std::string& command_name);
 
     int server_socket = -1; ///< Дескриптор сокета сервера.
+    int metrics_socket = -1; ///< Дескриптор сокета выгрузки метрик.
+    SignalEvent signal_event{SIGINT, SIGTERM}; ///< Сигналы завершения (создается до запуска всех потоков).
+    WakeupEvent shutdown_event; ///< Событие остановки для главного цикла.
+    int epoll_fd = -1; ///< Дескриптор epoll главного цикла.
+    InstrumentedMutex clients_mutex{"multimeter.clients"}; ///< Мьютекс соединений клиентов.
+    std::unordered_map<int, ClientPtr> clients; ///< Открытые соединения клиентов по дескриптору.
+    bool clients_closed = false; ///< Главный цикл завершен, соединения больше не ожидаются.
     TaskPool pool; ///< Пул потоков для асинхронной обработки запросов.
     ChannelController channel_controller; ///< Контроллер каналов.
+    std::unique_ptr<SeriesStore> series_store; ///< Дисковое хранилище значений каналов (может отсутствовать).
     std::string socket_path; ///< Путь к Unix-сокету.
-    static inline std::atomic<bool> server_running = true; ///< Флаг работы сервера.
+    std::string metrics_socket_path = MyConfig::DefaultConfig::metrics_socket_path; ///< Путь к сокету метрик.
+    Histogram& request_sizes; ///< Метрика: размеры запросов клиентов.
+    Histogram& response_sizes; ///< Метрика: размеры ответов клиентам.
+    size_t metrics_collector_id; ///< Идентификатор сборщика метрик логгера.
+    std::atomic<bool> server_running = true; ///< Флаг работы сервера.
+    std::atomic<int64_t> next_request_id{0}; ///< Идентификатор следующего запроса (для трассировки).
 };
@@ -0,0 +1,206 @@
+#include "quantile_sketch.h"
+#include "config.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+/**
+ * @brief Конструктор.
+ * @param k Параметр точности (емкость верхнего уровня).
+ */
+KllSketch::KllSketch(size_t k) : k(std::max<size_t>(k, 8)), levels(1) {
+    capacity_limit = total_capacity();
+}
+
+/**
+ * @brief Конструктор с параметром точности из конфигурации.
+ */
+KllSketch::KllSketch() : KllSketch(MyConfig::DefaultConfig::quantile_sketch_k) {}
+
+/**
+ * @brief Добавляет значение.
+ *
+ * Амортизированная стоимость - O(log k) на значение (сортировка уровня при уплотнении).
+ */
+void KllSketch::add(float value) {
+    if (std::isnan(value)) return;
+    min_value = n == 0 ? value : std::min(min_value, value);
+    max_value = n == 0 ? value : std::max(max_value, value);
+    levels[0].push_back(value);
+    ++n;
+    ++retained_count;
+    if (retained_count > capacity_limit) {
+        compress();
+    }
+}
+
+/**
+ * @brief Добавляет значения другого скетча.
+ * @param other Скетч.
+ */
+void KllSketch::merge(const KllSketch& other) {
+    if (other.n == 0) return;
+    min_value = n == 0 ? other.min_value : std::min(min_value, other.min_value);
+    max_value = n == 0 ? other.max_value : std::max(max_value, other.max_value);
+    if (levels.size() < other.levels.size()) {
+        levels.resize(other.levels.size());
+        capacity_limit = total_capacity();
+    }
+    for (size_t h = 0; h != other.levels.size(); ++h) {
+        levels[h].insert(levels[h].end(), other.levels[h].begin(), other.levels[h].end());
+    }
+    n += other.n;
+    retained_count += other.retained_count;
+    compress();
+}
+
+/**
+ * @brief Сбрасывает скетч.
+ *
+ * Память первого уровня сохраняется, чтобы не выделять ее заново при переиспользовании корзин.
+ */
+void KllSketch::reset() {
+    levels.resize(1);
+    capacity_limit = total_capacity();
+    levels[0].clear();
+    n = 0;
+    retained_count = 0;
+}
+
+uint64_t KllSketch::count() const {
+    return n;
+}
+
+size_t KllSketch::retained() const {
+    return retained_count;
+}
+
+/**
+ * @brief Емкость уровня: k * (2/3)^(глубина), но не меньше 8.
+ */
+size_t KllSketch::level_capacity(size_t level) const {
+    const size_t depth = levels.size() - 1 - level;
+    double capacity = std::ceil(static_cast<double>(k) * std::pow(2.0 / 3.0, static_cast<double>(depth)));
+    return std::max<size_t>(8, static_cast<size_t>(capacity));
+}
+
+size_t KllSketch::total_capacity() const {
+    size_t total = 0;
+    for (size_t h = 0; h != levels.size(); ++h) {
+        total += level_capacity(h);
+    }
+    return total;
+}
+
+/**
+ * @brief Уплотняет уровни, пока количество хранимых значений не станет допустимым.
+ *
+ * Каждый раз уплотняется самый нижний переполненный уровень.
+ */
+void KllSketch::compress() {
+    while (retained_count > capacity_limit) {
+        for (size_t h = 0; h != levels.size(); ++h) {
+            if (levels[h].size() >= level_capacity(h)) {
+                compact_level(h);
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Уплотняет один уровень.
+ *
+ * Уровень сортируется, из каждой пары соседних значений на следующий уровень
+ * переходит одно (четное или нечетное - выбирается случайно). При нечетном
+ * размере одно значение остается на уровне.
+ */
+void KllSketch::compact_level(size_t level) {
+    if (level + 1 == levels.size()) {
+        levels.emplace_back();
+        capacity_limit = total_capacity();
+    }
+    std::vector<float>& items = levels[level];
+    std::sort(items.begin(), items.end());
+
+    float leftover = 0.0f;
+    const bool odd = items.size() % 2 != 0;
+    if (odd) {
+        leftover = items.back();
+        items.pop_back();
+    }
+
+    // xorshift32: выбор четных или нечетных элементов
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    const size_t offset = random_state & 1U;
+
+    std::vector<float>& next = levels[level + 1];
+    for (size_t i = offset; i < items.size(); i += 2) {
+        next.push_back(items[i]);
+    }
+    retained_count -= items.size() / 2;
+
+    items.clear();
+    if (odd) {
+        items.push_back(leftover);
+    }
+}
+
+/**
+ * @brief Оценивает квантили.
+ *
+ * Значения всех уровней сортируются с весами 2^h, квантиль - первое значение,
+ * накопленный вес которого достигает доли от общего количества. Квантили 0 и 1
+ * возвращаются точно (минимум и максимум).
+ *
+ * @param fractions Доли в диапазоне [0, 1].
+ * @return Оценки квантилей (пусто, если значений нет).
+ */
+std::vector<float> KllSketch::quantiles(const std::vector<double>& fractions) const {
+    std::vector<float> result;
+    if (n == 0) return result;
+
+    std::vector<std::pair<float, uint64_t>> weighted;
+    weighted.reserve(retained_count);
+    for (size_t h = 0; h != levels.size(); ++h) {
+        for (float value : levels[h]) {
+            weighted.emplace_back(value, uint64_t(1) << h);
+        }
+    }
+    std::sort(weighted.begin(), weighted.end());
+
+    uint64_t total = 0;
+    for (const auto& item : weighted) {
+        total += item.second;
+    }
+
+    result.reserve(fractions.size());
+    for (double fraction : fractions) {
+        if (fraction <= 0.0 || fraction >= 1.0) {
+            result.push_back(fraction <= 0.0 ? min_value : max_value);
+            continue;
+        }
+        const double target = fraction * static_cast<double>(total);
+        uint64_t cumulative = 0;
+        float estimate = weighted.back().first;
+        for (const auto& item : weighted) {
+            cumulative += item.second;
+            if (static_cast<double>(cumulative) >= target) {
+                estimate = item.first;
+                break;
+            }
+        }
+        result.push_back(estimate);
+    }
+    return result;
+}
+
+/**
+ * @brief Конструктор. Создает окна по умолчанию из конфигурации.
+ */
+ChannelQuantiles::ChannelQuantiles()
+    : WindowSet<KllSketch>(MyConfig::DefaultConfig::quantile_windows, MyConfig::DefaultConfig::quantile_window_buckets,
+                            MyConfig::DefaultConfig::max_stats_windows) {}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "channel_stats.h"
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @class KllSketch
+ * @brief Потоковый скетч квантилей KLL (Karnin-Lang-Liberty).
+ *
+ * Хранит ограниченное число значений (около 3k) в уровнях-компакторах: значение
+ * на уровне h представляет 2^h исходных значений. При переполнении уровень
+ * сортируется и каждое второе значение переходит на следующий уровень. Скетчи
+ * можно сливать, поэтому они подходят для корзин скользящих окон.
+ *
+ * Ошибка ранга квантиля порядка 1/k от количества значений.
+ */
+class KllSketch {
+public:
+    /**
+     * @brief Конструктор.
+     * @param k Параметр точности (емкость верхнего уровня).
+     */
+    explicit KllSketch(size_t k);
+
+    /**
+     * @brief Конструктор с параметром точности из конфигурации.
+     */
+    KllSketch();
+
+    /**
+     * @brief Добавляет значение.
+     * @param value Значение.
+     */
+    void add(float value);
+
+    /**
+     * @brief Добавляет значения другого скетча.
+     * @param other Скетч.
+     */
+    void merge(const KllSketch& other);
+
+    /**
+     * @brief Сбрасывает скетч.
+     */
+    void reset();
+
+    /**
+     * @brief Возвращает количество добавленных значений.
+     */
+    uint64_t count() const;
+
+    /**
+     * @brief Возвращает количество хранимых значений.
+     */
+    size_t retained() const;
+
+    /**
+     * @brief Оценивает квантили.
+     * @param fractions Доли в диапазоне [0, 1] (0.5 - медиана).
+     * @return Оценки квантилей в том же порядке (пусто, если значений нет).
+     */
+    std::vector<float> quantiles(const std::vector<double>& fractions) const;
+
+private:
+    /**
+     * @brief Емкость уровня при текущем количестве уровней.
+     */
+    size_t level_capacity(size_t level) const;
+
+    /**
+     * @brief Суммарная емкость всех уровней.
+     */
+    size_t total_capacity() const;
+
+    /**
+     * @brief Уплотняет уровни, пока количество хранимых значений не станет допустимым.
+     */
+    void compress();
+
+    /**
+     * @brief Уплотняет один уровень, перенося половину значений на следующий.
+     */
+    void compact_level(size_t level);
+
+    size_t k; ///< Параметр точности
+    uint64_t n = 0; ///< Количество добавленных значений
+    float min_value = 0.0f; ///< Точный минимум (для квантиля 0)
+    float max_value = 0.0f; ///< Точный максимум (для квантиля 1)
+    size_t retained_count = 0; ///< Количество хранимых значений
+    size_t capacity_limit = 0; ///< Суммарная емкость уровней (пересчитывается при изменении числа уровней)
+    uint32_t random_state = 0x2545f491U; ///< Состояние генератора выбора половины при уплотнении
+    std::vector<std::vector<float>> levels; ///< Уровни-компакторы
+};
+
+/**
+ * @class ChannelQuantiles
+ * @brief Оконные скетчи квантилей канала.
+ *
+ * Окна по умолчанию берутся из конфигурации. Память на окно ограничена:
+ * количество корзин умноженное на размер одного скетча.
+ */
+class ChannelQuantiles : public WindowSet<KllSketch> {
+public:
+    /**
+     * @brief Конструктор. Создает окна по умолчанию из конфигурации.
+     */
+    ChannelQuantiles();
+};
@@ -3,6 +3,7 @@
 #include <vector>
 #include <string>
 #include <shared_mutex>
+#include "lock_stats.h"
 
 /**
  * @class RangeManager
@@ -80,5 +81,5 @@ private:
     static std::vector<RangeConfig> initialize_ranges();
 
     /// Мьютекс для синхронизации доступа к диапазонам
-    inline static std::shared_mutex mtx;
+    inline static InstrumentedSharedMutex mtx{"range_manager.mtx"};
 };
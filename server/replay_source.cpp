@@ -0,0 +1,89 @@
+#include "replay_source.h"
+#include "config.h"
+#include "my_tools.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+/**
+ * @brief Конструктор. Отображает файл записи из каталога capture_directory в память.
+ */
+ReplaySource::ReplaySource(const std::string& file_name, double speed, bool loop)
+    : file_name(file_name), speed(speed), loop(loop) {
+    MyTools::check_file_name(file_name);
+    if (!(speed > 0.0)) {
+        throw std::invalid_argument("Replay speed must be positive");
+    }
+    capture = std::make_unique<CaptureFile>(std::string(MyConfig::DefaultConfig::capture_directory) + "/" + file_name);
+    duration_ns = capture->timestamps()[capture->size() - 1] - capture->timestamps()[0];
+}
+
+/**
+ * @brief Заполняет блок значениями записи.
+ *
+ * Позиция каждого значения блока вычисляется от начала воспроизведения (а не
+ * накапливается), поэтому ошибка не растет со временем. Индекс записи в обычном
+ * случае только продвигается вперед; двоичный поиск нужен лишь после
+ * перемещения или перехода на новый круг.
+ */
+void ReplaySource::generate(SignalBlock& block) {
+    const int64_t seek_position = pending_seek.exchange(-1);
+    if (origin_ns < 0 || seek_position >= 0) {
+        origin_ns = block.start_ns;
+        if (seek_position >= 0) {
+            base_position_ns = seek_position;
+        }
+        index = find_index(capture->timestamps()[0] + base_position_ns);
+    }
+
+    const int64_t* timestamps = capture->timestamps();
+    const float* values = capture->values();
+    const size_t count = capture->size();
+
+    for (size_t i = 0; i != block.count; ++i) {
+        const int64_t elapsed = block.start_ns + static_cast<int64_t>(i) * block.period_ns - origin_ns;
+        double position = static_cast<double>(base_position_ns) + static_cast<double>(elapsed) * speed;
+        if (position > static_cast<double>(duration_ns)) {
+            position = loop && duration_ns > 0 ? std::fmod(position, static_cast<double>(duration_ns + 1))
+                                               : static_cast<double>(duration_ns);
+        }
+        const int64_t target = timestamps[0] + static_cast<int64_t>(position);
+
+        if (timestamps[index] > target) {
+            index = find_index(target); // Новый круг
+        }
+        while (index + 1 < count && timestamps[index + 1] <= target) {
+            ++index;
+        }
+        block.values[i] = values[index];
+    }
+}
+
+std::string ReplaySource::describe() const {
+    std::ostringstream stream;
+    stream << "replay, " << file_name << ", " << speed << ", " << (loop ? "loop" : "once");
+    return stream.str();
+}
+
+/**
+ * @brief Перемещает воспроизведение на позицию от начала записи.
+ * @throws std::out_of_range Если позиция за пределами записи.
+ */
+void ReplaySource::seek(int64_t position_ns) {
+    if (position_ns < 0 || position_ns > duration_ns) {
+        throw std::out_of_range("Seek position is outside of the capture");
+    }
+    pending_seek.store(position_ns);
+}
+
+/**
+ * @brief Находит индекс последней записи не позже момента записи.
+ */
+size_t ReplaySource::find_index(int64_t capture_time_ns) const {
+    const int64_t* begin = capture->timestamps();
+    const int64_t* end = begin + capture->size();
+    const int64_t* it = std::upper_bound(begin, end, capture_time_ns);
+    return it == begin ? 0 : static_cast<size_t>(it - begin - 1);
+}
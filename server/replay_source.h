@@ -0,0 +1,59 @@
+#pragma once
+
+#include "signal_source.h"
+#include "capture_file.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <cstdint>
+
+/**
+ * @class ReplaySource
+ * @brief Воспроизведение записи канала из файла, отображенного в память.
+ *
+ * Позиция воспроизведения движется вместе со временем измерений, умноженным на
+ * скорость; значение канала - последнее записанное значение не позже позиции
+ * (выборка с удержанием). Значения читаются прямо из отображения файла.
+ * По окончании записи воспроизведение начинается сначала (loop) или
+ * удерживает последнее значение (once).
+ */
+class ReplaySource : public ISignalSource {
+public:
+    /**
+     * @brief Конструктор.
+     * @param file_name Имя файла записи (без пути) в каталоге capture_directory.
+     * @param speed Скорость воспроизведения (1 - исходная).
+     * @param loop Воспроизводить по кругу.
+     * @throws std::invalid_argument Если имя файла содержит путь или скорость некорректна.
+     * @throws std::runtime_error Если файл записи не открывается.
+     */
+    ReplaySource(const std::string& file_name, double speed, bool loop);
+
+    void generate(SignalBlock& block) override;
+    std::string describe() const override;
+
+    /**
+     * @brief Перемещает воспроизведение на позицию от начала записи.
+     * @param position_ns Позиция (нс), не больше длительности записи.
+     * @throws std::out_of_range Если позиция за пределами записи.
+     */
+    void seek(int64_t position_ns) override;
+
+private:
+    /**
+     * @brief Находит индекс последней записи не позже момента записи.
+     */
+    size_t find_index(int64_t capture_time_ns) const;
+
+    std::string file_name; ///< Имя файла записи
+    std::unique_ptr<CaptureFile> capture; ///< Файл записи
+    double speed; ///< Скорость воспроизведения
+    bool loop; ///< Воспроизводить по кругу
+    int64_t duration_ns; ///< Длительность записи (нс)
+
+    std::atomic<int64_t> pending_seek{-1}; ///< Запрошенная позиция (-1 - нет запроса)
+    int64_t origin_ns = -1; ///< Время измерений, соответствующее base_position_ns
+    int64_t base_position_ns = 0; ///< Позиция воспроизведения в момент origin_ns
+    size_t index = 0; ///< Текущая запись
+};
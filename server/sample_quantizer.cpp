@@ -0,0 +1,73 @@
+#include "sample_quantizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+double power_of_ten(int exponent) {
+    return std::pow(10.0, exponent);
+}
+
+}
+
+/**
+ * @brief Конструктор.
+ *
+ * Ширина кода выбирается по количеству шагов точности в диапазоне.
+ */
+SampleQuantizer::SampleQuantizer(const RangeManager::RangeConfig& range)
+    : precision(range.precision), scale(power_of_ten(range.precision)),
+      offset(to_code(range.min_value, range.precision)) {
+    const int64_t span = to_code(range.max_value, precision) - offset;
+    wide = span > std::numeric_limits<int16_t>::max();
+}
+
+/**
+ * @brief Кодирует значение.
+ *
+ * Вычисления ведутся в double, поэтому код float-значения диапазона
+ * определяется однозначно.
+ */
+int32_t SampleQuantizer::encode(float value) const {
+    if (std::isnan(value)) {
+        return 0;
+    }
+    const double code = std::nearbyint(static_cast<double>(value) * scale) - static_cast<double>(offset);
+    const double low = wide ? std::numeric_limits<int32_t>::min() : std::numeric_limits<int16_t>::min();
+    const double high = wide ? std::numeric_limits<int32_t>::max() : std::numeric_limits<int16_t>::max();
+    return static_cast<int32_t>(std::clamp(code, low, high));
+}
+
+/**
+ * @brief Абсолютный код значения.
+ *
+ * Для точностей диапазонов произведение float на 10^precision в double точное,
+ * а округление к ближайшему четному совпадает с округлением при выводе значения
+ * (MyTools::float_to_string), поэтому код воспроизводит отображаемое значение.
+ */
+int64_t SampleQuantizer::to_code(float value, int precision) {
+    if (std::isnan(value)) {
+        return nan_code;
+    }
+    if (std::isinf(value)) {
+        return value > 0 ? positive_infinity_code : negative_infinity_code;
+    }
+    // Проверка до llrint: результат за пределами int64_t не определен
+    const double code = std::nearbyint(static_cast<double>(value) * power_of_ten(precision));
+    return static_cast<int64_t>(std::clamp(code, -static_cast<double>(max_code), static_cast<double>(max_code)));
+}
+
+/**
+ * @brief Значение по абсолютному коду.
+ */
+float SampleQuantizer::from_code(int64_t code, int precision) {
+    if (code == nan_code) {
+        return std::numeric_limits<float>::quiet_NaN();
+    }
+    if (code == positive_infinity_code || code == negative_infinity_code) {
+        return code > 0 ? std::numeric_limits<float>::infinity() : -std::numeric_limits<float>::infinity();
+    }
+    return static_cast<float>(static_cast<double>(code) / power_of_ten(precision));
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "ranges.h"
+
+#include <cstdint>
+
+/**
+ * @class SampleQuantizer
+ * @brief Представление значений диапазона целыми числами с фиксированной точкой.
+ *
+ * Значение хранится как round(value * 10^precision) - offset, где precision -
+ * точность отображения диапазона, а offset - код нижней границы диапазона.
+ * Если все значения диапазона помещаются в int16, используется int16, иначе int32;
+ * значения за пределами этих типов насыщаются. Для значений диапазона
+ * преобразование обратимо с точностью отображения.
+ */
+class SampleQuantizer {
+public:
+    /**
+     * @brief Конструктор.
+     * @param range Диапазон значений.
+     */
+    explicit SampleQuantizer(const RangeManager::RangeConfig& range);
+
+    /**
+     * @brief Кодирует значение.
+     * @param value Значение.
+     * @return Код (в пределах int16, если is_wide() == false).
+     */
+    int32_t encode(float value) const;
+
+    /**
+     * @brief Восстанавливает значение по коду.
+     */
+    float decode(int32_t code) const {
+        return static_cast<float>(static_cast<double>(code + offset) / scale);
+    }
+
+    /**
+     * @brief Требуется ли int32 для кодов диапазона.
+     */
+    bool is_wide() const { return wide; }
+
+    /**
+     * @brief Точность (количество десятичных знаков).
+     */
+    int get_precision() const { return precision; }
+
+    static constexpr int64_t max_code = int64_t{1} << 60; ///< Предел модуля кода конечного значения
+    static constexpr int64_t nan_code = max_code + 1; ///< Код NaN
+    static constexpr int64_t positive_infinity_code = max_code + 2; ///< Код +inf
+    static constexpr int64_t negative_infinity_code = -positive_infinity_code; ///< Код -inf
+
+    /**
+     * @brief Абсолютный код значения: round(value * 10^precision).
+     *
+     * Конечные значения насыщаются до [-max_code, max_code], NaN и бесконечности
+     * получают отдельные коды за этими пределами. Разность любых двух кодов
+     * помещается в int64_t.
+     */
+    static int64_t to_code(float value, int precision);
+
+    /**
+     * @brief Значение по абсолютному коду (коды NaN и бесконечностей восстанавливаются).
+     */
+    static float from_code(int64_t code, int precision);
+
+private:
+    int precision; ///< Точность (десятичных знаков)
+    double scale; ///< 10^precision
+    int64_t offset; ///< Код нижней границы диапазона
+    bool wide; ///< Коды диапазона не помещаются в int16
+};
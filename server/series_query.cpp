@@ -0,0 +1,259 @@
+#include "series_query.h"
+#include "series_store.h"
+#include "gorilla.h"
+#include "config.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+/**
+ * @class MappedFile
+ * @brief Файл хранилища, отображенный в память только для чтения.
+ *
+ * Отсутствующий файл считается пустым (канал еще не успел его создать).
+ */
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1) {
+            if (errno == ENOENT) return;
+            throw std::runtime_error("open " + path + ": " + strerror(errno));
+        }
+        struct stat file_stat;
+        if (fstat(fd, &file_stat) == -1) {
+            int error = errno;
+            close(fd);
+            throw std::runtime_error("fstat " + path + ": " + strerror(error));
+        }
+        size = static_cast<size_t>(file_stat.st_size);
+        if (size == 0) {
+            close(fd);
+            return;
+        }
+        mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        int error = errno;
+        close(fd);
+        if (mapping == MAP_FAILED) {
+            mapping = nullptr;
+            size = 0;
+            throw std::runtime_error("mmap " + path + ": " + strerror(error));
+        }
+    }
+
+    ~MappedFile() {
+        if (mapping) {
+            munmap(mapping, size);
+        }
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const uint8_t* data() const { return static_cast<const uint8_t*>(mapping); }
+
+    /**
+     * @brief Количество целых записей типа T в файле.
+     */
+    template <typename T>
+    size_t records() const { return size / sizeof(T); }
+
+    /**
+     * @brief Запись типа T с номером index.
+     */
+    template <typename T>
+    T record(size_t index) const {
+        T value;
+        std::memcpy(&value, data() + index * sizeof(T), sizeof(T));
+        return value;
+    }
+
+    size_t get_size() const { return size; }
+
+private:
+    void* mapping = nullptr; ///< Отображение
+    size_t size = 0; ///< Размер отображения
+};
+
+/**
+ * @struct Cell
+ * @brief Агрегаты одного шага запроса.
+ */
+struct Cell {
+    uint64_t count = 0;
+    float min = std::numeric_limits<float>::max();
+    float max = std::numeric_limits<float>::lowest();
+    double sum = 0.0;
+
+    void merge(uint64_t other_count, float other_min, float other_max, double other_sum) {
+        count += other_count;
+        min = std::min(min, other_min);
+        max = std::max(max, other_max);
+        sum += other_sum;
+    }
+};
+
+/**
+ * @brief Номер шага, содержащего время (с округлением вниз).
+ */
+int64_t step_number(int64_t timestamp_ns, int64_t step_ns) {
+    int64_t number = timestamp_ns / step_ns;
+    return number * step_ns > timestamp_ns ? number - 1 : number;
+}
+
+/**
+ * @brief Первая запись отсортированного по времени файла, для которой предикат ложен.
+ */
+template <typename T, typename Predicate>
+size_t lower_bound(const MappedFile& file, Predicate before) {
+    size_t low = 0;
+    size_t high = file.records<T>();
+    while (low < high) {
+        const size_t middle = low + (high - low) / 2;
+        if (before(file.record<T>(middle))) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+}
+
+/**
+ * @brief Конструктор.
+ */
+SeriesQuery::SeriesQuery(const std::string& directory, const std::string& channel_name)
+    : directory(directory), channel_name(channel_name) {}
+
+/**
+ * @brief Разбирает агрегат.
+ */
+SeriesQuery::Aggregate SeriesQuery::parse_aggregate(const std::string& text) {
+    if (text == "min") return Aggregate::Min;
+    if (text == "max") return Aggregate::Max;
+    if (text == "avg") return Aggregate::Avg;
+    if (text == "sum") return Aggregate::Sum;
+    if (text == "count") return Aggregate::Count;
+    throw std::invalid_argument("Unknown aggregate: " + text);
+}
+
+/**
+ * @brief Выполняет запрос.
+ *
+ * Источники перебираются от крупного к мелкому; каждый следующий учитывает
+ * только значения после конца данных предыдущего (covered_ns), поэтому
+ * значения не учитываются дважды.
+ */
+std::vector<SeriesQueryPoint> SeriesQuery::run(int64_t t0_ns, int64_t t1_ns, Aggregate aggregate, int64_t step_ns) const {
+    if (t1_ns <= t0_ns) {
+        throw std::invalid_argument("Empty time interval");
+    }
+    if (step_ns <= 0) {
+        throw std::invalid_argument("Invalid step");
+    }
+    const int64_t first_step = step_number(t0_ns, step_ns);
+    const int64_t step_count = step_number(t1_ns - 1, step_ns) - first_step + 1;
+    if (step_count > static_cast<int64_t>(MyConfig::DefaultConfig::query_max_steps)) {
+        throw std::invalid_argument("Too many steps: " + std::to_string(step_count));
+    }
+    std::vector<Cell> cells(static_cast<size_t>(step_count));
+    auto cell = [&](int64_t timestamp_ns) -> Cell& {
+        const int64_t index = std::clamp<int64_t>(step_number(timestamp_ns, step_ns) - first_step, 0, step_count - 1);
+        return cells[static_cast<size_t>(index)];
+    };
+
+    // Самый крупный уровень свертки, разрешение которого делит шаг
+    int tier = -1;
+    for (int i = 0; i != static_cast<int>(std::size(series_rollup_tiers)); ++i) {
+        const int64_t resolution_ns = series_rollup_tiers[i].resolution_ns;
+        if (resolution_ns <= step_ns && step_ns % resolution_ns == 0) {
+            tier = i;
+        }
+    }
+
+    // Незавершенная запись покрывает время только до своего последнего значения (end_ns),
+    // поэтому значения, записанные после перезапуска в тот же интервал, не теряются
+    int64_t covered_ns = t0_ns;
+    for (int i = tier; i >= 0 && covered_ns < t1_ns; --i) {
+        MappedFile file(SeriesStore::get_path(directory, channel_name, series_rollup_tiers[i].extension));
+        size_t index = lower_bound<SeriesRollupRecord>(file, [&](const SeriesRollupRecord& record) {
+            return record.end_ns <= covered_ns;
+        });
+        int64_t end_ns = covered_ns;
+        for (; index != file.records<SeriesRollupRecord>(); ++index) {
+            const SeriesRollupRecord record = file.record<SeriesRollupRecord>(index);
+            if (record.start_ns >= t1_ns) break;
+            cell(record.start_ns).merge(record.count, record.min, record.max, record.sum);
+            end_ns = std::max(end_ns, record.end_ns);
+        }
+        covered_ns = end_ns;
+    }
+
+    if (covered_ns < t1_ns) {
+        MappedFile index_file(SeriesStore::get_path(directory, channel_name, "index"));
+        MappedFile series_file(SeriesStore::get_path(directory, channel_name, "series"));
+        size_t index = lower_bound<SeriesIndexEntry>(index_file, [&](const SeriesIndexEntry& entry) {
+            return entry.t_last < covered_ns;
+        });
+        for (; index != index_file.records<SeriesIndexEntry>(); ++index) {
+            const SeriesIndexEntry entry = index_file.record<SeriesIndexEntry>(index);
+            if (entry.t_first >= t1_ns) break;
+            if (entry.offset + SeriesFile::chunk_header_size > series_file.get_size()) break;
+            const uint8_t* header = series_file.data() + entry.offset;
+
+            if (entry.t_first >= covered_ns && entry.t_last < t1_ns
+                && step_number(entry.t_first, step_ns) == step_number(entry.t_last, step_ns)) {
+                // Блок целиком в одном шаге: достаточно агрегатов заголовка
+                float v_min, v_max;
+                double v_sum;
+                std::memcpy(&v_min, header + 32, sizeof(v_min));
+                std::memcpy(&v_max, header + 36, sizeof(v_max));
+                std::memcpy(&v_sum, header + 40, sizeof(v_sum));
+                cell(entry.t_first).merge(entry.count, v_min, v_max, v_sum);
+                continue;
+            }
+
+            uint16_t flags;
+            uint32_t payload_size;
+            std::memcpy(&flags, header + 6, sizeof(flags));
+            std::memcpy(&payload_size, header + 12, sizeof(payload_size));
+            if (entry.offset + SeriesFile::chunk_header_size + payload_size > series_file.get_size()) break;
+            GorillaDecoder decoder(header + SeriesFile::chunk_header_size, payload_size, entry.count, chunk_precision(flags));
+            int64_t timestamp_ns;
+            float value;
+            while (decoder.next(timestamp_ns, value)) {
+                if (timestamp_ns >= covered_ns && timestamp_ns < t1_ns) {
+                    cell(timestamp_ns).merge(1, value, value, value);
+                }
+            }
+        }
+    }
+
+    std::vector<SeriesQueryPoint> result;
+    for (size_t i = 0; i != cells.size(); ++i) {
+        const Cell& c = cells[i];
+        if (c.count == 0) continue;
+        double value = 0.0;
+        switch (aggregate) {
+            case Aggregate::Min: value = c.min; break;
+            case Aggregate::Max: value = c.max; break;
+            case Aggregate::Avg: value = c.sum / static_cast<double>(c.count); break;
+            case Aggregate::Sum: value = c.sum; break;
+            case Aggregate::Count: value = static_cast<double>(c.count); break;
+        }
+        result.push_back({(first_step + static_cast<int64_t>(i)) * step_ns, value});
+    }
+    return result;
+}
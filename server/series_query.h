@@ -0,0 +1,79 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @struct SeriesQueryPoint
+ * @brief Значение агрегата за один шаг запроса.
+ */
+struct SeriesQueryPoint {
+    int64_t start_ns; ///< Начало шага (нс, кратно шагу)
+    double value; ///< Значение агрегата
+};
+
+/**
+ * @class SeriesQuery
+ * @brief Агрегирующие запросы по сохраненной истории канала.
+ *
+ * Читает файлы SeriesStore через mmap, не синхронизируясь с потоком записи:
+ * файлы только дописываются, а индекс и уровни свертки состоят из записей
+ * фиксированного размера, поэтому читатель видит согласованный префикс.
+ *
+ * Интервал запроса делится на шаги, выровненные по абсолютному времени.
+ * Основная часть интервала берется из самого крупного уровня свертки, разрешение
+ * которого делит шаг; хвост, еще не попавший в этот уровень, - из более мелких
+ * уровней и затем из сжатых блоков. Блок, целиком попадающий в один шаг,
+ * учитывается по агрегатам из заголовка без распаковки.
+ *
+ * Значения, еще не выгруженные из истории канала на диск, в запрос не попадают.
+ */
+class SeriesQuery {
+public:
+    /**
+     * @enum Aggregate
+     * @brief Агрегат запроса.
+     */
+    enum class Aggregate {
+        Min, ///< Минимум
+        Max, ///< Максимум
+        Avg, ///< Среднее
+        Sum, ///< Сумма
+        Count ///< Количество значений
+    };
+
+    /**
+     * @brief Конструктор.
+     * @param directory Каталог хранилища.
+     * @param channel_name Имя канала.
+     */
+    SeriesQuery(const std::string& directory, const std::string& channel_name);
+
+    /**
+     * @brief Выполняет запрос.
+     *
+     * Крайние шаги выровнены по сетке и могут включать значения чуть за пределами
+     * интервала (в пределах разрешения выбранного уровня свертки).
+     *
+     * @param t0_ns Начало интервала (нс).
+     * @param t1_ns Конец интервала (нс).
+     * @param aggregate Агрегат.
+     * @param step_ns Шаг (нс).
+     * @return Значения непустых шагов в порядке времени.
+     * @throws std::invalid_argument Если интервал пуст или шагов слишком много.
+     * @throws std::runtime_error Если файлы хранилища не удалось прочитать.
+     */
+    std::vector<SeriesQueryPoint> run(int64_t t0_ns, int64_t t1_ns, Aggregate aggregate, int64_t step_ns) const;
+
+    /**
+     * @brief Разбирает агрегат ("min", "max", "avg", "sum" или "count").
+     * @throws std::invalid_argument Если агрегат неизвестен.
+     */
+    static Aggregate parse_aggregate(const std::string& text);
+
+private:
+    std::string directory; ///< Каталог хранилища
+    std::string channel_name; ///< Имя канала
+};
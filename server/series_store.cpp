@@ -0,0 +1,633 @@
+#include "series_store.h"
+#include "channel_controller.h"
+#include "waveform.h"
+#include "logger.h"
+#include "config.h"
+
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+constexpr char chunk_magic[4] = {'C', 'H', 'N', 'K'}; ///< Сигнатура заголовка блока
+constexpr char footer_magic[4] = {'C', 'E', 'N', 'D'}; ///< Сигнатура окончания блока
+constexpr uint16_t chunk_version = 1; ///< Версия формата блока
+
+/**
+ * @brief Таблица CRC32 (полином 0xEDB88320).
+ */
+struct Crc32Table {
+    uint32_t entries[256];
+
+    constexpr Crc32Table() : entries() {
+        for (uint32_t i = 0; i != 256; ++i) {
+            uint32_t crc = i;
+            for (int bit = 0; bit != 8; ++bit) {
+                crc = (crc >> 1) ^ (0xEDB88320U & (0U - (crc & 1U)));
+            }
+            entries[i] = crc;
+        }
+    }
+};
+
+constexpr Crc32Table crc32_table;
+
+uint32_t crc32(const uint8_t* data, size_t size) {
+    uint32_t crc = 0xFFFFFFFFU;
+    for (size_t i = 0; i != size; ++i) {
+        crc = crc32_table.entries[(crc ^ data[i]) & 0xFFU] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFU;
+}
+
+template <typename T>
+void put(uint8_t* base, size_t offset, T value) {
+    std::memcpy(base + offset, &value, sizeof(T));
+}
+
+template <typename T>
+T get(const uint8_t* base, size_t offset) {
+    T value;
+    std::memcpy(&value, base + offset, sizeof(T));
+    return value;
+}
+
+/**
+ * @brief Читает ровно size байт по смещению.
+ * @return false, если файл закончился раньше.
+ */
+bool read_exact(int fd, uint8_t* data, size_t size, uint64_t offset) {
+    while (size > 0) {
+        ssize_t result = pread(fd, data, size, static_cast<off_t>(offset));
+        if (result == -1 && errno == EINTR) continue;
+        if (result <= 0) return false;
+        data += result;
+        size -= static_cast<size_t>(result);
+        offset += static_cast<uint64_t>(result);
+    }
+    return true;
+}
+
+/**
+ * @brief Флаги заголовка блока: бит 0 - коды с фиксированной точкой, биты 8-15 - точность.
+ */
+uint16_t chunk_flags(int precision) {
+    return precision < 0 ? 0 : static_cast<uint16_t>(1U | (static_cast<unsigned>(precision) << 8));
+}
+
+size_t padded_size(size_t size) {
+    return (size + 7) & ~size_t(7);
+}
+
+/**
+ * @brief Записывает ровно size байт по смещению.
+ * @throws std::runtime_error Если запись не удалась.
+ */
+void write_exact(int fd, const void* data, size_t size, uint64_t offset, const std::string& path) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    while (size > 0) {
+        ssize_t result = pwrite(fd, bytes, size, static_cast<off_t>(offset));
+        if (result == -1 && errno == EINTR) continue;
+        if (result <= 0) {
+            throw std::runtime_error("write " + path + ": " + strerror(errno));
+        }
+        bytes += result;
+        size -= static_cast<size_t>(result);
+        offset += static_cast<uint64_t>(result);
+    }
+}
+
+/**
+ * @brief Начало интервала разрешения resolution_ns, содержащего время.
+ */
+int64_t interval_start(int64_t timestamp_ns, int64_t resolution_ns) {
+    int64_t start = timestamp_ns - timestamp_ns % resolution_ns;
+    return start > timestamp_ns ? start - resolution_ns : start;
+}
+
+}
+
+/**
+ * @brief Открывает (или создает) файл и восстанавливает его после сбоя.
+ */
+SeriesFile::SeriesFile(const std::string& path, const std::string& index_path) : path(path), index_path(index_path) {
+    fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        throw std::runtime_error("open " + path + ": " + strerror(errno));
+    }
+    index_fd = open(index_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (index_fd == -1) {
+        int error = errno;
+        close(fd);
+        throw std::runtime_error("open " + index_path + ": " + strerror(error));
+    }
+    try {
+        recover();
+        rebuild_index();
+    } catch (...) {
+        close(index_fd);
+        close(fd);
+        throw;
+    }
+}
+
+/**
+ * @brief Деструктор. Закрывает файлы.
+ */
+SeriesFile::~SeriesFile() {
+    sync();
+    close(index_fd);
+    close(fd);
+}
+
+/**
+ * @brief Проверяет блоки файла и обрезает его по первому испорченному.
+ *
+ * Проверяются сигнатуры, размеры и CRC каждого блока. Все, что идет после
+ * первого некорректного блока, считается недописанным при сбое и удаляется.
+ */
+void SeriesFile::recover() {
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == -1) {
+        throw std::runtime_error("fstat " + path + ": " + strerror(errno));
+    }
+    const uint64_t file_size = static_cast<uint64_t>(file_stat.st_size);
+
+    uint64_t offset = 0;
+    while (offset + chunk_header_size + chunk_footer_size <= file_size) {
+        uint8_t header[chunk_header_size];
+        if (!read_exact(fd, header, sizeof(header), offset)
+            || std::memcmp(header, chunk_magic, sizeof(chunk_magic)) != 0
+            || get<uint16_t>(header, 4) != chunk_version) {
+            break;
+        }
+        const uint32_t count = get<uint32_t>(header, 8);
+        const uint32_t payload_size = get<uint32_t>(header, 12);
+        const uint64_t total_size = chunk_header_size + padded_size(payload_size) + chunk_footer_size;
+        if (count == 0 || offset + total_size > file_size) {
+            break;
+        }
+
+        buffer.resize(static_cast<size_t>(total_size));
+        if (!read_exact(fd, buffer.data(), buffer.size(), offset)) {
+            break;
+        }
+        const uint8_t* footer = buffer.data() + total_size - chunk_footer_size;
+        if (std::memcmp(footer, footer_magic, sizeof(footer_magic)) != 0
+            || get<uint64_t>(footer, 8) != total_size
+            || get<uint32_t>(footer, 4) != crc32(buffer.data(), static_cast<size_t>(total_size - chunk_footer_size))) {
+            break;
+        }
+
+        chunks.push_back({offset, count, get<int64_t>(header, 16), get<int64_t>(header, 24),
+                          get<float>(header, 32), get<float>(header, 36), get<double>(header, 40)});
+        chunks.back().precision = chunk_precision(get<uint16_t>(header, 6));
+        offset += total_size;
+    }
+
+    if (offset != file_size) {
+        Log::log("SeriesFile " + path + ": dropped " + std::to_string(file_size - offset)
+                 + " bytes of incomplete data after " + std::to_string(chunks.size()) + " chunks");
+        if (ftruncate(fd, static_cast<off_t>(offset)) == -1) {
+            throw std::runtime_error("ftruncate " + path + ": " + strerror(errno));
+        }
+    }
+    size = offset;
+    buffer.clear();
+}
+
+/**
+ * @brief Приводит индекс в соответствие со списком блоков.
+ *
+ * Индекс мог отстать от файла значений или, наоборот, ссылаться на блоки,
+ * отброшенные при восстановлении. Совпадающий индекс не трогается. Иначе новый
+ * индекс пишется во временный файл и заменяет старый переименованием: запрос,
+ * отобразивший старый индекс в память, дочитает его целиком.
+ */
+void SeriesFile::rebuild_index() {
+    std::vector<SeriesIndexEntry> entries;
+    entries.reserve(chunks.size());
+    for (const SeriesChunkInfo& info : chunks) {
+        entries.push_back({info.t_first, info.t_last, info.offset, info.count, 0});
+    }
+    const size_t bytes = entries.size() * sizeof(SeriesIndexEntry);
+
+    struct stat index_stat;
+    if (fstat(index_fd, &index_stat) == -1) {
+        throw std::runtime_error("fstat " + index_path + ": " + strerror(errno));
+    }
+    if (static_cast<uint64_t>(index_stat.st_size) == bytes) {
+        std::vector<SeriesIndexEntry> current(entries.size());
+        if (read_exact(index_fd, reinterpret_cast<uint8_t*>(current.data()), bytes, 0)
+            && std::memcmp(current.data(), entries.data(), bytes) == 0) {
+            return;
+        }
+    }
+
+    const std::string temp_path = index_path + ".tmp";
+    int temp_fd = open(temp_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (temp_fd == -1) {
+        throw std::runtime_error("open " + temp_path + ": " + strerror(errno));
+    }
+    try {
+        write_exact(temp_fd, entries.data(), bytes, 0, temp_path);
+        if (fdatasync(temp_fd) == -1) {
+            throw std::runtime_error("fdatasync " + temp_path + ": " + strerror(errno));
+        }
+        if (rename(temp_path.c_str(), index_path.c_str()) == -1) {
+            throw std::runtime_error("rename " + temp_path + ": " + strerror(errno));
+        }
+    } catch (...) {
+        close(temp_fd);
+        unlink(temp_path.c_str());
+        throw;
+    }
+    close(index_fd);
+    index_fd = temp_fd;
+    Log::log("SeriesFile " + index_path + ": rebuilt for " + std::to_string(entries.size()) + " chunks");
+}
+
+/**
+ * @brief Дописывает блок в конец файла.
+ *
+ * Заголовок, данные и окончание собираются в один буфер и записываются одним
+ * вызовом pwrite. При частичной записи хвост обрезается, чтобы следующий
+ * блок не оказался за мусором.
+ */
+void SeriesFile::append(GorillaEncoder& encoder, SeriesChunkInfo& info) {
+    const std::vector<uint8_t>& payload = encoder.finish();
+    const size_t total_size = chunk_header_size + padded_size(payload.size()) + chunk_footer_size;
+
+    buffer.assign(total_size, 0);
+    uint8_t* base = buffer.data();
+    std::memcpy(base, chunk_magic, sizeof(chunk_magic));
+    put<uint16_t>(base, 4, chunk_version);
+    put<uint16_t>(base, 6, chunk_flags(encoder.get_precision()));
+    put<uint32_t>(base, 8, info.count);
+    put<uint32_t>(base, 12, static_cast<uint32_t>(payload.size()));
+    put<int64_t>(base, 16, info.t_first);
+    put<int64_t>(base, 24, info.t_last);
+    put<float>(base, 32, info.v_min);
+    put<float>(base, 36, info.v_max);
+    put<double>(base, 40, info.v_sum);
+    std::memcpy(base + chunk_header_size, payload.data(), payload.size());
+    uint8_t* footer = base + total_size - chunk_footer_size;
+    std::memcpy(footer, footer_magic, sizeof(footer_magic));
+    put<uint32_t>(footer, 4, crc32(base, total_size - chunk_footer_size));
+    put<uint64_t>(footer, 8, total_size);
+
+    size_t written = 0;
+    while (written != total_size) {
+        ssize_t result = pwrite(fd, base + written, total_size - written, static_cast<off_t>(size + written));
+        if (result == -1 && errno == EINTR) continue;
+        if (result <= 0) {
+            int error = errno;
+            if (ftruncate(fd, static_cast<off_t>(size)) == -1) {
+                // Недописанный блок будет отброшен при следующем открытии
+            }
+            throw std::runtime_error("write " + path + ": " + strerror(error));
+        }
+        written += static_cast<size_t>(result);
+    }
+
+    info.offset = size;
+    info.precision = encoder.get_precision();
+    const SeriesIndexEntry entry{info.t_first, info.t_last, info.offset, info.count, 0};
+    write_exact(index_fd, &entry, sizeof(entry), chunks.size() * sizeof(SeriesIndexEntry), index_path);
+    chunks.push_back(info);
+    size += total_size;
+    dirty = true;
+}
+
+/**
+ * @brief Сбрасывает записанные блоки на диск (fdatasync).
+ */
+void SeriesFile::sync() {
+    if (dirty) {
+        fdatasync(fd);
+        fdatasync(index_fd);
+        dirty = false;
+    }
+}
+
+/**
+ * @brief Распаковывает значения блока.
+ */
+void SeriesFile::read_chunk(const SeriesChunkInfo& info, const std::function<void(int64_t, float)>& callback) const {
+    uint8_t header[chunk_header_size];
+    if (!read_exact(fd, header, sizeof(header), info.offset)) {
+        throw std::runtime_error("read " + path + ": unexpected end of file");
+    }
+    std::vector<uint8_t> payload(get<uint32_t>(header, 12));
+    if (!read_exact(fd, payload.data(), payload.size(), info.offset + chunk_header_size)) {
+        throw std::runtime_error("read " + path + ": unexpected end of file");
+    }
+    GorillaDecoder decoder(payload.data(), payload.size(), info.count, chunk_precision(get<uint16_t>(header, 6)));
+    int64_t timestamp_ns;
+    float value;
+    while (decoder.next(timestamp_ns, value)) {
+        callback(timestamp_ns, value);
+    }
+}
+
+/**
+ * @brief Деструктор. Закрывает файл.
+ */
+SeriesRollup::~SeriesRollup() {
+    if (fd != -1) {
+        sync();
+        close(fd);
+    }
+}
+
+/**
+ * @brief Завершает текущий интервал и начинает новый со значения.
+ */
+void SeriesRollup::start_interval(int64_t timestamp_ns, float value) {
+    if (current.count) {
+        current.end_ns = current_end;
+        completed.push_back(current);
+    }
+    current = {interval_start(timestamp_ns, resolution_ns), 1, value, value, value, timestamp_ns + 1};
+    current_end = current.start_ns + resolution_ns;
+}
+
+/**
+ * @brief Дописывает завершенные интервалы в файл.
+ *
+ * Файл открывается при первой записи; недописанная при сбое запись в конце
+ * отбрасывается (размер файла выравнивается вниз до целого числа записей).
+ * Текущий интервал записывается с концом покрытого времени на последнем значении.
+ */
+void SeriesRollup::flush(bool include_open) {
+    if (include_open && current.count) {
+        completed.push_back(current);
+        current.count = 0;
+    }
+    if (completed.empty()) {
+        return;
+    }
+    if (fd == -1) {
+        fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd == -1) {
+            throw std::runtime_error("open " + path + ": " + strerror(errno));
+        }
+        struct stat file_stat;
+        if (fstat(fd, &file_stat) == -1) {
+            int error = errno;
+            close(fd);
+            fd = -1;
+            throw std::runtime_error("fstat " + path + ": " + strerror(error));
+        }
+        size = static_cast<uint64_t>(file_stat.st_size) / sizeof(SeriesRollupRecord) * sizeof(SeriesRollupRecord);
+    }
+    const size_t bytes = completed.size() * sizeof(SeriesRollupRecord);
+    write_exact(fd, completed.data(), bytes, size, path);
+    completed.clear();
+    size += bytes;
+    dirty = true;
+}
+
+/**
+ * @brief Сбрасывает записанные интервалы на диск (fdatasync).
+ */
+void SeriesRollup::sync() {
+    if (dirty) {
+        fdatasync(fd);
+        dirty = false;
+    }
+}
+
+/**
+ * @brief Конструктор. Создает каталог и запускает поток записи.
+ */
+SeriesStore::SeriesStore(const std::string& directory, const ChannelController& controller)
+    : directory(directory), controller(controller) {
+    if (mkdir(directory.c_str(), 0755) == -1 && errno != EEXIST) {
+        throw std::runtime_error("mkdir " + directory + ": " + strerror(errno));
+    }
+    flush_thread = std::thread(&SeriesStore::flush_loop, this);
+    Log::log("SeriesStore is writing to " + directory);
+}
+
+/**
+ * @brief Деструктор. Останавливает поток записи.
+ */
+SeriesStore::~SeriesStore() {
+    stop();
+}
+
+/**
+ * @brief Останавливает поток записи.
+ *
+ * После остановки потока новые значения забираются последний раз, открытые
+ * блоки закрываются и файлы сбрасываются на диск.
+ */
+void SeriesStore::stop() {
+    {
+        std::lock_guard<std::mutex> lock(stop_mutex);
+        if (stopping.exchange(true)) {
+            return;
+        }
+    }
+    stop_cond_var.notify_all();
+    if (flush_thread.joinable()) {
+        flush_thread.join();
+    }
+    for (auto& [name, series] : series_map) {
+        finish_series(*series);
+    }
+    series_map.clear();
+}
+
+/**
+ * @brief Возвращает путь к файлу канала.
+ */
+std::string SeriesStore::get_path(const std::string& directory, const std::string& channel_name, const std::string& extension) {
+    return directory + "/" + channel_name + "." + extension;
+}
+
+/**
+ * @brief Основной цикл потока записи.
+ *
+ * Раз в store_flush_interval_ns забирает новые значения всех сохраняемых каналов
+ * и сбрасывает на диск файлы, в которые были дописаны блоки. Интервал меньше времени
+ * заполнения истории канала на минимальном периоде опроса; проходы идут по сетке
+ * интервала, поэтому время самого прохода не удлиняет промежуток между выгрузками.
+ */
+void SeriesStore::flush_loop() {
+    const auto interval = std::chrono::nanoseconds(MyConfig::DefaultConfig::store_flush_interval_ns);
+    auto next_flush = std::chrono::steady_clock::now();
+    while (!stopping) {
+        track_channels();
+        for (auto& [name, series] : series_map) {
+            try {
+                flush_series(*series, false);
+                sync(*series);
+            } catch (const std::exception& e) {
+                Log::log("SeriesStore " + name + ": " + e.what());
+            }
+        }
+        // Опоздавший проход не наверстывается серией проходов подряд
+        next_flush = std::max(next_flush + interval, std::chrono::steady_clock::now());
+        std::unique_lock<std::mutex> lock(stop_mutex);
+        stop_cond_var.wait_until(lock, next_flush, [this] { return stopping.load(); });
+    }
+}
+
+/**
+ * @brief Начинает сохранять каналы, перешедшие в состояние измерения.
+ *
+ * Каналы, которые ни разу не измеряли, не трогаются: для каналов таблицы
+ * история создается лениво, и обращение к ней выделило бы память зря.
+ * Каналы, удаленные из контроллера, и каналы, пересозданные под тем же именем
+ * (история сменилась), завершаются.
+ */
+void SeriesStore::track_channels() {
+    const std::vector<std::shared_ptr<IChannel>> channels = controller.get_channels();
+    std::unordered_map<std::string, const IChannel*> present;
+    present.reserve(channels.size());
+    for (const std::shared_ptr<IChannel>& channel : channels) {
+        present.emplace(channel->get_name(), channel.get());
+    }
+    for (auto it = series_map.begin(); it != series_map.end();) {
+        if (!present.count(it->first)) {
+            finish_series(*it->second);
+            it = series_map.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    for (const std::shared_ptr<IChannel>& channel : channels) {
+        const std::string& name = channel->get_name();
+        if (channel->get_state() != ChannelStateManager::ChannelState::Measure) {
+            continue;
+        }
+        auto tracked = series_map.find(name);
+        if (tracked != series_map.end()) {
+            if (tracked->second->waveform == channel->get_waveform()) {
+                continue;
+            }
+            finish_series(*tracked->second);
+            series_map.erase(tracked);
+        }
+        try {
+            auto series = std::make_unique<Series>();
+            series->name = name;
+            series->waveform = channel->get_waveform();
+            for (const SeriesRollupTier& tier : series_rollup_tiers) {
+                series->rollups.push_back(std::make_unique<SeriesRollup>(
+                    get_path(directory, name, tier.extension), tier.resolution_ns));
+            }
+            series_map.emplace(name, std::move(series));
+        } catch (const std::exception& e) {
+            Log::log("SeriesStore " + name + ": " + e.what());
+        }
+    }
+}
+
+/**
+ * @brief Дописывает оставшиеся значения канала и закрывает его файлы.
+ */
+void SeriesStore::finish_series(Series& series) {
+    try {
+        flush_series(series, true);
+        sync(series);
+    } catch (const std::exception& e) {
+        Log::log("SeriesStore " + series.name + ": " + e.what());
+    }
+}
+
+/**
+ * @brief Забирает новые значения канала и дописывает заполненные блоки.
+ */
+void SeriesStore::flush_series(Series& series, bool seal_all) {
+    const size_t chunk_samples = MyConfig::DefaultConfig::store_chunk_samples;
+    // История читается по участкам одного диапазона; блок хранит коды одной точности
+    for (;;) {
+        timestamps.clear();
+        values.clear();
+        int precision = -1;
+        const uint64_t lost = series.waveform->read_since(series.sequence, timestamps, values, precision);
+        if (lost && series.started) {
+            Log::log("SeriesStore " + series.name + ": " + std::to_string(lost) + " samples lost (flusher fell behind)");
+        }
+        series.started = true;
+        if (timestamps.empty()) {
+            break;
+        }
+        if (series.encoder.count() && series.encoder.get_precision() != precision) {
+            seal(series);
+        }
+
+        for (size_t i = 0; i != timestamps.size(); ++i) {
+            SeriesChunkInfo& info = series.info;
+            const float value = values[i];
+            if (series.encoder.count() == 0) {
+                info = {0, 0, timestamps[i], timestamps[i], value, value, 0.0};
+                series.encoder.reset(precision);
+                series.opened = std::chrono::steady_clock::now();
+            }
+            series.encoder.append(timestamps[i], value);
+            for (const std::unique_ptr<SeriesRollup>& rollup : series.rollups) {
+                rollup->add(timestamps[i], value);
+            }
+            info.t_last = timestamps[i];
+            info.v_min = std::min(info.v_min, value);
+            info.v_max = std::max(info.v_max, value);
+            info.v_sum += value;
+            ++info.count;
+            if (info.count >= chunk_samples) {
+                seal(series);
+            }
+        }
+    }
+
+    const auto max_age = std::chrono::milliseconds(MyConfig::DefaultConfig::store_chunk_max_age_ms);
+    if (series.encoder.count() && (seal_all || std::chrono::steady_clock::now() - series.opened >= max_age)) {
+        seal(series);
+    }
+    for (const std::unique_ptr<SeriesRollup>& rollup : series.rollups) {
+        rollup->flush(seal_all);
+    }
+}
+
+/**
+ * @brief Закрывает открытый блок и дописывает его в файл.
+ *
+ * Файл канала открывается при записи первого блока, чтобы каналы без значений
+ * не оставляли пустых файлов. При ошибке записи блок теряется, но кодировщик
+ * сбрасывается, чтобы следующие блоки писались с чистого состояния.
+ */
+void SeriesStore::seal(Series& series) {
+    try {
+        if (!series.file) {
+            series.file = std::make_unique<SeriesFile>(get_path(directory, series.name, "series"),
+                                                       get_path(directory, series.name, "index"));
+        }
+        series.file->append(series.encoder, series.info);
+    } catch (...) {
+        series.encoder.reset();
+        throw;
+    }
+    series.encoder.reset();
+}
+
+/**
+ * @brief Сбрасывает файлы канала на диск.
+ */
+void SeriesStore::sync(Series& series) {
+    if (series.file) {
+        series.file->sync();
+    }
+    for (const std::unique_ptr<SeriesRollup>& rollup : series.rollups) {
+        rollup->sync();
+    }
+}
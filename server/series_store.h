@@ -0,0 +1,374 @@
+#pragma once
+
+#include "gorilla.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+class ChannelController;
+class ChannelWaveform;
+
+/**
+ * @struct SeriesChunkInfo
+ * @brief Сводка блока хранилища (из заголовка блока).
+ */
+struct SeriesChunkInfo {
+    uint64_t offset; ///< Смещение блока в файле
+    uint32_t count; ///< Количество значений
+    int64_t t_first; ///< Время первого значения (нс)
+    int64_t t_last; ///< Время последнего значения (нс)
+    float v_min; ///< Минимальное значение
+    float v_max; ///< Максимальное значение
+    double v_sum; ///< Сумма значений
+    int precision = -1; ///< Точность кодов значений (-1 - значения хранятся как float)
+};
+
+/**
+ * @brief Точность кодов значений блока по флагам заголовка.
+ * @return Точность или -1, если значения хранятся как float.
+ */
+inline int chunk_precision(uint16_t flags) {
+    return (flags & 1U) ? static_cast<int>(flags >> 8) : -1;
+}
+
+/**
+ * @struct SeriesIndexEntry
+ * @brief Запись разреженного индекса времени: одна на блок хранилища.
+ *
+ * Индекс хранится отдельным файлом из записей фиксированного размера, поэтому
+ * поиск блока по времени - двоичный поиск по отображенному файлу.
+ */
+struct SeriesIndexEntry {
+    int64_t t_first; ///< Время первого значения блока (нс)
+    int64_t t_last; ///< Время последнего значения блока (нс)
+    uint64_t offset; ///< Смещение блока в файле значений
+    uint32_t count; ///< Количество значений блока
+    uint32_t reserved; ///< Зарезервировано (0)
+};
+
+static_assert(sizeof(SeriesIndexEntry) == 32, "SeriesIndexEntry must have a fixed on-disk size");
+
+/**
+ * @struct SeriesRollupRecord
+ * @brief Агрегаты значений за один интервал уровня свертки.
+ *
+ * Запись незавершенного интервала (записанного при остановке) покрывает время
+ * только до последнего значения: более поздние значения того же интервала
+ * запрос берет из следующих записей или из блоков хранилища.
+ */
+struct SeriesRollupRecord {
+    int64_t start_ns; ///< Начало интервала (нс, кратно разрешению уровня)
+    uint64_t count; ///< Количество значений
+    float min; ///< Минимальное значение
+    float max; ///< Максимальное значение
+    double sum; ///< Сумма значений
+    int64_t end_ns; ///< Конец покрытого времени (нс): конец интервала или, если он не завершен, последнее значение + 1
+};
+
+static_assert(sizeof(SeriesRollupRecord) == 40, "SeriesRollupRecord must have a fixed on-disk size");
+
+/**
+ * @struct SeriesRollupTier
+ * @brief Уровень свертки: разрешение и расширение файла.
+ */
+struct SeriesRollupTier {
+    int64_t resolution_ns; ///< Длительность интервала (нс)
+    const char* extension; ///< Расширение файла уровня
+};
+
+/**
+ * @brief Уровни свертки от мелкого к крупному.
+ */
+inline constexpr SeriesRollupTier series_rollup_tiers[] = {
+    {1000000000LL, "1s"},
+    {60000000000LL, "1m"},
+    {3600000000000LL, "1h"}
+};
+
+/**
+ * @class SeriesFile
+ * @brief Файл хранилища одного канала: последовательность сжатых блоков.
+ *
+ * Формат блока:
+ * - заголовок (48 байт): "CHNK", версия, флаги (бит 0 - значения кодами с фиксированной
+ *   точкой, биты 8-15 - их точность), количество значений, размер данных,
+ *   время первого и последнего значения, минимум, максимум и сумма значений;
+ * - данные GorillaEncoder, дополненные нулями до кратности 8 байтам;
+ * - окончание (16 байт): "CEND", CRC32 заголовка и данных, полный размер блока.
+ *
+ * Для каждого блока в файл индекса дописывается SeriesIndexEntry. Индекс
+ * пишется после блока, поэтому читатель индекса видит только дописанные блоки.
+ *
+ * Блок дописывается одним вызовом pwrite, поэтому после сбоя в конце файла может
+ * оказаться только недописанный блок. При открытии он отбрасывается: файл
+ * обрезается по первому блоку с неверным заголовком, окончанием или CRC.
+ */
+class SeriesFile {
+public:
+    /**
+     * @brief Открывает (или создает) файл и восстанавливает его после сбоя.
+     *
+     * Индекс, не совпадающий с уцелевшими блоками, перестраивается.
+     *
+     * @param path Путь к файлу значений.
+     * @param index_path Путь к файлу индекса.
+     * @throws std::runtime_error Если файлы не удалось открыть.
+     */
+    SeriesFile(const std::string& path, const std::string& index_path);
+
+    /**
+     * @brief Деструктор. Закрывает файл.
+     */
+    ~SeriesFile();
+
+    SeriesFile(const SeriesFile&) = delete;
+    SeriesFile& operator=(const SeriesFile&) = delete;
+
+    /**
+     * @brief Дописывает блок в конец файла.
+     * @param encoder Закодированные значения блока.
+     * @param info Сводка блока (смещение заполняется).
+     * @throws std::runtime_error Если запись не удалась.
+     */
+    void append(GorillaEncoder& encoder, SeriesChunkInfo& info);
+
+    /**
+     * @brief Сбрасывает записанные блоки на диск (fdatasync).
+     */
+    void sync();
+
+    /**
+     * @brief Сводки блоков файла в порядке записи.
+     */
+    const std::vector<SeriesChunkInfo>& get_chunks() const { return chunks; }
+
+    /**
+     * @brief Распаковывает значения блока.
+     * @param info Сводка блока.
+     * @param callback Вызывается для каждого значения (время, значение).
+     * @throws std::runtime_error Если блок не удалось прочитать.
+     */
+    void read_chunk(const SeriesChunkInfo& info, const std::function<void(int64_t, float)>& callback) const;
+
+    /**
+     * @brief Путь к файлу.
+     */
+    const std::string& get_path() const { return path; }
+
+    static constexpr size_t chunk_header_size = 48; ///< Размер заголовка блока
+    static constexpr size_t chunk_footer_size = 16; ///< Размер окончания блока
+
+private:
+    /**
+     * @brief Проверяет блоки файла и обрезает его по первому испорченному.
+     */
+    void recover();
+
+    /**
+     * @brief Приводит индекс в соответствие со списком блоков.
+     */
+    void rebuild_index();
+
+    std::string path; ///< Путь к файлу
+    std::string index_path; ///< Путь к файлу индекса
+    int fd = -1; ///< Дескриптор файла
+    int index_fd = -1; ///< Дескриптор файла индекса
+    uint64_t size = 0; ///< Размер корректной части файла
+    bool dirty = false; ///< Есть записи, не сброшенные на диск
+    std::vector<SeriesChunkInfo> chunks; ///< Сводки блоков
+    std::vector<uint8_t> buffer; ///< Буфер сборки блока
+};
+
+/**
+ * @class SeriesRollup
+ * @brief Свертка значений канала в один уровень (min/max/sum/count за интервал).
+ *
+ * Завершенные интервалы дописываются в файл записями SeriesRollupRecord.
+ * Текущий интервал хранится в памяти; при остановке он записывается
+ * незавершенным (покрытое время заканчивается на последнем значении), и после
+ * перезапуска в файле может появиться вторая запись с тем же началом
+ * (агрегаты при чтении объединяются).
+ */
+class SeriesRollup {
+public:
+    /**
+     * @brief Конструктор. Файл открывается при первой записи.
+     * @param path Путь к файлу уровня.
+     * @param resolution_ns Длительность интервала (нс).
+     */
+    SeriesRollup(const std::string& path, int64_t resolution_ns) : path(path), resolution_ns(resolution_ns) {}
+
+    /**
+     * @brief Деструктор. Закрывает файл.
+     */
+    ~SeriesRollup();
+
+    SeriesRollup(const SeriesRollup&) = delete;
+    SeriesRollup& operator=(const SeriesRollup&) = delete;
+
+    /**
+     * @brief Учитывает значение.
+     * @param timestamp_ns Время значения (нс).
+     * @param value Значение.
+     */
+    void add(int64_t timestamp_ns, float value) {
+        if (current.count == 0 || timestamp_ns >= current_end || timestamp_ns < current.start_ns) {
+            start_interval(timestamp_ns, value);
+            return;
+        }
+        if (value < current.min) current.min = value;
+        if (value > current.max) current.max = value;
+        current.sum += value;
+        ++current.count;
+        current.end_ns = timestamp_ns + 1;
+    }
+
+    /**
+     * @brief Дописывает завершенные интервалы в файл.
+     * @param include_open Записать и текущий (незавершенный) интервал.
+     * @throws std::runtime_error Если запись не удалась.
+     */
+    void flush(bool include_open);
+
+    /**
+     * @brief Сбрасывает записанные интервалы на диск (fdatasync).
+     */
+    void sync();
+
+private:
+    /**
+     * @brief Завершает текущий интервал и начинает новый со значения.
+     */
+    void start_interval(int64_t timestamp_ns, float value);
+
+    std::string path; ///< Путь к файлу
+    int64_t resolution_ns; ///< Длительность интервала (нс)
+    int fd = -1; ///< Дескриптор файла
+    uint64_t size = 0; ///< Размер файла
+    bool dirty = false; ///< Есть записи, не сброшенные на диск
+    SeriesRollupRecord current{}; ///< Текущий интервал (count == 0 - интервала нет)
+    int64_t current_end = 0; ///< Конец текущего интервала (нс)
+    std::vector<SeriesRollupRecord> completed; ///< Завершенные, но не записанные интервалы
+};
+
+/**
+ * @class SeriesStore
+ * @brief Дисковое хранилище значений каналов (только дописывание).
+ *
+ * Фоновый поток периодически забирает новые значения из истории каналов
+ * (ChannelWaveform), сжимает их и дописывает блоками в файл канала
+ * `<каталог>/<имя канала>.series`. Блок закрывается, когда набирает
+ * store_chunk_samples значений или становится старше store_chunk_max_age_ms.
+ * Поток измерений при этом не блокируется дольше копирования из кольца.
+ *
+ * Параллельно значения сворачиваются в уровни series_rollup_tiers
+ * (`<каталог>/<имя канала>.1s` и т.д.) для быстрых запросов по длинным интервалам.
+ *
+ * Канал начинает сохраняться, когда впервые оказывается в состоянии измерения.
+ * Когда канал удаляется из контроллера (или пересоздается под тем же именем),
+ * его оставшиеся значения дописываются, а файлы закрываются.
+ * Если поток не успел забрать значения до их вытеснения из истории, потеря
+ * записывается в лог.
+ */
+class SeriesStore {
+public:
+    /**
+     * @brief Конструктор. Создает каталог и запускает поток записи.
+     * @param directory Каталог хранилища.
+     * @param controller Контроллер каналов (должен пережить хранилище).
+     * @throws std::runtime_error Если каталог не удалось создать.
+     */
+    SeriesStore(const std::string& directory, const ChannelController& controller);
+
+    /**
+     * @brief Деструктор. Останавливает поток записи.
+     */
+    ~SeriesStore();
+
+    /**
+     * @brief Останавливает поток записи.
+     *
+     * Оставшиеся в истории значения дописываются, открытые блоки закрываются.
+     * Вызывается после остановки каналов.
+     */
+    void stop();
+
+    /**
+     * @brief Возвращает путь к файлу канала.
+     * @param directory Каталог хранилища.
+     * @param channel_name Имя канала.
+     * @param extension Расширение файла ("series", "index" или расширение уровня свертки).
+     */
+    static std::string get_path(const std::string& directory, const std::string& channel_name, const std::string& extension);
+
+private:
+    /**
+     * @struct Series
+     * @brief Состояние сохранения одного канала.
+     */
+    struct Series {
+        std::string name; ///< Имя канала
+        std::shared_ptr<ChannelWaveform> waveform; ///< История канала
+        std::unique_ptr<SeriesFile> file; ///< Файл канала (открывается с первым блоком)
+        std::vector<std::unique_ptr<SeriesRollup>> rollups; ///< Уровни свертки
+        uint64_t sequence = 0; ///< Номер первого незабранного значения истории
+        bool started = false; ///< Значения уже забирались (вытесненное до этого не считается потерей)
+        GorillaEncoder encoder; ///< Открытый блок
+        SeriesChunkInfo info{}; ///< Сводка открытого блока
+        std::chrono::steady_clock::time_point opened; ///< Момент открытия блока
+    };
+
+    /**
+     * @brief Основной цикл потока записи.
+     */
+    void flush_loop();
+
+    /**
+     * @brief Начинает сохранять каналы, перешедшие в состояние измерения.
+     */
+    void track_channels();
+
+    /**
+     * @brief Дописывает оставшиеся значения канала и закрывает его файлы.
+     */
+    void finish_series(Series& series);
+
+    /**
+     * @brief Забирает новые значения канала и дописывает заполненные блоки.
+     * @param series Канал.
+     * @param seal_all Закрыть открытый блок независимо от заполнения.
+     */
+    void flush_series(Series& series, bool seal_all);
+
+    /**
+     * @brief Закрывает открытый блок и дописывает его в файл.
+     */
+    void seal(Series& series);
+
+    /**
+     * @brief Сбрасывает файлы канала на диск.
+     */
+    static void sync(Series& series);
+
+    std::string directory; ///< Каталог хранилища
+    const ChannelController& controller; ///< Контроллер каналов
+
+    std::unordered_map<std::string, std::unique_ptr<Series>> series_map; ///< Сохраняемые каналы (только поток записи)
+    std::vector<int64_t> timestamps; ///< Буфер времен забранных значений
+    std::vector<float> values; ///< Буфер забранных значений
+
+    std::thread flush_thread; ///< Поток записи
+    std::atomic<bool> stopping = false; ///< Флаг остановки
+    std::mutex stop_mutex; ///< Мьютекс прерываемой паузы
+    std::condition_variable stop_cond_var; ///< Условная переменная прерываемой паузы
+};
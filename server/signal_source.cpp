@@ -0,0 +1,276 @@
+#include "signal_source.h"
+#include "simd_kernels.h"
+#include "replay_source.h"
+#include "my_tools.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+/**
+ * @brief Разбирает числовой параметр источника.
+ * @param params Параметры.
+ * @param index Номер параметра.
+ * @param default_value Значение, если параметр не указан.
+ * @throws std::invalid_argument Если параметр не является числом.
+ */
+double get_param(const std::vector<std::string>& params, size_t index, double default_value) {
+    if (index >= params.size() || params[index].empty()) {
+        return default_value;
+    }
+    size_t pos = 0;
+    double value = 0.0;
+    try {
+        value = std::stod(params[index], &pos);
+    } catch (const std::exception&) {
+        pos = 0;
+    }
+    if (pos != params[index].size() || !std::isfinite(value)) {
+        throw std::invalid_argument("Invalid source parameter: " + params[index]);
+    }
+    return value;
+}
+
+/**
+ * @brief Разбирает обязательный числовой параметр источника.
+ * @throws std::invalid_argument Если параметр не указан или не является числом.
+ */
+double get_required_param(const std::vector<std::string>& params, size_t index, const char* name) {
+    if (index >= params.size() || params[index].empty()) {
+        throw std::invalid_argument(std::string("Source parameter is not specified: ") + name);
+    }
+    return get_param(params, index, 0.0);
+}
+
+/**
+ * @brief Проверяет, что доля лежит в диапазоне [0, 1].
+ */
+void check_fraction(double value, const char* name) {
+    if (value < 0.0 || value > 1.0) {
+        throw std::invalid_argument(std::string("Source parameter must be in [0, 1]: ") + name);
+    }
+}
+
+/**
+ * @brief Форматирует число без лишних нулей ("5", "0.8").
+ */
+std::string format_number(double value) {
+    std::ostringstream stream;
+    stream << value;
+    return stream.str();
+}
+
+/**
+ * @brief Ограничивает значения блока диапазоном канала.
+ */
+void clamp_block(SignalBlock& block) {
+    for (size_t i = 0; i != block.count; ++i) {
+        block.values[i] = std::min(std::max(block.values[i], block.min_value), block.max_value);
+    }
+}
+
+}
+
+/**
+ * @brief Перемещение по умолчанию не поддерживается.
+ * @throws std::logic_error Всегда.
+ */
+void ISignalSource::seek(int64_t position_ns) {
+    (void)position_ns;
+    throw std::logic_error("source does not support seeking");
+}
+
+NoiseSource::NoiseSource() : seed(static_cast<uint32_t>(MyTools::make_seed())) {}
+
+/**
+ * @brief Заполняет блок равномерным шумом в диапазоне канала.
+ */
+void NoiseSource::generate(SignalBlock& block) {
+    Simd::generate_in_range(block.values, block.count, block.min_value, block.max_value, seed, counter);
+    counter += static_cast<uint32_t>(block.count);
+}
+
+std::string NoiseSource::describe() const {
+    return "noise";
+}
+
+/**
+ * @brief Конструктор периодического источника.
+ * @throws std::invalid_argument Если параметры некорректны.
+ */
+PeriodicSource::PeriodicSource(Shape shape, double frequency_hz, float amplitude, float noise, double duty)
+    : shape(shape), frequency_hz(frequency_hz), amplitude(amplitude), noise(noise), duty(duty),
+      seed(static_cast<uint32_t>(MyTools::make_seed())) {
+    if (frequency_hz <= 0.0) {
+        throw std::invalid_argument("Source frequency must be positive");
+    }
+    check_fraction(amplitude, "amplitude");
+    check_fraction(noise, "noise");
+    check_fraction(duty, "duty");
+}
+
+/**
+ * @brief Заполняет блок периодическим сигналом.
+ *
+ * Сначала вычисляется форма сигнала в [-1, 1] (ветвление по форме вынесено за
+ * внутренний цикл), затем шум и масштабирование в диапазон канала.
+ */
+void PeriodicSource::generate(SignalBlock& block) {
+    if (origin_ns < 0) {
+        origin_ns = block.start_ns;
+    }
+    float* out = block.values;
+    const size_t n = block.count;
+
+    // Фаза первого значения и приращение фазы в периодах сигнала
+    const double start_phase = std::fmod(frequency_hz * static_cast<double>(block.start_ns - origin_ns) * 1e-9, 1.0);
+    const double phase_step = frequency_hz * static_cast<double>(block.period_ns) * 1e-9;
+    const double two_pi = 2.0 * M_PI;
+
+    switch (shape) {
+        case Shape::Sine:
+            for (size_t i = 0; i != n; ++i) {
+                out[i] = static_cast<float>(std::sin(two_pi * (start_phase + phase_step * static_cast<double>(i))));
+            }
+            break;
+        case Shape::Square:
+            for (size_t i = 0; i != n; ++i) {
+                double phase = start_phase + phase_step * static_cast<double>(i);
+                out[i] = phase - std::floor(phase) < duty ? 1.0f : -1.0f;
+            }
+            break;
+        case Shape::Ramp:
+            for (size_t i = 0; i != n; ++i) {
+                double phase = start_phase + phase_step * static_cast<double>(i);
+                out[i] = static_cast<float>(2.0 * (phase - std::floor(phase)) - 1.0);
+            }
+            break;
+    }
+
+    const float center = 0.5f * (block.min_value + block.max_value);
+    const float half_span = 0.5f * (block.max_value - block.min_value);
+    if (noise > 0.0f) {
+        noise_buffer.resize(n);
+        Simd::generate_in_range(noise_buffer.data(), n, -noise, noise, seed, counter);
+        counter += static_cast<uint32_t>(n);
+        for (size_t i = 0; i != n; ++i) {
+            out[i] = out[i] * amplitude + noise_buffer[i];
+        }
+        Simd::scale_offset(out, out, n, half_span, center);
+        clamp_block(block);
+    } else {
+        Simd::scale_offset(out, out, n, half_span * amplitude, center);
+    }
+}
+
+std::string PeriodicSource::describe() const {
+    switch (shape) {
+        case Shape::Sine:
+            if (noise > 0.0f) {
+                return "noisy_sine, " + format_number(frequency_hz) + ", " + format_number(amplitude) + ", " + format_number(noise);
+            }
+            return "sine, " + format_number(frequency_hz) + ", " + format_number(amplitude);
+        case Shape::Square:
+            return "square, " + format_number(frequency_hz) + ", " + format_number(amplitude) + ", " + format_number(duty);
+        case Shape::Ramp:
+            return "ramp, " + format_number(frequency_hz) + ", " + format_number(amplitude);
+    }
+    return "unknown";
+}
+
+/**
+ * @brief Конструктор случайного блуждания.
+ * @throws std::invalid_argument Если шаг некорректен.
+ */
+RandomWalkSource::RandomWalkSource(float step) : step(step), seed(static_cast<uint32_t>(MyTools::make_seed())) {
+    check_fraction(step, "step");
+}
+
+/**
+ * @brief Заполняет блок случайным блужданием.
+ *
+ * Шаги генерируются одним пакетом, накопление выполняется последовательно.
+ * При выходе за границу положение отражается от нее.
+ */
+void RandomWalkSource::generate(SignalBlock& block) {
+    float* out = block.values;
+    const size_t n = block.count;
+    Simd::generate_in_range(out, n, -step, step, seed, counter);
+    counter += static_cast<uint32_t>(n);
+    for (size_t i = 0; i != n; ++i) {
+        position += out[i];
+        if (position > 1.0f) position = 2.0f - position;
+        if (position < -1.0f) position = -2.0f - position;
+        out[i] = position;
+    }
+    const float center = 0.5f * (block.min_value + block.max_value);
+    const float half_span = 0.5f * (block.max_value - block.min_value);
+    Simd::scale_offset(out, out, n, half_span, center);
+}
+
+std::string RandomWalkSource::describe() const {
+    return "random_walk, " + format_number(step);
+}
+
+/**
+ * @brief Создает источник сигнала.
+ * @return Источник или nullptr, если источник с таким именем не найден.
+ */
+std::shared_ptr<ISignalSource> SignalSourceFactory::create_source(const std::string& name, TypeParams params) {
+    const auto& source_map = get_source_map();
+    auto it = source_map.find(name);
+    if (it != source_map.end()) {
+        return it->second(params);
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Возвращает карту источников (имя -> функция создания).
+ *
+ * Параметры передаются без имени источника.
+ */
+const std::unordered_map<std::string, SignalSourceFactory::TypeCreator>& SignalSourceFactory::get_source_map() {
+    static const std::unordered_map<std::string, TypeCreator> source_map = {
+        {"noise", [](TypeParams) {
+            return std::make_shared<NoiseSource>();
+        }},
+        {"sine", [](TypeParams params) {
+            return std::make_shared<PeriodicSource>(PeriodicSource::Shape::Sine,
+                get_required_param(params, 0, "frequency"), get_param(params, 1, 1.0));
+        }},
+        {"square", [](TypeParams params) {
+            return std::make_shared<PeriodicSource>(PeriodicSource::Shape::Square,
+                get_required_param(params, 0, "frequency"), get_param(params, 1, 1.0), 0.0f, get_param(params, 2, 0.5));
+        }},
+        {"ramp", [](TypeParams params) {
+            return std::make_shared<PeriodicSource>(PeriodicSource::Shape::Ramp,
+                get_required_param(params, 0, "frequency"), get_param(params, 1, 1.0));
+        }},
+        {"noisy_sine", [](TypeParams params) {
+            return std::make_shared<PeriodicSource>(PeriodicSource::Shape::Sine,
+                get_required_param(params, 0, "frequency"), get_param(params, 1, 0.8), get_param(params, 2, 0.2));
+        }},
+        {"random_walk", [](TypeParams params) {
+            return std::make_shared<RandomWalkSource>(get_param(params, 0, 0.05));
+        }},
+        {"replay", [](TypeParams params) {
+            if (params.empty() || params[0].empty()) {
+                throw std::invalid_argument("Source parameter is not specified: file");
+            }
+            bool loop = true;
+            if (params.size() > 2) {
+                if (params[2] != "loop" && params[2] != "once") {
+                    throw std::invalid_argument("Invalid source parameter: " + params[2]);
+                }
+                loop = params[2] == "loop";
+            }
+            return std::make_shared<ReplaySource>(params[0], get_param(params, 1, 1.0), loop);
+        }}
+    };
+    return source_map;
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @struct SignalBlock
+ * @brief Блок значений, запрашиваемый у источника сигнала.
+ *
+ * Значения блока равноотстоят во времени: i-е значение соответствует моменту
+ * start_ns + i * period_ns.
+ */
+struct SignalBlock {
+    int64_t start_ns; ///< Время первого значения (нс)
+    int64_t period_ns; ///< Период между значениями (нс)
+    float min_value; ///< Нижняя граница диапазона канала
+    float max_value; ///< Верхняя граница диапазона канала
+    float* values; ///< Буфер значений (count элементов)
+    size_t count; ///< Количество значений
+};
+
+/**
+ * @class ISignalSource
+ * @brief Интерфейс источника сигнала канала.
+ *
+ * Источник генерирует значения блоками, чтобы на высоких частотах опроса
+ * виртуальный вызов приходился на блок, а не на каждое значение, и внутренний
+ * цикл мог векторизоваться. Метод generate вызывается только из потока измерений
+ * канала, поэтому внутреннее состояние источника не требует синхронизации.
+ */
+class ISignalSource {
+public:
+    virtual ~ISignalSource() = default;
+
+    /**
+     * @brief Заполняет блок значениями.
+     * @param block Блок значений.
+     */
+    virtual void generate(SignalBlock& block) = 0;
+
+    /**
+     * @brief Возвращает описание источника в формате параметров команды set_source.
+     * @return Строка вида "sine, 5, 0.8".
+     */
+    virtual std::string describe() const = 0;
+
+    /**
+     * @brief Перемещает воспроизведение на заданную позицию.
+     *
+     * Поддерживается только источниками-записями. Вызывается из потока команд;
+     * позиция применяется при следующей генерации.
+     *
+     * @param position_ns Позиция от начала записи (нс).
+     * @throws std::logic_error Если источник не поддерживает перемещение.
+     */
+    virtual void seek(int64_t position_ns);
+};
+
+/**
+ * @class NoiseSource
+ * @brief Равномерный шум во всем диапазоне канала (источник по умолчанию).
+ */
+class NoiseSource : public ISignalSource {
+public:
+    NoiseSource();
+    void generate(SignalBlock& block) override;
+    std::string describe() const override;
+
+private:
+    uint32_t seed; ///< Зерно генератора
+    uint32_t counter = 0; ///< Номер следующего значения в последовательности генератора
+};
+
+/**
+ * @class PeriodicSource
+ * @brief Периодический сигнал (синус, меандр, пила) с необязательным шумом.
+ *
+ * Сигнал центрирован в середине диапазона канала, амплитуда задается долей
+ * половины диапазона. Фаза отсчитывается от первого сгенерированного значения.
+ */
+class PeriodicSource : public ISignalSource {
+public:
+    /**
+     * @enum Shape
+     * @brief Форма сигнала.
+     */
+    enum class Shape {
+        Sine, ///< Синус
+        Square, ///< Меандр
+        Ramp ///< Пила
+    };
+
+    /**
+     * @brief Конструктор.
+     * @param shape Форма сигнала.
+     * @param frequency_hz Частота сигнала (Гц).
+     * @param amplitude Амплитуда (доля половины диапазона, 0..1).
+     * @param noise Амплитуда шума (доля половины диапазона, 0..1).
+     * @param duty Коэффициент заполнения меандра (0..1).
+     * @throws std::invalid_argument Если параметры некорректны.
+     */
+    PeriodicSource(Shape shape, double frequency_hz, float amplitude, float noise = 0.0f, double duty = 0.5);
+
+    void generate(SignalBlock& block) override;
+    std::string describe() const override;
+
+private:
+    Shape shape; ///< Форма сигнала
+    double frequency_hz; ///< Частота сигнала (Гц)
+    float amplitude; ///< Амплитуда (доля половины диапазона)
+    float noise; ///< Амплитуда шума (доля половины диапазона)
+    double duty; ///< Коэффициент заполнения меандра
+    int64_t origin_ns = -1; ///< Время нулевой фазы (нс)
+    uint32_t seed; ///< Зерно генератора шума
+    uint32_t counter = 0; ///< Номер следующего значения генератора шума
+    std::vector<float> noise_buffer; ///< Буфер шума блока
+};
+
+/**
+ * @class RandomWalkSource
+ * @brief Случайное блуждание, отражающееся от границ диапазона.
+ */
+class RandomWalkSource : public ISignalSource {
+public:
+    /**
+     * @brief Конструктор.
+     * @param step Максимальный шаг (доля половины диапазона, 0..1).
+     * @throws std::invalid_argument Если шаг некорректен.
+     */
+    explicit RandomWalkSource(float step);
+
+    void generate(SignalBlock& block) override;
+    std::string describe() const override;
+
+private:
+    float step; ///< Максимальный шаг (доля половины диапазона)
+    float position = 0.0f; ///< Текущее положение (-1..1 относительно диапазона)
+    uint32_t seed; ///< Зерно генератора
+    uint32_t counter = 0; ///< Номер следующего значения генератора
+};
+
+/**
+ * @class SignalSourceFactory
+ * @brief Фабрика источников сигнала по имени и параметрам.
+ *
+ * Поддерживаемые источники и их параметры (в скобках - необязательные):
+ * - noise
+ * - sine, <частота Гц>, (амплитуда)
+ * - square, <частота Гц>, (амплитуда), (заполнение)
+ * - ramp, <частота Гц>, (амплитуда)
+ * - noisy_sine, <частота Гц>, (амплитуда), (шум)
+ * - random_walk, (шаг)
+ * - replay, <файл записи в каталоге capture_directory>, (скорость), (loop|once)
+ */
+class SignalSourceFactory {
+public:
+    /// Тип параметров источника
+    using TypeParams = const std::vector<std::string>&;
+
+    /// Тип функции создания источника
+    using TypeCreator = std::function<std::shared_ptr<ISignalSource>(TypeParams)>;
+
+    /**
+     * @brief Создает источник сигнала.
+     * @param name Имя источника.
+     * @param params Параметры источника.
+     * @return Источник или nullptr, если источник с таким именем не найден.
+     * @throws std::invalid_argument Если параметры некорректны.
+     */
+    static std::shared_ptr<ISignalSource> create_source(const std::string& name, TypeParams params);
+
+private:
+    /**
+     * @brief Возвращает карту источников (имя -> функция создания).
+     */
+    static const std::unordered_map<std::string, TypeCreator>& get_source_map();
+};
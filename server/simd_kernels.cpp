@@ -0,0 +1,492 @@
+#include "simd_kernels.h"
+
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMD_KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+// Порядок операций с плавающей точкой должен совпадать во всех вариантах ядер,
+// поэтому файл собирается с -ffp-contract=off (см. CMakeLists.txt).
+
+namespace Simd {
+
+namespace {
+
+/**
+ * @brief Таблица реализаций ядер для одного набора инструкций.
+ */
+struct KernelTable {
+    Isa isa;
+    void (*generate_in_range)(float*, size_t, float, float, uint32_t, uint32_t);
+    void (*scale_offset)(const float*, float*, size_t, float, float);
+    Reduction (*reduce)(const float*, size_t);
+    void (*to_fixed)(const float*, int32_t*, size_t, float);
+};
+
+constexpr float unit_scale = 1.0f / 16777216.0f; ///< 2^-24: перевод 24 старших бит хеша в [0, 1)
+constexpr uint32_t hash_mul1 = 0x7feb352dU;
+constexpr uint32_t hash_mul2 = 0x846ca68bU;
+
+/**
+ * @brief 32-битная хеш-функция (lowbias32), основа счетного генератора.
+ */
+inline uint32_t hash32(uint32_t x) {
+    x ^= x >> 16;
+    x *= hash_mul1;
+    x ^= x >> 15;
+    x *= hash_mul2;
+    x ^= x >> 16;
+    return x;
+}
+
+/**
+ * @brief Ключ генератора, производный от зерна.
+ */
+inline uint32_t seed_key(uint32_t seed) {
+    return hash32(seed ^ 0x9e3779b9U);
+}
+
+// ---------------------------------------------------------------------------
+// Скалярные реализации (эталон для всех векторных вариантов)
+// ---------------------------------------------------------------------------
+
+void generate_scalar(float* out, size_t n, float min_value, float max_value, uint32_t seed, uint32_t counter) {
+    const uint32_t key = seed_key(seed);
+    const float span = max_value - min_value;
+    for (size_t i = 0; i != n; ++i) {
+        uint32_t h = hash32((counter + static_cast<uint32_t>(i)) ^ key);
+        float unit = static_cast<float>(static_cast<int32_t>(h >> 8)) * unit_scale;
+        out[i] = min_value + unit * span;
+    }
+}
+
+void scale_offset_scalar(const float* in, float* out, size_t n, float scale, float offset) {
+    for (size_t i = 0; i != n; ++i) {
+        out[i] = in[i] * scale + offset;
+    }
+}
+
+/**
+ * @brief Полосы редукции, общие для всех вариантов.
+ */
+struct ReductionLanes {
+    float min[reduction_lanes];
+    float max[reduction_lanes];
+    float sum[reduction_lanes];
+
+    ReductionLanes() {
+        for (size_t l = 0; l != reduction_lanes; ++l) {
+            min[l] = std::numeric_limits<float>::infinity();
+            max[l] = -std::numeric_limits<float>::infinity();
+            sum[l] = 0.0f;
+        }
+    }
+
+    /**
+     * @brief Добавляет элементы [begin, n) в полосы i % reduction_lanes.
+     *
+     * Сравнения записаны так же, как работают minps/maxps: при NaN остается текущее значение.
+     */
+    void accumulate(const float* in, size_t begin, size_t n) {
+        for (size_t i = begin; i != n; ++i) {
+            const size_t l = i % reduction_lanes;
+            const float x = in[i];
+            min[l] = (x < min[l]) ? x : min[l];
+            max[l] = (x > max[l]) ? x : max[l];
+            sum[l] = sum[l] + x;
+        }
+    }
+
+    /**
+     * @brief Сворачивает полосы в фиксированном порядке.
+     */
+    Reduction fold() const {
+        Reduction result{min[0], max[0], sum[0]};
+        for (size_t l = 1; l != reduction_lanes; ++l) {
+            result.min = (min[l] < result.min) ? min[l] : result.min;
+            result.max = (max[l] > result.max) ? max[l] : result.max;
+            result.sum = result.sum + sum[l];
+        }
+        return result;
+    }
+};
+
+Reduction reduce_scalar(const float* in, size_t n) {
+    ReductionLanes lanes;
+    lanes.accumulate(in, 0, n);
+    return lanes.fold();
+}
+
+void to_fixed_scalar(const float* in, int32_t* out, size_t n, float scale) {
+    for (size_t i = 0; i != n; ++i) {
+        const float v = in[i] * scale;
+        // Поведение совпадает с cvtps2dq: вне диапазона и NaN дают INT32_MIN
+        if (v >= -2147483648.0f && v < 2147483648.0f) {
+            out[i] = static_cast<int32_t>(std::nearbyint(v));
+        } else {
+            out[i] = std::numeric_limits<int32_t>::min();
+        }
+    }
+}
+
+const KernelTable scalar_table = {
+    Isa::Scalar, generate_scalar, scale_offset_scalar, reduce_scalar, to_fixed_scalar
+};
+
+#ifdef SIMD_KERNELS_X86
+
+// ---------------------------------------------------------------------------
+// SSE2
+// ---------------------------------------------------------------------------
+
+/**
+ * @brief Младшие 32 бита произведения (в SSE2 нет pmulld).
+ */
+inline __m128i mullo32_sse2(__m128i a, __m128i b) {
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+inline __m128i hash32_sse2(__m128i x) {
+    x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+    x = mullo32_sse2(x, _mm_set1_epi32(static_cast<int>(hash_mul1)));
+    x = _mm_xor_si128(x, _mm_srli_epi32(x, 15));
+    x = mullo32_sse2(x, _mm_set1_epi32(static_cast<int>(hash_mul2)));
+    x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+    return x;
+}
+
+void generate_sse2(float* out, size_t n, float min_value, float max_value, uint32_t seed, uint32_t counter) {
+    const __m128i key = _mm_set1_epi32(static_cast<int>(seed_key(seed)));
+    const __m128 span = _mm_set1_ps(max_value - min_value);
+    const __m128 base = _mm_set1_ps(min_value);
+    const __m128 unit = _mm_set1_ps(unit_scale);
+    __m128i index = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(counter)), _mm_setr_epi32(0, 1, 2, 3));
+    const __m128i step = _mm_set1_epi32(4);
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i h = hash32_sse2(_mm_xor_si128(index, key));
+        __m128 u = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(h, 8)), unit);
+        _mm_storeu_ps(out + i, _mm_add_ps(base, _mm_mul_ps(u, span)));
+        index = _mm_add_epi32(index, step);
+    }
+    generate_scalar(out + i, n - i, min_value, max_value, seed, counter + static_cast<uint32_t>(i));
+}
+
+void scale_offset_sse2(const float* in, float* out, size_t n, float scale, float offset) {
+    const __m128 s = _mm_set1_ps(scale);
+    const __m128 o = _mm_set1_ps(offset);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(in + i), s), o));
+    }
+    scale_offset_scalar(in + i, out + i, n - i, scale, offset);
+}
+
+Reduction reduce_sse2(const float* in, size_t n) {
+    ReductionLanes lanes;
+    __m128 mn[4], mx[4], sm[4];
+    for (int r = 0; r != 4; ++r) {
+        mn[r] = _mm_loadu_ps(lanes.min + 4 * r);
+        mx[r] = _mm_loadu_ps(lanes.max + 4 * r);
+        sm[r] = _mm_loadu_ps(lanes.sum + 4 * r);
+    }
+    size_t i = 0;
+    for (; i + reduction_lanes <= n; i += reduction_lanes) {
+        for (int r = 0; r != 4; ++r) {
+            __m128 x = _mm_loadu_ps(in + i + 4 * r);
+            mn[r] = _mm_min_ps(x, mn[r]);
+            mx[r] = _mm_max_ps(x, mx[r]);
+            sm[r] = _mm_add_ps(sm[r], x);
+        }
+    }
+    for (int r = 0; r != 4; ++r) {
+        _mm_storeu_ps(lanes.min + 4 * r, mn[r]);
+        _mm_storeu_ps(lanes.max + 4 * r, mx[r]);
+        _mm_storeu_ps(lanes.sum + 4 * r, sm[r]);
+    }
+    lanes.accumulate(in, i, n);
+    return lanes.fold();
+}
+
+void to_fixed_sse2(const float* in, int32_t* out, size_t n, float scale) {
+    const __m128 s = _mm_set1_ps(scale);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i q = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(in + i), s));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), q);
+    }
+    to_fixed_scalar(in + i, out + i, n - i, scale);
+}
+
+const KernelTable sse2_table = {
+    Isa::Sse2, generate_sse2, scale_offset_sse2, reduce_sse2, to_fixed_sse2
+};
+
+// ---------------------------------------------------------------------------
+// AVX2
+// ---------------------------------------------------------------------------
+
+__attribute__((target("avx2")))
+inline __m256i hash32_avx2(__m256i x) {
+    x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+    x = _mm256_mullo_epi32(x, _mm256_set1_epi32(static_cast<int>(hash_mul1)));
+    x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 15));
+    x = _mm256_mullo_epi32(x, _mm256_set1_epi32(static_cast<int>(hash_mul2)));
+    x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+    return x;
+}
+
+__attribute__((target("avx2")))
+void generate_avx2(float* out, size_t n, float min_value, float max_value, uint32_t seed, uint32_t counter) {
+    const __m256i key = _mm256_set1_epi32(static_cast<int>(seed_key(seed)));
+    const __m256 span = _mm256_set1_ps(max_value - min_value);
+    const __m256 base = _mm256_set1_ps(min_value);
+    const __m256 unit = _mm256_set1_ps(unit_scale);
+    __m256i index = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(counter)), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    const __m256i step = _mm256_set1_epi32(8);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i h = hash32_avx2(_mm256_xor_si256(index, key));
+        __m256 u = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(h, 8)), unit);
+        _mm256_storeu_ps(out + i, _mm256_add_ps(base, _mm256_mul_ps(u, span)));
+        index = _mm256_add_epi32(index, step);
+    }
+    generate_scalar(out + i, n - i, min_value, max_value, seed, counter + static_cast<uint32_t>(i));
+}
+
+__attribute__((target("avx2")))
+void scale_offset_avx2(const float* in, float* out, size_t n, float scale, float offset) {
+    const __m256 s = _mm256_set1_ps(scale);
+    const __m256 o = _mm256_set1_ps(offset);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(in + i), s), o));
+    }
+    scale_offset_scalar(in + i, out + i, n - i, scale, offset);
+}
+
+__attribute__((target("avx2")))
+Reduction reduce_avx2(const float* in, size_t n) {
+    ReductionLanes lanes;
+    __m256 mn[2], mx[2], sm[2];
+    for (int r = 0; r != 2; ++r) {
+        mn[r] = _mm256_loadu_ps(lanes.min + 8 * r);
+        mx[r] = _mm256_loadu_ps(lanes.max + 8 * r);
+        sm[r] = _mm256_loadu_ps(lanes.sum + 8 * r);
+    }
+    size_t i = 0;
+    for (; i + reduction_lanes <= n; i += reduction_lanes) {
+        for (int r = 0; r != 2; ++r) {
+            __m256 x = _mm256_loadu_ps(in + i + 8 * r);
+            mn[r] = _mm256_min_ps(x, mn[r]);
+            mx[r] = _mm256_max_ps(x, mx[r]);
+            sm[r] = _mm256_add_ps(sm[r], x);
+        }
+    }
+    for (int r = 0; r != 2; ++r) {
+        _mm256_storeu_ps(lanes.min + 8 * r, mn[r]);
+        _mm256_storeu_ps(lanes.max + 8 * r, mx[r]);
+        _mm256_storeu_ps(lanes.sum + 8 * r, sm[r]);
+    }
+    lanes.accumulate(in, i, n);
+    return lanes.fold();
+}
+
+__attribute__((target("avx2")))
+void to_fixed_avx2(const float* in, int32_t* out, size_t n, float scale) {
+    const __m256 s = _mm256_set1_ps(scale);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i q = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_loadu_ps(in + i), s));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), q);
+    }
+    to_fixed_scalar(in + i, out + i, n - i, scale);
+}
+
+const KernelTable avx2_table = {
+    Isa::Avx2, generate_avx2, scale_offset_avx2, reduce_avx2, to_fixed_avx2
+};
+
+// ---------------------------------------------------------------------------
+// AVX-512F
+// ---------------------------------------------------------------------------
+
+__attribute__((target("avx512f")))
+inline __m512i hash32_avx512(__m512i x) {
+    x = _mm512_xor_si512(x, _mm512_srli_epi32(x, 16));
+    x = _mm512_mullo_epi32(x, _mm512_set1_epi32(static_cast<int>(hash_mul1)));
+    x = _mm512_xor_si512(x, _mm512_srli_epi32(x, 15));
+    x = _mm512_mullo_epi32(x, _mm512_set1_epi32(static_cast<int>(hash_mul2)));
+    x = _mm512_xor_si512(x, _mm512_srli_epi32(x, 16));
+    return x;
+}
+
+__attribute__((target("avx512f")))
+void generate_avx512(float* out, size_t n, float min_value, float max_value, uint32_t seed, uint32_t counter) {
+    const __m512i key = _mm512_set1_epi32(static_cast<int>(seed_key(seed)));
+    const __m512 span = _mm512_set1_ps(max_value - min_value);
+    const __m512 base = _mm512_set1_ps(min_value);
+    const __m512 unit = _mm512_set1_ps(unit_scale);
+    __m512i index = _mm512_add_epi32(_mm512_set1_epi32(static_cast<int>(counter)),
+        _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+    const __m512i step = _mm512_set1_epi32(16);
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512i h = hash32_avx512(_mm512_xor_si512(index, key));
+        __m512 u = _mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_srli_epi32(h, 8)), unit);
+        _mm512_storeu_ps(out + i, _mm512_add_ps(base, _mm512_mul_ps(u, span)));
+        index = _mm512_add_epi32(index, step);
+    }
+    generate_scalar(out + i, n - i, min_value, max_value, seed, counter + static_cast<uint32_t>(i));
+}
+
+__attribute__((target("avx512f")))
+void scale_offset_avx512(const float* in, float* out, size_t n, float scale, float offset) {
+    const __m512 s = _mm512_set1_ps(scale);
+    const __m512 o = _mm512_set1_ps(offset);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm512_storeu_ps(out + i, _mm512_add_ps(_mm512_mul_ps(_mm512_loadu_ps(in + i), s), o));
+    }
+    scale_offset_scalar(in + i, out + i, n - i, scale, offset);
+}
+
+__attribute__((target("avx512f")))
+Reduction reduce_avx512(const float* in, size_t n) {
+    ReductionLanes lanes;
+    __m512 mn = _mm512_loadu_ps(lanes.min);
+    __m512 mx = _mm512_loadu_ps(lanes.max);
+    __m512 sm = _mm512_loadu_ps(lanes.sum);
+    size_t i = 0;
+    for (; i + reduction_lanes <= n; i += reduction_lanes) {
+        __m512 x = _mm512_loadu_ps(in + i);
+        mn = _mm512_min_ps(x, mn);
+        mx = _mm512_max_ps(x, mx);
+        sm = _mm512_add_ps(sm, x);
+    }
+    _mm512_storeu_ps(lanes.min, mn);
+    _mm512_storeu_ps(lanes.max, mx);
+    _mm512_storeu_ps(lanes.sum, sm);
+    lanes.accumulate(in, i, n);
+    return lanes.fold();
+}
+
+__attribute__((target("avx512f")))
+void to_fixed_avx512(const float* in, int32_t* out, size_t n, float scale) {
+    const __m512 s = _mm512_set1_ps(scale);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512i q = _mm512_cvtps_epi32(_mm512_mul_ps(_mm512_loadu_ps(in + i), s));
+        _mm512_storeu_si512(out + i, q);
+    }
+    to_fixed_scalar(in + i, out + i, n - i, scale);
+}
+
+const KernelTable avx512_table = {
+    Isa::Avx512, generate_avx512, scale_offset_avx512, reduce_avx512, to_fixed_avx512
+};
+
+#endif // SIMD_KERNELS_X86
+
+/**
+ * @brief Возвращает таблицу ядер для набора инструкций.
+ */
+const KernelTable* table_for(Isa isa) {
+    switch (isa) {
+#ifdef SIMD_KERNELS_X86
+    case Isa::Sse2: return &sse2_table;
+    case Isa::Avx2: return &avx2_table;
+    case Isa::Avx512: return &avx512_table;
+#endif
+    default: return &scalar_table;
+    }
+}
+
+/**
+ * @brief Выбирает наилучший поддерживаемый набор инструкций.
+ */
+const KernelTable* detect_best() {
+    for (Isa isa : {Isa::Avx512, Isa::Avx2, Isa::Sse2}) {
+        if (is_supported(isa)) {
+            return table_for(isa);
+        }
+    }
+    return &scalar_table;
+}
+
+/**
+ * @brief Активная таблица ядер (выбирается при первом обращении).
+ */
+std::atomic<const KernelTable*>& active_table() {
+    static std::atomic<const KernelTable*> table{detect_best()};
+    return table;
+}
+
+}
+
+void generate_in_range(float* out, size_t n, float min_value, float max_value, uint32_t seed, uint32_t counter) {
+    active_table().load(std::memory_order_relaxed)->generate_in_range(out, n, min_value, max_value, seed, counter);
+}
+
+void scale_offset(const float* in, float* out, size_t n, float scale, float offset) {
+    active_table().load(std::memory_order_relaxed)->scale_offset(in, out, n, scale, offset);
+}
+
+Reduction reduce(const float* in, size_t n) {
+    return active_table().load(std::memory_order_relaxed)->reduce(in, n);
+}
+
+void to_fixed(const float* in, int32_t* out, size_t n, float scale) {
+    active_table().load(std::memory_order_relaxed)->to_fixed(in, out, n, scale);
+}
+
+Isa get_isa() {
+    return active_table().load(std::memory_order_relaxed)->isa;
+}
+
+bool is_supported(Isa isa) {
+    switch (isa) {
+    case Isa::Scalar:
+        return true;
+#ifdef SIMD_KERNELS_X86
+    case Isa::Sse2:
+        return __builtin_cpu_supports("sse2");
+    case Isa::Avx2:
+        return __builtin_cpu_supports("avx2");
+    case Isa::Avx512:
+        return __builtin_cpu_supports("avx512f");
+#endif
+    default:
+        return false;
+    }
+}
+
+void set_isa(Isa isa) {
+    if (!is_supported(isa)) {
+        throw std::invalid_argument("ISA is not supported: " + to_string(isa));
+    }
+    active_table().store(table_for(isa), std::memory_order_relaxed);
+}
+
+std::string to_string(Isa isa) {
+    switch (isa) {
+    case Isa::Scalar: return "scalar";
+    case Isa::Sse2: return "sse2";
+    case Isa::Avx2: return "avx2";
+    case Isa::Avx512: return "avx512";
+    }
+    return "unknown";
+}
+
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @namespace Simd
+ * @brief Векторные ядра для пакетной обработки значений.
+ *
+ * Каждое ядро реализовано в скалярном варианте и в вариантах SSE2, AVX2 и AVX-512.
+ * Подходящий вариант выбирается один раз при запуске по CPUID. Все варианты дают
+ * побитово одинаковый результат: порядок операций с плавающей точкой зафиксирован
+ * (16 логических полос для редукций, без слияния умножения со сложением).
+ */
+namespace Simd {
+
+/**
+ * @enum Isa
+ * @brief Набор инструкций, используемый ядрами.
+ */
+enum class Isa : int {
+    Scalar, ///< Скалярная реализация
+    Sse2,   ///< SSE2
+    Avx2,   ///< AVX2
+    Avx512  ///< AVX-512F
+};
+
+/**
+ * @struct Reduction
+ * @brief Результат редукции: минимум, максимум и сумма.
+ */
+struct Reduction {
+    float min; ///< Минимальное значение (+inf для пустого массива)
+    float max; ///< Максимальное значение (-inf для пустого массива)
+    float sum; ///< Сумма значений
+};
+
+/// Количество логических полос редукции, одинаковое для всех наборов инструкций
+constexpr size_t reduction_lanes = 16;
+
+/**
+ * @brief Генерирует равномерно распределенные значения в диапазоне [min_value, max_value).
+ *
+ * Используется счетный (counter-based) генератор: значение с номером i зависит только
+ * от seed и counter + i, поэтому блок можно генерировать любыми порциями.
+ *
+ * @param out Выходной массив.
+ * @param n Количество значений.
+ * @param min_value Нижняя граница диапазона.
+ * @param max_value Верхняя граница диапазона.
+ * @param seed Зерно генератора.
+ * @param counter Номер первого значения в последовательности.
+ */
+void generate_in_range(float* out, size_t n, float min_value, float max_value, uint32_t seed, uint32_t counter);
+
+/**
+ * @brief Линейное преобразование out[i] = in[i] * scale + offset.
+ *
+ * Допускается in == out.
+ */
+void scale_offset(const float* in, float* out, size_t n, float scale, float offset);
+
+/**
+ * @brief Вычисляет минимум, максимум и сумму массива.
+ *
+ * Элемент с номером i накапливается в полосе i % reduction_lanes, полосы
+ * сворачиваются последовательно. NaN игнорируются при поиске минимума и максимума.
+ */
+Reduction reduce(const float* in, size_t n);
+
+/**
+ * @brief Подготовка к форматированию: перевод в число с фиксированной точкой.
+ *
+ * out[i] = round(in[i] * scale) с округлением к ближайшему четному. Значения вне
+ * диапазона int32 и NaN дают INT32_MIN.
+ *
+ * @param in Входной массив.
+ * @param out Выходной массив.
+ * @param n Количество значений.
+ * @param scale Масштаб (например, 10^precision).
+ */
+void to_fixed(const float* in, int32_t* out, size_t n, float scale);
+
+/**
+ * @brief Возвращает используемый набор инструкций.
+ */
+Isa get_isa();
+
+/**
+ * @brief Проверяет, поддерживает ли процессор набор инструкций.
+ */
+bool is_supported(Isa isa);
+
+/**
+ * @brief Принудительно выбирает набор инструкций (для проверок и бенчмарков).
+ * @throws std::invalid_argument Если набор не поддерживается процессором.
+ */
+void set_isa(Isa isa);
+
+/**
+ * @brief Возвращает имя набора инструкций.
+ */
+std::string to_string(Isa isa);
+
+}
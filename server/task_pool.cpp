@@ -1,5 +1,6 @@
 #include "task_pool.h"
 #include "logger.h"
+#include "tracing.h"
 
 #include <vector>
 #include <functional>
@@ -14,7 +15,11 @@
  * Создает пул потоков, каждый из которых будет выполнять метод worker_thread.
  * @param num_threads Количество потоков для создания в пуле.
  */
-TaskPool::TaskPool(size_t num_threads) {
+TaskPool::TaskPool(size_t num_threads)
+    : queue_depth(Metrics::registry().gauge("multimeter_pool_queue_depth", "Tasks waiting in the task pool queue")),
+      queue_wait(Metrics::registry().duration_histogram("multimeter_pool_queue_wait_seconds",
+                                                        "Time from enqueue to the start of a task")),
+      tasks_started(Metrics::registry().counter("multimeter_pool_tasks_total", "Tasks started by the task pool")) {
     for (size_t i = 0; i < num_threads; ++i) {
         workers.emplace_back([this] { worker_thread(); });
     }
@@ -40,7 +45,7 @@ TaskPool::~TaskPool() {
  * Устанавливает флаг остановки и уведомляет все потоки, чтобы они завершили выполнение.
  */
 void TaskPool::stop_pool() {
-    std::unique_lock<std::mutex> lock(queue_mutex); 
+    InstrumentedUniqueLock lock(queue_mutex); 
     stop.store(true);  ///< Устанавливаем флаг остановки
     cond_var.notify_all();  ///< Уведомляем все потоки, чтобы они завершили работу
 }
@@ -53,9 +58,11 @@ void TaskPool::stop_pool() {
  */
 void TaskPool::enqueue(std::function<void()> task) {
     {
-        std::unique_lock<std::mutex> lock(queue_mutex);
+        InstrumentedUniqueLock lock(queue_mutex);
         if (!stop.load()) {
-            tasks.push(std::move(task));  ///< Добавляем задачу в очередь
+            tasks.push({std::move(task), Metrics::now_ns()});  ///< Добавляем задачу в очередь
+            queue_depth.add(1);
+            queued.fetch_add(1, std::memory_order_relaxed);
         }
         cond_var.notify_one();  ///< Уведомляем один из потоков, что задача появилась
     }
@@ -68,10 +75,11 @@ void TaskPool::enqueue(std::function<void()> task) {
  * Рабочий поток завершит свою работу, если пул будет остановлен и очередь задач станет пустой.
  */
 void TaskPool::worker_thread() {
+    Tracer::get_instance().set_thread_name("pool");
     while (true) {
-        std::function<void()> task;
+        QueuedTask task;
         {
-            std::unique_lock<std::mutex> lock(queue_mutex);
+            InstrumentedUniqueLock lock(queue_mutex);
             cond_var.wait(lock, [this] { return stop || !tasks.empty(); });  ///< Ожидаем задачи или сигнала об остановке
 
             if (stop && tasks.empty()) {
@@ -82,8 +90,16 @@ void TaskPool::worker_thread() {
             if (!tasks.empty()) {
                 task = std::move(tasks.front());  ///< Извлекаем задачу из очереди
                 tasks.pop();  ///< Убираем задачу из очереди
+                queue_depth.add(-1);
+                queued.fetch_sub(1, std::memory_order_relaxed);
             }
         }
-        task();  ///< Выполняем задачу
+        const int64_t started_ns = Metrics::now_ns();
+        queue_wait.record(started_ns - task.enqueued_ns);
+        if (Tracer::is_enabled()) {
+            Tracer::get_instance().record("pool_wait", "pool", task.enqueued_ns, started_ns, -1);
+        }
+        tasks_started.add();
+        task.task();  ///< Выполняем задачу
     }
 }
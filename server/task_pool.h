@@ -7,6 +7,9 @@
 #include <functional>
 #include <atomic>
 #include <memory>
+#include <cstdint>
+#include "lock_stats.h"
+#include "metrics.h"
 
 /**
  * @class TaskPool
@@ -14,6 +17,7 @@
  *
  * Этот класс позволяет выполнять задачи параллельно с использованием пула потоков. 
  * Он управляет очередью задач и синхронизирует доступ к ней с помощью мьютексов и условных переменных.
+ * Длина очереди и время ожидания задачи в очереди выгружаются в метрики.
  */
 class TaskPool {
 public:
@@ -47,6 +51,12 @@ public:
      */
     void enqueue(std::function<void()> task);
 
+    /**
+     * @brief Проверяет, ждут ли задачи в очереди.
+     * @return true, если в очереди есть задачи, которые еще не начали выполняться.
+     */
+    bool has_queued_tasks() const { return queued.load(std::memory_order_relaxed) != 0; }
+
 private:
     /**
      * @brief Рабочий поток, который выполняет задачи из очереди.
@@ -56,9 +66,22 @@ private:
      */
     void worker_thread();
 
+    /**
+     * @struct QueuedTask
+     * @brief Задача в очереди.
+     */
+    struct QueuedTask {
+        std::function<void()> task; ///< Задача
+        int64_t enqueued_ns = 0; ///< Время постановки в очередь (Metrics::now_ns)
+    };
+
+    Gauge& queue_depth; ///< Метрика: длина очереди
+    Histogram& queue_wait; ///< Метрика: время от постановки задачи до начала выполнения
+    Counter& tasks_started; ///< Метрика: количество выполненных задач
     std::vector<std::thread> workers; ///< Вектор потоков пула
-    std::queue<std::function<void()>> tasks; ///< Очередь задач
-    std::mutex queue_mutex; ///< Мьютекс для синхронизации доступа к очереди
-    std::condition_variable cond_var; ///< Условная переменная для ожидания задач
+    std::queue<QueuedTask> tasks; ///< Очередь задач
+    InstrumentedMutex queue_mutex{"task_pool.queue"}; ///< Мьютекс для синхронизации доступа к очереди
+    InstrumentedConditionVariable cond_var; ///< Условная переменная для ожидания задач
     std::atomic<bool> stop = false; ///< Флаг для остановки пула
+    std::atomic<size_t> queued{0}; ///< Количество задач в очереди
 };
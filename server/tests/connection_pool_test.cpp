@@ -0,0 +1,146 @@
+#include "multimeter.h"
+#include "logger.h"
+#include "connection_pool.h"
+
+#include <stdlib.h>
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <future>
+#include <iostream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @file connection_pool_test.cpp
+ * @brief Проверка пула соединений клиента против сервера, у которого потоков меньше, чем соединений.
+ *
+ * Сервер запускается в этом же процессе на временном сокете (во временном каталоге,
+ * выгрузка метрик отключена). Пул открывает больше соединений, чем потоков у сервера,
+ * несколько потоков отправляют через него команды ping, затем пул несколько раз
+ * проверяет простаивающие соединения. Все команды и проверки должны получить ответ:
+ * сервер не должен закреплять поток за соединением. Код возврата 1 - проверка не прошла.
+ */
+
+namespace {
+
+constexpr size_t server_threads = 2; ///< Потоки пула сервера
+constexpr size_t pool_size = 6; ///< Соединения пула клиента
+constexpr size_t sender_count = 4; ///< Потоки, отправляющие команды
+constexpr size_t requests_per_sender = 500; ///< Команд на поток
+constexpr auto response_timeout = std::chrono::seconds(5); ///< Срок ответа на команду
+
+/**
+ * @brief Буфер потока вывода, отбрасывающий все данные.
+ */
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+int failures = 0; ///< Количество не прошедших проверок
+
+/**
+ * @brief Учитывает результат проверки.
+ */
+void check(bool ok, const std::string& what) {
+    std::printf("%s: %s\n", ok ? "ok" : "FAILED", what.c_str());
+    if (!ok) {
+        ++failures;
+    }
+}
+
+/**
+ * @brief Отправляет команды ping через пул и сверяет ответы.
+ * @return Количество неверных ответов и ответов, не полученных в срок.
+ */
+size_t send_pings(ConnectionPool& pool, size_t sender) {
+    std::vector<std::future<std::string>> responses;
+    std::vector<std::string> tokens;
+    for (size_t i = 0; i != requests_per_sender; ++i) {
+        tokens.push_back(std::to_string(sender) + "-" + std::to_string(i));
+        responses.push_back(pool.send("ping " + tokens.back()));
+    }
+    size_t errors = 0;
+    for (size_t i = 0; i != responses.size(); ++i) {
+        if (responses[i].wait_for(response_timeout) != std::future_status::ready) {
+            ++errors;
+            continue;
+        }
+        try {
+            if (responses[i].get() != "ok, " + tokens[i]) {
+                ++errors;
+            }
+        } catch (const std::exception&) {
+            ++errors;
+        }
+    }
+    return errors;
+}
+
+} // namespace
+
+int main() {
+    // Сокет и хранилище значений сервера - во временном каталоге
+    char directory_template[] = "/tmp/multimeter_pool_test_XXXXXX";
+    if (!mkdtemp(directory_template)) {
+        std::perror("mkdtemp");
+        return 1;
+    }
+    const std::filesystem::path directory = directory_template;
+    std::filesystem::current_path(directory);
+    const std::string socket_path = (directory / "socket").string();
+
+    NullBuffer null_buffer;
+    std::streambuf* saved = std::cout.rdbuf(&null_buffer);
+    {
+        Multimeter multimeter(socket_path, server_threads, 4);
+        multimeter.set_metrics_socket_path("");
+        std::thread server([&multimeter] { multimeter.run(); });
+        const auto started = std::chrono::steady_clock::now();
+        while (!std::filesystem::exists(socket_path) && std::chrono::steady_clock::now() - started < response_timeout) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        ConnectionPoolOptions options;
+        options.size = pool_size;
+        options.ping_interval_ms = 50;
+        options.ping_timeout_ms = 1000;
+        ConnectionPool pool(socket_path, options);
+        check(pool.start() == pool_size, "all " + std::to_string(pool_size) + " connections are open");
+
+        std::vector<std::future<size_t>> senders;
+        for (size_t s = 0; s != sender_count; ++s) {
+            senders.push_back(std::async(std::launch::async, [&pool, s] { return send_pings(pool, s); }));
+        }
+        size_t errors = 0;
+        for (auto& sender : senders) {
+            errors += sender.get();
+        }
+        check(errors == 0, std::to_string(sender_count * requests_per_sender) + " commands over " +
+                           std::to_string(pool_size) + " connections to " + std::to_string(server_threads) +
+                           " server threads, unanswered or wrong: " + std::to_string(errors));
+
+        // Несколько периодов проверки простаивающих соединений
+        std::this_thread::sleep_for(std::chrono::milliseconds(options.ping_timeout_ms + 4 * options.ping_interval_ms));
+        const ConnectionPoolStats stats = pool.get_stats();
+        check(stats.connected == pool_size, "connections stay open: " + std::to_string(stats.connected));
+        check(stats.failed_pings == 0, "failed pings: " + std::to_string(stats.failed_pings));
+
+        pool.stop();
+        multimeter.stop();
+        server.join();
+    }
+
+    while (ThreadSafeLogger::get_instance().get_backlog() != 0) {
+        std::this_thread::yield();
+    }
+    std::cout.rdbuf(saved);
+    std::filesystem::current_path("/");
+    std::filesystem::remove_all(directory);
+    return failures ? 1 : 0;
+}
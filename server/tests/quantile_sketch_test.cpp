@@ -0,0 +1,179 @@
+#include "quantile_sketch.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @file quantile_sketch_test.cpp
+ * @brief Проверка точности скетча квантилей KLL и слияния корзин скользящего окна.
+ *
+ * В скетч добавляется перестановка чисел 0..n-1, поэтому истинный ранг оценки
+ * равен ей самой. Ошибка ранга на наборе долей должна оставаться в пределах
+ * порядка 1/k, доли 0 и 1 - давать точные минимум и максимум. Те же значения,
+ * разложенные по нескольким скетчам и слитые, должны давать ту же точность.
+ * Для скользящего окна ChannelQuantiles проверяется, что сводка сливает все
+ * корзины окна и перестает учитывать корзины, вышедшие из окна.
+ * Код возврата 1 - проверка не прошла.
+ */
+
+namespace {
+
+constexpr size_t sketch_k = 128; ///< Параметр точности скетча
+constexpr size_t value_count = 100000; ///< Значений в скетче
+constexpr size_t part_count = 20; ///< Скетчей, на которые раскладываются значения для слияния
+constexpr double rank_error_bound = 2.0 / sketch_k; ///< Допустимая ошибка ранга
+constexpr int64_t second_ns = 1000000000LL; ///< Секунда (нс)
+constexpr int64_t window_period_ns = 1000000; ///< Период значений в проверке окна
+const std::vector<double> fractions = {0.01, 0.05, 0.1, 0.25, 0.5, 0.75, 0.9, 0.95, 0.99}; ///< Проверяемые доли
+
+/**
+ * @brief Буфер потока вывода, отбрасывающий все данные.
+ */
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+int failures = 0; ///< Количество не прошедших проверок
+
+/**
+ * @brief Учитывает результат проверки.
+ */
+void check(bool ok, const std::string& what) {
+    std::printf("%s: %s\n", ok ? "ok" : "FAILED", what.c_str());
+    if (!ok) {
+        ++failures;
+    }
+}
+
+/**
+ * @brief Возвращает числа first..last-1 в случайном (воспроизводимом) порядке.
+ */
+std::vector<float> shuffled_range(size_t first, size_t last, uint32_t seed) {
+    std::vector<float> values;
+    for (size_t i = first; i != last; ++i) {
+        values.push_back(static_cast<float>(i));
+    }
+    std::mt19937 random(seed);
+    for (size_t i = values.size(); i > 1; --i) {
+        std::swap(values[i - 1], values[random() % i]);
+    }
+    return values;
+}
+
+/**
+ * @brief Наибольшая ошибка ранга оценок квантилей значений first..last-1.
+ */
+double max_rank_error(const KllSketch& sketch, size_t first, size_t last) {
+    const std::vector<float> estimates = sketch.quantiles(fractions);
+    const double total = static_cast<double>(last - first);
+    double worst = 0.0;
+    for (size_t i = 0; i != fractions.size(); ++i) {
+        double rank = (estimates[i] - static_cast<double>(first) + 1.0) / total;
+        worst = std::max(worst, std::fabs(rank - fractions[i]));
+    }
+    return worst;
+}
+
+/**
+ * @brief Проверяет точность одного скетча и слияния скетчей.
+ */
+void check_sketch() {
+    const std::vector<float> values = shuffled_range(0, value_count, 1);
+
+    KllSketch sketch(sketch_k);
+    for (float value : values) {
+        sketch.add(value);
+    }
+    check(sketch.count() == value_count, "count " + std::to_string(sketch.count()));
+    check(sketch.retained() <= 3 * sketch_k + 64, "retained " + std::to_string(sketch.retained()) +
+                                                  " values of " + std::to_string(value_count));
+    const std::vector<float> bounds = sketch.quantiles({0.0, 1.0});
+    check(bounds[0] == 0.0f && bounds[1] == static_cast<float>(value_count - 1),
+          "quantiles 0 and 1 are the exact min and max");
+    double error = max_rank_error(sketch, 0, value_count);
+    check(error <= rank_error_bound, "single sketch rank error " + std::to_string(error));
+
+    std::vector<KllSketch> parts(part_count, KllSketch(sketch_k));
+    for (size_t i = 0; i != values.size(); ++i) {
+        parts[i % part_count].add(values[i]);
+    }
+    KllSketch merged(sketch_k);
+    for (const auto& part : parts) {
+        merged.merge(part);
+    }
+    check(merged.count() == value_count, "merged count " + std::to_string(merged.count()));
+    check(merged.retained() <= 3 * sketch_k + 64, "merged retained " + std::to_string(merged.retained()));
+    const std::vector<float> merged_bounds = merged.quantiles({0.0, 1.0});
+    check(merged_bounds[0] == 0.0f && merged_bounds[1] == static_cast<float>(value_count - 1),
+          "merged quantiles 0 and 1 are the exact min and max");
+    error = max_rank_error(merged, 0, value_count);
+    check(error <= rank_error_bound, "merge of " + std::to_string(part_count) + " sketches rank error " +
+                                     std::to_string(error));
+}
+
+/**
+ * @brief Проверяет слияние корзин скользящего окна 10s.
+ *
+ * За 10 секунд (по корзине на секунду) в окно добавляются значения: в первые
+ * 5 секунд - 0..4999, в последние 5 секунд - 5000..9999. Пока все корзины в окне,
+ * сводка оценивает все значения; через 5 секунд после последнего значения
+ * в окне остаются только корзины второй половины.
+ */
+void check_window() {
+    const size_t half = 5 * second_ns / window_period_ns;
+    std::vector<float> values = shuffled_range(0, half, 2);
+    const std::vector<float> second_half = shuffled_range(half, 2 * half, 3);
+    values.insert(values.end(), second_half.begin(), second_half.end());
+
+    ChannelQuantiles quantiles;
+    const int64_t start = 1000 * second_ns;
+    for (size_t i = 0; i != values.size(); ++i) {
+        quantiles.add_sample(start + static_cast<int64_t>(i) * window_period_ns, values[i]);
+    }
+
+    KllSketch summary;
+    const int64_t last = start + static_cast<int64_t>(values.size() - 1) * window_period_ns;
+    check(quantiles.get_summary("10s", last, summary), "window 10s exists");
+    check(summary.count() == values.size(), "all 10 buckets merged: count " + std::to_string(summary.count()));
+    std::vector<float> bounds = summary.quantiles({0.0, 1.0});
+    check(bounds[0] == 0.0f && bounds[1] == static_cast<float>(2 * half - 1), "window min and max over all buckets");
+    double error = max_rank_error(summary, 0, 2 * half);
+    check(error <= rank_error_bound, "window rank error over all buckets " + std::to_string(error));
+
+    quantiles.get_summary("10s", last + 5 * second_ns, summary);
+    check(summary.count() == half, "expired buckets dropped: count " + std::to_string(summary.count()));
+    bounds = summary.quantiles({0.0, 1.0});
+    check(bounds[0] == static_cast<float>(half) && bounds[1] == static_cast<float>(2 * half - 1),
+          "window min and max over the remaining buckets");
+    error = max_rank_error(summary, half, 2 * half);
+    check(error <= rank_error_bound, "window rank error over the remaining buckets " + std::to_string(error));
+
+    quantiles.get_summary("10s", last + 10 * second_ns, summary);
+    check(summary.count() == 0, "window is empty after 10s without values");
+}
+
+} // namespace
+
+int main() {
+    NullBuffer null_buffer;
+    std::streambuf* saved = std::cout.rdbuf(&null_buffer);
+
+    check_sketch();
+    check_window();
+
+    while (ThreadSafeLogger::get_instance().get_backlog() != 0) {
+        std::this_thread::yield();
+    }
+    std::cout.rdbuf(saved);
+    return failures ? 1 : 0;
+}
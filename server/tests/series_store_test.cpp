@@ -0,0 +1,356 @@
+#include "series_store.h"
+#include "gorilla.h"
+#include "sample_quantizer.h"
+#include "logger.h"
+
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @file series_store_test.cpp
+ * @brief Проверка сжатия Gorilla и восстановления файлов хранилища значений.
+ *
+ * Проверяются точность распаковки (побитово для float, по кодам для значений
+ * с фиксированной точкой), размер сжатых значений на типичных сигналах,
+ * отбрасывание блока с неверной CRC и восстановление файла, обрезанного
+ * посреди блока (уцелевшие значения и индекс). Файлы создаются во временном
+ * каталоге. Код возврата 1 - проверка не прошла.
+ */
+
+namespace {
+
+constexpr int64_t start_ns = 1700000000LL * 1000000000LL; ///< Время первого значения
+constexpr int64_t period_ns = 1000000; ///< Период равномерной сетки
+constexpr size_t chunk_samples = 4096; ///< Значений в блоке файла
+constexpr size_t chunk_count = 3; ///< Блоков в файле
+
+/**
+ * @brief Буфер потока вывода, отбрасывающий все данные.
+ */
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+int failures = 0; ///< Количество не прошедших проверок
+
+/**
+ * @brief Учитывает результат проверки.
+ */
+void check(bool ok, const std::string& what) {
+    std::printf("%s: %s\n", ok ? "ok" : "FAILED", what.c_str());
+    if (!ok) {
+        ++failures;
+    }
+}
+
+/**
+ * @struct Samples
+ * @brief Последовательность значений.
+ */
+struct Samples {
+    std::vector<int64_t> timestamps;
+    std::vector<float> values;
+};
+
+uint32_t float_bits(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+/**
+ * @brief Сжимает значения и возвращает поток.
+ */
+std::vector<uint8_t> encode(const Samples& samples, int precision) {
+    GorillaEncoder encoder;
+    encoder.reset(precision);
+    for (size_t i = 0; i != samples.timestamps.size(); ++i) {
+        encoder.append(samples.timestamps[i], samples.values[i]);
+    }
+    return encoder.finish();
+}
+
+/**
+ * @brief Распаковывает поток.
+ */
+Samples decode(const std::vector<uint8_t>& data, size_t count, int precision) {
+    Samples result;
+    GorillaDecoder decoder(data.data(), data.size(), count, precision);
+    int64_t timestamp_ns;
+    float value;
+    while (decoder.next(timestamp_ns, value)) {
+        result.timestamps.push_back(timestamp_ns);
+        result.values.push_back(value);
+    }
+    return result;
+}
+
+/**
+ * @brief Сравнивает значения побитово (float) или по кодам (фиксированная точка).
+ */
+bool same_samples(const Samples& expected, const Samples& actual, int precision) {
+    if (expected.timestamps != actual.timestamps || expected.values.size() != actual.values.size()) {
+        return false;
+    }
+    for (size_t i = 0; i != expected.values.size(); ++i) {
+        const bool same = precision < 0
+            ? float_bits(expected.values[i]) == float_bits(actual.values[i])
+            : SampleQuantizer::to_code(expected.values[i], precision) == SampleQuantizer::to_code(actual.values[i], precision);
+        if (!same) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Времена с неравномерными шагами: дрожание, повторы, паузы всех классов разностей.
+ */
+std::vector<int64_t> irregular_timestamps(size_t count, std::mt19937& random) {
+    std::uniform_int_distribution<int64_t> jitter(-500, 500);
+    const int64_t pauses[] = {0, 1, 63, 64, 8191, 8192, 8388607, 8388608, 3600LL * 1000000000LL};
+    std::vector<int64_t> timestamps;
+    int64_t timestamp_ns = start_ns;
+    for (size_t i = 0; i != count; ++i) {
+        timestamps.push_back(timestamp_ns);
+        timestamp_ns += (i % 97 == 0) ? pauses[(i / 97) % std::size(pauses)] : period_ns + jitter(random);
+    }
+    return timestamps;
+}
+
+/**
+ * @brief Точность распаковки.
+ */
+void check_round_trip() {
+    std::mt19937 random(1);
+    const size_t count = 10000;
+
+    Samples floats;
+    floats.timestamps = irregular_timestamps(count, random);
+    std::uniform_real_distribution<float> noise(-1000.0f, 1000.0f);
+    const float specials[] = {0.0f, -0.0f, std::numeric_limits<float>::quiet_NaN(), std::numeric_limits<float>::infinity(),
+        -std::numeric_limits<float>::infinity(), std::numeric_limits<float>::denorm_min(), std::numeric_limits<float>::max(),
+        std::numeric_limits<float>::lowest()};
+    for (size_t i = 0; i != count; ++i) {
+        if (i % 50 < std::size(specials)) {
+            floats.values.push_back(specials[i % 50]);
+        } else {
+            floats.values.push_back(i % 3 ? noise(random) : floats.values.back());
+        }
+    }
+    check(same_samples(floats, decode(encode(floats, -1), count, -1), -1),
+          "float values and irregular timestamps decode bit for bit");
+
+    Samples codes;
+    codes.timestamps = irregular_timestamps(count, random);
+    std::uniform_int_distribution<int64_t> code(1, 1000);
+    for (size_t i = 0; i != count; ++i) {
+        codes.values.push_back(SampleQuantizer::from_code(code(random), 3));
+    }
+    codes.values[10] = std::numeric_limits<float>::quiet_NaN();
+    codes.values[11] = std::numeric_limits<float>::infinity();
+    codes.values[12] = -std::numeric_limits<float>::infinity();
+    const Samples decoded = decode(encode(codes, 3), count, 3);
+    check(same_samples(codes, decoded, 3), "fixed-point codes decode exactly");
+    check(std::isnan(decoded.values[10]) && decoded.values[11] == std::numeric_limits<float>::infinity()
+          && decoded.values[12] == -std::numeric_limits<float>::infinity(),
+          "NaN and infinities survive fixed-point coding");
+}
+
+/**
+ * @brief Размер сжатых значений на равномерной сетке (байт на значение).
+ */
+double bytes_per_sample(const std::vector<float>& values, int precision) {
+    Samples samples;
+    for (size_t i = 0; i != values.size(); ++i) {
+        samples.timestamps.push_back(start_ns + static_cast<int64_t>(i) * period_ns);
+        samples.values.push_back(values[i]);
+    }
+    return static_cast<double>(encode(samples, precision).size()) / static_cast<double>(values.size());
+}
+
+/**
+ * @brief Размер сжатых значений: постоянный сигнал, шум и гладкий сигнал диапазона [0.001, 1] с точностью 3.
+ */
+void check_compression() {
+    const size_t count = 16384;
+    std::mt19937 random(2);
+    std::uniform_real_distribution<float> noise(0.001f, 1.0f);
+    std::vector<float> constant(count, 0.5f);
+    std::vector<float> noisy(count);
+    std::vector<float> smooth(count);
+    for (size_t i = 0; i != count; ++i) {
+        noisy[i] = noise(random);
+        smooth[i] = 0.5f + 0.4f * static_cast<float>(std::sin(static_cast<double>(i) * 0.01));
+    }
+
+    char text[64];
+    const double constant_size = bytes_per_sample(constant, -1);
+    std::snprintf(text, sizeof(text), "%.3f", constant_size);
+    check(constant_size <= 0.26, std::string("constant signal, float: ") + text + " B/sample (claimed 0.25)");
+
+    const double noisy_size = bytes_per_sample(noisy, 3);
+    std::snprintf(text, sizeof(text), "%.3f", noisy_size);
+    check(noisy_size <= 2.3, std::string("noise, precision 3: ") + text + " B/sample (claimed 2.2)");
+
+    const double smooth_size = bytes_per_sample(smooth, 3);
+    std::snprintf(text, sizeof(text), "%.3f", smooth_size);
+    check(smooth_size <= 1.2, std::string("smooth signal, precision 3: ") + text + " B/sample (claimed 0.6-1.2)");
+}
+
+/**
+ * @brief Значения блока number файла.
+ */
+Samples chunk_samples_for(size_t number) {
+    Samples samples;
+    for (size_t i = 0; i != chunk_samples; ++i) {
+        const size_t n = number * chunk_samples + i;
+        samples.timestamps.push_back(start_ns + static_cast<int64_t>(n) * period_ns);
+        samples.values.push_back(SampleQuantizer::from_code(static_cast<int64_t>(n % 1000), 3));
+    }
+    return samples;
+}
+
+/**
+ * @brief Создает файл из chunk_count блоков.
+ * @return Смещения блоков и размер файла.
+ */
+std::vector<uint64_t> write_series(const std::string& path, const std::string& index_path) {
+    std::filesystem::remove(path);
+    std::filesystem::remove(index_path);
+    SeriesFile file(path, index_path);
+    GorillaEncoder encoder;
+    for (size_t number = 0; number != chunk_count; ++number) {
+        const Samples samples = chunk_samples_for(number);
+        encoder.reset(3);
+        SeriesChunkInfo info{0, 0, samples.timestamps.front(), samples.timestamps.back(), samples.values.front(), samples.values.front(), 0.0};
+        for (size_t i = 0; i != samples.timestamps.size(); ++i) {
+            encoder.append(samples.timestamps[i], samples.values[i]);
+            info.v_min = std::min(info.v_min, samples.values[i]);
+            info.v_max = std::max(info.v_max, samples.values[i]);
+            info.v_sum += samples.values[i];
+            ++info.count;
+        }
+        file.append(encoder, info);
+    }
+    file.sync();
+    std::vector<uint64_t> offsets;
+    for (const SeriesChunkInfo& info : file.get_chunks()) {
+        offsets.push_back(info.offset);
+    }
+    offsets.push_back(std::filesystem::file_size(path));
+    return offsets;
+}
+
+/**
+ * @brief Проверяет, что открытый файл содержит ровно первые expected_chunks блоков и индекс совпадает с ними.
+ */
+void check_recovered(const std::string& path, const std::string& index_path, size_t expected_chunks,
+                     const std::vector<uint64_t>& offsets, const std::string& what) {
+    SeriesFile file(path, index_path);
+    const std::vector<SeriesChunkInfo>& chunks = file.get_chunks();
+    check(chunks.size() == expected_chunks, what + ": " + std::to_string(chunks.size()) + " chunks recovered");
+    check(std::filesystem::file_size(path) == offsets[expected_chunks], what + ": file cut at the end of the last good chunk");
+
+    bool samples_match = chunks.size() == expected_chunks;
+    for (size_t number = 0; samples_match && number != chunks.size(); ++number) {
+        Samples read;
+        file.read_chunk(chunks[number], [&read](int64_t timestamp_ns, float value) {
+            read.timestamps.push_back(timestamp_ns);
+            read.values.push_back(value);
+        });
+        samples_match = same_samples(chunk_samples_for(number), read, 3);
+    }
+    check(samples_match, what + ": recovered samples match");
+
+    std::vector<SeriesIndexEntry> index(std::filesystem::file_size(index_path) / sizeof(SeriesIndexEntry));
+    std::ifstream index_stream(index_path, std::ios::binary);
+    index_stream.read(reinterpret_cast<char*>(index.data()), static_cast<std::streamsize>(index.size() * sizeof(SeriesIndexEntry)));
+    bool index_match = index.size() == expected_chunks && std::filesystem::file_size(index_path) % sizeof(SeriesIndexEntry) == 0;
+    for (size_t number = 0; index_match && number != index.size(); ++number) {
+        const Samples samples = chunk_samples_for(number);
+        index_match = index[number].offset == offsets[number] && index[number].count == chunk_samples
+            && index[number].t_first == samples.timestamps.front() && index[number].t_last == samples.timestamps.back();
+    }
+    check(index_match, what + ": index lists exactly the recovered chunks");
+}
+
+/**
+ * @brief Отбрасывание испорченного блока и недописанного хвоста при открытии.
+ */
+void check_recovery(const std::filesystem::path& directory) {
+    const std::string path = (directory / "channel.series").string();
+    const std::string index_path = (directory / "channel.index").string();
+
+    // Неизмененный файл открывается как есть, индекс не перезаписывается
+    std::vector<uint64_t> offsets = write_series(path, index_path);
+    struct stat before;
+    stat(index_path.c_str(), &before);
+    check_recovered(path, index_path, chunk_count, offsets, "intact file");
+    struct stat after;
+    stat(index_path.c_str(), &after);
+    check(before.st_ino == after.st_ino, "intact file: index is not rewritten");
+
+    // Испорченный байт данных второго блока: CRC не сходится
+    offsets = write_series(path, index_path);
+    {
+        std::fstream stream(path, std::ios::in | std::ios::out | std::ios::binary);
+        stream.seekg(static_cast<std::streamoff>(offsets[1] + SeriesFile::chunk_header_size + 10));
+        char byte = 0;
+        stream.read(&byte, 1);
+        byte = static_cast<char>(byte ^ 0x01);
+        stream.seekp(static_cast<std::streamoff>(offsets[1] + SeriesFile::chunk_header_size + 10));
+        stream.write(&byte, 1);
+    }
+    check_recovered(path, index_path, 1, offsets, "CRC mismatch");
+
+    // Файл обрезан посреди последнего блока (CHNK записан, CEND нет)
+    offsets = write_series(path, index_path);
+    std::filesystem::resize_file(path, (offsets[chunk_count - 1] + offsets[chunk_count]) / 2);
+    check_recovered(path, index_path, chunk_count - 1, offsets, "truncated tail");
+
+    // Обрезан посреди окончания блока
+    offsets = write_series(path, index_path);
+    std::filesystem::resize_file(path, offsets[chunk_count] - SeriesFile::chunk_footer_size / 2);
+    check_recovered(path, index_path, chunk_count - 1, offsets, "truncated footer");
+}
+
+} // namespace
+
+int main() {
+    char directory_template[] = "/tmp/multimeter_series_test_XXXXXX";
+    if (!mkdtemp(directory_template)) {
+        std::perror("mkdtemp");
+        return 1;
+    }
+    const std::filesystem::path directory = directory_template;
+
+    NullBuffer null_buffer;
+    std::streambuf* saved = std::cout.rdbuf(&null_buffer);
+
+    check_round_trip();
+    check_compression();
+    check_recovery(directory);
+
+    while (ThreadSafeLogger::get_instance().get_backlog() != 0) {
+        std::this_thread::yield();
+    }
+    std::cout.rdbuf(saved);
+    std::filesystem::remove_all(directory);
+    return failures ? 1 : 0;
+}
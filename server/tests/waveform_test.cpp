@@ -0,0 +1,247 @@
+#include "waveform.h"
+#include "sample_quantizer.h"
+#include "logger.h"
+#include "config.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <random>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @file waveform_test.cpp
+ * @brief Проверка прореживания осциллограммы (min-max и LTTB) и кэша корзин.
+ *
+ * На коротких рядах результат сверяется с точками, посчитанными вручную. На длинном
+ * ряду min-max сверяется с прямым подсчетом минимума и максимума корзин, проверяются
+ * количество корзин и точек и сохранение первой и последней точки обоими способами.
+ * Повторные запросы после добавления значений (кэш корзин каждой ширины дополняется
+ * только новыми значениями) и после вытеснения кэшей должны совпадать с результатом
+ * новой осциллограммы без кэша. Код возврата 1 - проверка не прошла.
+ */
+
+namespace {
+
+constexpr RangeManager::RangeID range = 2; ///< Диапазон значений: 1..1000, точность 1 знак
+constexpr int precision = 1; ///< Точность диапазона
+constexpr int64_t start_ns = 1700000000LL * 1000000000LL; ///< Время первого значения длинного ряда
+constexpr int64_t period_ns = 1000000; ///< Период значений длинного ряда
+constexpr size_t sample_count = 20000; ///< Значений в длинном ряду
+
+/**
+ * @brief Буфер потока вывода, отбрасывающий все данные.
+ */
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+int failures = 0; ///< Количество не прошедших проверок
+
+/**
+ * @brief Учитывает результат проверки.
+ */
+void check(bool ok, const std::string& what) {
+    std::printf("%s: %s\n", ok ? "ok" : "FAILED", what.c_str());
+    if (!ok) {
+        ++failures;
+    }
+}
+
+/**
+ * @brief Совпадают ли точки (времена и значения) побитово.
+ */
+bool same_points(const std::vector<WaveformPoint>& a, const std::vector<WaveformPoint>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i != a.size(); ++i) {
+        if (a[i].timestamp_ns != b[i].timestamp_ns || a[i].value != b[i].value) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Ширина корзины, которую выбирает get_waveform для интервала и числа кандидатов.
+ */
+int64_t bucket_width_for(int64_t span_ns, size_t candidates) {
+    const int64_t bucket_count = static_cast<int64_t>(candidates / 2 - 1);
+    return std::max<int64_t>(1, (span_ns + bucket_count - 1) / bucket_count);
+}
+
+/**
+ * @brief Прямой подсчет min-max: первые минимум и максимум каждой корзины в порядке времени.
+ */
+std::vector<WaveformPoint> reference_minmax(const std::vector<WaveformPoint>& samples, int64_t width,
+                                            int64_t t0_ns, int64_t t1_ns, size_t& bucket_count) {
+    std::map<int64_t, std::pair<WaveformPoint, WaveformPoint>> buckets;
+    for (const WaveformPoint& sample : samples) {
+        const int64_t index = sample.timestamp_ns / width;
+        if (index < t0_ns / width || index > t1_ns / width) continue;
+        auto inserted = buckets.emplace(index, std::make_pair(sample, sample));
+        auto& bucket = inserted.first->second;
+        if (sample.value < bucket.first.value) bucket.first = sample;
+        if (sample.value > bucket.second.value) bucket.second = sample;
+    }
+    bucket_count = buckets.size();
+    std::vector<WaveformPoint> result;
+    for (const auto& [index, bucket] : buckets) {
+        const bool min_first = bucket.first.timestamp_ns <= bucket.second.timestamp_ns;
+        result.push_back(min_first ? bucket.first : bucket.second);
+        if (bucket.first.timestamp_ns != bucket.second.timestamp_ns) {
+            result.push_back(min_first ? bucket.second : bucket.first);
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief Проверяет прореживание коротких рядов с результатом, посчитанным вручную.
+ *
+ * 12 значений с временами 0..11 нс. Для 8 точек min-max берет 3 корзины шириной 4;
+ * во второй корзине все значения равны, и точка выдается один раз. Для 4 точек
+ * LTTB отбирает 16 кандидатов (6 корзин шириной 2 - все 12 значений) и оставляет
+ * первую точку, пик, точку с наибольшим треугольником во второй группе и последнюю точку.
+ */
+void check_small() {
+    const std::vector<float> minmax_values = {5, 1, 9, 5, 2, 2, 2, 2, 7, 3, 3, 8};
+    ChannelWaveform minmax_waveform(64);
+    for (size_t i = 0; i != minmax_values.size(); ++i) {
+        minmax_waveform.add_sample(static_cast<int64_t>(i), minmax_values[i], range);
+    }
+    const std::vector<WaveformPoint> minmax_expected = {{1, 1}, {2, 9}, {4, 2}, {9, 3}, {11, 8}};
+    check(same_points(minmax_waveform.get_waveform(0, 12, 8, ChannelWaveform::Mode::MinMax), minmax_expected),
+          "min-max of 12 values into 3 buckets");
+
+    const std::vector<float> lttb_values = {10, 11, 12, 100, 13, 14, 15, 16, 1, 17, 18, 19};
+    ChannelWaveform lttb_waveform(64);
+    for (size_t i = 0; i != lttb_values.size(); ++i) {
+        lttb_waveform.add_sample(static_cast<int64_t>(i), lttb_values[i], range);
+    }
+    const std::vector<WaveformPoint> lttb_expected = {{0, 10}, {3, 100}, {6, 15}, {11, 19}};
+    check(same_points(lttb_waveform.get_waveform(0, 12, 4, ChannelWaveform::Mode::Lttb), lttb_expected),
+          "LTTB of 12 values into 4 points");
+}
+
+/**
+ * @brief Возвращает длинный ряд: шум 10..900 с максимумом в первом значении и минимумом в последнем.
+ */
+std::vector<WaveformPoint> make_samples() {
+    std::mt19937 random(1);
+    std::vector<WaveformPoint> samples;
+    for (size_t i = 0; i != sample_count; ++i) {
+        const int64_t code = 100 + static_cast<int64_t>(random() % 8900);
+        samples.push_back({start_ns + static_cast<int64_t>(i) * period_ns, SampleQuantizer::from_code(code, precision)});
+    }
+    samples.front().value = 999.0f;
+    samples.back().value = 1.0f;
+    return samples;
+}
+
+/**
+ * @brief Добавляет в осциллограмму значения ряда [begin, end).
+ */
+void add_samples(ChannelWaveform& waveform, const std::vector<WaveformPoint>& samples, size_t begin, size_t end) {
+    for (size_t i = begin; i != end; ++i) {
+        waveform.add_sample(samples[i].timestamp_ns, samples[i].value, range);
+    }
+}
+
+/**
+ * @brief Проверяет min-max и LTTB длинного ряда на нескольких разрешениях.
+ */
+void check_decimation(const std::vector<WaveformPoint>& samples) {
+    ChannelWaveform waveform(sample_count);
+    add_samples(waveform, samples, 0, samples.size());
+    const int64_t t0 = samples.front().timestamp_ns;
+    const int64_t t1 = samples.back().timestamp_ns + 1;
+
+    for (size_t points : {4, 100, 1000, 4096}) {
+        const std::string name = std::to_string(points) + " points";
+        const std::vector<WaveformPoint> minmax = waveform.get_waveform(t0, t1, points, ChannelWaveform::Mode::MinMax);
+        const int64_t width = bucket_width_for(t1 - t0, points);
+        size_t bucket_count = 0;
+        const std::vector<WaveformPoint> expected = reference_minmax(samples, width, t0, t1, bucket_count);
+        check(same_points(minmax, expected), "min-max " + name + " matches the direct count");
+        // Значения плотнее корзин, поэтому непусты все корзины от первой до последней
+        const size_t spanned = static_cast<size_t>((t1 - 1) / width - t0 / width + 1);
+        check(bucket_count == spanned && bucket_count <= points / 2 && minmax.size() <= points,
+              "min-max " + name + ": " + std::to_string(bucket_count) + " buckets, " + std::to_string(minmax.size()) + " points");
+        check(!minmax.empty() && minmax.front().timestamp_ns == t0 && minmax.back().timestamp_ns == t1 - 1,
+              "min-max " + name + " keeps the first and last points");
+
+        const std::vector<WaveformPoint> lttb = waveform.get_waveform(t0, t1, points, ChannelWaveform::Mode::Lttb);
+        check(lttb.size() == points, "LTTB " + name + ": " + std::to_string(lttb.size()) + " points");
+        check(!lttb.empty() && lttb.front().timestamp_ns == t0 && lttb.front().value == 999.0f &&
+              lttb.back().timestamp_ns == t1 - 1 && lttb.back().value == 1.0f,
+              "LTTB " + name + " keeps the first and last points");
+    }
+}
+
+/**
+ * @brief Проверяет дополнение и вытеснение кэшей корзин.
+ *
+ * Запросы двух разрешений (у каждого своя ширина корзины) повторяются после
+ * добавления второй половины ряда, затем после вытеснения кэшей запросами других
+ * разрешений. Результаты должны совпадать с осциллограммой, которой ряд добавлен
+ * целиком и которую ни разу не запрашивали.
+ */
+void check_cache(const std::vector<WaveformPoint>& samples) {
+    const int64_t t0 = samples.front().timestamp_ns;
+    const int64_t t1 = samples.back().timestamp_ns + 1;
+    const std::vector<std::pair<size_t, ChannelWaveform::Mode>> queries = {
+        {100, ChannelWaveform::Mode::MinMax}, {250, ChannelWaveform::Mode::Lttb}};
+
+    ChannelWaveform cached(sample_count);
+    add_samples(cached, samples, 0, samples.size() / 2);
+    for (const auto& [points, mode] : queries) {
+        cached.get_waveform(t0, t1, points, mode);
+    }
+    add_samples(cached, samples, samples.size() / 2, samples.size());
+
+    std::vector<std::vector<WaveformPoint>> expected;
+    for (const auto& [points, mode] : queries) {
+        ChannelWaveform fresh(sample_count);
+        add_samples(fresh, samples, 0, samples.size());
+        expected.push_back(fresh.get_waveform(t0, t1, points, mode));
+    }
+
+    for (size_t q = 0; q != queries.size(); ++q) {
+        const std::string name = std::to_string(queries[q].first) + " points";
+        check(same_points(cached.get_waveform(t0, t1, queries[q].first, queries[q].second), expected[q]),
+              name + " after new values matches an uncached waveform");
+        check(same_points(cached.get_waveform(t0, t1, queries[q].first, queries[q].second), expected[q]),
+              name + " repeated query is unchanged");
+    }
+
+    // Больше разрешений, чем кэшей: кэши первых запросов вытесняются и строятся заново
+    for (size_t points = 10; points != 10 + 2 * (MyConfig::DefaultConfig::waveform_cache_entries + 1); points += 2) {
+        cached.get_waveform(t0, t1, points, ChannelWaveform::Mode::MinMax);
+    }
+    for (size_t q = 0; q != queries.size(); ++q) {
+        check(same_points(cached.get_waveform(t0, t1, queries[q].first, queries[q].second), expected[q]),
+              std::to_string(queries[q].first) + " points after cache eviction matches an uncached waveform");
+    }
+}
+
+} // namespace
+
+int main() {
+    NullBuffer null_buffer;
+    std::streambuf* saved = std::cout.rdbuf(&null_buffer);
+
+    check_small();
+    const std::vector<WaveformPoint> samples = make_samples();
+    check_decimation(samples);
+    check_cache(samples);
+
+    while (ThreadSafeLogger::get_instance().get_backlog() != 0) {
+        std::this_thread::yield();
+    }
+    std::cout.rdbuf(saved);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,69 @@
+#include "capture_file.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <exception>
+
+/**
+ * @file capture_tool.cpp
+ * @brief Преобразование записи канала из CSV в файл записи для источника replay.
+ *
+ * Использование: capture_tool <input.csv> <output.cap>
+ *
+ * Источник replay открывает записи только из каталога capture_directory
+ * (config.h), поэтому output.cap следует положить туда.
+ *
+ * Каждая строка CSV: "<время нс>,<значение>". Строки, которые не удается
+ * разобрать (например, заголовок), пропускаются. Время должно не убывать.
+ */
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        std::fprintf(stderr, "usage: %s <input.csv> <output.cap>\n", argv[0]);
+        return 2;
+    }
+
+    std::ifstream input(argv[1]);
+    if (!input) {
+        std::fprintf(stderr, "cannot open %s\n", argv[1]);
+        return 1;
+    }
+
+    std::vector<int64_t> timestamps;
+    std::vector<float> values;
+    std::string line;
+    size_t skipped = 0;
+    while (std::getline(input, line)) {
+        std::istringstream fields(line);
+        long long timestamp = 0;
+        char separator = 0;
+        float value = 0.0f;
+        if (!(fields >> timestamp >> separator >> value) || separator != ',') {
+            ++skipped;
+            continue;
+        }
+        if (!timestamps.empty() && timestamp < timestamps.back()) {
+            std::fprintf(stderr, "timestamps must not decrease: %s\n", line.c_str());
+            return 1;
+        }
+        timestamps.push_back(timestamp);
+        values.push_back(value);
+    }
+    if (timestamps.empty()) {
+        std::fprintf(stderr, "no samples in %s\n", argv[1]);
+        return 1;
+    }
+
+    try {
+        CaptureFile::write(argv[2], timestamps.data(), values.data(), timestamps.size());
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    std::printf("samples=%zu skipped=%zu\n", timestamps.size(), skipped);
+    return 0;
+}
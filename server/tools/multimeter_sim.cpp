@@ -0,0 +1,181 @@
+#include "analog_input.h"
+#include "signal_source.h"
+#include "channel_stats.h"
+#include "my_tools.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * @file multimeter_sim.cpp
+ * @brief Детерминированная имитация измерений в виртуальном времени.
+ *
+ * Использование: multimeter_sim [--channels=N] [--duration=1h] [--step=1s] [--period=100ms]
+ *                [--seed=N] [--source=<имя>,<параметры>...]
+ *
+ * Каналы создаются без потоков измерений, а один поток сдвигает виртуальное время
+ * (MyTools::set_virtual_time) шагами step и выполняет в каждом канале измерения,
+ * срок которых наступил. Время идет так быстро, как позволяет процессор: час измерений
+ * тысячи каналов занимает секунды. Зерна генераторов берутся из детерминированной
+ * последовательности (MyTools::set_seed_base), поэтому при одинаковых параметрах
+ * результат повторяется побитово.
+ *
+ * Результат печатается строкой `sim key=value ...`; digest - хеш последних значений
+ * и итогов окон статистики всех каналов, по нему сравниваются запуски.
+ */
+
+namespace {
+
+/// Начало виртуального времени (нс от эпохи): фиксировано ради повторяемости
+constexpr int64_t virtual_epoch_ns = 1700000000LL * 1000000000LL;
+
+/**
+ * @struct Options
+ * @brief Параметры имитации.
+ */
+struct Options {
+    size_t channels = 1000; ///< Количество каналов
+    int64_t duration_ns = 3600LL * 1000000000LL; ///< Длительность в виртуальном времени
+    int64_t step_ns = 1000000000LL; ///< Шаг виртуального времени
+    int64_t period_ns = 0; ///< Период опроса (0 - по умолчанию)
+    uint64_t seed = 1; ///< База зерен генераторов
+    std::vector<std::string> source; ///< Источник сигнала и его параметры (пусто - по умолчанию)
+};
+
+/**
+ * @brief Разбивает строку по запятым.
+ */
+std::vector<std::string> split(const std::string& text) {
+    std::vector<std::string> parts;
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t end = text.find(',', start);
+        if (end == std::string::npos) end = text.size();
+        parts.push_back(text.substr(start, end - start));
+        start = end + 1;
+    }
+    return parts;
+}
+
+/**
+ * @brief Разбирает аргументы командной строки вида --key=value.
+ * @throws std::invalid_argument Если аргумент неизвестен или некорректен.
+ */
+Options parse_options(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const size_t eq = arg.find('=');
+        if (arg.compare(0, 2, "--") != 0 || eq == std::string::npos) {
+            throw std::invalid_argument("bad argument: " + arg);
+        }
+        const std::string key = arg.substr(2, eq - 2);
+        const std::string value = arg.substr(eq + 1);
+        if (key == "channels") options.channels = std::stoul(value);
+        else if (key == "duration") options.duration_ns = MyTools::parse_duration_ns(value);
+        else if (key == "step") options.step_ns = MyTools::parse_duration_ns(value);
+        else if (key == "period") options.period_ns = MyTools::parse_duration_ns(value);
+        else if (key == "seed") options.seed = std::stoull(value);
+        else if (key == "source") options.source = split(value);
+        else throw std::invalid_argument("unknown option: " + key);
+    }
+    if (options.channels == 0 || options.seed == 0) {
+        throw std::invalid_argument("channels and seed must be positive");
+    }
+    return options;
+}
+
+/**
+ * @brief Добавляет байты в хеш FNV-1a.
+ */
+void hash_bytes(uint64_t& hash, const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i != size; ++i) {
+        hash = (hash ^ bytes[i]) * 0x100000001B3ULL;
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    try {
+        options = parse_options(argc, argv);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        std::fprintf(stderr, "usage: %s [--channels=N] [--duration=1h] [--step=1s] [--period=100ms] [--seed=N] "
+                             "[--source=<name>,<params>...]\n", argv[0]);
+        return 2;
+    }
+
+    MyTools::set_seed_base(options.seed);
+    MyTools::set_virtual_time(virtual_epoch_ns);
+
+    std::vector<std::shared_ptr<AnalogInput>> channels;
+    try {
+        for (size_t i = 0; i != options.channels; ++i) {
+            auto channel = std::make_shared<AnalogInput>("sim" + std::to_string(i));
+            if (options.period_ns) {
+                channel->set_period_ns(options.period_ns);
+            }
+            if (!options.source.empty()) {
+                const std::vector<std::string> params(options.source.begin() + 1, options.source.end());
+                std::shared_ptr<ISignalSource> source = SignalSourceFactory::create_source(options.source[0], params);
+                if (!source) {
+                    throw std::invalid_argument("unknown source " + options.source[0]);
+                }
+                channel->set_source(source);
+            }
+            channels.push_back(std::move(channel));
+        }
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    const auto wall_start = std::chrono::steady_clock::now();
+    const int64_t end_ns = virtual_epoch_ns + options.duration_ns;
+    for (int64_t now = virtual_epoch_ns; now <= end_ns; now += options.step_ns) {
+        MyTools::set_virtual_time(now);
+        for (const auto& channel : channels) {
+            channel->acquire_until(now);
+        }
+    }
+    const double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+
+    // Хеш последних значений и итогов минутного окна всех каналов
+    uint64_t digest = 0xCBF29CE484222325ULL;
+    uint64_t samples = 0;
+    for (const auto& channel : channels) {
+        const float value = channel->get_measuring_value();
+        const int64_t time = channel->get_measuring_time();
+        hash_bytes(digest, &value, sizeof(value));
+        hash_bytes(digest, &time, sizeof(time));
+        StatsAccumulator summary;
+        if (channel->get_stats()->get_summary("1m", MyTools::now_ns(), summary)) {
+            hash_bytes(digest, &summary.count, sizeof(summary.count));
+            hash_bytes(digest, &summary.sum, sizeof(summary.sum));
+            hash_bytes(digest, &summary.min, sizeof(summary.min));
+            hash_bytes(digest, &summary.max, sizeof(summary.max));
+        }
+        samples += channel->get_health()->get_samples();
+    }
+
+    std::printf("sim channels=%zu duration_s=%.1f step_ms=%.3f seed=%llu samples=%llu wall_s=%.3f speedup=%.0f "
+                "digest=%016llx\n",
+                options.channels, static_cast<double>(options.duration_ns) / 1e9,
+                static_cast<double>(options.step_ns) / 1e6, static_cast<unsigned long long>(options.seed),
+                static_cast<unsigned long long>(samples), wall_s,
+                static_cast<double>(options.duration_ns) / 1e9 / std::max(wall_s, 1e-9),
+                static_cast<unsigned long long>(digest));
+    return 0;
+}
@@ -0,0 +1,197 @@
+#include "tracing.h"
+#include "config.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <unistd.h>
+
+std::atomic<bool> Tracer::enabled{MyConfig::DefaultConfig::trace_at_start};
+
+namespace {
+
+thread_local int64_t current_id = -1; ///< Идентификатор текущего запроса потока
+
+/**
+ * @brief Экранирует строку для JSON.
+ */
+std::string escape_json(const std::string& text) {
+    std::string result;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            result += '\\';
+            result += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char buffer[8];
+            std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+            result += buffer;
+        } else {
+            result += c;
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief Наносекунды в микросекунды для JSON (единица формата trace-event).
+ */
+std::string to_us(int64_t ns) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.3f", static_cast<double>(ns) / 1000.0);
+    return buffer;
+}
+
+} // namespace
+
+/**
+ * @brief Задает идентификатор текущего запроса потока.
+ */
+void Tracer::set_current_id(int64_t id) {
+    current_id = id;
+}
+
+/**
+ * @brief Идентификатор текущего запроса потока.
+ */
+int64_t Tracer::get_current_id() {
+    return current_id;
+}
+
+/**
+ * @brief Буфер вызывающего потока.
+ *
+ * Буфер регистрируется в списке при первом обращении потока и отмечается
+ * завершенным при выходе из потока: события завершившихся потоков остаются
+ * доступными для выгрузки до очистки.
+ */
+Tracer::ThreadBuffer& Tracer::get_thread_buffer() {
+    struct Holder {
+        std::shared_ptr<ThreadBuffer> buffer;
+        ~Holder() {
+            if (buffer) {
+                std::lock_guard<std::mutex> lock(buffer->mutex);
+                buffer->finished = true;
+            }
+        }
+    };
+    thread_local Holder holder;
+
+    if (!holder.buffer) {
+        auto buffer = std::make_shared<ThreadBuffer>();
+        std::lock_guard<std::mutex> lock(buffers_mutex);
+        // Завершившиеся потоки без событий больше не нужны
+        buffers.erase(std::remove_if(buffers.begin(), buffers.end(), [](const std::shared_ptr<ThreadBuffer>& b) {
+            std::lock_guard<std::mutex> buffer_lock(b->mutex);
+            return b->finished && b->events.empty();
+        }), buffers.end());
+        buffer->tid = next_tid++;
+        buffers.push_back(buffer);
+        holder.buffer = std::move(buffer);
+    }
+    return *holder.buffer;
+}
+
+/**
+ * @brief Задает имя вызывающего потока для выгрузки.
+ */
+void Tracer::set_thread_name(const std::string& name) {
+    ThreadBuffer& buffer = get_thread_buffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    buffer.name = name;
+}
+
+/**
+ * @brief Записывает завершенный интервал в буфер вызывающего потока.
+ */
+void Tracer::record(const char* name, const char* category, int64_t start_ns, int64_t end_ns, int64_t id) {
+    ThreadBuffer& buffer = get_thread_buffer();
+    const Event event{name, category, start_ns, end_ns - start_ns, id};
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    if (buffer.events.size() < MyConfig::DefaultConfig::trace_buffer_events) {
+        buffer.events.push_back(event);
+    } else {
+        buffer.events[buffer.next] = event;
+        buffer.next = (buffer.next + 1) % buffer.events.size();
+    }
+}
+
+/**
+ * @brief Выгрузка всех буферов в JSON формата Chrome trace-event.
+ *
+ * Интервалы выгружаются событиями "X" (complete), имена потоков - событиями
+ * метаданных "M".
+ */
+std::string Tracer::dump_json(size_t& event_count) {
+    std::vector<std::shared_ptr<ThreadBuffer>> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex);
+        snapshot = buffers;
+    }
+
+    const std::string pid = std::to_string(getpid());
+    std::string json = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    auto append = [&](const std::string& event) {
+        if (!first) json += ",\n";
+        json += event;
+        first = false;
+    };
+
+    event_count = 0;
+    for (const auto& buffer : snapshot) {
+        std::lock_guard<std::mutex> lock(buffer->mutex);
+        const std::string tid = std::to_string(buffer->tid);
+        if (!buffer->name.empty()) {
+            append("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + pid + ",\"tid\":" + tid +
+                   ",\"args\":{\"name\":\"" + escape_json(buffer->name) + "\"}}");
+        }
+        for (size_t k = 0; k != buffer->events.size(); ++k) {
+            // В заполненном кольце самое старое событие - в позиции записи
+            const Event& event = buffer->events[(buffer->next + k) % buffer->events.size()];
+            std::string line = "{\"name\":\"" + std::string(event.name) + "\",\"cat\":\"" + event.category +
+                               "\",\"ph\":\"X\",\"ts\":" + to_us(event.start_ns) + ",\"dur\":" + to_us(event.duration_ns) +
+                               ",\"pid\":" + pid + ",\"tid\":" + tid;
+            if (event.id >= 0) {
+                line += ",\"args\":{\"id\":" + std::to_string(event.id) + "}";
+            }
+            append(line + "}");
+        }
+        event_count += buffer->events.size();
+    }
+    json += "]}\n";
+    return json;
+}
+
+/**
+ * @brief Записывает выгрузку в файл.
+ */
+size_t Tracer::write_json(const std::string& path) {
+    size_t event_count = 0;
+    const std::string json = dump_json(event_count);
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file || !file.write(json.data(), static_cast<std::streamsize>(json.size()))) {
+        throw std::runtime_error("cannot write " + path);
+    }
+    return event_count;
+}
+
+/**
+ * @brief Очищает буферы и забывает завершившиеся потоки.
+ */
+void Tracer::clear() {
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    buffers.erase(std::remove_if(buffers.begin(), buffers.end(), [](const std::shared_ptr<ThreadBuffer>& buffer) {
+        std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+        buffer->events.clear();
+        buffer->next = 0;
+        return buffer->finished;
+    }), buffers.end());
+}
+
+/**
+ * @brief Записывает завершенный интервал.
+ */
+void TraceSpan::finish() {
+    Tracer::get_instance().record(name, category, start_ns, Metrics::now_ns(), Tracer::get_current_id());
+}
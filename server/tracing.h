@@ -0,0 +1,164 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "metrics.h"
+
+/**
+ * @class Tracer
+ * @brief Трассировка запросов и проходов измерений в формате Chrome trace-event.
+ *
+ * Интервалы (TraceSpan) записываются в буфер своего потока, поэтому потоки
+ * не борются за общий буфер; буфер ограничен trace_buffer_events событиями,
+ * при переполнении вытесняются самые старые. Выгрузка собирает буферы всех
+ * потоков (в том числе завершившихся) в JSON, который открывается в
+ * chrome://tracing или Perfetto.
+ *
+ * Пока трассировка выключена, интервал стоит одно relaxed-чтение флага.
+ * Время - Metrics::now_ns() (steady_clock), как и у метрик.
+ */
+class Tracer {
+public:
+    /**
+     * @brief Получить единственный экземпляр трассировщика.
+     */
+    static Tracer& get_instance() {
+        static Tracer instance;
+        return instance;
+    }
+
+    /**
+     * @brief Трассировка включена.
+     */
+    static bool is_enabled() { return enabled.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Включает или выключает трассировку.
+     */
+    static void set_enabled(bool value) { enabled.store(value, std::memory_order_relaxed); }
+
+    /**
+     * @brief Задает идентификатор текущего запроса потока.
+     *
+     * Идентификатор попадает в аргументы всех интервалов потока, пока не будет
+     * заменен; -1 - интервалы без идентификатора.
+     */
+    static void set_current_id(int64_t id);
+
+    /**
+     * @brief Идентификатор текущего запроса потока.
+     */
+    static int64_t get_current_id();
+
+    /**
+     * @brief Задает имя вызывающего потока для выгрузки.
+     */
+    void set_thread_name(const std::string& name);
+
+    /**
+     * @brief Записывает завершенный интервал в буфер вызывающего потока.
+     * @param name Имя интервала (строковый литерал: хранится указатель).
+     * @param category Категория (строковый литерал).
+     * @param start_ns Начало (Metrics::now_ns).
+     * @param end_ns Конец (Metrics::now_ns).
+     * @param id Идентификатор запроса; -1 - без идентификатора.
+     */
+    void record(const char* name, const char* category, int64_t start_ns, int64_t end_ns, int64_t id);
+
+    /**
+     * @brief Выгрузка всех буферов в JSON формата Chrome trace-event.
+     * @param event_count Количество выгруженных интервалов.
+     */
+    std::string dump_json(size_t& event_count);
+
+    /**
+     * @brief Записывает выгрузку в файл.
+     * @return Количество выгруженных интервалов.
+     * @throws std::runtime_error Если файл не удалось записать.
+     */
+    size_t write_json(const std::string& path);
+
+    /**
+     * @brief Очищает буферы и забывает завершившиеся потоки.
+     */
+    void clear();
+
+private:
+    Tracer() = default;
+
+    /**
+     * @struct Event
+     * @brief Завершенный интервал.
+     */
+    struct Event {
+        const char* name; ///< Имя интервала
+        const char* category; ///< Категория
+        int64_t start_ns; ///< Начало
+        int64_t duration_ns; ///< Длительность
+        int64_t id; ///< Идентификатор запроса (-1 - нет)
+    };
+
+    /**
+     * @struct ThreadBuffer
+     * @brief Буфер событий одного потока.
+     *
+     * Пишет в буфер только его поток; мьютекс нужен лишь против выгрузки
+     * и поэтому почти всегда свободен.
+     */
+    struct ThreadBuffer {
+        std::mutex mutex; ///< Мьютекс против выгрузки
+        std::vector<Event> events; ///< События (кольцо после заполнения)
+        size_t next = 0; ///< Позиция записи в заполненном кольце
+        std::string name; ///< Имя потока
+        uint32_t tid = 0; ///< Номер потока в выгрузке
+        bool finished = false; ///< Поток завершился
+    };
+
+    /**
+     * @brief Буфер вызывающего потока (создается при первом обращении).
+     */
+    ThreadBuffer& get_thread_buffer();
+
+    static std::atomic<bool> enabled; ///< Флаг трассировки
+
+    std::mutex buffers_mutex; ///< Мьютекс списка буферов
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers; ///< Буферы потоков
+    uint32_t next_tid = 1; ///< Следующий номер потока
+};
+
+/**
+ * @class TraceSpan
+ * @brief Интервал трассировки, охватывающий область видимости.
+ *
+ * Пример: `TraceSpan span("parse", "request");`. Имя и категория должны быть
+ * строковыми литералами.
+ */
+class TraceSpan {
+public:
+    TraceSpan(const char* name, const char* category)
+        : name(name), category(category), start_ns(Tracer::is_enabled() ? Metrics::now_ns() : 0) {}
+
+    ~TraceSpan() {
+        if (start_ns) {
+            finish();
+        }
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    /**
+     * @brief Записывает завершенный интервал.
+     */
+    void finish();
+
+    const char* name; ///< Имя интервала
+    const char* category; ///< Категория
+    int64_t start_ns; ///< Начало; 0 - трассировка была выключена
+};
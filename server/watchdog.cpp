@@ -0,0 +1,169 @@
+#include "watchdog.h"
+#include "my_tools.h"
+#include "logger.h"
+#include "config.h"
+
+#include <chrono>
+#include <string>
+
+/**
+ * @brief Конструктор. Запускает поток проверки.
+ */
+AcquisitionWatchdog::AcquisitionWatchdog() {
+    watchdog_thread = std::thread(&AcquisitionWatchdog::run, this);
+}
+
+/**
+ * @brief Деструктор. Останавливает поток проверки.
+ */
+AcquisitionWatchdog::~AcquisitionWatchdog() {
+    stop();
+}
+
+/**
+ * @brief Начинает наблюдать канал с собственным потоком измерений.
+ */
+void AcquisitionWatchdog::watch(const std::shared_ptr<IChannel>& channel) {
+    Target target;
+    target.health = channel->get_health();
+    target.channel = channel;
+    std::lock_guard<std::mutex> lock(mutex);
+    targets.push_back(std::move(target));
+}
+
+/**
+ * @brief Начинает наблюдать поток измерений плотной таблицы.
+ */
+void AcquisitionWatchdog::watch_table(const std::shared_ptr<ChannelTable>& table) {
+    Target target;
+    target.health = std::shared_ptr<ChannelHealth>(table, &table->get_health());
+    target.table = table;
+    std::lock_guard<std::mutex> lock(mutex);
+    targets.push_back(std::move(target));
+}
+
+/**
+ * @brief Останавливает поток проверки.
+ */
+void AcquisitionWatchdog::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping) {
+            return;
+        }
+        stopping = true;
+    }
+    stop_cond_var.notify_all();
+    if (watchdog_thread.joinable()) {
+        watchdog_thread.join();
+    }
+}
+
+/**
+ * @brief Основной цикл потока проверки.
+ */
+void AcquisitionWatchdog::run() {
+    const auto interval = std::chrono::milliseconds(MyConfig::DefaultConfig::watchdog_interval_ms);
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        check(MyTools::monotonic_ns());
+        stop_cond_var.wait_for(lock, interval, [this] { return stopping; });
+    }
+}
+
+/**
+ * @brief Проверяет все наблюдаемые потоки.
+ *
+ * Для работающего потока проверка - одно чтение срока; уничтоженные каналы
+ * удаляются из списка.
+ */
+void AcquisitionWatchdog::check(int64_t now_ns) {
+    const int64_t threshold_ns = static_cast<int64_t>(MyConfig::DefaultConfig::watchdog_stall_threshold_ms) * 1000000;
+    for (size_t i = 0; i < targets.size();) {
+        Target& target = targets[i];
+        const int64_t deadline = target.health->get_deadline_ns();
+        const int64_t overdue = deadline ? now_ns - deadline : 0;
+
+        bool alive = true;
+        if (!target.stalled && overdue > threshold_ns) {
+            alive = fail(target, now_ns, overdue);
+        } else if (target.stalled && overdue <= threshold_ns) {
+            recover(target, now_ns);
+        } else if (!target.stalled && target.channel.expired() && target.table.expired()) {
+            alive = false;
+        }
+
+        if (alive) {
+            ++i;
+        } else {
+            targets[i] = std::move(targets.back());
+            targets.pop_back();
+        }
+    }
+}
+
+/**
+ * @brief Переводит каналы зависшего потока в error_state.
+ *
+ * Переводятся только каналы в состоянии измерения: временные состояния
+ * (например, имитированные сбои) не перезаписываются.
+ */
+bool AcquisitionWatchdog::fail(Target& target, int64_t now_ns, int64_t overdue_ns) {
+    const std::string reason = "acquisition stalled, no progress for " + std::to_string(overdue_ns / 1000000) + "ms";
+    std::string name;
+
+    if (std::shared_ptr<IChannel> channel = target.channel.lock()) {
+        name = channel->get_name();
+        target.prior_state = channel->get_state();
+        if (target.prior_state == ChannelStateManager::ChannelState::Measure) {
+            channel->set_state(ChannelStateManager::ChannelState::Error);
+        }
+    } else if (std::shared_ptr<ChannelTable> table = target.table.lock()) {
+        name = "table";
+        target.failed_ids.clear();
+        const size_t n = table->size();
+        for (ChannelTable::ChannelID id = 0; id != n; ++id) {
+            if (table->exchange_state(id, ChannelStateManager::ChannelState::Measure, ChannelStateManager::ChannelState::Error)) {
+                target.failed_ids.push_back(id);
+            }
+        }
+    } else {
+        return false;
+    }
+
+    target.stalled = true;
+    target.stalled_since_ns = now_ns - overdue_ns;
+    target.health->set_stalled(reason);
+    Log::log("Watchdog [" + name + "] " + reason);
+    return true;
+}
+
+/**
+ * @brief Восстанавливает каналы потока, возобновившего работу.
+ *
+ * Состояние восстанавливается, только если канал все еще в error_state.
+ */
+void AcquisitionWatchdog::recover(Target& target, int64_t now_ns) {
+    const int64_t stall_ns = now_ns - target.stalled_since_ns;
+    std::string name;
+
+    if (std::shared_ptr<IChannel> channel = target.channel.lock()) {
+        name = channel->get_name();
+        if (target.prior_state == ChannelStateManager::ChannelState::Measure &&
+            channel->get_state() == ChannelStateManager::ChannelState::Error) {
+            channel->set_state(target.prior_state);
+        }
+    } else if (std::shared_ptr<ChannelTable> table = target.table.lock()) {
+        name = "table";
+        for (ChannelTable::ChannelID id : target.failed_ids) {
+            table->exchange_state(id, ChannelStateManager::ChannelState::Error, ChannelStateManager::ChannelState::Measure);
+        }
+        target.failed_ids.clear();
+    }
+
+    target.stalled = false;
+    target.health->set_recovered(stall_ns);
+    if (!name.empty()) {
+        Log::log("Watchdog [" + name + "] acquisition resumed after " + std::to_string(stall_ns / 1000000) + "ms");
+    }
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "channel.h"
+#include "channel_health.h"
+#include "channel_table.h"
+
+#include <memory>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <cstdint>
+
+/**
+ * @class AcquisitionWatchdog
+ * @brief Сторожевой таймер потоков измерений.
+ *
+ * Раз в watchdog_interval_ms проверяет, что каждый наблюдаемый поток измерений
+ * сделал проход к опубликованному им сроку (ChannelHealth). Если срок просрочен
+ * больше чем на watchdog_stall_threshold_ms, каналы потока переводятся в состояние
+ * error_state с причиной; когда поток возобновляет работу, прежнее состояние
+ * восстанавливается (если его за это время не изменили), а длительность зависания
+ * записывается в гистограмму.
+ *
+ * Проверка потока - одно атомарное чтение срока, поэтому проход по тысячам
+ * каналов занимает микросекунды. Каналы плотной таблицы обслуживает один поток,
+ * поэтому таблица наблюдается целиком, а ее каналы перебираются только при
+ * зависании и восстановлении.
+ */
+class AcquisitionWatchdog {
+public:
+    /**
+     * @brief Конструктор. Запускает поток проверки.
+     */
+    AcquisitionWatchdog();
+
+    /**
+     * @brief Деструктор. Останавливает поток проверки.
+     */
+    ~AcquisitionWatchdog();
+
+    AcquisitionWatchdog(const AcquisitionWatchdog&) = delete;
+    AcquisitionWatchdog& operator=(const AcquisitionWatchdog&) = delete;
+
+    /**
+     * @brief Начинает наблюдать канал с собственным потоком измерений.
+     *
+     * Канал перестает наблюдаться, когда он уничтожается.
+     *
+     * @param channel Канал.
+     */
+    void watch(const std::shared_ptr<IChannel>& channel);
+
+    /**
+     * @brief Начинает наблюдать поток измерений плотной таблицы.
+     * @param table Таблица каналов.
+     */
+    void watch_table(const std::shared_ptr<ChannelTable>& table);
+
+    /**
+     * @brief Останавливает поток проверки.
+     */
+    void stop();
+
+private:
+    /**
+     * @struct Target
+     * @brief Наблюдаемый поток измерений.
+     */
+    struct Target {
+        std::shared_ptr<ChannelHealth> health; ///< Сведения о работе потока
+        std::weak_ptr<IChannel> channel; ///< Канал (для канала с собственным потоком)
+        std::weak_ptr<ChannelTable> table; ///< Таблица (для потока таблицы)
+        bool stalled = false; ///< Поток считается зависшим
+        int64_t stalled_since_ns = 0; ///< Просроченный срок, с которого идет зависание (нс)
+        ChannelStateManager::ChannelState prior_state = ChannelStateManager::ChannelState::Measure; ///< Состояние канала до зависания
+        std::vector<ChannelTable::ChannelID> failed_ids; ///< Каналы таблицы, переведенные в error_state
+    };
+
+    /**
+     * @brief Основной цикл потока проверки.
+     */
+    void run();
+
+    /**
+     * @brief Проверяет все наблюдаемые потоки.
+     * @param now_ns Текущее время (нс, MyTools::monotonic_ns()).
+     */
+    void check(int64_t now_ns);
+
+    /**
+     * @brief Переводит каналы зависшего потока в error_state.
+     * @return false, если объект наблюдения уже уничтожен.
+     */
+    bool fail(Target& target, int64_t now_ns, int64_t overdue_ns);
+
+    /**
+     * @brief Восстанавливает каналы потока, возобновившего работу.
+     */
+    void recover(Target& target, int64_t now_ns);
+
+    std::mutex mutex; ///< Мьютекс списка наблюдаемых потоков
+    std::condition_variable stop_cond_var; ///< Прерываемая пауза между проверками
+    bool stopping = false; ///< Флаг остановки
+    std::vector<Target> targets; ///< Наблюдаемые потоки
+    std::thread watchdog_thread; ///< Поток проверки
+};
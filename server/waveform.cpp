@@ -0,0 +1,365 @@
+#include "waveform.h"
+#include "config.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+/**
+ * @brief Конструктор. Емкость истории берется из конфигурации.
+ */
+ChannelWaveform::ChannelWaveform() : ChannelWaveform(MyConfig::DefaultConfig::waveform_history_capacity) {}
+
+/**
+ * @brief Конструктор.
+ *
+ * История начинается с участка диапазона по умолчанию.
+ *
+ * @param history_capacity Количество хранимых значений.
+ */
+ChannelWaveform::ChannelWaveform(size_t history_capacity)
+    : capacity(std::max<size_t>(history_capacity, 1)), timestamps(capacity) {
+    const RangeManager::RangeID range = MyConfig::DefaultConfig::range;
+    segments.push_back({0, range, SampleQuantizer(RangeManager::get_range(range))});
+    set_wide(segments.back().quantizer.is_wide());
+}
+
+/**
+ * @brief Добавляет значение в историю.
+ *
+ * Самое старое значение перезаписывается. Кэш корзин здесь не трогается,
+ * чтобы не задерживать поток измерений.
+ */
+void ChannelWaveform::add_sample(int64_t timestamp_ns, float value, RangeManager::RangeID range) {
+    add_samples(&timestamp_ns, &value, 1, range);
+}
+
+/**
+ * @brief Добавляет блок значений в историю.
+ *
+ * Блок кодируется в кольцо не более чем двумя кусками под одним захватом мьютекса.
+ * Если блок длиннее истории, сохраняется только его конец.
+ */
+void ChannelWaveform::add_samples(const int64_t* timestamps_ns, const float* values, size_t count,
+                                  RangeManager::RangeID range) {
+    std::lock_guard<InstrumentedMutex> lock(history_mutex);
+    if (count > capacity) {
+        timestamps_ns += count - capacity;
+        values += count - capacity;
+        total += count - capacity;
+        count = capacity;
+    }
+    switch_range(range);
+    const SampleQuantizer& quantizer = segments.back().quantizer;
+    size_t done = 0;
+    while (done != count) {
+        const size_t slot = static_cast<size_t>(total % capacity);
+        const size_t chunk = std::min(count - done, capacity - slot);
+        std::copy(timestamps_ns + done, timestamps_ns + done + chunk, timestamps.begin() + slot);
+        if (wide) {
+            for (size_t i = 0; i != chunk; ++i) {
+                wide_codes[slot + i] = quantizer.encode(values[done + i]);
+            }
+        } else {
+            for (size_t i = 0; i != chunk; ++i) {
+                narrow_codes[slot + i] = static_cast<int16_t>(quantizer.encode(values[done + i]));
+            }
+        }
+        total += chunk;
+        done += chunk;
+    }
+    prune_segments();
+}
+
+/**
+ * @brief Начинает новый участок истории, если диапазон сменился.
+ *
+ * Кольцо расширяется до int32, если новому диапазону не хватает int16.
+ * Вызывается под history_mutex.
+ */
+void ChannelWaveform::switch_range(RangeManager::RangeID range) {
+    if (segments.back().range == range) {
+        return;
+    }
+    Segment segment{total, range, SampleQuantizer(RangeManager::get_range(range))};
+    if (segments.back().first_sequence == total) {
+        segments.back() = segment; // Прежний участок пуст
+    } else {
+        segments.push_back(segment);
+    }
+    if (segment.quantizer.is_wide()) {
+        set_wide(true);
+    }
+}
+
+/**
+ * @brief Меняет разрядность кольца кодов.
+ *
+ * Коды переносятся без изменений: коды участков int16 помещаются в оба кольца.
+ * Вызывается под history_mutex.
+ */
+void ChannelWaveform::set_wide(bool new_wide) {
+    if (new_wide == wide && (wide ? !wide_codes.empty() : !narrow_codes.empty())) {
+        return;
+    }
+    if (new_wide) {
+        wide_codes.assign(capacity, 0);
+        std::copy(narrow_codes.begin(), narrow_codes.end(), wide_codes.begin());
+        std::vector<int16_t>().swap(narrow_codes);
+    } else {
+        narrow_codes.assign(capacity, 0);
+        std::transform(wide_codes.begin(), wide_codes.end(), narrow_codes.begin(),
+                       [](int32_t code) { return static_cast<int16_t>(code); });
+        std::vector<int32_t>().swap(wide_codes);
+    }
+    wide = new_wide;
+}
+
+/**
+ * @brief Удаляет участки, полностью вытесненные из истории.
+ *
+ * Когда вытеснен последний участок, которому был нужен int32, кольцо
+ * возвращается к int16. Вызывается под history_mutex.
+ */
+void ChannelWaveform::prune_segments() {
+    const uint64_t first = first_available();
+    if (segments.size() < 2 || segments[1].first_sequence > first) {
+        return;
+    }
+    while (segments.size() > 1 && segments[1].first_sequence <= first) {
+        segments.pop_front();
+    }
+    if (wide && std::none_of(segments.begin(), segments.end(),
+                             [](const Segment& segment) { return segment.quantizer.is_wide(); })) {
+        set_wide(false);
+    }
+}
+
+/**
+ * @brief Перебирает значения истории [from, to) с их номерами.
+ *
+ * Участки перебираются по порядку, поэтому поиск участка не повторяется
+ * для каждого значения. Вызывается под history_mutex.
+ */
+template <typename Callback>
+void ChannelWaveform::for_each_value(uint64_t from, uint64_t to, Callback&& callback) const {
+    size_t segment_index = 0;
+    for (uint64_t seq = from; seq < to; ++seq) {
+        while (segment_index + 1 < segments.size() && segments[segment_index + 1].first_sequence <= seq) {
+            ++segment_index;
+        }
+        const size_t slot = static_cast<size_t>(seq % capacity);
+        const int32_t code = wide ? wide_codes[slot] : narrow_codes[slot];
+        callback(seq, slot, segments[segment_index].quantizer.decode(code));
+    }
+}
+
+/**
+ * @brief Дописывает значения, добавленные после заданного номера.
+ *
+ * Значения декодируются под мьютексом истории до конца участка, в который
+ * попадает sequence.
+ */
+uint64_t ChannelWaveform::read_since(uint64_t& sequence, std::vector<int64_t>& timestamps_ns, std::vector<float>& values,
+                                     int& precision) {
+    std::lock_guard<InstrumentedMutex> lock(history_mutex);
+    const uint64_t first = first_available();
+    uint64_t lost = 0;
+    if (sequence < first) {
+        lost = first - sequence;
+        sequence = first;
+    }
+
+    // Читаем до конца участка, в который попадает sequence
+    size_t segment_index = 0;
+    while (segment_index + 1 < segments.size() && segments[segment_index + 1].first_sequence <= sequence) {
+        ++segment_index;
+    }
+    const uint64_t end = segment_index + 1 < segments.size() ? segments[segment_index + 1].first_sequence : total;
+    precision = segments[segment_index].quantizer.get_precision();
+    for_each_value(sequence, end, [&](uint64_t, size_t slot, float value) {
+        timestamps_ns.push_back(timestamps[slot]);
+        values.push_back(value);
+    });
+    sequence = std::max(sequence, end);
+    return lost;
+}
+
+/**
+ * @brief Разбирает способ прореживания.
+ */
+ChannelWaveform::Mode ChannelWaveform::parse_mode(const std::string& text) {
+    if (text == "minmax") return Mode::MinMax;
+    if (text == "lttb") return Mode::Lttb;
+    throw std::invalid_argument("Unknown waveform mode: " + text);
+}
+
+/**
+ * @brief Возвращает прореженную осциллограмму за интервал.
+ *
+ * Для min-max интервал делится на points/2 - 1 корзин (по две точки на корзину).
+ * Для LTTB сначала выполняется min-max отбор с запасом (waveform_lttb_preselection
+ * кандидатов на точку), затем LTTB сокращает кандидатов до points.
+ */
+std::vector<WaveformPoint> ChannelWaveform::get_waveform(int64_t t0_ns, int64_t t1_ns, size_t points, Mode mode) {
+    if (t1_ns <= t0_ns) {
+        throw std::invalid_argument("Empty time interval");
+    }
+    if (points < 4 || points > MyConfig::DefaultConfig::waveform_max_points) {
+        throw std::invalid_argument("Invalid number of points: " + std::to_string(points));
+    }
+
+    size_t candidates = points;
+    if (mode == Mode::Lttb) {
+        candidates = points * MyConfig::DefaultConfig::waveform_lttb_preselection;
+    }
+    // Невыровненный интервал задевает на одну корзину больше
+    const int64_t bucket_count = static_cast<int64_t>(candidates / 2 - 1);
+    const int64_t span = t1_ns - t0_ns;
+    const int64_t bucket_width = std::max<int64_t>(1, (span + bucket_count - 1) / bucket_count);
+
+    std::vector<WaveformPoint> result;
+    {
+        std::lock_guard<InstrumentedMutex> lock(cache_mutex);
+        result = collect(get_cache(bucket_width), bucket_width, t0_ns, t1_ns);
+    }
+    if (mode == Mode::Lttb) {
+        result = lttb(result, points);
+    }
+    return result;
+}
+
+/**
+ * @brief Возвращает кэш корзин заданной ширины, дополненный новыми значениями.
+ *
+ * Под мьютексом истории копируются только значения, появившиеся после прошлого
+ * обращения к этому кэшу; разнесение по корзинам выполняется уже без него.
+ * Корзины старше истории удаляются, а кэши вытесняются по давности использования,
+ * так что память ограничена емкостью истории и числом кэшей.
+ * Вызывается под cache_mutex.
+ */
+ChannelWaveform::BucketCache& ChannelWaveform::get_cache(int64_t bucket_width) {
+    auto found = caches.find(bucket_width);
+    if (found == caches.end()) {
+        if (caches.size() >= MyConfig::DefaultConfig::waveform_cache_entries) {
+            auto oldest = std::min_element(caches.begin(), caches.end(),
+                [](const auto& a, const auto& b) { return a.second.last_used < b.second.last_used; });
+            caches.erase(oldest);
+        }
+        found = caches.emplace(bucket_width, BucketCache()).first;
+    }
+    BucketCache& cache = found->second;
+    cache.last_used = ++use_counter;
+
+    int64_t oldest_timestamp = 0;
+    pending.clear();
+    {
+        std::lock_guard<InstrumentedMutex> lock(history_mutex);
+        const uint64_t first = first_available();
+        if (total != first) {
+            oldest_timestamp = timestamps[first % capacity];
+        }
+        for_each_value(std::max(cache.next_sequence, first), total, [&](uint64_t, size_t slot, float value) {
+            pending.push_back({timestamps[slot], value});
+        });
+        cache.next_sequence = total;
+    }
+
+    for (const WaveformPoint& point : pending) {
+        auto inserted = cache.buckets.emplace(point.timestamp_ns / bucket_width, Bucket{point, point});
+        if (!inserted.second) {
+            Bucket& bucket = inserted.first->second;
+            if (point.value < bucket.min.value) bucket.min = point;
+            if (point.value > bucket.max.value) bucket.max = point;
+        }
+    }
+
+    cache.buckets.erase(cache.buckets.begin(), cache.buckets.lower_bound(oldest_timestamp / bucket_width));
+    return cache;
+}
+
+/**
+ * @brief Собирает min-max точки корзин интервала.
+ *
+ * Минимум и максимум корзины выдаются в порядке их времени; если это одна
+ * и та же точка, она выдается один раз.
+ */
+std::vector<WaveformPoint> ChannelWaveform::collect(const BucketCache& cache, int64_t bucket_width,
+                                                    int64_t t0_ns, int64_t t1_ns) {
+    std::vector<WaveformPoint> result;
+    auto begin = cache.buckets.lower_bound(t0_ns / bucket_width);
+    auto end = cache.buckets.upper_bound(t1_ns / bucket_width);
+    for (auto it = begin; it != end; ++it) {
+        const Bucket& bucket = it->second;
+        const WaveformPoint& first = bucket.min.timestamp_ns <= bucket.max.timestamp_ns ? bucket.min : bucket.max;
+        const WaveformPoint& second = bucket.min.timestamp_ns <= bucket.max.timestamp_ns ? bucket.max : bucket.min;
+        result.push_back(first);
+        if (second.timestamp_ns != first.timestamp_ns) {
+            result.push_back(second);
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief Прореживает точки алгоритмом LTTB.
+ *
+ * Первая и последняя точки сохраняются. Остальные делятся на threshold - 2
+ * групп; из каждой выбирается точка, образующая треугольник наибольшей площади
+ * с выбранной точкой предыдущей группы и средней точкой следующей.
+ */
+std::vector<WaveformPoint> ChannelWaveform::lttb(const std::vector<WaveformPoint>& data, size_t threshold) {
+    const size_t n = data.size();
+    if (threshold >= n || threshold < 3) {
+        return data;
+    }
+
+    // Время считается от первой точки, чтобы не терять точность в double
+    const int64_t origin = data.front().timestamp_ns;
+    auto x = [&](size_t i) { return static_cast<double>(data[i].timestamp_ns - origin); };
+    auto y = [&](size_t i) { return static_cast<double>(data[i].value); };
+
+    std::vector<WaveformPoint> sampled;
+    sampled.reserve(threshold);
+    sampled.push_back(data.front());
+
+    const double every = static_cast<double>(n - 2) / static_cast<double>(threshold - 2);
+    size_t selected = 0;
+    for (size_t i = 0; i != threshold - 2; ++i) {
+        // Средняя точка следующей группы (для последней группы - последняя точка)
+        size_t avg_begin = static_cast<size_t>(std::floor((i + 1) * every)) + 1;
+        size_t avg_end = std::min(static_cast<size_t>(std::floor((i + 2) * every)) + 1, n);
+        double avg_x = 0.0, avg_y = 0.0;
+        for (size_t j = avg_begin; j < avg_end; ++j) {
+            avg_x += x(j);
+            avg_y += y(j);
+        }
+        const size_t avg_count = avg_end > avg_begin ? avg_end - avg_begin : 0;
+        if (avg_count) {
+            avg_x /= static_cast<double>(avg_count);
+            avg_y /= static_cast<double>(avg_count);
+        } else {
+            avg_x = x(n - 1);
+            avg_y = y(n - 1);
+        }
+
+        // Точка текущей группы с наибольшей площадью треугольника
+        const size_t range_begin = static_cast<size_t>(std::floor(i * every)) + 1;
+        const size_t range_end = std::min(static_cast<size_t>(std::floor((i + 1) * every)) + 1, n - 1);
+        double max_area = -1.0;
+        size_t next_selected = range_begin;
+        for (size_t j = range_begin; j < range_end; ++j) {
+            double area = std::fabs((x(selected) - avg_x) * (y(j) - y(selected))
+                                    - (x(selected) - x(j)) * (avg_y - y(selected)));
+            if (area > max_area) {
+                max_area = area;
+                next_selected = j;
+            }
+        }
+        sampled.push_back(data[next_selected]);
+        selected = next_selected;
+    }
+
+    sampled.push_back(data.back());
+    return sampled;
+}
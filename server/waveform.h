@@ -0,0 +1,205 @@
+#pragma once
+
+#include "ranges.h"
+#include "sample_quantizer.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <deque>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+#include <cstddef>
+#include "lock_stats.h"
+
+/**
+ * @struct WaveformPoint
+ * @brief Точка осциллограммы.
+ */
+struct WaveformPoint {
+    int64_t timestamp_ns; ///< Время значения (нс)
+    float value; ///< Значение
+};
+
+/**
+ * @class ChannelWaveform
+ * @brief История значений канала и прореживание ее для отображения.
+ *
+ * Последние значения канала хранятся в кольцевом буфере фиксированной емкости
+ * в виде целых кодов с точностью диапазона канала (SampleQuantizer): int16
+ * для диапазонов, которые в него помещаются, иначе int32. При смене диапазона
+ * прежние значения не перекодируются: кольцо делится на участки со своим
+ * диапазоном.
+ * По запросу история прореживается до заданного числа точек одним из способов:
+ * - min-max: в каждой корзине времени сохраняются минимум и максимум;
+ * - LTTB (Largest-Triangle-Three-Buckets) поверх предварительного min-max отбора.
+ *
+ * Корзины выровнены по абсолютному времени и кэшируются по ширине корзины, поэтому
+ * повторный запрос того же окна с тем же разрешением обрабатывает только новые
+ * значения, а не всю историю.
+ */
+class ChannelWaveform {
+public:
+    /**
+     * @enum Mode
+     * @brief Способ прореживания.
+     */
+    enum class Mode {
+        MinMax, ///< Минимум и максимум в каждой корзине
+        Lttb ///< Largest-Triangle-Three-Buckets
+    };
+
+    /**
+     * @brief Конструктор. Емкость истории берется из конфигурации.
+     */
+    ChannelWaveform();
+
+    /**
+     * @brief Конструктор.
+     * @param history_capacity Количество хранимых значений.
+     */
+    explicit ChannelWaveform(size_t history_capacity);
+
+    /**
+     * @brief Добавляет значение в историю.
+     * @param timestamp_ns Время значения (нс).
+     * @param value Значение.
+     * @param range Диапазон канала, в котором получено значение.
+     */
+    void add_sample(int64_t timestamp_ns, float value, RangeManager::RangeID range);
+
+    /**
+     * @brief Добавляет блок значений в историю.
+     * @param timestamps_ns Времена значений (нс).
+     * @param values Значения.
+     * @param count Количество значений.
+     * @param range Диапазон канала, в котором получены значения.
+     */
+    void add_samples(const int64_t* timestamps_ns, const float* values, size_t count, RangeManager::RangeID range);
+
+    /**
+     * @brief Возвращает прореженную осциллограмму за интервал.
+     *
+     * Крайние корзины выровнены по сетке и могут включать значения чуть за
+     * пределами интервала.
+     *
+     * @param t0_ns Начало интервала (нс).
+     * @param t1_ns Конец интервала (нс).
+     * @param points Максимальное количество точек.
+     * @param mode Способ прореживания.
+     * @return Точки в порядке времени.
+     * @throws std::invalid_argument Если интервал пуст или количество точек некорректно.
+     */
+    std::vector<WaveformPoint> get_waveform(int64_t t0_ns, int64_t t1_ns, size_t points, Mode mode);
+
+    /**
+     * @brief Дописывает значения, добавленные после заданного номера.
+     *
+     * Используется для выгрузки истории (например, в хранилище) без повторов.
+     * За один вызов читаются значения только одного диапазона; чтобы дочитать
+     * историю, вызов повторяется, пока он что-то дописывает.
+     *
+     * @param sequence Номер первого непрочитанного значения; продвигается за прочитанные.
+     * @param timestamps_ns Буфер времен (дописывается).
+     * @param values Буфер значений (дописывается).
+     * @param precision Точность диапазона прочитанных значений.
+     * @return Количество значений, вытесненных из истории до прочтения.
+     */
+    uint64_t read_since(uint64_t& sequence, std::vector<int64_t>& timestamps_ns, std::vector<float>& values, int& precision);
+
+    /**
+     * @brief Разбирает способ прореживания ("minmax" или "lttb").
+     * @throws std::invalid_argument Если способ неизвестен.
+     */
+    static Mode parse_mode(const std::string& text);
+
+private:
+    /**
+     * @struct Bucket
+     * @brief Минимум и максимум значений корзины.
+     */
+    struct Bucket {
+        WaveformPoint min; ///< Точка с минимальным значением
+        WaveformPoint max; ///< Точка с максимальным значением
+    };
+
+    /**
+     * @struct Segment
+     * @brief Участок истории, записанный в одном диапазоне.
+     */
+    struct Segment {
+        uint64_t first_sequence; ///< Номер первого значения участка
+        RangeManager::RangeID range; ///< Диапазон
+        SampleQuantizer quantizer; ///< Кодирование значений диапазона
+    };
+
+    /**
+     * @brief Начинает новый участок истории, если диапазон сменился.
+     */
+    void switch_range(RangeManager::RangeID range);
+
+    /**
+     * @brief Меняет разрядность кольца кодов.
+     */
+    void set_wide(bool new_wide);
+
+    /**
+     * @brief Удаляет участки, полностью вытесненные из истории.
+     */
+    void prune_segments();
+
+    /**
+     * @brief Номер первого значения, еще хранящегося в истории.
+     */
+    uint64_t first_available() const { return total > capacity ? total - capacity : 0; }
+
+    /**
+     * @brief Перебирает значения истории [from, to) с их номерами.
+     * @param callback Вызывается как callback(номер, слот, значение).
+     */
+    template <typename Callback>
+    void for_each_value(uint64_t from, uint64_t to, Callback&& callback) const;
+
+    /**
+     * @struct BucketCache
+     * @brief Корзины одной ширины, накопленные по истории.
+     */
+    struct BucketCache {
+        std::map<int64_t, Bucket> buckets; ///< Корзины по номеру интервала
+        uint64_t next_sequence = 0; ///< Номер первого значения, еще не разнесенного по корзинам
+        uint64_t last_used = 0; ///< Момент последнего использования (для вытеснения)
+    };
+
+    /**
+     * @brief Возвращает кэш корзин заданной ширины, дополненный новыми значениями.
+     */
+    BucketCache& get_cache(int64_t bucket_width);
+
+    /**
+     * @brief Собирает min-max точки корзин интервала.
+     */
+    static std::vector<WaveformPoint> collect(const BucketCache& cache, int64_t bucket_width, int64_t t0_ns, int64_t t1_ns);
+
+    /**
+     * @brief Прореживает точки алгоритмом LTTB.
+     * @param data Точки в порядке времени.
+     * @param threshold Количество точек результата.
+     */
+    static std::vector<WaveformPoint> lttb(const std::vector<WaveformPoint>& data, size_t threshold);
+
+    const size_t capacity; ///< Емкость истории
+
+    InstrumentedMutex history_mutex{"waveform.history"}; ///< Мьютекс истории (пишет поток измерений)
+    std::vector<int64_t> timestamps; ///< Кольцо времен значений
+    std::vector<int16_t> narrow_codes; ///< Кольцо кодов значений, если все участки помещаются в int16
+    std::vector<int32_t> wide_codes; ///< Кольцо кодов значений, если какому-то участку нужен int32
+    bool wide = false; ///< Используется кольцо int32
+    std::deque<Segment> segments; ///< Участки истории по диапазонам (последний - текущий)
+    uint64_t total = 0; ///< Количество значений, добавленных за все время
+
+    InstrumentedMutex cache_mutex{"waveform.cache"}; ///< Мьютекс кэша корзин (читают команды)
+    std::unordered_map<int64_t, BucketCache> caches; ///< Кэши по ширине корзины
+    uint64_t use_counter = 0; ///< Счетчик обращений к кэшу
+    std::vector<WaveformPoint> pending; ///< Буфер новых значений для разнесения по корзинам
+};